@@ -0,0 +1,364 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+
+/**
+ *
+ * Partition quality analyser. Reports, for a partitioning and without
+ * running the graph servers, what their data loaders will build and what one
+ * epoch will cost:
+ *     - local vertices, in / out edges, src / dst ghosts and boundary
+ *       vertices of every partition (localVtxCnt, localInEdgeCnt,
+ *       localOutEdgeCnt, srcGhostCnt, dstGhostCnt of Graph);
+ *     - the ghost rows and bytes every partition sends and receives per
+ *       epoch for a layer config, GNN and ghost codecs;
+ *     - the replication factor, and the max / avg imbalances of the above,
+ *       which is what the slowest node makes everybody wait for at every
+ *       layer barrier.
+ *
+ * Edges are counted as DataLoader does: self edges are dropped, and an
+ * undirected graph has every edge in both directions. Partition p sends a
+ * vertex to partition q in the forward scatter if the vertex has an out edge
+ * into q (it is a src ghost of q), and in the backward scatter if it has an
+ * in edge from q (it is a dst ghost of q).
+ *
+ */
+
+
+typedef unsigned VertexType;
+
+
+/** Binary snap file header struct. */
+struct BSHeaderType {
+    int sizeOfVertexType;
+    VertexType numVertices;
+    unsigned long long numEdges;
+};
+
+
+/** Ghost row codecs, named as the graph servers' --fwdghostcodec / --bwdghostcodec. */
+static const char *CODEC_NAMES[] = { "fp32", "fp16", "bf16", "int8" };
+
+/** Bytes of an encoded ghost row, as ghostRowSize() in engine/ghost_codec.cpp. */
+static unsigned rowBytes(unsigned codec, unsigned featDim) {
+    switch (codec) {
+        case 1:
+        case 2:
+            return 2 * featDim;
+        case 3:
+            return 4 + featDim;
+        default:
+            return 4 * featDim;
+    }
+}
+
+static int parseCodec(const std::string &name) {
+    for (unsigned i = 0; i < sizeof(CODEC_NAMES) / sizeof(CODEC_NAMES[0]); ++i) {
+        if (name == CODEC_NAMES[i])
+            return i;
+    }
+    return -1;
+}
+
+
+static std::vector<short> readParts(const std::string &partsFile) {
+    std::ifstream infile(partsFile.c_str());
+    if (!infile.good()) {
+        std::cerr << "Cannot open partition file: " << partsFile << " [Reason: " << std::strerror(errno) << "]" << std::endl;
+        exit(-1);
+    }
+    std::vector<short> parts;
+    std::string line;
+    while (std::getline(infile, line)) {
+        if (line.size() == 0 || (line[0] < '0' || line[0] > '9'))
+            continue;
+        std::istringstream iss(line);
+        short partId;
+        if (!(iss >> partId))
+            break;
+        parts.push_back(partId);
+    }
+    return parts;
+}
+
+static std::vector<unsigned> readLayerConfig(const std::string &layerFile) {
+    std::ifstream infile(layerFile.c_str());
+    if (!infile.good()) {
+        std::cerr << "Cannot open layer config file: " << layerFile << " [Reason: " << std::strerror(errno) << "]" << std::endl;
+        exit(-1);
+    }
+    std::vector<unsigned> layerConfig;
+    std::string line;
+    while (std::getline(infile, line)) {
+        if (line.length() > 0)
+            layerConfig.push_back(std::stoul(line));
+    }
+    return layerConfig;
+}
+
+
+/** What Graph holds on one partition, and its scatter traffic. */
+struct PartStats {
+    unsigned long long vertices = 0;
+    unsigned long long inEdges = 0;
+    unsigned long long outEdges = 0;
+    unsigned long long srcGhosts = 0;
+    unsigned long long dstGhosts = 0;
+    unsigned long long boundary = 0;
+    unsigned long long fwdSendRows = 0;     // sum over peers of |forwardGhostsList|
+    unsigned long long bwdSendRows = 0;     // sum over peers of |backwardGhostsList|
+    unsigned long long sendBytes = 0;
+    unsigned long long recvBytes = 0;
+};
+
+
+class PartAnalyser {
+public:
+    PartAnalyser(const std::vector<short> &_parts, unsigned _numParts)
+        : parts(_parts), numParts(_numParts), maskWords((_numParts + 63) / 64),
+          srcMasks(parts.size() * maskWords, 0), dstMasks(parts.size() * maskWords, 0),
+          stats(_numParts) {}
+
+    void readEdges(const std::string &edgesFile, bool undirected);
+    void countGhosts();
+    void scatterBytes(const std::vector<unsigned> &fwdDims, const std::vector<unsigned> &bwdDims,
+                      unsigned fwdCodec, unsigned bwdCodec);
+
+    const std::vector<PartStats> &getStats() const { return stats; }
+
+private:
+    void edge(VertexType from, VertexType to) {
+        short pf = parts[from], pt = parts[to];
+        ++stats[pf].outEdges;
+        ++stats[pt].inEdges;
+        if (pf != pt) {
+            srcMasks[(size_t) from * maskWords + pt / 64] |= 1ULL << (pt % 64);
+            dstMasks[(size_t) to * maskWords + pf / 64] |= 1ULL << (pf % 64);
+        }
+    }
+    /** Add one per set bit of a mask to counts[partition]. */
+    void forEachBit(const unsigned long long *mask, std::vector<unsigned long long> &counts) {
+        for (unsigned w = 0; w < maskWords; ++w) {
+            unsigned long long bits = mask[w];
+            while (bits) {
+                ++counts[w * 64 + __builtin_ctzll(bits)];
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    const std::vector<short> &parts;
+    unsigned numParts;
+    unsigned maskWords;
+    // Partitions a vertex is a src ghost / dst ghost of
+    std::vector<unsigned long long> srcMasks;
+    std::vector<unsigned long long> dstMasks;
+    std::vector<PartStats> stats;
+};
+
+
+void PartAnalyser::readEdges(const std::string &edgesFile, bool undirected) {
+    std::ifstream infile(edgesFile.c_str(), std::ios::binary);
+    if (!infile.good()) {
+        std::cerr << "Cannot open edges file: " << edgesFile << " [Reason: " << std::strerror(errno) << "]" << std::endl;
+        exit(-1);
+    }
+    BSHeaderType bsHeader;
+    infile.read(reinterpret_cast<char *>(&bsHeader), sizeof(bsHeader));
+    assert(bsHeader.sizeOfVertexType == sizeof(VertexType));
+
+    std::vector<VertexType> buf(1 << 21);
+    while (infile.read(reinterpret_cast<char *>(buf.data()), buf.size() * sizeof(VertexType)) ||
+           infile.gcount() > 0) {
+        size_t cnt = infile.gcount() / (2 * sizeof(VertexType));
+        for (size_t i = 0; i < cnt; ++i) {
+            VertexType src = buf[2 * i], dst = buf[2 * i + 1];
+            if (src == dst)
+                continue;
+            if (src >= parts.size() || dst >= parts.size()) {
+                std::cerr << "Edge (" << src << ", " << dst << ") out of the partitioned vertices" << std::endl;
+                exit(-1);
+            }
+            edge(src, dst);
+            if (undirected)
+                edge(dst, src);
+        }
+    }
+}
+
+void PartAnalyser::countGhosts() {
+    std::vector<unsigned long long> srcGhosts(numParts, 0), dstGhosts(numParts, 0);
+    for (size_t v = 0; v < parts.size(); ++v) {
+        PartStats &ps = stats[parts[v]];
+        ++ps.vertices;
+        const unsigned long long *srcMask = &srcMasks[v * maskWords];
+        const unsigned long long *dstMask = &dstMasks[v * maskWords];
+        unsigned fwdPeers = 0, bwdPeers = 0;
+        for (unsigned w = 0; w < maskWords; ++w) {
+            fwdPeers += __builtin_popcountll(srcMask[w]);
+            bwdPeers += __builtin_popcountll(dstMask[w]);
+        }
+        ps.fwdSendRows += fwdPeers;
+        ps.bwdSendRows += bwdPeers;
+        if (fwdPeers + bwdPeers > 0)
+            ++ps.boundary;
+        forEachBit(srcMask, srcGhosts);
+        forEachBit(dstMask, dstGhosts);
+    }
+    for (unsigned p = 0; p < numParts; ++p) {
+        stats[p].srcGhosts = srcGhosts[p];
+        stats[p].dstGhosts = dstGhosts[p];
+    }
+}
+
+/**
+ *
+ * Rows of the forward scatter go to src ghosts, those of the backward
+ * scatter to dst ghosts; one scatter per entry of the dims.
+ *
+ */
+void PartAnalyser::scatterBytes(const std::vector<unsigned> &fwdDims, const std::vector<unsigned> &bwdDims,
+                                unsigned fwdCodec, unsigned bwdCodec) {
+    for (PartStats &ps : stats) {
+        for (unsigned dim : fwdDims) {
+            ps.sendBytes += ps.fwdSendRows * rowBytes(fwdCodec, dim);
+            ps.recvBytes += ps.srcGhosts * rowBytes(fwdCodec, dim);
+        }
+        for (unsigned dim : bwdDims) {
+            ps.sendBytes += ps.bwdSendRows * rowBytes(bwdCodec, dim);
+            ps.recvBytes += ps.dstGhosts * rowBytes(bwdCodec, dim);
+        }
+    }
+}
+
+
+static void printImbalance(const char *name, const std::vector<PartStats> &stats,
+                           unsigned long long PartStats::*field) {
+    unsigned long long maxVal = 0, sum = 0;
+    for (const PartStats &ps : stats) {
+        maxVal = std::max(maxVal, ps.*field);
+        sum += ps.*field;
+    }
+    double avg = (double) sum / stats.size();
+    printf("  %-18s max %14llu  avg %16.1f  max/avg %.3f\n", name, maxVal, avg, avg > 0 ? maxVal / avg : 1.0);
+}
+
+
+/**
+ *
+ * Main entrance.
+ *
+ */
+int
+main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cout << "Usage: " << argv[0] << " <PartitionDir> <NumPartitions> <Undirected? (0/1)>"
+                  << " [--layerfile=<LayerConfigFile>] [--gnn=gcn|gat]"
+                  << " [--fwdghostcodec=fp32|fp16|bf16|int8] [--bwdghostcodec=fp32|fp16|bf16|int8]" << std::endl;
+        return -1;
+    }
+
+    std::string partsDir = argv[1];
+    unsigned numParts = std::atoi(argv[2]);
+    bool undirected = std::atoi(argv[3]) != 0;
+    std::string layerFile;
+    bool gat = false;
+    int fwdCodec = 0, bwdCodec = 0;
+    for (int i = 4; i < argc; ++i) {
+        if (strncmp("--layerfile=", argv[i], 12) == 0)
+            layerFile = argv[i] + 12;
+        else if (strcmp("--gnn=gat", argv[i]) == 0)
+            gat = true;
+        else if (strcmp("--gnn=gcn", argv[i]) == 0)
+            gat = false;
+        else if (strncmp("--fwdghostcodec=", argv[i], 16) == 0)
+            fwdCodec = parseCodec(argv[i] + 16);
+        else if (strncmp("--bwdghostcodec=", argv[i], 16) == 0)
+            bwdCodec = parseCodec(argv[i] + 16);
+        else {
+            std::cout << "Unknown option " << argv[i] << std::endl;
+            return -1;
+        }
+    }
+    if (numParts == 0 || fwdCodec < 0 || bwdCodec < 0) {
+        std::cout << "Invalid number of partitions or ghost codec" << std::endl;
+        return -1;
+    }
+
+    std::vector<short> parts = readParts(partsDir + "/graph.bsnap.parts");
+    for (short p : parts) {
+        if (p < 0 || (unsigned) p >= numParts) {
+            std::cerr << "Partition ID " << p << " out of range" << std::endl;
+            return -1;
+        }
+    }
+
+    // Dims of the scattered rows per epoch. GCN scatters the hidden layers'
+    // features forward and their gradients backward (layer 0 ghosts come
+    // from the features shards); GAT scatters every layer's output.
+    std::vector<unsigned> fwdDims, bwdDims;
+    if (!layerFile.empty()) {
+        std::vector<unsigned> layerConfig = readLayerConfig(layerFile);
+        if (layerConfig.size() < 2) {
+            std::cerr << "Layer config needs at least 2 dims" << std::endl;
+            return -1;
+        }
+        unsigned numLayers = layerConfig.size() - 1;
+        unsigned lastLayer = gat ? numLayers : numLayers - 1;
+        for (unsigned l = 1; l <= lastLayer; ++l) {
+            fwdDims.push_back(layerConfig[l]);
+            bwdDims.push_back(layerConfig[l]);
+        }
+    }
+
+    PartAnalyser analyser(parts, numParts);
+    analyser.readEdges(partsDir + "/graph.bsnap.edges", undirected);
+    analyser.countGhosts();
+    analyser.scatterBytes(fwdDims, bwdDims, fwdCodec, bwdCodec);
+    const std::vector<PartStats> &stats = analyser.getStats();
+
+    printf("%u partitions, %zu vertices\n\n", numParts, parts.size());
+    printf("%5s %12s %14s %14s %12s %12s %12s %12s %12s", "part", "vertices", "inEdges", "outEdges",
+           "srcGhosts", "dstGhosts", "boundary", "fwdSendRows", "bwdSendRows");
+    if (!layerFile.empty())
+        printf(" %12s %12s", "sendMB/ep", "recvMB/ep");
+    printf("\n");
+    unsigned long long copies = 0;
+    for (unsigned p = 0; p < numParts; ++p) {
+        const PartStats &ps = stats[p];
+        printf("%5u %12llu %14llu %14llu %12llu %12llu %12llu %12llu %12llu", p, ps.vertices, ps.inEdges,
+               ps.outEdges, ps.srcGhosts, ps.dstGhosts, ps.boundary, ps.fwdSendRows, ps.bwdSendRows);
+        if (!layerFile.empty())
+            printf(" %12.2f %12.2f", ps.sendBytes / 1e6, ps.recvBytes / 1e6);
+        printf("\n");
+        copies += ps.vertices + ps.srcGhosts;
+    }
+
+    printf("\nReplication factor (local + src ghost copies per vertex): %.3f\n",
+           parts.empty() ? 0.0 : (double) copies / parts.size());
+    printf("Imbalance:\n");
+    printImbalance("vertices", stats, &PartStats::vertices);
+    printImbalance("inEdges", stats, &PartStats::inEdges);
+    printImbalance("srcGhosts", stats, &PartStats::srcGhosts);
+    printImbalance("dstGhosts", stats, &PartStats::dstGhosts);
+    if (!layerFile.empty()) {
+        printImbalance("sendBytes/epoch", stats, &PartStats::sendBytes);
+        printImbalance("recvBytes/epoch", stats, &PartStats::recvBytes);
+        unsigned long long total = 0;
+        for (const PartStats &ps : stats)
+            total += ps.sendBytes;
+        printf("Ghost payload per epoch: %.2f MB (%s forward, %s backward, %s)\n", total / 1e6,
+               CODEC_NAMES[fwdCodec], CODEC_NAMES[bwdCodec], gat ? "GAT" : "GCN");
+    }
+
+    return 0;
+}
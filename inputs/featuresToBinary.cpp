@@ -6,8 +6,8 @@
 #include <cstdio>
 #include <cstring>
 #include <vector>
-#include <boost/algorithm/string/split.hpp>
-#include <boost/algorithm/string/trim.hpp>
+#include <chrono>
+#include "textParse.hpp"
 
 
 using namespace std;
@@ -26,43 +26,67 @@ static FeaturesHeader head;
 // TODO: add header
 
 
+/**
+ *
+ * Parse a piece of the features file: lines not starting with a digit (after
+ * trimming) are skipped, the others are split on ',' / ' ' runs and must have
+ * exactly `numFeautures` values.
+ *
+ */
+static bool
+parsePiece(const char *p, const char *end, std::vector<FeatType> &feats) {
+    feats.clear();
+    while (p < end) {
+        const char *eol = (const char *) memchr(p, '\n', end - p);
+        if (eol == NULL)
+            eol = end;
+        const char *b = p, *e = eol;
+        p = eol + 1;
+
+        trim(b, e);
+        if (b == e || !isDigit(*b))
+            continue;
+
+        unsigned cnt = 0;
+        while (true) {
+            const char *tok = b;
+            while (b < e && *b != ',' && *b != ' ')
+                ++b;
+            float f;
+            if (!parseFloat(tok, b, f)) {
+                std::cerr << "Invalid feature value: " << std::string(tok, b) << std::endl;
+                exit(-1);
+            }
+            feats.push_back(f);
+            ++cnt;
+            if (b == e)
+                break;
+            while (b < e && (*b == ',' || *b == ' '))
+                ++b;
+        }
+        assert(cnt == head.numFeautures);
+    }
+    return true;
+}
+
+
 /**
  *
  * Read in features file, convert into binary representation, and write to a '.bsnap' file.
  * 
  */
 void
-readWriteFile(std::string featuresFileName) {
-    std::ifstream infile(featuresFileName.c_str());
-    if (!infile.good())
-        printf("Cannot open feature file: %s [Reason: %s]\n", featuresFileName.c_str(), std::strerror(errno));
-
-    assert(infile.good());
+readWriteFile(std::string featuresFileName, unsigned numThreads) {
+    MappedText infile(featuresFileName);
 
     std::ofstream bSStream;
     bSStream.open(featuresFileName + ".bsnap", std::ios::binary);
     bSStream.write(reinterpret_cast<char *>(&head), sizeof(FeaturesHeader));
 
-    std::string line;
-    while (!infile.eof()) {
-        std::getline(infile, line);
-        boost::algorithm::trim(line);
-
-        if (line[0] < '0' || line[0] > '9')
-            continue;
-
-        std::vector<std::string> splited_strings;
-        std::vector<FeatType> feature_vec;
-
-        // Split each line into numbers.
-        boost::split(splited_strings, line, boost::is_any_of(", "), boost::token_compress_on);
-        assert(size_t(head.numFeautures) == splited_strings.size());
-
-        for (std::string& substr : splited_strings) {
-            FeatType f = std::stof(substr);
-            bSStream.write(reinterpret_cast<char *>(&f), sizeof(FeatType));
-        }
-    }
+    parseChunks<std::vector<FeatType>>(infile, numThreads, parsePiece,
+        [&](std::vector<FeatType> &feats) {
+            bSStream.write(reinterpret_cast<char *>(feats.data()), feats.size() * sizeof(FeatType));
+        });
 }
 
 
@@ -73,19 +97,24 @@ readWriteFile(std::string featuresFileName) {
  */
 int
 main(int argc, char *argv[]) {
-    if (argc != 3) {
-        std::cout << "Usage: " << argv[0] << " --featuresfile=<FeatureFile> --featuredimension=<FeatureDimension>" << std::endl;
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " --featuresfile=<FeatureFile> --featuredimension=<FeatureDimension> [--threads=<NumThreads>]" << std::endl;
         return -1;
     }
 
     std::string featuresFile;
     bool withheader = false;
+    unsigned numThreads = defaultThreads();
     for (int i = 0; i < argc; ++i) {
         if (strncmp("--featuresfile=", argv[i], 15) == 0)
             featuresFile = argv[i] + 15;
         if (strncmp("--featuredimension=", argv[i], 19) == 0)
             sscanf(argv[i] + 19, "%u", &head.numFeautures);
+        if (strncmp("--threads=", argv[i], 10) == 0)
+            sscanf(argv[i] + 10, "%u", &numThreads);
     }
+    if (numThreads == 0)
+        numThreads = 1;
     std::cout << "Features file: " << featuresFile << std::endl;
     std::cout << "Features size: " << head.numFeautures << std::endl;
 
@@ -96,7 +125,12 @@ main(int argc, char *argv[]) {
         return -1;
     }
 
-    readWriteFile(featuresFile);
+    std::chrono::steady_clock::time_point stt = std::chrono::steady_clock::now();
+    readWriteFile(featuresFile, numThreads);
+
+    struct stat st;
+    stat(featuresFile.c_str(), &st);
+    reportThroughput(st.st_size, std::chrono::duration<double>(std::chrono::steady_clock::now() - stt).count());
 
     return 0;
 }
@@ -0,0 +1,432 @@
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+
+/**
+ *
+ * Synthetic dataset generator for the scaling benchmarks. Writes, under the
+ * output directory, the same layout `prepare` builds in `data/`:
+ *     graph.bsnap                          binary edge list (with header)
+ *     parts_<k>/graph.bsnap.parts          partitioning for <k> graph servers
+ *     parts_<k>/graph.bsnap.edges          -> ../graph.bsnap
+ *     features.bsnap, labels.bsnap         binary features / labels
+ *
+ * The graph is R-MAT with `--rmat=a,b,c` controlling the degree skew, and
+ * planted communities: vertex u belongs to community u % C, and with
+ * probability 1 - `--mixing` an edge stays inside the community of its
+ * source (its destination drawn by R-MAT over the community). Vertex IDs are
+ * then scrambled by a seeded bijection, so neither hubs nor communities are
+ * contiguous ID ranges. Features are a per-community centroid plus uniform
+ * noise, and labels are the community (mod #labels) with `--labelnoise`
+ * uniformly random ones, so there is something to learn.
+ *
+ * Every random number is a hash of (seed, stream, index), so the output only
+ * depends on the arguments, not on the number of threads or the platform's
+ * <random> implementation.
+ *
+ */
+
+
+typedef unsigned VertexType;
+typedef float FeatType;
+
+
+struct BSHeaderType {
+    int sizeOfVertexType;
+    VertexType numVertices;
+    unsigned long long numEdges;
+};
+
+
+/** Edges generated per task. */
+#define GEN_BLOCK_EDGES (1 << 20)
+/** Feature rows generated per task. */
+#define GEN_BLOCK_ROWS (1 << 14)
+
+
+/** Random streams, for independent draws from the same seed. */
+enum Stream { EDGES = 1, SCRAMBLE, CENTROIDS, FEATURES, LABELS };
+
+
+static inline unsigned long long mix64(unsigned long long x) {
+    // splitmix64 finalizer
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/** Counter based generator for the draws of one item of a stream. */
+class ItemRng {
+public:
+    ItemRng(unsigned long long seed, Stream stream, unsigned long long item)
+        : state(mix64(mix64(seed ^ ((unsigned long long) stream << 56)) ^ item)) {}
+
+    unsigned long long next() { state += 0x9e3779b97f4a7c15ULL; return mix64(state); }
+    /** Uniform in [0, 1). */
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+    /** Uniform in [0, n). */
+    unsigned long long below(unsigned long long n) { return (unsigned long long) (uniform() * n); }
+
+private:
+    unsigned long long state;
+};
+
+
+/**
+ *
+ * Seeded bijection on [0, n): odd multiplies, an xor-shift and additions
+ * mod 2^bits, cycle-walked back into range. `backward` inverts `forward`.
+ *
+ */
+class Scramble {
+public:
+    Scramble(unsigned long long _n, unsigned long long seed, bool enabled) : n(_n) {
+        bits = 1;
+        while ((1ULL << bits) < n)
+            ++bits;
+        mask = (1ULL << bits) - 1;
+        shift = (bits + 1) / 2;
+        ItemRng rng(seed, SCRAMBLE, 0);
+        mul1 = enabled ? (rng.next() | 1) : 1;
+        mul2 = enabled ? (rng.next() | 1) : 1;
+        add1 = enabled ? rng.next() : 0;
+        add2 = enabled ? rng.next() : 0;
+        xorShift = enabled;
+        inv1 = inverse(mul1);
+        inv2 = inverse(mul2);
+    }
+
+    unsigned long long forward(unsigned long long x) const {
+        do { x = round(x); } while (x >= n);
+        return x;
+    }
+    unsigned long long backward(unsigned long long x) const {
+        do { x = unround(x); } while (x >= n);
+        return x;
+    }
+
+private:
+    unsigned long long round(unsigned long long x) const {
+        x = (x * mul1 + add1) & mask;
+        if (xorShift) x ^= x >> shift;
+        return (x * mul2 + add2) & mask;
+    }
+    unsigned long long unround(unsigned long long x) const {
+        x = ((x - add2) * inv2) & mask;
+        if (xorShift) x ^= x >> shift;      // an involution for shift >= bits / 2
+        return ((x - add1) * inv1) & mask;
+    }
+    static unsigned long long inverse(unsigned long long odd) {
+        unsigned long long y = odd;
+        for (int i = 0; i < 5; ++i)
+            y *= 2 - odd * y;
+        return y;
+    }
+
+    unsigned long long n, mask;
+    unsigned bits, shift;
+    unsigned long long mul1, mul2, add1, add2, inv1, inv2;
+    bool xorShift;
+};
+
+
+struct GenConfig {
+    std::string outDir;
+    unsigned scale = 20;
+    unsigned long long numVertices = 0;
+    unsigned edgeFactor = 16;
+    unsigned numParts = 1;
+    unsigned long long seed = 1;
+    double a = 0.57, b = 0.19, c = 0.19;
+    unsigned numCommunities = 64;
+    double mixing = 0.2;
+    unsigned featDim = 64;
+    unsigned numLabels = 16;
+    double featNoise = 1.0;
+    double labelNoise = 0.1;
+    bool undirected = true;
+    bool scramble = true;
+    bool communityParts = false;
+    unsigned numThreads = 0;
+};
+
+
+class Generator {
+public:
+    Generator(const GenConfig &_cfg)
+        : cfg(_cfg), perm(_cfg.numVertices, _cfg.seed, _cfg.scramble) {}
+
+    void writeGraph(const std::string &filename);
+    void writeParts(const std::string &filename);
+    void writeFeatures(const std::string &filename);
+    void writeLabels(const std::string &filename);
+
+private:
+    /** R-MAT edge (u, v) of [0, n)^2, one quadrant per ID bit. */
+    void rmat(ItemRng &rng, unsigned long long n, unsigned long long &u, unsigned long long &v) {
+        do {
+            u = v = 0;
+            for (unsigned long long bit = 1; bit < n; bit <<= 1) {
+                double r = rng.uniform();
+                if (r >= cfg.a + cfg.b)
+                    u |= bit;
+                if ((r >= cfg.a && r < cfg.a + cfg.b) || r >= cfg.a + cfg.b + cfg.c)
+                    v |= bit;
+            }
+        } while (u >= n || v >= n);
+    }
+    void edge(unsigned long long e, VertexType &src, VertexType &dst);
+    unsigned community(VertexType v) { return perm.backward(v) % cfg.numCommunities; }
+
+    template <typename Out, typename Gen, typename Emit>
+    void generate(unsigned long long numTasks, Gen gen, Emit emit);
+
+    GenConfig cfg;
+    Scramble perm;
+};
+
+
+/**
+ *
+ * Edge `e`: an R-MAT source, and an R-MAT destination either over the whole
+ * graph or over the source's community. Self edges are redrawn.
+ *
+ */
+void
+Generator::edge(unsigned long long e, VertexType &src, VertexType &dst) {
+    ItemRng rng(cfg.seed, EDGES, e);
+    const unsigned long long n = cfg.numVertices;
+    const unsigned long long C = cfg.numCommunities;
+    do {
+        unsigned long long u, v;
+        rmat(rng, n, u, v);
+        if (rng.uniform() >= cfg.mixing) {
+            // Destination among the members of u's community, with the
+            // same skew
+            unsigned long long comm = u % C;
+            unsigned long long members = (n - comm + C - 1) / C;
+            unsigned long long unused;
+            rmat(rng, members, unused, v);
+            v = v * C + comm;
+        }
+        src = perm.forward(u);
+        dst = perm.forward(v);
+    } while (src == dst);
+}
+
+/**
+ *
+ * Run gen(task, out) for all tasks, `numThreads` at a time, and emit(out) in
+ * task order, so the output does not depend on the number of threads.
+ *
+ */
+template <typename Out, typename Gen, typename Emit>
+void
+Generator::generate(unsigned long long numTasks, Gen gen, Emit emit) {
+    std::vector<Out> outs(cfg.numThreads);
+    for (unsigned long long first = 0; first < numTasks; first += cfg.numThreads) {
+        unsigned cnt = std::min<unsigned long long>(cfg.numThreads, numTasks - first);
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < cnt; ++t)
+            threads.push_back(std::thread([&, t] { gen(first + t, outs[t]); }));
+        gen(first, outs[0]);
+        for (std::thread &t : threads)
+            t.join();
+        for (unsigned t = 0; t < cnt; ++t)
+            emit(outs[t]);
+    }
+}
+
+void
+Generator::writeGraph(const std::string &filename) {
+    const unsigned long long numEdges = cfg.numVertices * cfg.edgeFactor;
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    BSHeaderType header = { sizeof(VertexType), (VertexType) cfg.numVertices,
+                            cfg.undirected ? 2 * numEdges : numEdges };
+    out.write((char *) &header, sizeof(header));
+
+    generate<std::vector<VertexType>>((numEdges + GEN_BLOCK_EDGES - 1) / GEN_BLOCK_EDGES,
+        [&](unsigned long long task, std::vector<VertexType> &buf) {
+            buf.clear();
+            unsigned long long last = std::min(numEdges, (task + 1) * GEN_BLOCK_EDGES);
+            for (unsigned long long e = task * GEN_BLOCK_EDGES; e < last; ++e) {
+                VertexType src, dst;
+                edge(e, src, dst);
+                buf.push_back(src);
+                buf.push_back(dst);
+                if (cfg.undirected) {
+                    buf.push_back(dst);
+                    buf.push_back(src);
+                }
+            }
+        },
+        [&](std::vector<VertexType> &buf) {
+            out.write((char *) buf.data(), buf.size() * sizeof(VertexType));
+        });
+    out.close();
+}
+
+/** Hash partitioning, or the planted communities spread over the partitions. */
+void
+Generator::writeParts(const std::string &filename) {
+    std::ofstream out(filename.c_str());
+    for (VertexType v = 0; v < cfg.numVertices; ++v) {
+        unsigned part = cfg.communityParts ? community(v) % cfg.numParts
+                                           : mix64(cfg.seed ^ v) % cfg.numParts;
+        out << part << "\n";
+    }
+    out.close();
+}
+
+void
+Generator::writeFeatures(const std::string &filename) {
+    std::vector<FeatType> centroids((size_t) cfg.numCommunities * cfg.featDim);
+    for (unsigned comm = 0; comm < cfg.numCommunities; ++comm) {
+        ItemRng rng(cfg.seed, CENTROIDS, comm);
+        for (unsigned j = 0; j < cfg.featDim; ++j)
+            centroids[(size_t) comm * cfg.featDim + j] = (FeatType) (2.0 * rng.uniform() - 1.0);
+    }
+
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    out.write((char *) &cfg.featDim, sizeof(unsigned));
+    generate<std::vector<FeatType>>((cfg.numVertices + GEN_BLOCK_ROWS - 1) / GEN_BLOCK_ROWS,
+        [&](unsigned long long task, std::vector<FeatType> &buf) {
+            buf.clear();
+            unsigned long long last = std::min(cfg.numVertices, (task + 1) * GEN_BLOCK_ROWS);
+            for (unsigned long long v = task * GEN_BLOCK_ROWS; v < last; ++v) {
+                const FeatType *centroid = &centroids[(size_t) community(v) * cfg.featDim];
+                ItemRng rng(cfg.seed, FEATURES, v);
+                for (unsigned j = 0; j < cfg.featDim; ++j)
+                    buf.push_back(centroid[j] + (FeatType) (cfg.featNoise * (2.0 * rng.uniform() - 1.0)));
+            }
+        },
+        [&](std::vector<FeatType> &buf) {
+            out.write((char *) buf.data(), buf.size() * sizeof(FeatType));
+        });
+    out.close();
+}
+
+void
+Generator::writeLabels(const std::string &filename) {
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    out.write((char *) &cfg.numLabels, sizeof(unsigned));
+    for (VertexType v = 0; v < cfg.numVertices; ++v) {
+        ItemRng rng(cfg.seed, LABELS, v);
+        unsigned label = rng.uniform() < cfg.labelNoise ? rng.below(cfg.numLabels)
+                                                         : community(v) % cfg.numLabels;
+        out.write((char *) &label, sizeof(unsigned));
+    }
+    out.close();
+}
+
+
+/**
+ *
+ * Main entrance.
+ *
+ */
+int
+main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " --outdir=<Dir> [--scale=<log2 #vertices>] [--vertices=<#vertices>]"
+                  << " [--edgefactor=<#edges / #vertices>] [--nodes=<#partitions>] [--seed=<Seed>]"
+                  << " [--rmat=<a,b,c>] [--communities=<#communities>] [--mixing=<0..1>]"
+                  << " [--featdim=<Dim>] [--labels=<#labels>] [--featnoise=<Noise>] [--labelnoise=<0..1>]"
+                  << " [--undirected=<0/1>] [--scramble=<0/1>] [--partition=hash|community]"
+                  << " [--threads=<NumThreads>]" << std::endl;
+        return -1;
+    }
+
+    GenConfig cfg;
+    for (int i = 1; i < argc; ++i) {
+        int flag = 0;
+        if (strncmp("--outdir=", argv[i], 9) == 0)
+            cfg.outDir = argv[i] + 9;
+        else if (strncmp("--scale=", argv[i], 8) == 0)
+            sscanf(argv[i] + 8, "%u", &cfg.scale);
+        else if (strncmp("--vertices=", argv[i], 11) == 0)
+            sscanf(argv[i] + 11, "%llu", &cfg.numVertices);
+        else if (strncmp("--edgefactor=", argv[i], 13) == 0)
+            sscanf(argv[i] + 13, "%u", &cfg.edgeFactor);
+        else if (strncmp("--nodes=", argv[i], 8) == 0)
+            sscanf(argv[i] + 8, "%u", &cfg.numParts);
+        else if (strncmp("--seed=", argv[i], 7) == 0)
+            sscanf(argv[i] + 7, "%llu", &cfg.seed);
+        else if (strncmp("--rmat=", argv[i], 7) == 0)
+            sscanf(argv[i] + 7, "%lf,%lf,%lf", &cfg.a, &cfg.b, &cfg.c);
+        else if (strncmp("--communities=", argv[i], 14) == 0)
+            sscanf(argv[i] + 14, "%u", &cfg.numCommunities);
+        else if (strncmp("--mixing=", argv[i], 9) == 0)
+            sscanf(argv[i] + 9, "%lf", &cfg.mixing);
+        else if (strncmp("--featdim=", argv[i], 10) == 0)
+            sscanf(argv[i] + 10, "%u", &cfg.featDim);
+        else if (strncmp("--labels=", argv[i], 9) == 0)
+            sscanf(argv[i] + 9, "%u", &cfg.numLabels);
+        else if (strncmp("--featnoise=", argv[i], 12) == 0)
+            sscanf(argv[i] + 12, "%lf", &cfg.featNoise);
+        else if (strncmp("--labelnoise=", argv[i], 13) == 0)
+            sscanf(argv[i] + 13, "%lf", &cfg.labelNoise);
+        else if (strncmp("--undirected=", argv[i], 13) == 0) {
+            sscanf(argv[i] + 13, "%d", &flag);
+            cfg.undirected = flag != 0;
+        } else if (strncmp("--scramble=", argv[i], 11) == 0) {
+            sscanf(argv[i] + 11, "%d", &flag);
+            cfg.scramble = flag != 0;
+        } else if (strcmp("--partition=community", argv[i]) == 0)
+            cfg.communityParts = true;
+        else if (strcmp("--partition=hash", argv[i]) == 0)
+            cfg.communityParts = false;
+        else if (strncmp("--threads=", argv[i], 10) == 0)
+            sscanf(argv[i] + 10, "%u", &cfg.numThreads);
+        else {
+            std::cout << "Unknown option " << argv[i] << std::endl;
+            return -1;
+        }
+    }
+
+    if (cfg.numVertices == 0)
+        cfg.numVertices = 1ULL << cfg.scale;
+    if (cfg.numThreads == 0)
+        cfg.numThreads = std::max(1u, std::thread::hardware_concurrency());
+    if (cfg.outDir.empty() || cfg.numVertices < 2 || cfg.numVertices > 0xffffffffULL ||
+        cfg.numParts == 0 || cfg.numCommunities == 0 || 2 * cfg.numCommunities > cfg.numVertices ||
+        cfg.featDim == 0 || cfg.numLabels == 0 || cfg.a + cfg.b + cfg.c > 1.0) {
+        std::cout << "Invalid generator configuration" << std::endl;
+        return -1;
+    }
+
+    std::string partsDir = cfg.outDir + "/parts_" + std::to_string(cfg.numParts);
+    mkdir(cfg.outDir.c_str(), 0777);
+    mkdir(partsDir.c_str(), 0777);
+
+    std::cout << "Generating " << cfg.numVertices << " vertices, " << cfg.numVertices * cfg.edgeFactor
+              << (cfg.undirected ? " undirected" : " directed") << " edges, " << cfg.numCommunities
+              << " communities, seed " << cfg.seed << "..." << std::endl;
+
+    Generator gen(cfg);
+    gen.writeGraph(cfg.outDir + "/graph.bsnap");
+    gen.writeParts(partsDir + "/graph.bsnap.parts");
+    std::string edgesLink = partsDir + "/graph.bsnap.edges";
+    unlink(edgesLink.c_str());
+    if (symlink("../graph.bsnap", edgesLink.c_str()) != 0)
+        std::cout << "Cannot link " << edgesLink << " [Reason: " << std::strerror(errno) << "]" << std::endl;
+    gen.writeFeatures(cfg.outDir + "/features.bsnap");
+    gen.writeLabels(cfg.outDir + "/labels.bsnap");
+
+    std::cout << "Dataset under '" << cfg.outDir << "' is ready." << std::endl;
+
+    return 0;
+}
@@ -1,11 +1,12 @@
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <string>
-#include <cassert>
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <vector>
+#include "textParse.hpp"
 
 
 typedef unsigned VertexType;
@@ -13,154 +14,162 @@ typedef unsigned CountType;
 
 
 struct HeaderType {
-	int sizeOfVertexType;
-	VertexType numVertices;
-	unsigned long long numEdges;
+    int sizeOfVertexType;
+    VertexType numVertices;
+    unsigned long long numEdges;
 };
 HeaderType header;
 
 
+/** Binary edges of one piece of the snap file, and its header stats. */
+struct EdgesPiece {
+    std::vector<VertexType> edges;
+    VertexType maxId;
+    unsigned long long numEdges;
+};
+
+
 /**
  *
- * Read file header.
- * 
+ * Parse a piece of the snap file. Comment lines start with '#' or '%', self
+ * edges are dropped, and the first line that is not an edge ends the graph.
+ *
  */
-void
-readFile(std::string snapFile) {
-	std::ifstream snapStream(snapFile);
-    if (!snapStream.good())
-        printf("Cannot open graph snap file: %s [Reason: %s]\n", snapFile.c_str(), std::strerror(errno));
-
-    assert(snapStream.good());
-
-	std::string line;
-	while (std::getline(snapStream, line)) {
-		if (line[0] == '#' || line[0] == '%')
-			continue;
-
-		std::istringstream iss(line);
-		VertexType dst, src;
-
-		if (!(iss >> src >> dst))
-			break;
-
-		if (dst == src)
-			continue;
-
-		header.numVertices = std::max(header.numVertices, std::max(src, dst));
-		++header.numEdges;
-	}
-
-	snapStream.close();
-	++header.numVertices;
+static bool
+parsePiece(const char *p, const char *end, bool undirected, EdgesPiece &piece) {
+    piece.edges.clear();
+    piece.maxId = 0;
+    piece.numEdges = 0;
+    while (p < end) {
+        const char *eol = (const char *) memchr(p, '\n', end - p);
+        if (eol == NULL)
+            eol = end;
+
+        if (*p != '#' && *p != '%') {
+            VertexType src, dst;
+            const char *q = p;
+            while (q < eol && isSpace(*q)) ++q;
+            if (!parseUnsigned(q, eol, src))
+                return false;
+            while (q < eol && isSpace(*q)) ++q;
+            if (!parseUnsigned(q, eol, dst))
+                return false;
+
+            if (src != dst) {
+                piece.edges.push_back(src);
+                piece.edges.push_back(dst);
+                if (undirected) {
+                    piece.edges.push_back(dst);
+                    piece.edges.push_back(src);
+                }
+                piece.maxId = std::max(piece.maxId, std::max(src, dst));
+                ++piece.numEdges;
+            }
+        }
+        p = eol + 1;
+    }
+    return true;
 }
 
 
 /**
  *
- * Read the snap file and write binary snap file.
- * 
+ * Read the snap file and write binary snap file. The header, if any, is
+ * filled in once the whole file is parsed.
+ *
  */
 void
-readWriteFile(std::string snapFile, std::string bSFile, bool undirected, bool withheader) {
-	std::ifstream snapStream(snapFile);
-	if(!snapStream.good())
-		printf("Cannot open graph snap file: %s [Reason: %s]\n", snapFile.c_str(), std::strerror(errno));
-	
-	assert(snapStream.good());
-
-	std::ofstream bSStream;
-	bSStream.open(bSFile, std::ios::binary);
-
-	if (withheader)
-		bSStream.write((char *) &header, sizeof(header));
-
-	std::string line;
-	unsigned long long oldId = 0;
-	std::vector<unsigned long long> dsts;
-	while (std::getline(snapStream, line)) {
-		if (line[0] == '#' || line[0] == '%')
-			continue;
-
-		std::istringstream iss(line);
-		VertexType src, dst;
-
-		if (!(iss >> src >> dst))
-			break;
-
-		if(src == dst)
-			continue;
-	
-		bSStream.write((char *) &src, header.sizeOfVertexType);
-		bSStream.write((char *) &dst, header.sizeOfVertexType);
-
-        if (undirected) {
-            bSStream.write((char*) &dst, header.sizeOfVertexType);
-            bSStream.write((char*) &src, header.sizeOfVertexType);
-        }
-	}
-	
-	snapStream.close();
-	bSStream.close();
+readWriteFile(std::string snapFile, std::string bSFile, bool undirected, bool withheader, unsigned numThreads) {
+    MappedText snap(snapFile);
+
+    std::ofstream bSStream;
+    bSStream.open(bSFile, std::ios::binary);
+
+    if (withheader)
+        bSStream.write((char *) &header, sizeof(header));
+
+    parseChunks<EdgesPiece>(snap, numThreads,
+        [&](const char *b, const char *e, EdgesPiece &piece) {
+            return parsePiece(b, e, undirected, piece);
+        },
+        [&](EdgesPiece &piece) {
+            bSStream.write((char *) piece.edges.data(), piece.edges.size() * sizeof(VertexType));
+            header.numVertices = std::max(header.numVertices, piece.maxId);
+            header.numEdges += piece.numEdges;
+        });
+    ++header.numVertices;
+
+    if (withheader) {
+        if (undirected) header.numEdges *= 2;
+        bSStream.seekp(0);
+        bSStream.write((char *) &header, sizeof(header));
+        std::cout << "Graph info - Vertices: " << header.numVertices
+          << ", Edges: " << header.numEdges << std::endl;
+    }
+
+    bSStream.close();
 }
 
 
 /**
  *
  * Main entrance.
- * 
+ *
  */
 int
 main(int argc, char* argv[]) {
-	if(argc < 4) {
-		std::cout << "Usage: " << argv[0] << " --snapfile=<BsnapFile> --undirected=<0/1> --header=<0/1>" << std::endl;
-		return -1;
-	}
-
-	std::string snapFile;
-	bool undirected = false;
-	bool withheader = false;
-
-	for (int i = 0; i < argc; ++i) {
-		if (strncmp("--snapfile=", argv[i], 11) == 0) 
-			snapFile = argv[i] + 11;
-		if (strncmp("--undirected=", argv[i], 13) == 0) {
-			int undir = 0;
-			sscanf(argv[i] + 13, "%d", &undir);
-			undirected = (undir == 0 ? false : true);
-		}
-		if (strncmp("--header=", argv[i], 9) == 0) {
-			int hdr = 0;
-			sscanf(argv[i] + 9, "%d", &hdr);
-			withheader = (hdr == 0 ? false : true);
-		}
-	}
-
-	if (snapFile.size() == 0) {
-		std::cout << "Empty graph snap file." << std::endl;
-		return -1; 
-	} 
-
-	std::cout << "SNAP file: " << snapFile << std::endl;
-	std::cout << "Unidrected: " << (undirected ? "true" : "false") << std::endl;
-	std::cout << "Header: " << (withheader ? "true" : "false") << std::endl;
-	std::cout << "Self-edges will be removed..." << std::endl;
-	std::cout << "If undirected, edge repitions might occur..." << std::endl;
-
-	header.sizeOfVertexType = sizeof(VertexType);
-	header.numVertices = 0;
-	header.numEdges = 0;
-
-	if (withheader) {
-		readFile(snapFile);
+    if(argc < 4) {
+        std::cout << "Usage: " << argv[0] << " --snapfile=<BsnapFile> --undirected=<0/1> --header=<0/1> [--threads=<NumThreads>]" << std::endl;
+        return -1;
+    }
 
-        if (undirected) header.numEdges *= 2;
-        std::cout << "Graph info - Vertices: " << header.numVertices
-          << ", Edges: " << header.numEdges << std::endl;
+    std::string snapFile;
+    bool undirected = false;
+    bool withheader = false;
+    unsigned numThreads = defaultThreads();
+
+    for (int i = 0; i < argc; ++i) {
+        if (strncmp("--snapfile=", argv[i], 11) == 0)
+            snapFile = argv[i] + 11;
+        if (strncmp("--undirected=", argv[i], 13) == 0) {
+            int undir = 0;
+            sscanf(argv[i] + 13, "%d", &undir);
+            undirected = (undir == 0 ? false : true);
+        }
+        if (strncmp("--header=", argv[i], 9) == 0) {
+            int hdr = 0;
+            sscanf(argv[i] + 9, "%d", &hdr);
+            withheader = (hdr == 0 ? false : true);
+        }
+        if (strncmp("--threads=", argv[i], 10) == 0)
+            sscanf(argv[i] + 10, "%u", &numThreads);
+    }
+
+    if (snapFile.size() == 0) {
+        std::cout << "Empty graph snap file." << std::endl;
+        return -1;
     }
+    if (numThreads == 0)
+        numThreads = 1;
+
+    std::cout << "SNAP file: " << snapFile << std::endl;
+    std::cout << "Unidrected: " << (undirected ? "true" : "false") << std::endl;
+    std::cout << "Header: " << (withheader ? "true" : "false") << std::endl;
+    std::cout << "Threads: " << numThreads << std::endl;
+    std::cout << "Self-edges will be removed..." << std::endl;
+    std::cout << "If undirected, edge repitions might occur..." << std::endl;
+
+    header.sizeOfVertexType = sizeof(VertexType);
+    header.numVertices = 0;
+    header.numEdges = 0;
+
+    std::chrono::steady_clock::time_point stt = std::chrono::steady_clock::now();
+    std::string bSFile = snapFile + ".bsnap";
+    readWriteFile(snapFile, bSFile, undirected, withheader, numThreads);
 
-	std::string bSFile = snapFile + ".bsnap";
-	readWriteFile(snapFile, bSFile, undirected, withheader);
+    struct stat st;
+    stat(snapFile.c_str(), &st);
+    reportThroughput(st.st_size, std::chrono::duration<double>(std::chrono::steady_clock::now() - stt).count());
 
-	return 0;
+    return 0;
 }
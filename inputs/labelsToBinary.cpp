@@ -7,8 +7,8 @@
 #include <cstring>
 #include <vector>
 #include <typeinfo>
-#include <boost/algorithm/string/split.hpp>
-#include <boost/algorithm/string/trim.hpp>
+#include <chrono>
+#include "textParse.hpp"
 
 
 using namespace std;
@@ -27,36 +27,59 @@ static LabelsHeader head;
 // TODO: add header
 
 
+/**
+ *
+ * Parse a piece of the labels file: one label per line, lines not starting
+ * with a digit (after trimming) are skipped.
+ *
+ */
+static bool
+parsePiece(const char *p, const char *end, std::vector<LabelType> &labels) {
+    labels.clear();
+    while (p < end) {
+        const char *eol = (const char *) memchr(p, '\n', end - p);
+        if (eol == NULL)
+            eol = end;
+        const char *b = p, *e = eol;
+        p = eol + 1;
+
+        trim(b, e);
+        if (b == e || !isDigit(*b))
+            continue;
+
+        // Like std::stoul: the leading digits, as an unsigned long
+        const char *line = b;
+        unsigned long long label = 0;
+        for (unsigned digits = 0; b < e && isDigit(*b); ++digits) {
+            if (digits == 19) {
+                std::cerr << "Label out of range: " << std::string(line, e) << std::endl;
+                exit(-1);
+            }
+            label = label * 10 + (*b++ - '0');
+        }
+        labels.push_back((LabelType) label);
+    }
+    return true;
+}
+
+
 /**
  *
  * Read in labels file, convert into binary representation, and write to a '.bsnap' file.
  * 
  */
 void
-readWriteFile(std::string labelsFileName) {
-    std::ifstream infile(labelsFileName.c_str());
-    if (!infile.good())
-        printf("Cannot open labels file: %s [Reason: %s]\n", labelsFileName.c_str(), std::strerror(errno));
-
-    assert(infile.good());
+readWriteFile(std::string labelsFileName, unsigned numThreads) {
+    MappedText infile(labelsFileName);
 
     std::ofstream bSStream;
     bSStream.open(labelsFileName + ".bsnap", std::ios::binary);
     bSStream.write(reinterpret_cast<char *>(&head), sizeof(LabelsHeader));
 
-    std::string line;
-    while (!infile.eof()) {
-        std::getline(infile, line);
-        boost::algorithm::trim(line);
-
-        if (line.length() > 0) {
-            if (line[0] < '0' || line[0] > '9')
-                continue;
-
-            LabelType label = std::stoul(line);
-            bSStream.write(reinterpret_cast<char *>(&label), sizeof(LabelType));
-        }
-    }
+    parseChunks<std::vector<LabelType>>(infile, numThreads, parsePiece,
+        [&](std::vector<LabelType> &labels) {
+            bSStream.write(reinterpret_cast<char *>(labels.data()), labels.size() * sizeof(LabelType));
+        });
 }
 
 
@@ -67,19 +90,24 @@ readWriteFile(std::string labelsFileName) {
  */
 int
 main(int argc, char *argv[]) {
-    if (argc != 3) {
-        std::cout << "Usage: " << argv[0] << " --labelsfile=<LabelFile> --labelkinds=<LabelKinds>" << std::endl;
+    if (argc < 3) {
+        std::cout << "Usage: " << argv[0] << " --labelsfile=<LabelFile> --labelkinds=<LabelKinds> [--threads=<NumThreads>]" << std::endl;
         return -1;
     }
 
     std::string labelsFile;
     bool withheader = false;
+    unsigned numThreads = defaultThreads();
     for (int i = 0; i < argc; ++i) {
         if (strncmp("--labelsfile=", argv[i], 13) == 0)
             labelsFile = argv[i] + 13;
         if (strncmp("--labelkinds=", argv[i], 13) == 0)
             sscanf(argv[i] + 13, "%u", &head.labelKinds);
+        if (strncmp("--threads=", argv[i], 10) == 0)
+            sscanf(argv[i] + 10, "%u", &numThreads);
     }
+    if (numThreads == 0)
+        numThreads = 1;
     std::cout << "Labels file: " << labelsFile << std::endl;
     std::cout << "Label kinds: " << head.labelKinds << std::endl;
 
@@ -90,7 +118,12 @@ main(int argc, char *argv[]) {
         return -1;
     }
 
-    readWriteFile(labelsFile);
+    std::chrono::steady_clock::time_point stt = std::chrono::steady_clock::now();
+    readWriteFile(labelsFile, numThreads);
+
+    struct stat st;
+    stat(labelsFile.c_str(), &st);
+    reportThroughput(st.st_size, std::chrono::duration<double>(std::chrono::steady_clock::now() - stt).count());
 
     return 0;
 }
@@ -0,0 +1,309 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+
+
+/**
+ *
+ * Split the binary features / labels files into per partition shards, so
+ * every graph server reads only its own rows with one sequential read.
+ *
+ * For each partition `p` it writes, into the partition directory:
+ *     feats.<p>.bin       features of the local vertices, in local ID order
+ *     ghostfeats.<p>.bin  features of the incoming edge ghosts, in ghost order
+ *     labels.<p>.bin      labels of the local vertices, in local ID order
+ *
+ * Local IDs follow the global ID order of the partition's vertices, and ghost
+ * vertices are numbered in global ID order too, as the graph servers' data
+ * loader does. So every shard is written in a single pass over the inputs.
+ *
+ * With a hub threshold (the graph servers' --hubthreshold), the edges into
+ * hubs from other partitions are mirrored and their sources are no ghosts,
+ * as in the hybrid cut of the data loader.
+ *
+ */
+
+
+typedef float FeatType;
+typedef unsigned VertexType;
+
+
+/** Binary snap file header struct. */
+struct BSHeaderType {
+    int sizeOfVertexType;
+    VertexType numVertices;
+    unsigned long long numEdges;
+};
+
+/** Must match FileStamp in src/graph-server/utils/utils.hpp. */
+struct FileStamp {
+    unsigned long long size;
+    long long mtime;                // ns since the epoch
+};
+
+/** Must match ShardHeaderType in src/graph-server/engine/engine.hpp. */
+#define SHARD_MAGIC 0x44524853u
+#define SHARD_VERSION 3
+struct ShardHeaderType {
+    unsigned magic;
+    unsigned version;
+    unsigned numRows;
+    unsigned rowDim;
+    unsigned long long idsHash;
+    FileStamp srcStamp;
+    unsigned hubThreshold;
+};
+
+/** Size and mtime of the file a shard is cut from, checked by the graph servers. */
+static FileStamp getFileStamp(const std::string &filename) {
+    FileStamp stamp = { 0, 0 };
+    struct stat st;
+    if (stat(filename.c_str(), &st) == 0) {
+        stamp.size = st.st_size;
+        stamp.mtime = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    }
+    return stamp;
+}
+
+/** Hash of the global IDs of the rows of a shard, in row order. */
+static inline void hashId(unsigned long long &hash, unsigned id) {
+    hash = (hash ^ id) * 0x100000001b3ULL;
+}
+static const unsigned long long HASH_SEED = 0xcbf29ce484222325ULL;
+
+
+/** One shard being written. The header is completed once all rows are in. */
+struct ShardWriter {
+    std::ofstream out;
+    ShardHeaderType header;
+
+    void open(const std::string &filename, unsigned rowDim, const FileStamp &srcStamp,
+              unsigned hubThreshold = 0) {
+        out.open(filename.c_str(), std::ios::binary);
+        if (!out.good()) {
+            std::cerr << "Cannot open output file: " << filename << " [Reason: " << std::strerror(errno) << "]" << std::endl;
+            exit(-1);
+        }
+        header = ShardHeaderType { SHARD_MAGIC, SHARD_VERSION, 0, rowDim, HASH_SEED, srcStamp,
+                                   hubThreshold };
+        out.write(reinterpret_cast<char *>(&header), sizeof(header));
+    }
+    void append(unsigned gvid, const char *row, size_t bytes) {
+        out.write(row, bytes);
+        hashId(header.idsHash, gvid);
+        ++header.numRows;
+    }
+    void close() {
+        out.seekp(0);
+        out.write(reinterpret_cast<char *>(&header), sizeof(header));
+        out.close();
+    }
+};
+
+
+static std::vector<short> readParts(const std::string &partsFile) {
+    std::ifstream infile(partsFile.c_str());
+    if (!infile.good()) {
+        std::cerr << "Cannot open partition file: " << partsFile << " [Reason: " << std::strerror(errno) << "]" << std::endl;
+        exit(-1);
+    }
+    std::vector<short> parts;
+    std::string line;
+    while (std::getline(infile, line)) {
+        if (line.size() == 0 || (line[0] < '0' || line[0] > '9'))
+            continue;
+        std::istringstream iss(line);
+        short partId;
+        if (!(iss >> partId))
+            break;
+        parts.push_back(partId);
+    }
+    return parts;
+}
+
+/** Call `func(src, dst)` for every edge of the binary edges file but self loops. */
+template <typename Func>
+static void scanEdges(const std::string &edgesFile, Func func) {
+    std::ifstream infile(edgesFile.c_str(), std::ios::binary);
+    if (!infile.good()) {
+        std::cerr << "Cannot open edges file: " << edgesFile << " [Reason: " << std::strerror(errno) << "]" << std::endl;
+        exit(-1);
+    }
+    BSHeaderType bsHeader;
+    infile.read(reinterpret_cast<char *>(&bsHeader), sizeof(bsHeader));
+    assert(bsHeader.sizeOfVertexType == sizeof(VertexType));
+
+    std::vector<VertexType> buf(1 << 21);
+    while (infile.read(reinterpret_cast<char *>(buf.data()), buf.size() * sizeof(VertexType)) ||
+           infile.gcount() > 0) {
+        size_t cnt = infile.gcount() / (2 * sizeof(VertexType));
+        for (size_t i = 0; i < cnt; ++i) {
+            VertexType src = buf[2 * i], dst = buf[2 * i + 1];
+            if (src != dst)
+                func(src, dst);
+        }
+    }
+}
+
+/** The vertices with more than `hubThreshold` in edges, as DataLoader::findHubs(). */
+static std::vector<bool> findHubs(const std::string &edgesFile, unsigned numVertices,
+                                  bool undirected, unsigned hubThreshold) {
+    std::vector<unsigned> inDegrees(numVertices, 0);
+    scanEdges(edgesFile, [&](VertexType src, VertexType dst) {
+        ++inDegrees[dst];
+        if (undirected)
+            ++inDegrees[src];
+    });
+    std::vector<bool> hubs(numVertices, false);
+    unsigned hubCnt = 0;
+    for (unsigned gvid = 0; gvid < numVertices; ++gvid) {
+        if (inDegrees[gvid] > hubThreshold) {
+            hubs[gvid] = true;
+            ++hubCnt;
+        }
+    }
+    std::cout << hubCnt << " hubs with more than " << hubThreshold << " in edges" << std::endl;
+    return hubs;
+}
+
+/**
+ *
+ * Mark, per partition, the vertices that are sources of its incoming edges
+ * but live elsewhere. One bit per (partition, vertex). Edges into `hubs`
+ * (empty for a plain edge cut) are mirrored and make no ghosts.
+ *
+ */
+static std::vector<std::vector<unsigned long long>>
+findGhosts(const std::string &edgesFile, const std::vector<short> &parts,
+           unsigned numParts, bool undirected, const std::vector<bool> &hubs) {
+    std::vector<std::vector<unsigned long long>> ghosts(numParts,
+        std::vector<unsigned long long>((parts.size() + 63) / 64, 0));
+
+    scanEdges(edgesFile, [&](VertexType src, VertexType dst) {
+        if (parts[src] == parts[dst])
+            return;
+        if (hubs.empty() || !hubs[dst])
+            ghosts[parts[dst]][src / 64] |= 1ULL << (src % 64);
+        if (undirected && (hubs.empty() || !hubs[src]))
+            ghosts[parts[src]][dst / 64] |= 1ULL << (dst % 64);
+    });
+    return ghosts;
+}
+
+static void shardFeatures(const std::string &featuresFile, const std::string &partsDir,
+                          const std::vector<short> &parts, unsigned numParts,
+                          const std::vector<std::vector<unsigned long long>> &ghosts,
+                          unsigned hubThreshold) {
+    std::ifstream infile(featuresFile.c_str(), std::ios::binary);
+    if (!infile.good()) {
+        std::cerr << "Cannot open features file: " << featuresFile << " [Reason: " << std::strerror(errno) << "]" << std::endl;
+        exit(-1);
+    }
+    unsigned featDim = 0;
+    infile.read(reinterpret_cast<char *>(&featDim), sizeof(unsigned));
+
+    FileStamp srcStamp = getFileStamp(featuresFile);
+    std::vector<ShardWriter> locals(numParts), ghostShards(numParts);
+    for (unsigned p = 0; p < numParts; ++p) {
+        locals[p].open(partsDir + "/feats." + std::to_string(p) + ".bin", featDim, srcStamp);
+        ghostShards[p].open(partsDir + "/ghostfeats." + std::to_string(p) + ".bin", featDim, srcStamp,
+                            hubThreshold);
+    }
+
+    const size_t rowBytes = featDim * sizeof(FeatType);
+    std::vector<char> row(rowBytes);
+    for (unsigned gvid = 0; gvid < parts.size(); ++gvid) {
+        if (!infile.read(row.data(), rowBytes)) {
+            std::cerr << "Features file ends at vertex " << gvid << std::endl;
+            exit(-1);
+        }
+        locals[parts[gvid]].append(gvid, row.data(), rowBytes);
+        for (unsigned p = 0; p < numParts; ++p) {
+            if (ghosts[p][gvid / 64] & (1ULL << (gvid % 64)))
+                ghostShards[p].append(gvid, row.data(), rowBytes);
+        }
+    }
+
+    for (unsigned p = 0; p < numParts; ++p) {
+        std::cout << "Partition " << p << ": " << locals[p].header.numRows << " local, "
+                  << ghostShards[p].header.numRows << " ghost feature rows" << std::endl;
+        locals[p].close();
+        ghostShards[p].close();
+    }
+}
+
+static void shardLabels(const std::string &labelsFile, const std::string &partsDir,
+                        const std::vector<short> &parts, unsigned numParts) {
+    std::ifstream infile(labelsFile.c_str(), std::ios::binary);
+    if (!infile.good()) {
+        std::cerr << "Cannot open labels file: " << labelsFile << " [Reason: " << std::strerror(errno) << "]" << std::endl;
+        exit(-1);
+    }
+    unsigned labelKinds = 0;
+    infile.read(reinterpret_cast<char *>(&labelKinds), sizeof(unsigned));
+
+    FileStamp srcStamp = getFileStamp(labelsFile);
+    std::vector<ShardWriter> locals(numParts);
+    for (unsigned p = 0; p < numParts; ++p)
+        locals[p].open(partsDir + "/labels." + std::to_string(p) + ".bin", labelKinds, srcStamp);
+
+    for (unsigned gvid = 0; gvid < parts.size(); ++gvid) {
+        unsigned label;
+        if (!infile.read(reinterpret_cast<char *>(&label), sizeof(unsigned))) {
+            std::cerr << "Labels file ends at vertex " << gvid << std::endl;
+            exit(-1);
+        }
+        locals[parts[gvid]].append(gvid, reinterpret_cast<char *>(&label), sizeof(unsigned));
+    }
+    for (unsigned p = 0; p < numParts; ++p)
+        locals[p].close();
+}
+
+
+/**
+ *
+ * Main entrance.
+ *
+ */
+int
+main(int argc, char *argv[]) {
+    if (argc != 6 && argc != 7) {
+        std::cout << "Usage: " << argv[0] << " <PartitionDir> <NumPartitions> <Undirected? (0/1)> <FeaturesFile> <LabelsFile> [HubThreshold (0: edge cut)]" << std::endl;
+        return -1;
+    }
+
+    std::string partsDir = argv[1];
+    unsigned numParts = std::atoi(argv[2]);
+    bool undirected = std::atoi(argv[3]) != 0;
+    std::string featuresFile = argv[4];
+    std::string labelsFile = argv[5];
+    unsigned hubThreshold = argc > 6 ? std::atoi(argv[6]) : 0;
+
+    std::vector<short> parts = readParts(partsDir + "/graph.bsnap.parts");
+    for (short p : parts) {
+        if (p < 0 || (unsigned)p >= numParts) {
+            std::cerr << "Partition ID " << p << " out of range" << std::endl;
+            return -1;
+        }
+    }
+    std::cout << "Sharding " << parts.size() << " vertices into " << numParts << " partitions..." << std::endl;
+
+    std::string edgesFile = partsDir + "/graph.bsnap.edges";
+    std::vector<bool> hubs;
+    if (hubThreshold > 0)
+        hubs = findHubs(edgesFile, parts.size(), undirected, hubThreshold);
+    std::vector<std::vector<unsigned long long>> ghosts =
+        findGhosts(edgesFile, parts, numParts, undirected, hubs);
+    shardFeatures(featuresFile, partsDir, parts, numParts, ghosts, hubThreshold);
+    shardLabels(labelsFile, partsDir, parts, numParts);
+
+    return 0;
+}
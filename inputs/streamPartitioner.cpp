@@ -0,0 +1,371 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+
+/**
+ *
+ * One-pass streaming partitioner, for graphs whose adjacency does not fit in
+ * memory for METIS. Memory is O(#vertices x #partitions / 64) words.
+ *
+ * The binary edge list is read as a vertex stream: a run of consecutive edges
+ * with the same source is that vertex and its neighbors (a graph converted
+ * from an adjacency / sorted edge list is one run per vertex; for other
+ * orders a vertex is placed at its first run). Each vertex goes to the
+ * partition with the best Fennel (additive) or LDG (multiplicative) balanced
+ * score. Vertices that never appear as sources fill the least loaded
+ * partitions at the end.
+ *
+ * The default objective counts ghost vertices, which is what drives the
+ * scatter volume of the graph servers: placing v in p is rewarded for every
+ * neighbor already in p, for every neighbor already a ghost of p (weighted by
+ * `--replica-weight`, as greedily chasing existing replicas scatters
+ * communities), and for p holding any neighbor (v then is not a ghost
+ * there). `--objective=edgecut` rewards the neighbors in p only, like classic
+ * Fennel / LDG.
+ *
+ * Restreaming passes (`--passes=N`) replay the stream with every vertex
+ * already placed, moving vertices to their best partition given the
+ * previous pass.
+ *
+ * Writes the same parts_<k>/<graph>.parts file as the METIS partitioner, and
+ * the number of ghost vertices as its communication cost.
+ *
+ */
+
+
+#define BASE_PATH "./"
+#define PARTS_PATH BASE_PATH "parts_"
+#define COMM_EXT ".comm"
+#define PART_EXT ".parts"
+
+#define READ_BLOCK_EDGES (1 << 20)
+#define UNASSIGNED (-1)
+
+
+typedef unsigned VertexType;
+
+
+struct BELHeaderType {
+    int sizeOfVertexType;
+    VertexType numVertices;
+    unsigned long long numEdges;
+};
+
+
+enum Objective { GHOSTS, EDGECUT };
+enum Heuristic { FENNEL, LDG };
+
+
+class StreamPartitioner {
+public:
+    StreamPartitioner(const std::string &_graphPath, unsigned _numParts, Objective _objective,
+                      Heuristic _heuristic, double slack, double _replicaWeight)
+        : graphPath(_graphPath), numParts(_numParts), objective(_objective),
+          heuristic(_heuristic), replicaWeight(_replicaWeight), maskWords((_numParts + 63) / 64) {
+        std::ifstream infile(graphPath.c_str(), std::ios::binary);
+        if (!infile.good()) {
+            printf("Cannot open graph bsnap file: %s [Reason: %s]\n", graphPath.c_str(), std::strerror(errno));
+            exit(-1);
+        }
+        infile.read((char *) &header, sizeof(header));
+        assert(header.sizeOfVertexType == sizeof(VertexType));
+
+        numVertices = header.numVertices;
+        capacity = (unsigned long long) std::ceil(slack * numVertices / numParts);
+        // Fennel: alpha = sqrt(k) * m / n^1.5, gamma = 1.5
+        alpha = std::sqrt((double) numParts) * header.numEdges /
+                std::pow((double) std::max(numVertices, 1u), 1.5);
+        parts.assign(numVertices, UNASSIGNED);
+        sizes.assign(numParts, 0);
+        masks.assign((size_t) numVertices * maskWords, 0);
+        benefit.assign(numParts, 0.0);
+        hasNbr.assign(numParts, false);
+    }
+
+    void stream(bool restream);
+    void placeRemaining();
+    void recomputeMasks();
+    void report(unsigned long long &ghosts, unsigned long long &edgeCut, double &imbalance);
+
+    std::vector<short> parts;
+
+private:
+    template <typename Fn> void forEachRun(Fn fn);
+    void place(VertexType v, const std::vector<VertexType> &nbrs, bool restream);
+
+    bool hasMask(VertexType v, unsigned p) {
+        return masks[(size_t) v * maskWords + p / 64] & (1ULL << (p % 64));
+    }
+    void setMask(VertexType v, unsigned p) {
+        masks[(size_t) v * maskWords + p / 64] |= 1ULL << (p % 64);
+    }
+
+    std::string graphPath;
+    BELHeaderType header;
+    unsigned numVertices;
+    unsigned numParts;
+    Objective objective;
+    Heuristic heuristic;
+    double replicaWeight;
+    unsigned maskWords;
+    unsigned long long capacity;
+    double alpha;
+
+    std::vector<unsigned long long> sizes;
+    // Partitions each vertex is a ghost of
+    std::vector<unsigned long long> masks;
+    std::vector<double> benefit;
+    std::vector<bool> hasNbr;
+};
+
+
+/** Call fn(src, neighbors) for every run of edges with the same source. */
+template <typename Fn>
+void StreamPartitioner::forEachRun(Fn fn) {
+    std::ifstream infile(graphPath.c_str(), std::ios::binary);
+    infile.seekg(sizeof(BELHeaderType));
+    std::vector<VertexType> buf(2 * READ_BLOCK_EDGES);
+    std::vector<VertexType> nbrs;
+    VertexType src = 0;
+    bool inRun = false;
+    while (infile.read((char *) buf.data(), buf.size() * sizeof(VertexType)) || infile.gcount() > 0) {
+        size_t cnt = infile.gcount() / (2 * sizeof(VertexType));
+        for (size_t i = 0; i < cnt; ++i) {
+            VertexType from = buf[2 * i], to = buf[2 * i + 1];
+            if (inRun && from != src) {
+                fn(src, nbrs);
+                nbrs.clear();
+            }
+            src = from;
+            inRun = true;
+            if (from != to)
+                nbrs.push_back(to);
+        }
+    }
+    if (inRun)
+        fn(src, nbrs);
+}
+
+/**
+ *
+ * Score every partition for v and move it to the best one with room left.
+ *
+ */
+void StreamPartitioner::place(VertexType v, const std::vector<VertexType> &nbrs, bool restream) {
+    if (parts[v] != UNASSIGNED) {
+        if (!restream) {
+            // Later run of a vertex already placed; just record the ghosts.
+            for (VertexType u : nbrs) {
+                if (parts[u] != UNASSIGNED && parts[u] != parts[v]) {
+                    setMask(u, parts[v]);
+                    setMask(v, parts[u]);
+                }
+            }
+            return;
+        }
+        --sizes[parts[v]];
+    }
+    // On restreams, bit `prev` of a neighbor's ghost set may be there only
+    // because of v itself, so it is not counted
+    short prev = parts[v];
+
+    std::fill(benefit.begin(), benefit.end(), 0.0);
+    std::fill(hasNbr.begin(), hasNbr.end(), false);
+
+    for (VertexType u : nbrs) {
+        short pu = parts[u];
+        if (pu == UNASSIGNED)
+            continue;
+        benefit[pu] += 1.0;
+        hasNbr[pu] = true;
+        if (objective == GHOSTS) {
+            // u is already replicated there, no new ghost
+            for (unsigned w = 0; w < maskWords; ++w) {
+                unsigned long long bits = masks[(size_t) u * maskWords + w];
+                while (bits) {
+                    unsigned p = w * 64 + __builtin_ctzll(bits);
+                    bits &= bits - 1;
+                    if (p != (unsigned) pu && (short) p != prev)
+                        benefit[p] += replicaWeight;
+                }
+            }
+        }
+    }
+    if (objective == GHOSTS) {
+        // v is no ghost of the partition it goes to
+        for (unsigned p = 0; p < numParts; ++p) {
+            if (hasNbr[p] || hasMask(v, p))
+                benefit[p] += 1.0;
+        }
+    }
+
+    unsigned best = numParts;
+    double bestScore = 0.0;
+    for (unsigned p = 0; p < numParts; ++p) {
+        if (sizes[p] >= capacity)
+            continue;
+        double score;
+        if (heuristic == FENNEL)
+            score = benefit[p] - alpha * 1.5 * std::sqrt((double) sizes[p]);
+        else
+            score = benefit[p] * (1.0 - (double) sizes[p] / capacity);
+        if (best == numParts || score > bestScore ||
+            (score == bestScore && sizes[p] < sizes[best])) {
+            best = p;
+            bestScore = score;
+        }
+    }
+    assert(best < numParts);
+
+    parts[v] = best;
+    ++sizes[best];
+    for (VertexType u : nbrs) {
+        if (parts[u] != UNASSIGNED && parts[u] != (short) best) {
+            setMask(u, best);
+            setMask(v, parts[u]);
+        }
+    }
+}
+
+void StreamPartitioner::stream(bool restream) {
+    forEachRun([&](VertexType v, const std::vector<VertexType> &nbrs) {
+        place(v, nbrs, restream);
+    });
+}
+
+/** Vertices without out edges go to the least loaded partitions. */
+void StreamPartitioner::placeRemaining() {
+    for (VertexType v = 0; v < numVertices; ++v) {
+        if (parts[v] != UNASSIGNED)
+            continue;
+        unsigned best = std::min_element(sizes.begin(), sizes.end()) - sizes.begin();
+        parts[v] = best;
+        ++sizes[best];
+    }
+}
+
+/** Ghost sets of the current assignment, before a restreaming pass. */
+void StreamPartitioner::recomputeMasks() {
+    std::fill(masks.begin(), masks.end(), 0);
+    forEachRun([&](VertexType v, const std::vector<VertexType> &nbrs) {
+        for (VertexType u : nbrs) {
+            if (parts[u] != parts[v]) {
+                setMask(u, parts[v]);
+                setMask(v, parts[u]);
+            }
+        }
+    });
+}
+
+void StreamPartitioner::report(unsigned long long &ghosts, unsigned long long &edgeCut,
+                               double &imbalance) {
+    recomputeMasks();
+    ghosts = 0;
+    for (unsigned long long word : masks)
+        ghosts += __builtin_popcountll(word);
+    edgeCut = 0;
+    forEachRun([&](VertexType v, const std::vector<VertexType> &nbrs) {
+        for (VertexType u : nbrs)
+            edgeCut += parts[u] != parts[v];
+    });
+    imbalance = (double) *std::max_element(sizes.begin(), sizes.end()) * numParts /
+                std::max(numVertices, 1u);
+}
+
+
+/**
+ *
+ * Main entrance.
+ *
+ */
+int
+main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cout << "Usage: " << argv[0] << " <GraphBsnapFile> <NumVertices> <NumPartitions>"
+                  << " [--passes=<NumRestreams>] [--objective=ghosts|edgecut]"
+                  << " [--heuristic=fennel|ldg] [--slack=<MaxPartSize / AvgPartSize>]"
+                  << " [--replica-weight=<0..1>]" << std::endl;
+        return -1;
+    }
+
+    std::string graphName = argv[1];
+    unsigned numParts = atoi(argv[3]);
+    unsigned passes = 0;
+    Objective objective = GHOSTS;
+    Heuristic heuristic = FENNEL;
+    double slack = 1.05;
+    double replicaWeight = 0.5;
+    for (int i = 4; i < argc; ++i) {
+        if (strncmp("--passes=", argv[i], 9) == 0)
+            passes = atoi(argv[i] + 9);
+        else if (strcmp("--objective=edgecut", argv[i]) == 0)
+            objective = EDGECUT;
+        else if (strcmp("--objective=ghosts", argv[i]) == 0)
+            objective = GHOSTS;
+        else if (strcmp("--heuristic=ldg", argv[i]) == 0)
+            heuristic = LDG;
+        else if (strcmp("--heuristic=fennel", argv[i]) == 0)
+            heuristic = FENNEL;
+        else if (strncmp("--slack=", argv[i], 8) == 0)
+            slack = atof(argv[i] + 8);
+        else if (strncmp("--replica-weight=", argv[i], 17) == 0)
+            replicaWeight = atof(argv[i] + 17);
+        else {
+            std::cout << "Unknown option " << argv[i] << std::endl;
+            return -1;
+        }
+    }
+    if (numParts == 0 || numParts > SHRT_MAX || slack < 1.0) {
+        std::cout << "Invalid number of partitions or slack" << std::endl;
+        return -1;
+    }
+
+    std::string partsDir = std::string(PARTS_PATH) + argv[3] + "/";
+    mkdir(partsDir.c_str(), 0777);
+
+    StreamPartitioner sp(BASE_PATH + graphName, numParts, objective, heuristic, slack, replicaWeight);
+
+    std::cout << "Streaming the graph into " << numParts << " partitions..." << std::endl;
+    sp.stream(false);
+    sp.placeRemaining();
+    for (unsigned pass = 1; pass <= passes; ++pass) {
+        std::cout << "Restreaming pass " << pass << "..." << std::endl;
+        sp.recomputeMasks();
+        sp.stream(true);
+    }
+
+    unsigned long long ghosts, edgeCut;
+    double imbalance;
+    sp.report(ghosts, edgeCut, imbalance);
+    std::cout << "Ghost vertices: " << ghosts << ", edge cut: " << edgeCut
+              << ", imbalance: " << imbalance << std::endl;
+
+    std::cout << "Writing partitioning results..." << std::endl;
+
+    std::string commPath = partsDir + graphName + COMM_EXT;
+    std::ofstream commFile;
+    commFile.open(commPath.c_str());
+    commFile << "Communication cost: " << ghosts << std::endl;
+    commFile.close();
+
+    std::string partPath = partsDir + graphName + PART_EXT;
+    std::ofstream partFile;
+    partFile.open(partPath.c_str());
+    for (short p : sp.parts)
+        partFile << p << std::endl;
+    partFile.close();
+
+    return 0;
+}
@@ -0,0 +1,251 @@
+#ifndef __TEXT_PARSE_HPP__
+#define __TEXT_PARSE_HPP__
+
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cerrno>
+#include <cfloat>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/**
+ *
+ * Shared by the text -> binary converters: the input is mmap'ed and parsed
+ * in rounds of `numThreads` newline aligned pieces, each piece by its own
+ * thread into its own buffer. Buffers are then written in file order, so the
+ * output is the same as a sequential parse, in one pass with bounded memory.
+ *
+ */
+
+
+/** Bytes parsed by one thread per round. */
+#define PARSE_PIECE_BYTES (64 << 20)
+
+
+/** Read-only mapping of a whole text file. */
+class MappedText {
+public:
+    MappedText(const std::string &filename) : data(NULL), size(0) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            printf("Cannot open input file: %s [Reason: %s]\n", filename.c_str(), std::strerror(errno));
+            exit(-1);
+        }
+        struct stat st;
+        fstat(fd, &st);
+        size = st.st_size;
+        if (size > 0) {
+            data = (const char *) mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                printf("Cannot mmap input file: %s [Reason: %s]\n", filename.c_str(), std::strerror(errno));
+                exit(-1);
+            }
+            madvise((void *) data, size, MADV_SEQUENTIAL);
+        }
+        close(fd);
+    }
+    ~MappedText() {
+        if (data != NULL)
+            munmap((void *) data, size);
+    }
+
+    const char *data;
+    size_t size;
+};
+
+
+static inline unsigned defaultThreads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+/** Start of the line after `p` (or `end`). */
+static inline const char *nextLine(const char *p, const char *end) {
+    const char *nl = (const char *) memchr(p, '\n', end - p);
+    return nl == NULL ? end : nl + 1;
+}
+
+/**
+ *
+ * Run parse(tid, begin, end, out) over newline aligned pieces of the text,
+ * `numThreads` at a time, then emit(out) for each piece in file order. A
+ * parse returning false ends the conversion after that piece is emitted.
+ *
+ */
+template <typename Out, typename Parse, typename Emit>
+void parseChunks(const MappedText &text, unsigned numThreads, Parse parse, Emit emit) {
+    std::vector<Out> outs(numThreads);
+    std::vector<char> oks(numThreads);
+    const char *end = text.data + text.size;
+    const char *pos = text.data;
+    while (pos < end) {
+        std::vector<const char *> bounds(numThreads + 1, end);
+        bounds[0] = pos;
+        for (unsigned t = 1; t <= numThreads; ++t) {
+            const char *b = bounds[t - 1];
+            bounds[t] = (size_t) (end - b) > PARSE_PIECE_BYTES ? nextLine(b + PARSE_PIECE_BYTES, end) : end;
+        }
+
+        std::vector<std::thread> threads;
+        for (unsigned t = 1; t < numThreads; ++t)
+            threads.push_back(std::thread([&, t] { oks[t] = parse(bounds[t], bounds[t + 1], outs[t]); }));
+        oks[0] = parse(bounds[0], bounds[1], outs[0]);
+        for (std::thread &t : threads)
+            t.join();
+
+        for (unsigned t = 0; t < numThreads; ++t) {
+            emit(outs[t]);
+            if (!oks[t])
+                return;
+        }
+        pos = bounds[numThreads];
+    }
+}
+
+
+static inline bool isSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/** Strip the whitespace around [b, e), like boost::algorithm::trim. */
+static inline void trim(const char *&b, const char *&e) {
+    while (b < e && isSpace(*b))
+        ++b;
+    while (e > b && isSpace(e[-1]))
+        --e;
+}
+
+/**
+ *
+ * Parse an unsigned at p the way `istream >> unsigned` does: optional sign
+ * (negatives wrap), decimal digits, failing on no digits or overflow.
+ *
+ */
+static inline bool parseUnsigned(const char *&p, const char *e, unsigned &val) {
+    bool neg = false;
+    if (p < e && (*p == '+' || *p == '-'))
+        neg = *p++ == '-';
+    if (p == e || !isDigit(*p))
+        return false;
+    unsigned long long v = 0;
+    while (p < e && isDigit(*p)) {
+        v = v * 10 + (*p++ - '0');
+        if (v > UINT_MAX)
+            return false;
+    }
+    val = neg ? (unsigned) -v : (unsigned) v;
+    return true;
+}
+
+/**
+ *
+ * Parse a whole decimal token into the correctly rounded float, as strtof
+ * does. Plain decimals use the exact fast paths (the mantissa and the power
+ * of ten are exact, so one rounding); anything else goes to strtof.
+ *
+ */
+static inline bool parseFloat(const char *b, const char *e, float &val) {
+    static const float pow10f[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+    static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    const char *p = b;
+    bool neg = false;
+    if (p < e && (*p == '+' || *p == '-'))
+        neg = *p++ == '-';
+    unsigned long long mant = 0;
+    int digits = 0, exp10 = 0;
+    bool any = false;
+    while (p < e && *p == '0') {
+        ++p;
+        any = true;
+    }
+    while (p < e && isDigit(*p)) {
+        mant = mant * 10 + (*p++ - '0');
+        ++digits;
+        any = true;
+    }
+    if (p < e && *p == '.') {
+        ++p;
+        if (digits == 0) {
+            while (p < e && *p == '0') {
+                ++p;
+                --exp10;
+                any = true;
+            }
+        }
+        while (p < e && isDigit(*p)) {
+            mant = mant * 10 + (*p++ - '0');
+            ++digits;
+            --exp10;
+            any = true;
+        }
+    }
+    if (p < e && (*p == 'e' || *p == 'E') && any) {
+        ++p;
+        bool eneg = false;
+        if (p < e && (*p == '+' || *p == '-'))
+            eneg = *p++ == '-';
+        int ev = 0;
+        bool edig = false;
+        while (p < e && isDigit(*p) && ev < 10000) {
+            ev = ev * 10 + (*p++ - '0');
+            edig = true;
+        }
+        if (!edig)
+            p = e + 1;      // let strtof decide
+        exp10 += eneg ? -ev : ev;
+    }
+
+    if (any && p == e && digits <= 19) {
+        if (mant == 0) {
+            val = neg ? -0.0f : 0.0f;
+            return true;
+        }
+        if (mant <= (1ULL << 24) && exp10 >= -10 && exp10 <= 10) {
+            float f = exp10 >= 0 ? (float) mant * pow10f[exp10] : (float) mant / pow10f[-exp10];
+            val = neg ? -f : f;
+            return true;
+        }
+        if (mant <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+            double d = exp10 >= 0 ? (double) mant * pow10[exp10] : (double) mant / pow10[-exp10];
+            // The double is correctly rounded; rounding it again to float is
+            // too unless it sits exactly on a float rounding boundary.
+            unsigned long long bits;
+            memcpy(&bits, &d, sizeof(bits));
+            if (d >= FLT_MIN && d <= FLT_MAX && (bits & ((1ULL << 29) - 1)) != (1ULL << 28)) {
+                val = neg ? -(float) d : (float) d;
+                return true;
+            }
+        }
+    }
+
+    std::string token(b, e);
+    char *stop;
+    val = strtof(token.c_str(), &stop);
+    return stop != token.c_str();
+}
+
+
+/** Report the conversion speed. */
+static inline void reportThroughput(size_t bytes, double seconds) {
+    printf("Parsed %.1f MB in %.2f s (%.2f GB/s)\n", bytes / 1e6, seconds,
+           seconds > 0 ? bytes / seconds / 1e9 : 0.0);
+}
+
+
+#endif // __TEXT_PARSE_HPP__
@@ -0,0 +1,90 @@
+#! /usr/bin/python3
+
+## Merge the per-node chunk traces (trace.<nodeId>.json, written by the graph
+## servers with --tracedir) into one Chrome/Perfetto trace.
+##
+## The nodes' clocks are aligned on the global barriers: every node records
+## the same sequence of "barrier" events and leaves each of them at about the
+## same time, so a node's offset is the median difference between its barrier
+## exits and those of the reference (lowest id) node.
+##
+## Usage: merge-traces.py <trace files or directories...> [-o merged.json]
+
+import argparse
+import glob
+import json
+import os
+import statistics
+
+
+def load_traces(paths):
+    files = []
+    for path in paths:
+        if os.path.isdir(path):
+            files += sorted(glob.glob(os.path.join(path, 'trace.*.json')))
+        else:
+            files.append(path)
+
+    traces = {}
+    for f in files:
+        with open(f, 'r') as fp:
+            trace = json.load(fp)
+        traces[trace['otherData']['nodeId']] = trace['traceEvents']
+    return traces
+
+
+def barrier_exits(events):
+    return sorted(e['ts'] + e['dur'] for e in events
+                  if e.get('name') == 'barrier' and e.get('ph') == 'X')
+
+
+def clock_offsets(traces):
+    ref = min(traces)
+    refExits = barrier_exits(traces[ref])
+    offsets = {}
+    for node, events in traces.items():
+        exits = barrier_exits(events)
+        n = min(len(exits), len(refExits))
+        if node == ref or n == 0:
+            offsets[node] = 0
+        else:
+            offsets[node] = statistics.median(
+                refExits[i] - exits[i] for i in range(n))
+    return offsets
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('traces', nargs='+')
+    parser.add_argument('-o', '--output', default='merged-trace.json')
+    args = parser.parse_args()
+
+    traces = load_traces(args.traces)
+    if not traces:
+        print("No trace files found")
+        exit(1)
+
+    offsets = clock_offsets(traces)
+    merged = []
+    for node in sorted(traces):
+        print("Node %3d: %8d events, clock offset %+.0f us" %
+              (node, len(traces[node]), offsets[node]))
+        for e in traces[node]:
+            if 'ts' in e:
+                e['ts'] += offsets[node]
+            merged.append(e)
+
+    # Start the timeline at 0
+    start = min(e['ts'] for e in merged if 'ts' in e)
+    for e in merged:
+        if 'ts' in e:
+            e['ts'] -= start
+
+    with open(args.output, 'w') as fp:
+        json.dump({ 'traceEvents': merged,
+                    'otherData': { 'clockOffsetsUs': offsets } }, fp)
+    print("Merged trace written to %s" % args.output)
+
+
+if __name__ == '__main__':
+    main()
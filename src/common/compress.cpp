@@ -0,0 +1,261 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sys/resource.h>
+#include <thread>
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "compress.hpp"
+
+
+// zstd level 1 is about as fast as LZ4 at a better ratio on float data.
+#define ZSTD_LEVEL 1
+// Below this ratio a codec is not worth its CPU time.
+#define MIN_RATIO 1.05
+
+static const char *CODEC_NAMES[COMPRESS_NUM_CODECS] = { "none", "lz4", "zstd" };
+
+const char *compressCodecName(CompressCodec codec) {
+    return codec < COMPRESS_NUM_CODECS ? CODEC_NAMES[codec] : "unknown";
+}
+
+bool compressSupported(CompressCodec codec) {
+    switch (codec) {
+        case COMPRESS_NONE:
+            return true;
+#ifdef HAVE_LZ4
+        case COMPRESS_LZ4:
+            return true;
+#endif
+#ifdef HAVE_ZSTD
+        case COMPRESS_ZSTD:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+size_t compressFrameBound(size_t size) {
+    size_t bound = size;
+#ifdef HAVE_LZ4
+    bound = std::max(bound, (size_t)LZ4_compressBound(size));
+#endif
+#ifdef HAVE_ZSTD
+    bound = std::max(bound, ZSTD_compressBound(size));
+#endif
+    return COMPRESS_FRAME_HDR + bound;
+}
+
+size_t framedRawSize(const char *frame) {
+    unsigned rawSize;
+    memcpy(&rawSize, frame + sizeof(unsigned), sizeof(unsigned));
+    return rawSize;
+}
+
+// Compress into `dst` of `cap` bytes. Returns the compressed size, 0 on
+// failure.
+static size_t compressRaw(CompressCodec codec, const char *src, size_t size,
+                          char *dst, size_t cap) {
+    switch (codec) {
+#ifdef HAVE_LZ4
+        case COMPRESS_LZ4: {
+            int n = LZ4_compress_default(src, dst, size, cap);
+            return n > 0 ? n : 0;
+        }
+#endif
+#ifdef HAVE_ZSTD
+        case COMPRESS_ZSTD: {
+            size_t n = ZSTD_compress(dst, cap, src, size, ZSTD_LEVEL);
+            return ZSTD_isError(n) ? 0 : n;
+        }
+#endif
+        default:
+            return 0;
+    }
+}
+
+bool decompressFrame(const char *frame, size_t frameSize, char *dst) {
+    if (frameSize < COMPRESS_FRAME_HDR)
+        return false;
+    unsigned codec;
+    memcpy(&codec, frame, sizeof(unsigned));
+    size_t rawSize = framedRawSize(frame);
+    const char *src = frame + COMPRESS_FRAME_HDR;
+    size_t srcSize = frameSize - COMPRESS_FRAME_HDR;
+
+    switch (codec) {
+        case COMPRESS_NONE:
+            if (srcSize != rawSize)
+                return false;
+            memcpy(dst, src, rawSize);
+            return true;
+#ifdef HAVE_LZ4
+        case COMPRESS_LZ4:
+            return LZ4_decompress_safe(src, dst, srcSize, rawSize) == (int)rawSize;
+#endif
+#ifdef HAVE_ZSTD
+        case COMPRESS_ZSTD:
+            return ZSTD_decompress(dst, rawSize, src, srcSize) == rawSize;
+#endif
+        default:
+            return false;
+    }
+}
+
+
+bool PayloadCompressor::init(const std::string &mode_, double linkMBps_) {
+    name = mode_;
+    linkMBps = linkMBps_;
+    if (mode_ == "none") {
+        mode = MODE_NONE;
+    } else if (mode_ == "auto") {
+        mode = MODE_AUTO;
+    } else {
+        mode = MODE_FIXED;
+        fixed = COMPRESS_NUM_CODECS;
+        for (unsigned c = COMPRESS_LZ4; c < COMPRESS_NUM_CODECS; ++c) {
+            if (mode_ == CODEC_NAMES[c])
+                fixed = (CompressCodec)c;
+        }
+        if (fixed == COMPRESS_NUM_CODECS)
+            return false;
+        // Built without the library: send raw
+        if (!compressSupported(fixed))
+            mode = MODE_NONE;
+    }
+    return true;
+}
+
+
+// Idle fraction of the cores since the last sample (every 100ms).
+double PayloadCompressor::headroom() {
+    using namespace std::chrono;
+    double wall = duration<double>(steady_clock::now().time_since_epoch()).count();
+    if (wall - lastWall < 0.1)
+        return cpuHeadroom;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+                 usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    if (lastWall > 0.0) {
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        double busy = (cpu - lastCpu) / ((wall - lastWall) * cores);
+        cpuHeadroom = std::min(1.0, std::max(0.05, 1.0 - busy));
+    }
+    lastWall = wall;
+    lastCpu = cpu;
+    return cpuHeadroom;
+}
+
+
+// Needs the lock.
+CompressCodec PayloadCompressor::choose(size_t size) {
+    ++payloads;
+    bool probe = payloads % PROBE_PERIOD == 0;
+
+    if (mode == MODE_FIXED) {
+        Stats &s = stats[fixed];
+        return (probe || s.ratio == 0.0 || s.ratio >= MIN_RATIO)
+             ? fixed : COMPRESS_NONE;
+    }
+
+    // Measure every available codec first, then probe them in turn
+    for (unsigned c = COMPRESS_LZ4; c < COMPRESS_NUM_CODECS; ++c) {
+        if (compressSupported((CompressCodec)c) && stats[c].calls == 0)
+            return (CompressCodec)c;
+    }
+    if (probe) {
+        for (unsigned i = 0; i < COMPRESS_NUM_CODECS - 1; ++i) {
+            unsigned c = COMPRESS_LZ4 + (probeNext++ % (COMPRESS_NUM_CODECS - 1));
+            if (compressSupported((CompressCodec)c))
+                return (CompressCodec)c;
+        }
+    }
+
+    double mb = size / 1e6;
+    double room = headroom();
+    CompressCodec best = COMPRESS_NONE;
+    double bestCost = mb / linkMBps;
+    for (unsigned c = COMPRESS_LZ4; c < COMPRESS_NUM_CODECS; ++c) {
+        Stats &s = stats[c];
+        if (!compressSupported((CompressCodec)c) || s.ratio < MIN_RATIO)
+            continue;
+        double cost = mb / s.mbps / room + mb / s.ratio / linkMBps;
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = (CompressCodec)c;
+        }
+    }
+    return best;
+}
+
+
+size_t PayloadCompressor::compress(const char *src, size_t size, char *dst,
+                                   size_t cap) {
+    if (mode == MODE_NONE || size < MIN_COMPRESS_SIZE || cap <= COMPRESS_FRAME_HDR)
+        return 0;
+
+    CompressCodec codec;
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        codec = choose(size);
+        if (codec == COMPRESS_NONE) {
+            stats[COMPRESS_NONE].rawBytes += size;
+            stats[COMPRESS_NONE].outBytes += size;
+            ++stats[COMPRESS_NONE].calls;
+            return 0;
+        }
+    }
+
+    auto stt = std::chrono::steady_clock::now();
+    size_t n = compressRaw(codec, src, size, dst + COMPRESS_FRAME_HDR,
+                           cap - COMPRESS_FRAME_HDR);
+    double secs = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - stt).count();
+
+    // Not smaller: the raw payload goes instead
+    size_t out = (n == 0 || n >= size) ? size : n;
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        Stats &s = stats[codec];
+        double ratio = (double)size / out;
+        double mbps = size / 1e6 / std::max(secs, 1e-7);
+        s.ratio = s.calls == 0 ? ratio : 0.8 * s.ratio + 0.2 * ratio;
+        s.mbps = s.calls == 0 ? mbps : 0.8 * s.mbps + 0.2 * mbps;
+        s.rawBytes += size;
+        s.outBytes += out;
+        ++s.calls;
+    }
+    if (out == size)
+        return 0;
+
+    unsigned hdr[2] = { (unsigned)codec, (unsigned)size };
+    memcpy(dst, hdr, sizeof(hdr));
+    return COMPRESS_FRAME_HDR + n;
+}
+
+
+std::string PayloadCompressor::report() {
+    std::lock_guard<std::mutex> lk(mtx);
+    std::string out = "compression " + name + ":";
+    char buf[128];
+    for (unsigned c = 0; c < COMPRESS_NUM_CODECS; ++c) {
+        Stats &s = stats[c];
+        if (s.calls == 0)
+            continue;
+        snprintf(buf, sizeof(buf), " %s %llu payloads %.1f MB -> %.1f MB;",
+                 CODEC_NAMES[c], s.calls, s.rawBytes / 1e6, s.outBytes / 1e6);
+        out += buf;
+    }
+    return out;
+}
@@ -0,0 +1,97 @@
+#ifndef __COMPRESS_HPP__
+#define __COMPRESS_HPP__
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+
+/**
+ *
+ * Lossless compression of bulk payloads (ghost rows, lambda tensors, weight
+ * updates). LZ4 and zstd are used when the build found them (HAVE_LZ4,
+ * HAVE_ZSTD, see CMakeLists.txt); otherwise payloads go raw.
+ *
+ * A compressed payload is framed as [codec][raw size][compressed bytes], so
+ * the receiver only needs a flag saying that the payload is framed.
+ *
+ */
+enum CompressCodec {
+    COMPRESS_NONE, COMPRESS_LZ4, COMPRESS_ZSTD, COMPRESS_NUM_CODECS
+};
+
+static const size_t COMPRESS_FRAME_HDR = sizeof(unsigned) * 2;
+// Payloads smaller than this are never compressed.
+static const size_t MIN_COMPRESS_SIZE = 4096;
+
+const char *compressCodecName(CompressCodec codec);
+bool compressSupported(CompressCodec codec);
+
+// Size of the frame of `size` raw bytes in the worst case.
+size_t compressFrameBound(size_t size);
+// Raw size of a framed payload.
+size_t framedRawSize(const char *frame);
+// Decompress a framed payload into `dst` (framedRawSize() bytes). Returns
+// false if the frame is corrupt or of an unsupported codec.
+bool decompressFrame(const char *frame, size_t frameSize, char *dst);
+
+
+/**
+ *
+ * Picks the codec of every payload, by mode:
+ *   none:      never compress.
+ *   lz4, zstd: always this codec, unless it stops paying off (ratio < 1.05),
+ *              in which case payloads go raw with periodic re-probes.
+ *   auto:      the codec with the lowest estimated cost, where
+ *                cost = compress time / CPU headroom + bytes out / link rate
+ *              and raw costs bytes / link rate. Ratio and speed of every codec
+ *              are measured on the payloads themselves; every PROBE_PERIOD-th
+ *              payload tries another codec to keep them current. CPU headroom
+ *              is the idle fraction of the cores, sampled from getrusage().
+ *
+ */
+class PayloadCompressor {
+public:
+    static const unsigned PROBE_PERIOD = 32;
+
+    bool init(const std::string &mode, double linkMBps = 600.0);
+    bool enabled() const { return mode != MODE_NONE; }
+    const std::string &modeName() const { return name; }
+
+    // Compress `size` bytes of `src` into a frame at `dst` of `cap` bytes
+    // (compressFrameBound(size) always fits). Returns the frame size, or 0 if
+    // the payload should go raw.
+    size_t compress(const char *src, size_t size, char *dst, size_t cap);
+
+    std::string report();
+
+private:
+    enum Mode { MODE_NONE, MODE_FIXED, MODE_AUTO };
+
+    struct Stats {
+        double ratio = 0.0;     // Raw / compressed, EWMA. 0 until measured.
+        double mbps = 0.0;      // Compression speed, EWMA.
+        unsigned long long rawBytes = 0;
+        unsigned long long outBytes = 0;
+        unsigned long long calls = 0;
+    };
+
+    CompressCodec choose(size_t size);
+    double headroom();
+
+    Mode mode = MODE_NONE;
+    std::string name = "none";
+    CompressCodec fixed = COMPRESS_NONE;
+    double linkMBps = 600.0;
+
+    std::mutex mtx;
+    Stats stats[COMPRESS_NUM_CODECS];
+    unsigned long long payloads = 0;
+    unsigned probeNext = 0;
+
+    double cpuHeadroom = 1.0;
+    double lastWall = 0.0;
+    double lastCpu = 0.0;
+};
+
+#endif // __COMPRESS_HPP__
@@ -32,6 +32,8 @@ typedef float EdgeType;
 // OP, TENSOR_NAME, FIELD0, FIELD1, ...
 static const size_t TENSOR_NAME_SIZE = 8;
 static const size_t TENSOR_HDR_SIZE = sizeof(unsigned) * 5 + TENSOR_NAME_SIZE;
+// Header field set to 1 when the tensor data is a compressed frame (compress.hpp).
+static const unsigned TENSOR_FRAMED_FIELD = 6;
 enum OP {
     REQ_VTX_FORWARD, PUSH_VTX_FORWARD, PULL_VTX_FORWARD,
     REQ_VTX_BACKWARD, PUSH_VTX_BACKWARD, PULL_VTX_BACKWARD,
@@ -73,19 +75,30 @@ struct Chunk {
 
     bool vertex;
 
-    bool operator<(const Chunk &rhs) const {
-        // TODO: (YIFAN) Assign priority in the computation sequence
+    // Whether this chunk is at a later pipeline stage than rhs.
+    bool laterStage(const Chunk &rhs) const {
         return
             epoch > rhs.epoch || (epoch == rhs.epoch && (
             dir > rhs.dir || (dir == rhs.dir && (
             (dir == PROP_TYPE::FORWARD && layer > rhs.layer) ||
             (dir == PROP_TYPE::BACKWARD && layer < rhs.layer) || (layer == rhs.layer && (
             (dir == PROP_TYPE::FORWARD && !vertex && rhs.vertex) ||
-            (dir == PROP_TYPE::BACKWARD && vertex && !rhs.vertex) || (vertex == rhs.vertex && (
+            (dir == PROP_TYPE::BACKWARD && vertex && !rhs.vertex)))))));
+    }
+
+    bool sameStage(const Chunk &rhs) const {
+        return epoch == rhs.epoch && dir == rhs.dir &&
+               layer == rhs.layer && vertex == rhs.vertex;
+    }
+
+    // Stage first, then ids. Priorities within a stage are assigned by the
+    // graph server's ChunkPolicy.
+    bool operator<(const Chunk &rhs) const {
+        return laterStage(rhs) || (sameStage(rhs) && (
             localId > rhs.localId || (localId == rhs.localId && (
             globalId > rhs.globalId || (globalId == rhs.globalId && (
             lowBound > rhs.lowBound || (lowBound == rhs.lowBound && (
-            upBound > rhs.upBound))))))))))))));
+            upBound > rhs.upBound))))))));
     }
 
     std::string str() const {
@@ -30,6 +30,9 @@ using namespace aws::lambda_runtime;
 using namespace std::chrono;
 
 
+// Tensors back to the graph server, in the mode it asked for
+static PayloadCompressor tensorCompressor;
+
 #define IDENTITY_SIZE (sizeof(Chunk) + sizeof(unsigned))
 std::vector<char> constructIdentity(Chunk &chunk) {
     std::vector<char> identity(IDENTITY_SIZE);
@@ -253,7 +256,7 @@ apply_vertex(zmq::socket_t& data_socket, zmq::socket_t& weights_socket, Chunk &c
 
     std::vector<Matrix> toSend = {Z};
     std::cout << "Sending Z tensor" << std::endl;
-    int ret = sendTensors(data_socket, chunk, toSend, true);
+    int ret = sendTensors(data_socket, chunk, toSend, true, &tensorCompressor);
     std::cout << "Fin send" << std::endl;
 
     for (auto& M : toSend)
@@ -312,7 +315,7 @@ apply_vertex_backward(zmq::socket_t& data_socket, zmq::socket_t& weights_socket,
         std::vector<Matrix> toSend;
         toSend.push_back(resultsGrad);
         std::cout << "Sending grad tensor" << std::endl;
-        sendTensors(data_socket, chunk, toSend, true);
+        sendTensors(data_socket, chunk, toSend, true, &tensorCompressor);
         std::cout << "Fin send" << std::endl;
         deleteMatrix(resultsGrad);
     } else {
@@ -416,6 +419,8 @@ my_handler(invocation_request const& request) {
     chunk.dir = static_cast<PROP_TYPE>(v.GetInteger("dir"));
     chunk.epoch = v.GetInteger("epoch");
     chunk.vertex = v.GetInteger("vtx");
+    tensorCompressor.init(v.ValueExists("compression")
+                          ? v.GetString("compression") : "none");
 
     std::cout << "[ACCEPTED] Thread " << chunk.str() << " is requested from "
               << dataserver << ":" << dport << ", FORWARD layer " << chunk.layer
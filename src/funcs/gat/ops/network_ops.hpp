@@ -7,6 +7,7 @@
 
 #include "../../../common/matrix.hpp"
 #include "../../../common/utils.hpp"
+#include "../../../common/compress.hpp"
 
 #include "../utils.hpp"
 
@@ -27,8 +28,10 @@ Matrix reqEdgeTensor(zmq::socket_t& socket, Chunk& chunk, std::string name);
 
 EdgeInfo reqEdgeInfo(zmq::socket_t& socket, Chunk& chunk);
 
+// Tensors are compressed if `compressor` is given and enabled.
 int sendTensors(zmq::socket_t& socket, Chunk &chunk,
-    std::vector<Matrix>& matrices, bool ack = false);
+    std::vector<Matrix>& matrices, bool ack = false,
+    PayloadCompressor *compressor = NULL);
 
 int sendEdgeTensors(zmq::socket_t& socket, Chunk& chunk,
         std::vector<Matrix>& matrices, bool ack = false);
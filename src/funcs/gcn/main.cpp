@@ -29,6 +29,9 @@ using namespace Aws::Utils::Json;
 using namespace aws::lambda_runtime;
 using namespace std::chrono;
 
+// Tensors back to the graph server, in the mode it asked for
+static PayloadCompressor tensorCompressor;
+
 #define IDENTITY_SIZE (sizeof(Chunk) + sizeof(unsigned))
 std::vector<char> constructIdentity(Chunk &chunk) {
     std::vector<char> identity(IDENTITY_SIZE);
@@ -111,7 +114,7 @@ finalLayer(zmq::socket_t& data_socket, zmq::socket_t& weights_socket, Chunk &chu
     std::cout << "Send interGrad" << std::endl;
     interGrad.setName("grad");
     std::vector<Matrix> toSend{interGrad};
-    int ret = sendTensors(data_socket, chunk, toSend, true);
+    int ret = sendTensors(data_socket, chunk, toSend, true, &tensorCompressor);
     // Clean up data
     for (auto& M : toSend)
         deleteMatrix(M);
@@ -189,7 +192,7 @@ backwardLayer(zmq::socket_t& data_socket, zmq::socket_t& weights_socket, Chunk &
     std::vector<Matrix> toSend{resultGrad};
     int ret = 0;
     if (chunk.layer > 0) { // not the last layer
-        ret = sendTensors(data_socket, chunk, toSend, true);
+        ret = sendTensors(data_socket, chunk, toSend, true, &tensorCompressor);
     } else { // the last backward layer (layer 0), skip sending the grad back
         ret = sendFinMsg(data_socket, chunk);
     }
@@ -256,7 +259,7 @@ forwardLayer(zmq::socket_t& data_socket, zmq::socket_t& weights_socket, Chunk &c
     toSend.push_back(H_l);
 
     std::cout << "Send tensors Z, H" << std::endl;
-    int ret = sendTensors(data_socket, chunk, toSend, true);
+    int ret = sendTensors(data_socket, chunk, toSend, true, &tensorCompressor);
     std::cout << "Fin send" << std::endl;
     // Clean up data
     for (auto& M : toSend)
@@ -354,6 +357,8 @@ my_handler(invocation_request const& request) {
     chunk.dir = static_cast<PROP_TYPE>(v.GetInteger("dir"));
     chunk.epoch = v.GetInteger("epoch");
     chunk.vertex = v.GetInteger("vtx");
+    tensorCompressor.init(v.ValueExists("compression")
+                          ? v.GetString("compression") : "none");
 
     std::cout << "[ACCEPTED] Thread " << chunk.str() << " is requested from "
               << dataserver << ":" << dport << ", FORWARD layer " << chunk.layer
@@ -23,7 +23,16 @@ int recvTensor(zmq::socket_t& socket, Matrix &mat) {
     unsigned cols = parse<unsigned>((char*)tensorHeader.data(), 4);
 
     FeatType* data = new FeatType[rows * cols];
-    std::memcpy(data, tensorData.data(), tensorData.size());
+    if (parse<unsigned>((char*)tensorHeader.data(), TENSOR_FRAMED_FIELD)) {
+        if (framedRawSize((char*)tensorData.data()) != rows * cols * sizeof(FeatType) ||
+            !decompressFrame((char*)tensorData.data(), tensorData.size(), (char*)data)) {
+            std::cerr << "Corrupt compressed tensor " << name << std::endl;
+            delete[] data;
+            return -1;
+        }
+    } else {
+        std::memcpy(data, tensorData.data(), tensorData.size());
+    }
 
     mat.setName(name.c_str());
     mat.setRows(rows);
@@ -102,17 +111,28 @@ std::vector<Matrix> reqTensors(zmq::socket_t& socket, Chunk &chunk,
 }
 
 int sendTensors(zmq::socket_t& socket, Chunk &chunk,
-            std::vector<Matrix>& matrices, bool ack) {
+            std::vector<Matrix>& matrices, bool ack,
+            PayloadCompressor *compressor) {
     zmq::message_t header(HEADER_SIZE);
     populateHeader(header.data(), OP::PUSH, chunk);
     socket.send(header, ZMQ_SNDMORE);
     for (uint32_t u = 0; u < matrices.size(); ++u) {
         std::cout << "Sending tensor " << matrices[u].name() << std::endl;
+        size_t dataSize = matrices[u].getDataSize();
+        std::vector<char> frame;
+        size_t frameSize = 0;
+        if (compressor && compressor->enabled()) {
+            frame.resize(compressFrameBound(dataSize));
+            frameSize = compressor->compress((char*)matrices[u].getData(), dataSize,
+                                             frame.data(), frame.size());
+        }
+        zmq::message_t tensorData(frameSize > 0 ? frameSize : dataSize);
+        std::memcpy(tensorData.data(),
+                    frameSize > 0 ? frame.data() : (char*)matrices[u].getData(),
+                    tensorData.size());
         zmq::message_t tensorHeader(TENSOR_HDR_SIZE);
         populateHeader(tensorHeader.data(), OP::PUSH, matrices[u].name().c_str(), chunk.layer,
-          matrices[u].getRows(), matrices[u].getCols());
-        zmq::message_t tensorData(matrices[u].getDataSize());
-        std::memcpy(tensorData.data(), matrices[u].getData(), matrices[u].getDataSize());
+          matrices[u].getRows(), matrices[u].getCols(), frameSize > 0);
 
         socket.send(tensorHeader, ZMQ_SNDMORE);
         if (u < matrices.size() - 1) {
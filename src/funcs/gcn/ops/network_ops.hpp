@@ -7,6 +7,7 @@
 
 #include "../../../common/matrix.hpp"
 #include "../../../common/utils.hpp"
+#include "../../../common/compress.hpp"
 
 #include "../utils.hpp"
 
@@ -22,8 +23,10 @@ int recvTensor(zmq::socket_t& socket, Matrix &mat);
 std::vector<Matrix> reqTensors(zmq::socket_t& socket, Chunk &chunk,
                             std::vector<std::string>& tensorRequests);
 
+// Tensors are compressed if `compressor` is given and enabled.
 int sendTensors(zmq::socket_t& socket, Chunk &chunk,
-    std::vector<Matrix>& matrices, bool ack = false);
+    std::vector<Matrix>& matrices, bool ack = false,
+    PayloadCompressor *compressor = NULL);
 
 void sendAccLoss(zmq::socket_t &dsocket, zmq::socket_t &wsocket, Matrix &predicts, Matrix &labels, Chunk &chunk);
 
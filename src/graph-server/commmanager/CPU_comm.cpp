@@ -16,6 +16,7 @@ CPUComm::CPUComm(Engine *engine_)
         free(addr);
     }
 
+    msgService.setNumChunks(engine->numLambdasForward);
     msgService.prefetchWeightsMatrix();
 }
 
@@ -24,90 +25,92 @@ void CPUComm::NNCompute(Chunk &chunk) {
     if (chunk.vertex) {
         if (chunk.dir == PROP_TYPE::FORWARD) {
             // printLog(nodeId, "CPU FORWARD vtx NN started");
-            vtxNNForward(layer, layer == (totalLayers - 1));
+            vtxNNForward(chunk, layer == (totalLayers - 1));
         } else {
             // printLog(nodeId, "CPU BACKWARD vtx NN started");
-            vtxNNBackward(layer);
+            vtxNNBackward(chunk);
         }
     } else {
         layer--; // YIFAN: fix this
         if (chunk.dir == PROP_TYPE::FORWARD) {
             // printLog(nodeId, "CPU FORWARD edg NN started");
-            edgNNForward(layer, layer == (totalLayers - 1));
+            edgNNForward(chunk, layer == (totalLayers - 1));
         } else {
             // printLog(nodeId, "CPU BACKWARD edg NN started");
-            edgNNBackward(layer);
+            edgNNBackward(chunk);
         }
     }
     // printLog(nodeId, "CPU NN Done");
     NNRecvCallback(engine, chunk);
 }
 
-void CPUComm::vtxNNForward(unsigned layer, bool lastLayer) {
+void CPUComm::vtxNNForward(Chunk &chunk, bool lastLayer) {
     switch (gnn_type) {
         case GNN::GCN:
-            vtxNNForwardGCN(layer, lastLayer);
+            vtxNNForwardGCN(chunk, lastLayer);
             break;
         case GNN::GAT:
-            vtxNNForwardGAT(layer, lastLayer);
+            vtxNNForwardGAT(chunk, lastLayer);
             break;
         default:
             abort();
     }
 }
 
-void CPUComm::vtxNNBackward(unsigned layer) {
+void CPUComm::vtxNNBackward(Chunk &chunk) {
     switch (gnn_type) {
         case GNN::GCN:
-            vtxNNBackwardGCN(layer);
+            vtxNNBackwardGCN(chunk);
             break;
         case GNN::GAT:
-            vtxNNBackwardGAT(layer);
+            vtxNNBackwardGAT(chunk);
             break;
         default:
             abort();
     }
 }
 
-void CPUComm::edgNNForward(unsigned layer, bool lastLayer) {
+void CPUComm::edgNNForward(Chunk &chunk, bool lastLayer) {
     switch (gnn_type) {
         case GNN::GCN:
-            edgNNForwardGCN(layer, lastLayer);
+            edgNNForwardGCN(chunk, lastLayer);
             break;
         case GNN::GAT:
-            edgNNForwardGAT(layer, lastLayer);
+            edgNNForwardGAT(chunk, lastLayer);
             break;
         default:
             abort();
     }
 }
 
-void CPUComm::edgNNBackward(unsigned layer) {
+void CPUComm::edgNNBackward(Chunk &chunk) {
     switch (gnn_type) {
         case GNN::GCN:
-            edgNNBackwardGCN(layer);
+            edgNNBackwardGCN(chunk);
             break;
         case GNN::GAT:
-            edgNNBackwardGAT(layer);
+            edgNNBackwardGAT(chunk);
             break;
         default:
             abort();
     }
 }
 
-void CPUComm::vtxNNForwardGCN(unsigned layer, bool lastLayer) {
-    Matrix feats = savedNNTensors[layer]["ah"];
+void CPUComm::vtxNNForwardGCN(Chunk &chunk, bool lastLayer) {
+    unsigned layer = chunk.layer;
+    Matrix feats = rowSlice(savedNNTensors[layer]["ah"], chunk);
     Matrix weight = msgService.getWeightMatrix(layer);
     Matrix z = feats.dot(weight);
     if (!lastLayer) {
-        memcpy(savedNNTensors[layer]["z"].getData(), z.getData(), z.getDataSize());
+        memcpy(savedNNTensors[layer]["z"].get(chunk.lowBound), z.getData(),
+               z.getDataSize());
         Matrix act_z = activate(z);  // z data get activated ...
-        memcpy(savedNNTensors[layer]["h"].getData(), act_z.getData(),
+        memcpy(savedNNTensors[layer]["h"].get(chunk.lowBound), act_z.getData(),
                act_z.getDataSize());
         deleteMatrix(act_z);
     } else {
         Matrix predictions = softmax(z);
-        Matrix labels = savedNNTensors[layer]["lab"];
+        Matrix labels = rowSlice(savedNNTensors[layer]["lab"], chunk);
 
         float acc, loss;
         getTrainStat(predictions, labels, acc, loss);
@@ -121,11 +124,10 @@ void CPUComm::vtxNNForwardGCN(unsigned layer, bool lastLayer) {
         d_output /= engine->graph.globalVtxCnt * TRAIN_PORTION; // Averaging init backward gradient
         Matrix weight = msgService.getWeightMatrix(layer);
         Matrix interGrad = d_output.dot(weight, false, true);
-        memcpy(savedNNTensors[layer]["grad"].getData(), interGrad.getData(),
-               interGrad.getDataSize());
+        memcpy(savedNNTensors[layer]["grad"].get(chunk.lowBound),
+               interGrad.getData(), interGrad.getDataSize());
 
-        Matrix ah = savedNNTensors[layer]["ah"];
-        Matrix weightUpdates = ah.dot(d_output, true, false);
+        Matrix weightUpdates = feats.dot(d_output, true, false);
         msgService.sendWeightUpdate(weightUpdates, layer);
         deleteMatrix(interGrad);
         deleteMatrix(d_output);
@@ -134,79 +136,92 @@ void CPUComm::vtxNNForwardGCN(unsigned layer, bool lastLayer) {
     deleteMatrix(z);
 }
 
-void CPUComm::vtxNNBackwardGCN(unsigned layer) {
+void CPUComm::vtxNNBackwardGCN(Chunk &chunk) {
+    unsigned layer = chunk.layer;
     Matrix weight = msgService.getWeightMatrix(layer);
-    Matrix grad = savedNNTensors[layer]["aTg"];
-    Matrix z = savedNNTensors[layer]["z"];
+    Matrix grad = rowSlice(savedNNTensors[layer]["aTg"], chunk);
+    Matrix z = rowSlice(savedNNTensors[layer]["z"], chunk);
 
     Matrix actDeriv = activateDerivative(z);
     Matrix interGrad = grad * actDeriv;
 
-    Matrix ah = savedNNTensors[layer]["ah"];
+    Matrix ah = rowSlice(savedNNTensors[layer]["ah"], chunk);
     Matrix weightUpdates = ah.dot(interGrad, true, false);
-    msgService.sendWeightUpdate(weightUpdates, layer);
+    bool lastChunk = msgService.sendWeightUpdate(weightUpdates, layer);
     if (layer != 0) {
         Matrix resultGrad = interGrad.dot(weight, false, true);
-        memcpy(savedNNTensors[layer]["grad"].getData(), resultGrad.getData(),
-               resultGrad.getDataSize());
+        memcpy(savedNNTensors[layer]["grad"].get(chunk.lowBound),
+               resultGrad.getData(), resultGrad.getDataSize());
         deleteMatrix(resultGrad);
     }
 
     deleteMatrix(actDeriv);
     deleteMatrix(interGrad);
 
-    if (layer == 0) msgService.prefetchWeightsMatrix();
+    if (layer == 0 && lastChunk) msgService.prefetchWeightsMatrix();
 }
 
-void CPUComm::vtxNNForwardGAT(unsigned layer, bool lastLayer) {
+void CPUComm::vtxNNForwardGAT(Chunk &chunk, bool lastLayer) {
+    unsigned layer = chunk.layer;
     Matrix feats = layer == 0
-                 ? savedNNTensors[layer]["h"]
-                 : savedNNTensors[layer - 1]["ah"];
+                 ? rowSlice(savedNNTensors[layer]["h"], chunk)
+                 : rowSlice(savedNNTensors[layer - 1]["ah"], chunk);
     Matrix weight = msgService.getWeightMatrix(layer);
     Matrix z = feats.dot(weight);
-    memcpy(savedNNTensors[layer]["z"].getData(), z.getData(), z.getDataSize());
+    memcpy(savedNNTensors[layer]["z"].get(chunk.lowBound), z.getData(),
+           z.getDataSize());
     deleteMatrix(z);
 }
 
-void CPUComm::vtxNNBackwardGAT(unsigned layer) {
+void CPUComm::vtxNNBackwardGAT(Chunk &chunk) {
+    unsigned layer = chunk.layer;
     Matrix weight = msgService.getWeightMatrix(layer);
-    Matrix grad = savedNNTensors[layer]["aTg"];
+    Matrix grad = rowSlice(savedNNTensors[layer]["aTg"], chunk);
     Matrix h = layer == 0
-             ? savedNNTensors[layer]["h"]
-             : savedNNTensors[layer - 1]["ah"];
+             ? rowSlice(savedNNTensors[layer]["h"], chunk)
+             : rowSlice(savedNNTensors[layer - 1]["ah"], chunk);
 
     Matrix weightUpdates = h.dot(grad, true, false);
-    msgService.sendWeightUpdate(weightUpdates, layer);
+    bool lastChunk = msgService.sendWeightUpdate(weightUpdates, layer);
 
     if (layer != 0) {
         Matrix resultGrad = grad.dot(weight, false, true);
-        memcpy(savedNNTensors[layer - 1]["grad"].getData(), resultGrad.getData(),
-               resultGrad.getDataSize());
+        memcpy(savedNNTensors[layer - 1]["grad"].get(chunk.lowBound),
+               resultGrad.getData(), resultGrad.getDataSize());
         resultGrad.free();
     }
-    if (layer == 0) msgService.prefetchWeightsMatrix();
+    if (layer == 0 && lastChunk) msgService.prefetchWeightsMatrix();
 }
 
-void CPUComm::edgNNForwardGAT(unsigned layer, bool lastLayer) {
+void CPUComm::edgNNForwardGAT(Chunk &chunk, bool lastLayer) {
+    unsigned layer = chunk.layer - 1; // YIFAN: fix this
     Matrix a = msgService.getaMatrix(layer); // YIFAN: fix this
     unsigned featLayer = layer; // YIFAN: fix this
     Matrix z = savedNNTensors[featLayer]["z"];
+    // In-edges of the chunk's vertices
+    unsigned long long eStt = engine->graph.forwardAdj.columnPtrs[chunk.lowBound];
 
     // expand and dot
-    Matrix zaTensor = expandDot(z, a, engine->graph.forwardAdj);
-    memcpy(savedNNTensors[featLayer]["az"].getData(), zaTensor.getData(), zaTensor.getDataSize());
+    Matrix zaTensor = expandDot(z, a, engine->graph.forwardAdj,
+                                chunk.lowBound, chunk.upBound);
+    memcpy(savedNNTensors[featLayer]["az"].get(eStt), zaTensor.getData(),
+           zaTensor.getDataSize());
     Matrix outputTensor = leakyRelu(zaTensor);
     zaTensor.free();
 
-    memcpy(savedNNTensors[featLayer]["A"].getData(), outputTensor.getData(), outputTensor.getDataSize());
+    memcpy(savedNNTensors[featLayer]["A"].get(eStt), outputTensor.getData(),
+           outputTensor.getDataSize());
     outputTensor.free();
 }
 
-void CPUComm::edgNNBackwardGAT(unsigned layer) {
+void CPUComm::edgNNBackwardGAT(Chunk &chunk) {
+    unsigned layer = chunk.layer - 1;
     Matrix a = msgService.getaMatrix(layer);
     unsigned featLayer = layer;
+    unsigned long long eStt = engine->graph.forwardAdj.columnPtrs[chunk.lowBound];
+    unsigned long long eEnd = engine->graph.forwardAdj.columnPtrs[chunk.upBound];
     Matrix gradTensor = savedNNTensors[featLayer]["grad"];
-    Matrix zaTensor = savedNNTensors[featLayer]["az"];
+    Matrix zaTensor(eEnd - eStt, 1, savedNNTensors[featLayer]["az"].get(eStt));
     Matrix localZTensor = savedNNTensors[featLayer]["z"]; // serve as Z_dst, and part of Z_src
     // Matrix ghostZTensor = savedNNTensors[featLayer]["fg_z"]; // serve as part of Z_src
     // FeatType **fedge = engine->savedEdgeTensors[featLayer]["fedge"]; // This serves the purpose of Z_src and Z_dst
@@ -217,12 +232,13 @@ void CPUComm::edgNNBackwardGAT(unsigned layer) {
     Matrix dLRelu = leakyReluBackward(zaTensor);
     // expand dP to (|E|, featDim) and element-wise multiply dLRelu
     // Shape of dAct is (|E|, featDim)
-    Matrix dAct = expandHadamardMul(gradTensor, dLRelu, engine->graph.forwardAdj);
+    Matrix dAct = expandHadamardMul(gradTensor, dLRelu, engine->graph.forwardAdj,
+                                    chunk.lowBound, chunk.upBound);
     dLRelu.free();
 
     // Shape of dA: (|E|, 1), serve as gradient of each edge for backward agg
     Matrix dA = dAct.dot(a);
-    memcpy(savedNNTensors[featLayer]["dA"].getData(), dA.getData(), dA.getDataSize());
+    memcpy(savedNNTensors[featLayer]["dA"].get(eStt), dA.getData(), dA.getDataSize());
     dA.free();
 
     // reduce dAct(|E|, featDim) to (1, featDim)
@@ -232,11 +248,12 @@ void CPUComm::edgNNBackwardGAT(unsigned layer) {
     // // Expand Z_src and Z_dst (both have shape (|V|, featDim)) to (|E|, featDim)
     // // And then do Z_dst^T \dot Z_src -> zz (featDim, featDim)
     // Matrix zz = expandMulZZ(fedge, edgCnt, featDim);
-    Matrix zz = localZTensor.dot(localZTensor, true, false);
-    // (1, featDim) \dot (featDim, featDim) -> (1, featDim), which is da's shape
-    Matrix da = zz.dot(dAct_reduce, false, true);
+    // da = (Z^T \dot Z) \dot dAct_reduce^T. Multiply from the right so each
+    // chunk only costs two (|V|, featDim) passes instead of building zz.
+    Matrix zr = localZTensor.dot(dAct_reduce, false, true);
+    Matrix da = localZTensor.dot(zr, true, false);
     dAct_reduce.free();
-    zz.free();
+    zr.free();
     msgService.sendaUpdate(da, layer);
     // da.free();
 }
@@ -296,21 +313,23 @@ Matrix softmax(Matrix &mat) {
     return Matrix(mat.getRows(), mat.getCols(), result);
 }
 
-Matrix expandDot(Matrix &m, Matrix &v, CSCMatrix<EdgeType> &forwardAdj) {
-    FeatType *outputData = new FeatType[forwardAdj.nnz];
-    Matrix outputTensor(forwardAdj.nnz, 1, outputData);
+Matrix expandDot(Matrix &m, Matrix &v, CSCMatrix<EdgeType> &forwardAdj,
+                 unsigned lowBound, unsigned upBound) {
+    unsigned long long eStt = forwardAdj.columnPtrs[lowBound];
+    unsigned long long edgCnt = forwardAdj.columnPtrs[upBound] - eStt;
+    FeatType *outputData = new FeatType[edgCnt];
+    Matrix outputTensor(edgCnt, 1, outputData);
     memset(outputData, 0, outputTensor.getDataSize());
 
-    unsigned vtcsCnt = m.getRows();
     unsigned featDim = m.getCols();
     FeatType *vPtr = v.getData();
 #pragma omp parallel for
-    for (unsigned lvid = 0; lvid < vtcsCnt; lvid++) {
+    for (unsigned lvid = lowBound; lvid < upBound; lvid++) {
         FeatType *mPtr = m.get(lvid);
         for (unsigned long long eid = forwardAdj.columnPtrs[lvid];
             eid < forwardAdj.columnPtrs[lvid + 1]; ++eid) {
             for (unsigned j = 0; j < featDim; ++j) {
-                outputData[eid] += mPtr[j] * vPtr[j];
+                outputData[eid - eStt] += mPtr[j] * vPtr[j];
             }
         }
     }
@@ -318,21 +337,22 @@ Matrix expandDot(Matrix &m, Matrix &v, CSCMatrix<EdgeType> &forwardAdj) {
     return outputTensor;
 }
 
-Matrix expandHadamardMul(Matrix &m, Matrix &v, CSCMatrix<EdgeType> &forwardAdj) {
-    unsigned vtcsCnt = m.getRows();
+Matrix expandHadamardMul(Matrix &m, Matrix &v, CSCMatrix<EdgeType> &forwardAdj,
+                         unsigned lowBound, unsigned upBound) {
     unsigned featDim = m.getCols();
-    unsigned edgCnt = forwardAdj.nnz;
+    unsigned long long eStt = forwardAdj.columnPtrs[lowBound];
+    unsigned long long edgCnt = forwardAdj.columnPtrs[upBound] - eStt;
 
     FeatType *outputData = new FeatType[edgCnt * featDim];
-    Matrix outputTensor(forwardAdj.nnz, featDim, outputData);
+    Matrix outputTensor(edgCnt, featDim, outputData);
     memset(outputData, 0, outputTensor.getDataSize());
 
     FeatType *vPtr = v.getData();
 #pragma omp parallel for
-    for (unsigned lvid = 0; lvid < vtcsCnt; lvid++) {
+    for (unsigned lvid = lowBound; lvid < upBound; lvid++) {
         FeatType *mPtr = m.get(lvid);
-        for (unsigned long long eid = forwardAdj.columnPtrs[lvid];
-            eid < forwardAdj.columnPtrs[lvid + 1]; ++eid) {
+        for (unsigned long long eid = forwardAdj.columnPtrs[lvid] - eStt;
+            eid < forwardAdj.columnPtrs[lvid + 1] - eStt; ++eid) {
             FeatType normFactor = vPtr[eid];
             for (unsigned j = 0; j < featDim; ++j) {
                 outputData[eid * featDim + j] = mPtr[j] * normFactor;
@@ -367,7 +387,7 @@ Matrix reduce(Matrix &mat) {
     unsigned edgCnt = mat.getRows();
     unsigned featDim = mat.getCols();
 
-    FeatType *outputData = new FeatType[featDim];
+    FeatType *outputData = new FeatType[featDim]();
     Matrix outputTensor(1, featDim, outputData);
 
     FeatType *mPtr = mat.getData();
@@ -475,4 +495,9 @@ void deleteMatrix(Matrix &mat) {
         delete[] mat.getData();
         mat = Matrix();
     }
-}
\ No newline at end of file
+}
+
+Matrix rowSlice(Matrix &mat, const Chunk &chunk) {
+    return Matrix(chunk.upBound - chunk.lowBound, mat.getCols(),
+                  mat.get(chunk.lowBound));
+}
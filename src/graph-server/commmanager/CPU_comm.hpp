@@ -23,15 +23,19 @@ class CPUComm : public ResourceComm {
 public:
     CPUComm(Engine *engine_);
 
+    // Chunks only touch their own rows (vertices) of the saved tensors, so
+    // several AV workers can compute different chunks at the same time.
     void NNCompute(Chunk &chunk);
+    bool concurrentNNCompute() { return true; };
     void prefetchWeights() { msgService.prefetchWeightsMatrix(); };
+    void setChunkCnt(unsigned chunkCnt) { msgService.setNumChunks(chunkCnt); };
 
 private:
     // compute related
-    void vtxNNForward(unsigned layer, bool lastLayer);
-    void vtxNNBackward(unsigned layer);
-    void edgNNForward(unsigned layer, bool lastLayer);
-    void edgNNBackward(unsigned layer);
+    void vtxNNForward(Chunk &chunk, bool lastLayer);
+    void vtxNNBackward(Chunk &chunk);
+    void edgNNForward(Chunk &chunk, bool lastLayer);
+    void edgNNBackward(Chunk &chunk);
 
     void getTrainStat(Matrix &preds, Matrix &labels, float &acc,
                            float &loss);
@@ -54,15 +58,15 @@ private:
     MessageService msgService;
 
     // GCN specific
-    void vtxNNForwardGCN(unsigned layer, bool lastLayer);
-    void vtxNNBackwardGCN(unsigned layer);
-    void edgNNForwardGCN(unsigned layer, bool lastLayer) {}
-    void edgNNBackwardGCN(unsigned layer) {}
+    void vtxNNForwardGCN(Chunk &chunk, bool lastLayer);
+    void vtxNNBackwardGCN(Chunk &chunk);
+    void edgNNForwardGCN(Chunk &chunk, bool lastLayer) {}
+    void edgNNBackwardGCN(Chunk &chunk) {}
     // GAT specific
-    void vtxNNForwardGAT(unsigned layer, bool lastLayer);
-    void vtxNNBackwardGAT(unsigned layer);
-    void edgNNForwardGAT(unsigned layer, bool lastLayer);
-    void edgNNBackwardGAT(unsigned layer);
+    void vtxNNForwardGAT(Chunk &chunk, bool lastLayer);
+    void vtxNNBackwardGAT(Chunk &chunk);
+    void edgNNForwardGAT(Chunk &chunk, bool lastLayer);
+    void edgNNBackwardGAT(Chunk &chunk);
 };
 
 Matrix activateDerivative(Matrix &mat);
@@ -71,8 +75,10 @@ Matrix hadamardSub(Matrix &A, Matrix &B);
 Matrix softmax(Matrix &mat);
 Matrix activate(Matrix &mat);
 // GAT compute utils
-Matrix expandDot(Matrix &m, Matrix &v, CSCMatrix<EdgeType> &forwardAdj);
-Matrix expandHadamardMul(Matrix &m, Matrix &v, CSCMatrix<EdgeType> &forwardAdj);
+Matrix expandDot(Matrix &m, Matrix &v, CSCMatrix<EdgeType> &forwardAdj,
+                 unsigned lowBound, unsigned upBound);
+Matrix expandHadamardMul(Matrix &m, Matrix &v, CSCMatrix<EdgeType> &forwardAdj,
+                         unsigned lowBound, unsigned upBound);
 Matrix expandMulZZ(FeatType **edgFeats, unsigned edgCnt, unsigned featDim);
 Matrix reduce(Matrix &mat);
 
@@ -83,4 +89,6 @@ void loadWeightServers(std::vector<char *> &addresses,
                        const std::string &wServersFile);
 
 void deleteMatrix(Matrix &mat);
+// Rows [chunk.lowBound, chunk.upBound) of mat, sharing its data.
+Matrix rowSlice(Matrix &mat, const Chunk &chunk);
 #endif  // CPU_COMM_HPP
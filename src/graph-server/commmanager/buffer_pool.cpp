@@ -0,0 +1,68 @@
+#include "buffer_pool.hpp"
+
+
+/** Oversized buffers are handed to zmq with this hint and freed on release. */
+static char OVERSIZED;
+
+
+BufferPool::~BufferPool() {
+    for (char *buf : freeBufs)
+        delete[] buf;
+}
+
+
+void
+BufferPool::init(size_t bufSize_, unsigned maxFree_) {
+    bufSize = bufSize_;
+    maxFree = maxFree_;
+    freeBufs.reserve(maxFree);
+}
+
+
+zmq::message_t
+BufferPool::message(size_t size) {
+    if (size > bufSize)
+        return zmq::message_t(new char[size], size, release, &OVERSIZED);
+    return message(get(), size);
+}
+
+
+char *
+BufferPool::get() {
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (!freeBufs.empty()) {
+            char *buf = freeBufs.back();
+            freeBufs.pop_back();
+            return buf;
+        }
+    }
+    return new char[bufSize];
+}
+
+
+void
+BufferPool::put(char *buf) {
+    release(buf, this);
+}
+
+
+zmq::message_t
+BufferPool::message(char *buf, size_t size) {
+    return zmq::message_t(buf, size, release, this);
+}
+
+
+void
+BufferPool::release(void *data, void *hint) {
+    char *buf = (char *) data;
+    if (hint != &OVERSIZED) {
+        BufferPool *pool = (BufferPool *) hint;
+        std::lock_guard<std::mutex> lk(pool->mtx);
+        if (pool->freeBufs.size() < pool->maxFree) {
+            pool->freeBufs.push_back(buf);
+            return;
+        }
+    }
+    delete[] buf;
+}
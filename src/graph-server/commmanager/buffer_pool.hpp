@@ -0,0 +1,49 @@
+#ifndef __BUFFER_POOL_HPP__
+#define __BUFFER_POOL_HPP__
+
+
+#include <mutex>
+#include <vector>
+#include <zmq.hpp>
+
+
+/**
+ *
+ * Pool of fixed-size send buffers.
+ *
+ * message() builds a zmq message over a pooled buffer, so the sender writes
+ * its payload straight into the message. zmq calls release() once the message
+ * is out (possibly from its I/O thread), which hands the buffer back to the
+ * pool. Messages larger than a buffer get a buffer of their own, freed the
+ * same way. The pool must outlive the zmq context the messages are sent on.
+ *
+ */
+class BufferPool {
+public:
+    BufferPool() {};
+    ~BufferPool();
+
+    // Buffers of `bufSize` bytes; at most `maxFree` idle buffers are kept.
+    void init(size_t bufSize_, unsigned maxFree_);
+    zmq::message_t message(size_t size);
+
+    // Raw buffers of bufferSize() bytes, for payloads whose size is only known
+    // once they are written. Send one with message(buf, size) or give it back
+    // with put().
+    size_t bufferSize() const { return bufSize; }
+    char *get();
+    void put(char *buf);
+    zmq::message_t message(char *buf, size_t size);
+
+private:
+    static void release(void *data, void *hint);
+
+    size_t bufSize = 0;
+    unsigned maxFree = 0;
+
+    std::mutex mtx;
+    std::vector<char *> freeBufs;
+};
+
+
+#endif //__BUFFER_POOL_HPP__
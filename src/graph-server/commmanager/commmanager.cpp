@@ -1,3 +1,5 @@
+#include <cerrno>
+#include <cstring>
 #include <unistd.h>
 #include "commmanager.hpp"
 
@@ -13,6 +15,10 @@ CommManager::init(NodeManager& nodeManager, unsigned ctxThds) {
     numNodes = nodeManager.getNumNodes();
     nodeId = nodeManager.getMyNodeId();
     Node me = nodeManager.getNode(nodeId);
+    size_t bufSize = SEND_BUFFER_SIZE;
+    if (maxMsgSize > 0)
+        bufSize = std::max(maxMsgSize + SEND_HEADER_ROOM, bufSize);
+    sendPool.init(bufSize, SEND_POOL_SIZE);
 
     if (nodeManager.standAloneMode() == true) {
         printLog(nodeId, "CommManager initialization complete.");
@@ -22,30 +28,38 @@ CommManager::init(NodeManager& nodeManager, unsigned ctxThds) {
     // Set data context threads for high scatter bandwidth
     zmq_ctx_set((void *)dataContext, ZMQ_IO_THREADS, ctxThds);
 
-    // Data publisher & subscriber.
-    dataPublisher = new zmq::socket_t(dataContext, ZMQ_PUB);
-    dataPublisher->setsockopt(ZMQ_SNDHWM, 0);       // Set no limit on number of message queueing.
-    dataPublisher->setsockopt(ZMQ_RCVHWM, 0);
-    char hostPort[50];
-    sprintf(hostPort, "tcp://%s:%u", me.ip.c_str(), dataPort);
-    dataPublisher->bind(hostPort);
-
-    dataSubscriber = new zmq::socket_t(dataContext, ZMQ_SUB);
-    dataSubscriber->setsockopt(ZMQ_SNDHWM, 0);
-    dataSubscriber->setsockopt(ZMQ_RCVHWM, 0);
-    char filter[9]; // filter for data subscriber
-    sprintf(filter, "%8X", nodeId);
-    dataSubscriber->setsockopt(ZMQ_SUBSCRIBE, filter, 8);
-    dataSubscriber->setsockopt(ZMQ_SUBSCRIBE, "FFFFFFFF", 8);
-    for (unsigned i = 0; i < numNodes; ++i) {
-        Node node = nodeManager.getNode(i);
+    if (dataPlane == DATA_P2P) {
+        initDataP2P(nodeManager);
+    } else {
+        // Data publisher & subscriber.
+        dataPublisher = new zmq::socket_t(dataContext, ZMQ_PUB);
+        dataPublisher->setsockopt(ZMQ_SNDHWM, 0);       // Set no limit on number of message queueing.
+        dataPublisher->setsockopt(ZMQ_RCVHWM, 0);
         char hostPort[50];
-        sprintf(hostPort, "tcp://%s:%u", node.ip.c_str(), dataPort);
-        dataSubscriber->connect(hostPort);
+        sprintf(hostPort, "tcp://%s:%u", me.ip.c_str(), dataPort);
+        dataPublisher->bind(hostPort);
+
+        dataSubscriber = new zmq::socket_t(dataContext, ZMQ_SUB);
+        dataSubscriber->setsockopt(ZMQ_SNDHWM, 0);
+        dataSubscriber->setsockopt(ZMQ_RCVHWM, 0);
+        char filter[9]; // filter for data subscriber
+        sprintf(filter, "%8X", nodeId);
+        dataSubscriber->setsockopt(ZMQ_SUBSCRIBE, filter, 8);
+        dataSubscriber->setsockopt(ZMQ_SUBSCRIBE, "FFFFFFFF", 8);
+        for (unsigned i = 0; i < numNodes; ++i) {
+            Node node = nodeManager.getNode(i);
+            char hostPort[50];
+            sprintf(hostPort, "tcp://%s:%u", node.ip.c_str(), dataPort);
+            dataSubscriber->connect(hostPort);
+        }
+
+        lockDataPublisher.init();
+        lockDataSubscriber.init();
     }
 
-    lockDataPublisher.init();
-    lockDataSubscriber.init();
+    // Peers attach to my rings after the handshake below
+    if (shmGhosts)
+        initShm(nodeManager);
 
     // Control publishers & subscribers.
     controlPublishers = new zmq::socket_t*[numNodes];
@@ -162,6 +176,9 @@ CommManager::init(NodeManager& nodeManager, unsigned ctxThds) {
             i = (i + 1) % numNodes;
     }
 
+    if (shmGhosts)
+        attachShm();
+
     flushData();
     flushControl();
     printLog(nodeId, "CommManager initialization complete.");
@@ -181,15 +198,22 @@ CommManager::destroy() {
     flushControl();
     flushData();
 
-    // Data publisher & subscriber.
-    dataPublisher->close();
-    dataSubscriber->close();
+    if (shmIn != NULL)
+        destroyShm();
 
-    delete dataPublisher;
-    delete dataSubscriber;
+    if (dataPlane == DATA_P2P) {
+        destroyDataP2P();
+    } else {
+        // Data publisher & subscriber.
+        dataPublisher->close();
+        dataSubscriber->close();
 
-    lockDataPublisher.destroy();
-    lockDataSubscriber.destroy();
+        delete dataPublisher;
+        delete dataSubscriber;
+
+        lockDataPublisher.destroy();
+        lockDataSubscriber.destroy();
+    }
 
     // Control publishers & subscribers.
     for (unsigned i = 0; i < numNodes; ++i) {
@@ -212,14 +236,98 @@ CommManager::destroy() {
 }
 
 void
-CommManager::rawMsgPushOut(zmq::message_t &msg) {
+CommManager::rawMsgPushOut(unsigned receiver, zmq::message_t &msg) {
     if (numNodes == 0) return;
 
+    // Messages larger than the ring go through ZMQ, they can pass the
+    // rows sent before them through the ring
+    if (shmGhosts && shmOut[receiver].valid() && shmOut[receiver].fits(msg.size())) {
+        // Blocks while the ring is full
+        BackoffSleeper bs;
+        lockShmOut[receiver].lock();
+        while (!shmOut[receiver].push(msg.data(), msg.size()))
+            bs.sleep();
+        lockShmOut[receiver].unlock();
+        return;
+    }
+
+    if (dataCompressor.enabled())
+        compressData(msg);
+
+    if (dataPlane == DATA_P2P) {
+        // Blocks while the receiver's send window is full
+        lockDataPushers[receiver].lock();
+        dataPushers[receiver]->ksend(msg);
+        lockDataPushers[receiver].unlock();
+        return;
+    }
+
     lockDataPublisher.lock();
     dataPublisher->ksend(msg, ZMQ_DONTWAIT);
     lockDataPublisher.unlock();
 }
 
+/**
+ *
+ * Replace a bulk message by its compressed version, if compression pays off.
+ * The header and the first compressPlainBytes of the value stay as they are
+ * (the receive shards hash them), the rest becomes a frame (compress.hpp).
+ *
+ */
+void
+CommManager::compressData(zmq::message_t &msg) {
+    const size_t plain = sizeof(char) * 8 + sizeof(unsigned) * 2 + compressPlainBytes;
+    // Bigger ones would fail the receiver's bound, see decompressData()
+    if (msg.size() < plain + MIN_COMPRESS_SIZE || msg.size() > sendPool.bufferSize())
+        return;
+
+    // Frames bigger than a pooled buffer did not compress well anyway
+    char *buf = sendPool.get();
+    size_t frameSize = dataCompressor.compress((char *)msg.data() + plain,
+                                               msg.size() - plain, buf + plain,
+                                               sendPool.bufferSize() - plain);
+    if (frameSize == 0) {
+        sendPool.put(buf);
+        return;
+    }
+    memcpy(buf, msg.data(), plain);
+    unsigned sender;
+    memcpy(&sender, buf + 8, sizeof(unsigned));
+    sender |= COMPRESSED_SENDER;
+    memcpy(buf + 8, &sender, sizeof(unsigned));
+
+    zmq::message_t out = sendPool.message(buf, plain + frameSize);
+    msg.move(&out);
+}
+
+
+void
+CommManager::decompressData(zmq::message_t &msg) {
+    const size_t plain = sizeof(char) * 8 + sizeof(unsigned) * 2 + compressPlainBytes;
+    const char *frame = (const char *)msg.data() + plain;
+    // Only messages that fit a pooled buffer are compressed. Check the size
+    // read off the wire before allocating for it.
+    if (msg.size() < plain + COMPRESS_FRAME_HDR ||
+        plain + framedRawSize(frame) > sendPool.bufferSize()) {
+        printLog(nodeId, "Corrupt compressed message");
+        abort();
+    }
+    zmq::message_t out = sendPool.message(plain + framedRawSize(frame));
+    char *buf = (char *)out.data();
+    if (!decompressFrame(frame, msg.size() - plain, buf + plain)) {
+        printLog(nodeId, "Corrupt compressed message");
+        abort();
+    }
+
+    memcpy(buf, msg.data(), plain);
+    unsigned sender;
+    memcpy(&sender, buf + 8, sizeof(unsigned));
+    sender &= ~COMPRESSED_SENDER;
+    memcpy(buf + 8, &sender, sizeof(unsigned));
+    msg.move(&out);
+}
+
+
 /**
  *
  * Push a value on a certain topic to all the nodes (including myself).
@@ -241,6 +349,13 @@ CommManager::dataPushOut(unsigned receiver, unsigned sender, unsigned topic, voi
     if (valSize > 0)
         memcpy((void *)msgPtr, value, valSize);
 
+    if (dataPlane == DATA_P2P) {
+        lockSmallPushers[receiver].lock();
+        smallPushers[receiver]->ksend(outMsg, ZMQ_DONTWAIT);
+        lockSmallPushers[receiver].unlock();
+        return;
+    }
+
     lockDataPublisher.lock();
     dataPublisher->ksend(outMsg, ZMQ_DONTWAIT);
     lockDataPublisher.unlock();
@@ -257,12 +372,7 @@ CommManager::dataPullIn(unsigned *sender, unsigned *topic, void *value, unsigned
     if (numNodes == 0) return true;
 
     zmq::message_t inMsg;
-
-    lockDataSubscriber.lock();
-    bool ret = dataSubscriber->krecv(&inMsg, ZMQ_DONTWAIT);
-    lockDataSubscriber.unlock();
-
-    if (!ret)
+    if (!pullData(inMsg))
         return false;
 
     unsigned valSize = inMsg.size() - sizeof(char) * 8 - sizeof(unsigned) - sizeof(unsigned);
@@ -279,6 +389,135 @@ CommManager::dataPullIn(unsigned *sender, unsigned *topic, void *value, unsigned
 }
 
 
+/**
+ *
+ * Pull a message in without copying its value out. `value` points into `msg`,
+ * which must be kept until the value is consumed.
+ *
+ */
+bool
+CommManager::dataPullIn(unsigned *sender, unsigned *topic, zmq::message_t &msg,
+                        char **value, unsigned *valSize) {
+    if (numNodes == 0) return true;
+
+    if (!pullData(msg))
+        return false;
+
+    parseData(msg, sender, topic, value, valSize);
+    return true;
+}
+
+
+/**
+ *
+ * Start the I/O thread of sharded receiving. No other pullIn may be used until
+ * stopRecvShards().
+ *
+ */
+void
+CommManager::startRecvShards(unsigned numShards, unsigned keyBytes) {
+    if (numNodes == 0 || dataSubscriber == NULL) return;   // Standalone.
+
+    assert(!recvRunning && numShards > 0);
+    for (unsigned i = 0; i < numShards; ++i)
+        recvShards.push_back(new SPSCQueue<zmq::message_t>(RECV_SHARD_QUEUE_SIZE));
+    recvKeyBytes = keyBytes;
+    recvRunning = true;
+    recvThread = std::thread(&CommManager::recvLoop, this);
+}
+
+
+void
+CommManager::stopRecvShards() {
+    if (!recvRunning) return;
+
+    recvRunning = false;
+    recvThread.join();
+    for (SPSCQueue<zmq::message_t> *q : recvShards)
+        delete q;
+    recvShards.clear();
+}
+
+
+/**
+ *
+ * Pull a message of my shard in, in place like the zero-copy dataPullIn().
+ *
+ */
+bool
+CommManager::dataPullIn(unsigned shard, unsigned *sender, unsigned *topic,
+                        zmq::message_t &msg, char **value, unsigned *valSize) {
+    if (numNodes == 0) return true;
+
+    if (shard >= recvShards.size())
+        return false;
+    msg.rebuild();      // Leave an empty message in the queue slot
+    if (!recvShards[shard]->tryPop(msg))
+        return false;
+
+    parseData(msg, sender, topic, value, valSize);
+    return true;
+}
+
+
+void
+CommManager::recvLoop() {
+    const size_t valOffset = sizeof(char) * 8 + sizeof(unsigned) * 2;
+    unsigned numShards = recvShards.size();
+    BackoffSleeper bs;
+    zmq::message_t msg;
+    while (recvRunning) {
+        if (!pullData(msg)) {
+            bs.sleep();
+            continue;
+        }
+        bs.reset();
+
+        // FNV-1a of the sender and the leading bytes of the value. The topic
+        // is left out, for ghost rows it is only the row count.
+        // Compressed or not, messages of a key go to the same shard.
+        const unsigned char *bytes = (const unsigned char *)msg.data();
+        unsigned sender;
+        memcpy(&sender, bytes + 8, sizeof(unsigned));
+        sender &= ~COMPRESSED_SENDER;
+        const unsigned char *senderBytes = (const unsigned char *)&sender;
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(unsigned); ++i)
+            hash = (hash ^ senderBytes[i]) * 1099511628211ull;
+        size_t keyEnd = std::min(msg.size(), valOffset + recvKeyBytes);
+        for (size_t i = valOffset; i < keyEnd; ++i)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+
+        SPSCQueue<zmq::message_t> *q = recvShards[hash % numShards];
+        while (!q->tryPush(std::move(msg))) {
+            if (!recvRunning) return;
+            bs.sleep();
+        }
+        bs.reset();
+        msg.rebuild();
+    }
+}
+
+
+void
+CommManager::parseData(zmq::message_t &msg, unsigned *sender, unsigned *topic,
+                       char **value, unsigned *valSize) {
+    unsigned rawSender;
+    memcpy(&rawSender, (char *)msg.data() + 8, sizeof(unsigned));
+    if (rawSender & COMPRESSED_SENDER)
+        decompressData(msg);
+
+    char *msgPtr = (char *)msg.data();
+    msgPtr += 8;
+    memcpy(sender, (unsigned *)msgPtr, sizeof(unsigned));
+    msgPtr += sizeof(unsigned);
+    memcpy(topic, msgPtr, sizeof(unsigned));
+    msgPtr += sizeof(unsigned);
+    *value = msgPtr;
+    *valSize = msg.size() - sizeof(char) * 8 - sizeof(unsigned) - sizeof(unsigned);
+}
+
+
 /**
  *
  * Push a value to a specific node (cannot be myself).
@@ -338,6 +577,158 @@ CommManager::controlPullIn(unsigned from, void *value, unsigned maxValSize) {
 ///////////////////////////////////////////////////////////////
 
 
+/**
+ *
+ * Set up the point-to-point data plane: PULL sockets here, PUSH sockets to
+ * every node. Messages pushed before a peer is up wait in its queue.
+ *
+ */
+void
+CommManager::initDataP2P(NodeManager& nodeManager) {
+    Node me = nodeManager.getNode(nodeId);
+    char hostPort[50];
+
+    dataSubscriber = new zmq::socket_t(dataContext, ZMQ_PULL);
+    dataSubscriber->setsockopt(ZMQ_RCVHWM, P2P_SEND_WINDOW);
+    sprintf(hostPort, "tcp://%s:%u", me.ip.c_str(), dataPort);
+    dataSubscriber->bind(hostPort);
+
+    smallPuller = new zmq::socket_t(dataContext, ZMQ_PULL);
+    smallPuller->setsockopt(ZMQ_RCVHWM, 0);
+    sprintf(hostPort, "tcp://%s:%u", me.ip.c_str(), dataPort + 1);
+    smallPuller->bind(hostPort);
+
+    dataPushers = new zmq::socket_t*[numNodes];
+    smallPushers = new zmq::socket_t*[numNodes];
+    lockDataPushers = new Lock[numNodes];
+    lockSmallPushers = new Lock[numNodes];
+    for (unsigned i = 0; i < numNodes; ++i) {
+        Node node = nodeManager.getNode(i);
+
+        dataPushers[i] = new zmq::socket_t(dataContext, ZMQ_PUSH);
+        dataPushers[i]->setsockopt(ZMQ_SNDHWM, P2P_SEND_WINDOW);
+        sprintf(hostPort, "tcp://%s:%u", node.ip.c_str(), dataPort);
+        dataPushers[i]->connect(hostPort);
+
+        smallPushers[i] = new zmq::socket_t(dataContext, ZMQ_PUSH);
+        smallPushers[i]->setsockopt(ZMQ_SNDHWM, 0);
+        sprintf(hostPort, "tcp://%s:%u", node.ip.c_str(), dataPort + 1);
+        smallPushers[i]->connect(hostPort);
+
+        lockDataPushers[i].init();
+        lockSmallPushers[i].init();
+    }
+
+    lockDataSubscriber.init();
+    printLog(nodeId, "Point-to-point data plane on ports %u, %u (window %u msgs)",
+             dataPort, dataPort + 1, P2P_SEND_WINDOW);
+}
+
+
+void
+CommManager::destroyDataP2P() {
+    for (unsigned i = 0; i < numNodes; ++i) {
+        dataPushers[i]->close();
+        smallPushers[i]->close();
+        delete dataPushers[i];
+        delete smallPushers[i];
+        lockDataPushers[i].destroy();
+        lockSmallPushers[i].destroy();
+    }
+    delete[] dataPushers;
+    delete[] smallPushers;
+    delete[] lockDataPushers;
+    delete[] lockSmallPushers;
+
+    dataSubscriber->close();
+    smallPuller->close();
+    delete dataSubscriber;
+    delete smallPuller;
+    lockDataSubscriber.destroy();
+}
+
+
+/**
+ *
+ * Shared-memory rings. Each node creates one ring per peer with the same IP
+ * before the control handshake; once the handshake is done, every such peer's
+ * rings exist, and the ones that can be attached to belong to peers that
+ * really are on this host.
+ *
+ */
+std::string
+CommManager::shmRingName(unsigned sender, unsigned receiver) {
+    return "/dorylus." + std::to_string(dataPort) + "." +
+           std::to_string(sender) + "-" + std::to_string(receiver);
+}
+
+
+void
+CommManager::initShm(NodeManager &nodeManager) {
+    shmIn = new ShmRing[numNodes];
+    shmOut = new ShmRing[numNodes];
+    lockShmOut = new Lock[numNodes];
+    shmPeers.assign(numNodes, false);
+    Node me = nodeManager.getNode(nodeId);
+    for (unsigned i = 0; i < numNodes; ++i) {
+        lockShmOut[i].init();
+        if (i == nodeId || nodeManager.getNode(i).ip != me.ip)
+            continue;
+        shmPeers[i] = true;
+        if (!shmIn[i].create(shmRingName(i, nodeId), SHM_RING_SIZE)) {
+            printLog(nodeId, "Cannot create shared memory ring %s [Reason: %s]",
+                     shmRingName(i, nodeId).c_str(), std::strerror(errno));
+        }
+    }
+}
+
+
+void
+CommManager::attachShm() {
+    unsigned numLocal = 0;
+    for (unsigned i = 0; i < numNodes; ++i) {
+        if (shmPeers[i] && shmOut[i].attach(shmRingName(nodeId, i)))
+            ++numLocal;
+    }
+    printLog(nodeId, "Ghost rows to %u co-located peer(s) go through shared memory",
+             numLocal);
+}
+
+
+void
+CommManager::destroyShm() {
+    for (unsigned i = 0; i < numNodes; ++i)
+        lockShmOut[i].destroy();
+    delete[] shmIn;
+    delete[] shmOut;
+    delete[] lockShmOut;
+}
+
+
+/**
+ *
+ * Receive the next data message, if any. In P2P small messages go first.
+ *
+ */
+bool
+CommManager::pullData(zmq::message_t &msg) {
+    lockDataSubscriber.lock();
+    bool ret = false;
+    if (dataPlane == DATA_P2P)
+        ret = smallPuller->krecv(&msg, ZMQ_DONTWAIT);
+    for (unsigned i = 0; shmGhosts && !ret && i < numNodes; ++i) {
+        ShmRing &ring = shmIn[shmNext];
+        if (ring.hasSender())
+            ret = ring.pop(msg);
+        shmNext = (shmNext + 1) % numNodes;
+    }
+    if (!ret)
+        ret = dataSubscriber->krecv(&msg, ZMQ_DONTWAIT);
+    lockDataSubscriber.unlock();
+    return ret;
+}
+
+
 /**
  *
  * Flush the data communication pipe between myself and all living nodes.
@@ -345,6 +736,11 @@ CommManager::controlPullIn(unsigned from, void *value, unsigned maxValSize) {
  */
 void
 CommManager::flushData() {
+    if (dataPlane == DATA_P2P) {
+        flushDataP2P();
+        return;
+    }
+
     lockDataPublisher.lock();
     lockDataSubscriber.lock();
 
@@ -372,6 +768,49 @@ CommManager::flushData() {
 }
 
 
+/**
+ *
+ * Point-to-point version: a NULL_CHAR on both sockets to everyone, then drain
+ * both of my sockets until everyone's NULL_CHAR arrived.
+ *
+ */
+void
+CommManager::flushDataP2P() {
+    lockDataSubscriber.lock();
+
+    zmq::socket_t **pushers[2] = { dataPushers, smallPushers };
+    Lock *locks[2] = { lockDataPushers, lockSmallPushers };
+    zmq::socket_t *pullers[2] = { dataSubscriber, smallPuller };
+    for (unsigned s = 0; s < 2; ++s) {
+        for (unsigned i = 0; i < numNodes; ++i) {
+            zmq::message_t outMsg(sizeof(char) * 8 + sizeof(unsigned));
+            char *msgPtr = (char *)(outMsg.data());
+            sprintf(msgPtr, "%8X", i);
+            msgPtr += 8;
+            *(unsigned *)msgPtr = NULL_CHAR;
+            locks[s][i].lock();
+            pushers[s][i]->ksend(outMsg);
+            locks[s][i].unlock();
+        }
+    }
+
+    for (unsigned s = 0; s < 2; ++s) {
+        unsigned rem = numNodes;
+        while (rem > 0) {
+            zmq::message_t inMsg;
+            pullers[s]->recv(&inMsg);
+            char *msgPtr = (char *)inMsg.data();
+            msgPtr += 8;
+            unsigned idx = *((unsigned *)msgPtr);
+            if (idx == NULL_CHAR)
+                --rem;
+        }
+    }
+
+    lockDataSubscriber.unlock();
+}
+
+
 /**
  *
  * Flush the control communication pipe between myself and all living nodes.
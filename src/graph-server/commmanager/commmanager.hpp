@@ -2,17 +2,47 @@
 #define __COMM_MANAGER_HPP__
 
 
+#include <atomic>
 #include <set>
+#include <thread>
 #include <vector>
 #include <climits>
 #include <zmq.hpp>
 #include "../parallel/lock.hpp"
 #include "../utils/utils.hpp"
+#include "../../common/compress.hpp"
+#include "../utils/spsc_queue.hpp"
 #include "../nodemanager/nodemanager.hpp"
+#include "buffer_pool.hpp"
+#include "shm_ring.hpp"
 
 
 #define NULL_CHAR MAX_IDTYPE
 
+/** Pooled send buffers fit a full data message (by default 1MB of values plus headers). */
+#define SEND_BUFFER_SIZE (1 * 1024 * 1024 + 4096)
+#define SEND_HEADER_ROOM 4096
+#define SEND_POOL_SIZE 32
+
+/**
+ * Data plane between the graph servers:
+ *   DATA_PUBSUB: one PUB socket to everyone, receivers filter on the node id.
+ *   DATA_P2P:    a PUSH socket to every peer and one PULL socket here. Bulk
+ *                (scatter) messages go on a socket with a send window of
+ *                P2P_SEND_WINDOW messages, so a slow peer only blocks the
+ *                threads sending to it. Small messages (acks etc.) go on a
+ *                second socket pair (data port + 1) without a window, so they
+ *                are never stuck behind bulk data.
+ */
+enum DataPlane { DATA_PUBSUB, DATA_P2P };
+#define P2P_SEND_WINDOW 64
+
+/** Shared-memory rings for ghost rows between co-located graph servers. */
+#define SHM_RING_SIZE (64 * 1024 * 1024)
+
+/** Messages waiting per receive shard, see CommManager::startRecvShards(). */
+#define RECV_SHARD_QUEUE_SIZE 256
+
 
 /** Control message topic & contents. */
 #define CONTROL_MESSAGE_TOPIC 'C'
@@ -38,13 +68,46 @@ public:
     void init(NodeManager& nodeManager, unsigned ctxThds = 2);
     void destroy();
 
-    void rawMsgPushOut(zmq::message_t &msg);
+    void rawMsgPushOut(unsigned receiver, zmq::message_t &msg);
     void dataPushOut(unsigned receiver, unsigned sender, unsigned topic, void* value, unsigned valSize);
     bool dataPullIn(unsigned *sender, unsigned *topic, void *value, unsigned maxValSize);
+    // Zero-copy versions: the payload is written / parsed in place.
+    zmq::message_t dataMessage(size_t size) { return sendPool.message(size); }
+    // Pooled send buffers of dataBufferSize() bytes (see BufferPool::get()).
+    size_t dataBufferSize() { return sendPool.bufferSize(); }
+    char *dataBuffer() { return sendPool.get(); }
+    void dataBufferPut(char *buf) { sendPool.put(buf); }
+    void dataBufferPushOut(unsigned receiver, char *buf, size_t size) {
+        zmq::message_t msg = sendPool.message(buf, size);
+        rawMsgPushOut(receiver, msg);
+    }
+    bool dataPullIn(unsigned *sender, unsigned *topic, zmq::message_t &msg,
+                    char **value, unsigned *valSize);
+
+    // Sharded receiving: while started, one I/O thread drains the data
+    // sockets and hands every message to one of `numShards` decoder threads,
+    // which pull with their shard id. Messages of one sender whose values
+    // start with the same `keyBytes` bytes go to the same shard, in order.
+    void startRecvShards(unsigned numShards, unsigned keyBytes);
+    void stopRecvShards();
+    bool dataPullIn(unsigned shard, unsigned *sender, unsigned *topic,
+                    zmq::message_t &msg, char **value, unsigned *valSize);
     void controlPushOut(unsigned to, void* value, unsigned valSize);
     bool controlPullIn(unsigned from, void *value, unsigned maxValSize);
 
     void setDataPort(unsigned dPort) { dataPort = dPort; }
+    void setDataPlane(DataPlane plane) { dataPlane = plane; }
+    void setShmGhosts(bool shm) { shmGhosts = shm; }
+    // Aggregated scatter messages, if any, get pooled buffers that fit them.
+    void setMaxMsgSize(size_t size) { maxMsgSize = size; }
+    size_t maxDataMsgSize() { return maxMsgSize; }
+    // Bulk messages (rawMsgPushOut) are compressed after the first
+    // `plainBytes` of their value, which must be the same on every node.
+    bool setDataCompression(const std::string &mode, unsigned plainBytes) {
+        compressPlainBytes = plainBytes;
+        return dataCompressor.init(mode);
+    }
+    std::string dataCompressionReport() { return dataCompressor.report(); }
     void setControlPortStart(unsigned cPort) { controlPortStart = cPort; }
 
 private:
@@ -52,14 +115,40 @@ private:
     unsigned numNodes = 0;
     unsigned nodeId = 0;
 
+    // Declared before the context: in-flight messages go back to it on exit.
+    BufferPool sendPool;
+    size_t maxMsgSize = 0;      // 0 when messages are not aggregated.
+
     zmq::context_t dataContext;
+    DataPlane dataPlane = DATA_PUBSUB;
     zmq::socket_t *dataPublisher = NULL;
-    zmq::socket_t *dataSubscriber = NULL;
+    zmq::socket_t *dataSubscriber = NULL;     // PULL of bulk messages in P2P.
     unsigned dataPort;
 
     Lock lockDataPublisher;
     Lock lockDataSubscriber;
 
+    // DATA_P2P only, per peer (myself included).
+    zmq::socket_t **dataPushers = NULL;
+    zmq::socket_t **smallPushers = NULL;
+    zmq::socket_t *smallPuller = NULL;
+    Lock *lockDataPushers = NULL;
+    Lock *lockSmallPushers = NULL;
+
+    // Ghost rows (rawMsgPushOut) to co-located peers go through shared memory
+    // rings instead, if enabled. shmIn[i] is created here for sender i;
+    // shmOut[i] is valid iff node i is on this host.
+    bool shmGhosts = false;
+    ShmRing *shmIn = NULL;
+    ShmRing *shmOut = NULL;
+    Lock *lockShmOut = NULL;
+    unsigned shmNext = 0;       // Round robin over shmIn, under lockDataSubscriber.
+    std::string shmRingName(unsigned sender, unsigned receiver);
+    std::vector<bool> shmPeers;     // Nodes with my IP, that may share the host.
+    void initShm(NodeManager &nodeManager);
+    void attachShm();
+    void destroyShm();
+
     zmq::context_t controlContext;
     zmq::socket_t **controlPublishers = NULL;
     zmq::socket_t **controlSubscribers = NULL;
@@ -68,8 +157,28 @@ private:
     Lock *lockControlPublishers = NULL;
     Lock *lockControlSubscribers = NULL;
 
+    // Compressed messages have this bit set in their sender field.
+    static const unsigned COMPRESSED_SENDER = 1u << 31;
+    PayloadCompressor dataCompressor;
+    unsigned compressPlainBytes = 0;
+    void compressData(zmq::message_t &msg);
+    void decompressData(zmq::message_t &msg);
+
+    std::vector<SPSCQueue<zmq::message_t> *> recvShards;
+    unsigned recvKeyBytes = 0;
+    std::atomic<bool> recvRunning{false};
+    std::thread recvThread;
+    void recvLoop();
+    void parseData(zmq::message_t &msg, unsigned *sender, unsigned *topic,
+                   char **value, unsigned *valSize);
+
+    void initDataP2P(NodeManager& nodeManager);
+    void destroyDataP2P();
+    bool pullData(zmq::message_t &msg);
+
     void flushControl();
     void flushData();
+    void flushDataP2P();
 };
 
 
@@ -26,6 +26,7 @@ LambdaComm::LambdaComm(Engine *_engine) :
 //        LAMBDA_NAME = "invalid_lambda_name";
 //    }
 
+    tensorCompressor.init(_engine->compressionName);
     loadWServerIps(_engine->weightserverIPFile);
     setupAwsClient();
     setupSockets();
@@ -38,6 +39,8 @@ LambdaComm::LambdaComm(Engine *_engine) :
 LambdaComm::~LambdaComm() {
     halt = true;
     lambdaOut.close();
+    if (tensorCompressor.enabled())
+        printLog(nodeId, "Lambda tensors: %s", tensorCompressor.report().c_str());
     // Delete allocated resources.
     stopRelaunchThd();
     closeSockets();
@@ -70,6 +73,11 @@ bool LambdaComm::NNRecv(Chunk &chunk) {
     }
 
     unsigned exeTime = timestamp_ms() - entry->second;
+    if (Tracer::enabled()) {
+        unsigned long long end = Tracer::now();
+        Tracer::complete("lambda", "lambda", chunk,
+                         end - exeTime * 1000ull, end);
+    }
     // if (engine->async) engine->vecTimeLambdaWait[chunk.dir * engine->numLayers + chunk.layer] += exeTime;
     timeoutTable.erase(chunk);
 
@@ -80,6 +88,8 @@ bool LambdaComm::NNRecv(Chunk &chunk) {
         } else {
             recordTable[engine->getAbsLayer(chunk)] = recordFound->second * 0.95 + exeTime * (1.0 - 0.95);
         }
+        engine->chunkPolicy->record(chunk, exeTime);
+        engine->recordChunkTime(chunk, exeTime);
     }
     timeoutMtx.unlock();
 
@@ -87,6 +97,17 @@ bool LambdaComm::NNRecv(Chunk &chunk) {
     return true;
 }
 
+void LambdaComm::setChunkCnt(unsigned chunkCnt) {
+    timeoutMtx.lock();
+    // Responses of old chunks are dropped by NNRecv from now on
+    for (auto &kv : timeoutTable) {
+        printLog(nodeId, "Drop stale chunk %s", kv.first.str().c_str());
+    }
+    timeoutTable.clear();
+    numChunk = chunkCnt;
+    timeoutMtx.unlock();
+}
+
 void LambdaComm::asyncRelaunchLoop() {
 #define MIN_TIMEOUT 500u     // at least wait for MIN_TIMEOUT ms before relaunching
 #define TIMEOUT_PERIOD 6000u // wait for up to TIMEOUT_PERIOD ms before relaunching
@@ -132,6 +153,7 @@ void LambdaComm::relaunchLambda(const Chunk &chunk) {
     if (entry != timeoutTable.end()) {
         entry->second = timestamp_ms();
         ++relaunchCnt;
+        Tracer::instant("relaunch", "lambda", chunk);
         invokeLambda(chunk);
     }
     timeoutMtx.unlock();
@@ -139,6 +161,7 @@ void LambdaComm::relaunchLambda(const Chunk &chunk) {
 
 // LAMBDA INVOCATION AND RETURN FUNCTIONS
 void LambdaComm::invokeLambda(const Chunk &chunk) {
+    Tracer::instant("invoke", "lambda", chunk);
     Aws::Lambda::Model::InvokeRequest invReq;
     invReq.SetFunctionName(LAMBDA_NAME);
     invReq.SetInvocationType(Aws::Lambda::Model::InvocationType::RequestResponse);
@@ -147,7 +170,7 @@ void LambdaComm::invokeLambda(const Chunk &chunk) {
 
     Aws::Utils::Json::JsonValue jsonPayload;
     jsonPayload.WithString("dserver", nodeIp);
-    const char *wserver = selectWeightServer(chunk.localId);
+    const char *wserver = selectWeightServer(chunk.globalId);
     jsonPayload.WithString("wserver", wserver);
     jsonPayload.WithInteger("dport", dport);
     jsonPayload.WithInteger("wport", wport);
@@ -163,6 +186,7 @@ void LambdaComm::invokeLambda(const Chunk &chunk) {
     jsonPayload.WithInteger("dir", chunk.dir);
     jsonPayload.WithInteger("epoch", chunk.epoch);
     jsonPayload.WithInteger("vtx", chunk.vertex);
+    jsonPayload.WithString("compression", engine->compressionName);
 
     *payload << jsonPayload.View().WriteReadable();
     invReq.SetBody(payload);
@@ -212,9 +236,10 @@ void LambdaComm::callback(const Aws::Lambda::LambdaClient *client,
 // END LAMBDA INVOCATION AND RETURN FUNCTIONS
 
 // Helper functions
-const char* LambdaComm::selectWeightServer(unsigned chunkId) {
-    // TODO: (YIFAN) Here I use engine.numLambdaForward to automatically adjust to engine's setting. This is ugly.
-    return wservers[(nodeId * engine->numLambdasForward + chunkId) % wservers.size()].c_str();
+// Chunk global ids are consecutive across nodes, matching how
+// WeightComm::updateChunkCnt spreads the chunk count over weight servers.
+const char* LambdaComm::selectWeightServer(unsigned globalChunkId) {
+    return wservers[globalChunkId % wservers.size()].c_str();
 }
 
 void LambdaComm::setupAwsClient() {
@@ -37,6 +37,7 @@
 #include "../parallel/lock.hpp"
 #include "../../common/matrix.hpp"
 #include "../../common/utils.hpp"
+#include "../../common/compress.hpp"
 
 
 static const bool relaunching = true;
@@ -57,8 +58,10 @@ public:
 
     void NNCompute(Chunk &chunk);
     bool NNRecv(Chunk &chunk);
+    bool concurrentNNCompute() { return true; };
 
     unsigned getRelaunchCnt() { return relaunchCnt; };
+    void setChunkCnt(unsigned chunkCnt);
 
     bool halt;
     std::vector<TensorMap>& savedNNTensors;
@@ -73,6 +76,9 @@ public:
     std::map<Chunk, unsigned> timeoutTable;
     std::map<unsigned, unsigned> recordTable; // map layer -> (avg_time)
 
+    // Tensors to the lambdas; the lambdas use the same mode on the way back.
+    PayloadCompressor tensorCompressor;
+
 
     struct AccLoss {
         float acc = 0.0;
@@ -114,7 +120,7 @@ public:
     std::ofstream lambdaOut;
 
     // Helper utilities
-    const char* selectWeightServer(unsigned chunkId);
+    const char* selectWeightServer(unsigned globalChunkId);
 
     Engine *engine;
     void loadWServerIps(std::string wsFile);
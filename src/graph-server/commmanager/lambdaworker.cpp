@@ -5,6 +5,7 @@
 #include <iomanip>
 
 static void nofree(void* data, void* hint) {}
+static void freeFrame(void* data, void* hint) { delete[] (char *)data; }
 
 /**
  *
@@ -314,11 +315,25 @@ void LambdaWorker::sendTensor(Matrix &tensor, Chunk &chunk, unsigned& more) {
     unsigned rows = chunk.upBound - chunk.lowBound;
     unsigned cols = tensor.getCols();
 
+    unsigned bufSize = rows * cols * sizeof(FeatType);
+    zmq::message_t tensorData;
+    size_t frameSize = 0;
+    PayloadCompressor &compressor = manager->tensorCompressor;
+    if (compressor.enabled() && bufSize >= MIN_COMPRESS_SIZE) {
+        size_t cap = compressFrameBound(bufSize);
+        char *frame = new char[cap];
+        frameSize = compressor.compress((char *)dptr, bufSize, frame, cap);
+        if (frameSize > 0)
+            tensorData.rebuild(frame, frameSize, freeFrame, NULL);
+        else
+            delete[] frame;
+    }
+    if (frameSize == 0)
+        tensorData.rebuild(dptr, bufSize, nofree, NULL);
+
     zmq::message_t responseHeader(TENSOR_HDR_SIZE);
     populateHeader(responseHeader.data(), OP::PULL, tensor.name().c_str(),
-      rows, cols);
-    unsigned bufSize = rows * cols * sizeof(FeatType);
-    zmq::message_t tensorData(dptr, bufSize, nofree, NULL);
+      rows, cols, 0, frameSize > 0);
 
     workersocket.send(responseHeader, ZMQ_SNDMORE);
 
@@ -442,8 +457,32 @@ int LambdaWorker::recvTensor(Chunk &chunk) {
     //          name.c_str(), chunk.upBound - chunk.lowBound,
     //          tensorData.size() / (chunk.upBound - chunk.lowBound) / 4,
     //          chunk.str().c_str(), found->second.shape().c_str());
+
+    // The rows must fit the chunk's part of the tensor, whatever the lambda says
+    unsigned rows = parse<unsigned>((char*)tensorHeader.data(), 3);
+    unsigned cols = parse<unsigned>((char*)tensorHeader.data(), 4);
+    bool framed = parse<unsigned>((char*)tensorHeader.data(), TENSOR_FRAMED_FIELD);
+    size_t rawSize = (size_t)rows * cols * sizeof(FeatType);
+    bool sized = framed ? tensorData.size() >= COMPRESS_FRAME_HDR &&
+                          framedRawSize((char*)tensorData.data()) == rawSize
+                        : tensorData.size() == rawSize;
+    if (!sized || cols != found->second.getCols() ||
+        chunk.lowBound + rows > found->second.getRows()) {
+        printLog(manager->nodeId, "Lambda %s returned tensor '%s' of a wrong size",
+                 chunk.str().c_str(), name.c_str());
+        return 1;
+    }
+
     FeatType* dptr = found->second.get(chunk.lowBound);
-    std::memcpy(dptr, tensorData.data(), tensorData.size());
+    if (framed) {
+        if (!decompressFrame((char*)tensorData.data(), tensorData.size(), (char*)dptr)) {
+            printLog(manager->nodeId, "Lambda %s returned a corrupt tensor '%s'",
+                     chunk.str().c_str(), name.c_str());
+            return 1;
+        }
+    } else {
+        std::memcpy(dptr, tensorData.data(), tensorData.size());
+    }
 
     return 0;
 }
@@ -116,7 +116,10 @@ MessageService::MessageService(unsigned wPort_, unsigned nodeId_,
                                unsigned numLayers_, GNN gnn_type_)
     : wctx(1), nodeId(nodeId_), wPort(wPort_), wsocket(wctx, ZMQ_DEALER),
       wsocktReady(0), confirm(5),
-      gnn_type(gnn_type_), numLayers(numLayers_), epoch(-1) {
+      gnn_type(gnn_type_), numLayers(numLayers_), epoch(-1),
+      numChunks(1), wUpdates(numLayers_), wUpdCnts(numLayers_, 0),
+      aUpdates(numLayers_), aUpdCnts(numLayers_, 0),
+      accSum(0.0), lossSum(0.0), vtcsSum(0), accCnt(0) {
 
     for (int layer = 0; layer < 2; layer++) {
         weights.push_back(Matrix());
@@ -139,60 +142,92 @@ void MessageService::setUpWeightSocket(char *addr) {
     wsocket.connect(whost_port);
 }
 
-Matrix MessageService::getWeightMatrix(unsigned layer) {
-    if (wSndThread.joinable()) wSndThread.join();
-    if (wReqThread.joinable()) wReqThread.join();
-    return weights.at(layer);
+void MessageService::setNumChunks(unsigned numChunks_) {
+    std::lock_guard<std::mutex> lk(mtx);
+    numChunks = numChunks_;
 }
 
-void MessageService::sendWeightUpdate(Matrix &matrix, unsigned layer) {
+// Must be called with mtx held.
+void MessageService::joinThreads() {
     if (wSndThread.joinable()) wSndThread.join();
     if (wReqThread.joinable()) wReqThread.join();
+}
+
+// Add the partial update of one chunk to the sum of the layer. Must be called
+// with mtx held. Returns true (and hands the sum back in `matrix`) once all
+// local chunks have contributed.
+bool MessageService::accumulate(std::vector<Matrix> &sums,
+                                std::vector<unsigned> &cnts,
+                                Matrix &matrix, unsigned layer) {
+    Matrix &sum = sums.at(layer);
+    if (sum.empty()) {
+        sum = matrix;
+    } else {
+        sum += matrix;
+        deleteMatrix(matrix);
+    }
+    if (++cnts[layer] < numChunks) {
+        matrix = Matrix();
+        return false;
+    }
+
+    matrix = sum;
+    sum = Matrix();
+    cnts[layer] = 0;
+    return true;
+}
+
+// Must be called with mtx held.
+void MessageService::sendUpdate(Matrix &matrix, unsigned layer,
+                                const char *name) {
+    joinThreads();
 
     wSndThread = std::thread(
-        [&](Matrix matrix, unsigned layer) {
-            matrix.setName("w");
+        [&](Matrix matrix, unsigned layer, const char *name) {
+            matrix.setName(name);
             std::vector<Matrix> weightUpdates{ matrix };
             Chunk c = { 0, nodeId, 0, 0, layer,
-                        PROP_TYPE::BACKWARD, epoch, true };
+                        PROP_TYPE::BACKWARD, epoch, true }; // YIFAN: fix this
             sendTensors(wsocket, c, weightUpdates);
             deleteMatrix(matrix);
         },
-        matrix, layer);
+        matrix, layer, name);
+}
+
+Matrix MessageService::getWeightMatrix(unsigned layer) {
+    std::lock_guard<std::mutex> lk(mtx);
+    joinThreads();
+    return weights.at(layer);
+}
+
+bool MessageService::sendWeightUpdate(Matrix &matrix, unsigned layer) {
+    std::lock_guard<std::mutex> lk(mtx);
+    if (!accumulate(wUpdates, wUpdCnts, matrix, layer)) return false;
+    sendUpdate(matrix, layer, "w");
+    return true;
 }
 
 Matrix MessageService::getaMatrix(unsigned layer) {
-    if (wSndThread.joinable()) wSndThread.join();
-    if (wReqThread.joinable()) wReqThread.join();
+    std::lock_guard<std::mutex> lk(mtx);
+    joinThreads();
     return as.at(layer);
 }
 
-void MessageService::sendaUpdate(Matrix &matrix, unsigned layer) {
-    if (wSndThread.joinable()) wSndThread.join();
-    if (wReqThread.joinable()) wReqThread.join();
-
-    wSndThread = std::thread(
-        [&](Matrix matrix, unsigned layer) {
-            matrix.setName("a_i");
-            std::vector<Matrix> weightUpdates{ matrix };
-            Chunk c = { 0, nodeId, 0 ,0, layer,
-                        PROP_TYPE::BACKWARD, epoch, true }; // YIFAN: fix this
-            sendTensors(wsocket, c, weightUpdates);
-            deleteMatrix(matrix);
-        },
-        matrix, layer);
+bool MessageService::sendaUpdate(Matrix &matrix, unsigned layer) {
+    std::lock_guard<std::mutex> lk(mtx);
+    if (!accumulate(aUpdates, aUpdCnts, matrix, layer)) return false;
+    sendUpdate(matrix, layer, "a_i");
+    return true;
 }
 
 // This retrieve all weights at the beginning
 // TODO: This can be improved by making it layer-wise prefectching
 void MessageService::prefetchWeightsMatrix() {
-    if (wSndThread.joinable()) wSndThread.join();
-    if (wReqThread.joinable()) wReqThread.join();
+    std::lock_guard<std::mutex> lk(mtx);
+    joinThreads();
 
     epoch++;
     wReqThread = std::thread([&]() {
-        if (wSndThread.joinable()) wSndThread.join();
-
         if (gnn_type == GNN::GCN) {
             for (unsigned i = 0; i < weights.size(); ++i) {
                 deleteMatrix(weights[i]);
@@ -222,10 +257,20 @@ void MessageService::prefetchWeightsMatrix() {
 }
 
 
-void MessageService::sendAccloss(float acc, float loss, unsigned vtcsCnt) {
-    if (wSndThread.joinable()) {
-        wSndThread.join();
-    }
+bool MessageService::sendAccloss(float acc, float loss, unsigned vtcsCnt) {
+    std::lock_guard<std::mutex> lk(mtx);
+    accSum += acc;
+    lossSum += loss;
+    vtcsSum += vtcsCnt;
+    if (++accCnt < numChunks) return false;
+
+    acc = accSum;
+    loss = lossSum;
+    vtcsCnt = vtcsSum;
+    accSum = lossSum = 0.0;
+    vtcsSum = accCnt = 0;
+
+    joinThreads();
 
     Chunk chunk = { nodeId, nodeId, 0, vtcsCnt, 1, PROP_TYPE::FORWARD, epoch, true };
 
@@ -239,4 +284,5 @@ void MessageService::sendAccloss(float acc, float loss, unsigned vtcsCnt) {
 
     wsocket.send(header, ZMQ_SNDMORE);
     wsocket.send(payload);
+    return true;
 }
@@ -2,6 +2,7 @@
 #define __MSG_SRV_HPP__
 
 #include <chrono>
+#include <mutex>
 #include <thread>
 #include <vector>
 #include <zmq.hpp>
@@ -11,6 +12,11 @@
 #include "../utils/utils.hpp"
 
 // This class is used for CPU/GPU <-> weight server communication
+//
+// All public methods are thread-safe. Updates and training stats are reported
+// per chunk and summed up locally; they are sent to the weight server once
+// every local chunk has reported, so the server sees one update per node.
+// The send methods return true for the call which triggered the send.
 class MessageService {
 public:
     MessageService(unsigned wPort_, unsigned nodeId_,
@@ -19,17 +25,23 @@ public:
     // weight server related
     void setUpWeightSocket(char *addr);
     void prefetchWeightsMatrix();
+    void setNumChunks(unsigned numChunks_);
 
     // for 'w' weight matrix
     Matrix getWeightMatrix(unsigned layer);
-    void sendWeightUpdate(Matrix &matrix, unsigned layer);
+    bool sendWeightUpdate(Matrix &matrix, unsigned layer);
     // for 'a_i' weight matrix
     Matrix getaMatrix(unsigned layer);
-    void sendaUpdate(Matrix &matrix, unsigned layer);
+    bool sendaUpdate(Matrix &matrix, unsigned layer);
 
-    void sendAccloss(float acc, float loss, unsigned vtcsCnt);
+    bool sendAccloss(float acc, float loss, unsigned vtcsCnt);
 
 private:
+    void joinThreads();
+    bool accumulate(std::vector<Matrix> &sums, std::vector<unsigned> &cnts,
+                    Matrix &matrix, unsigned layer);
+    void sendUpdate(Matrix &matrix, unsigned layer, const char *name);
+
     zmq::context_t wctx;
     zmq::socket_t wsocket;
     zmq::message_t confirm;
@@ -45,6 +57,17 @@ private:
     std::vector<Matrix> as;
     std::thread wReqThread;
     std::thread wSndThread;
+
+    std::mutex mtx;
+    unsigned numChunks;
+    std::vector<Matrix> wUpdates;   // Partial sums of the chunks, per layer.
+    std::vector<unsigned> wUpdCnts;
+    std::vector<Matrix> aUpdates;
+    std::vector<unsigned> aUpdCnts;
+    float accSum;
+    float lossSum;
+    unsigned vtcsSum;
+    unsigned accCnt;
 };
 
 #endif
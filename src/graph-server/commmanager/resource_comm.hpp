@@ -10,11 +10,16 @@ enum { LAMBDA, GPU, CPU };
 class Engine;
 
 //abstract interface for communicator
+//
+// NNCompute() is called by the AV/AE worker threads. When the backend returns
+// true from concurrentNNCompute(), the engine may run several AV workers and
+// NNCompute() must then be safe to call for different chunks at the same time.
 class ResourceComm {
 public:
     virtual ~ResourceComm() {};
 
     virtual void NNCompute(Chunk &chunk) = 0;
+    virtual bool concurrentNNCompute() { return false; };
     // Push result chunks back to queues
     void NNRecvCallback(Engine *engine, Chunk &chunk);
 
@@ -22,6 +27,9 @@ public:
 
     virtual unsigned getRelaunchCnt() { return 0u; };
 
+    // Number of local chunks changed (re-chunking between epochs)
+    virtual void setChunkCnt(unsigned chunkCnt) {};
+
 private:
     void NNRecvCallbackGCN(Engine *engine, Chunk &chunk);
     void NNRecvCallbackGAT(Engine *engine, Chunk &chunk);
@@ -0,0 +1,167 @@
+#include <cassert>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "shm_ring.hpp"
+
+
+#define SHM_RING_MAGIC 0x444f52594c555352ull    // "DORYLUSR"
+#define SHM_RING_DATA_OFFSET 256
+#define SHM_RING_WRAP UINT64_MAX
+
+static_assert(sizeof(ShmRingHeader) <= SHM_RING_DATA_OFFSET, "ShmRingHeader too large");
+
+static inline uint64_t padded(uint64_t len) {
+    return (len + 7) & ~7ull;
+}
+
+
+/**
+ *
+ * Create the ring as its receiver. A stale ring of the same name is replaced.
+ *
+ */
+bool
+ShmRing::create(const std::string &name_, size_t capacity) {
+    assert(capacity % 8 == 0);
+    name = name_;
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+        return false;
+    mapSize = SHM_RING_DATA_OFFSET + capacity;
+    if (ftruncate(fd, mapSize) != 0) {
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void *addr = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    owner = true;
+    hdr = (ShmRingHeader *) addr;
+    data = (char *) addr + SHM_RING_DATA_OFFSET;
+    hdr->ownerPid = getpid();
+    hdr->senderAttached.store(0);
+    hdr->capacity = capacity;
+    hdr->head.store(0);
+    hdr->tail.store(0);
+    std::atomic_thread_fence(std::memory_order_release);
+    hdr->magic = SHM_RING_MAGIC;
+    return true;
+}
+
+
+/**
+ *
+ * Attach to the ring as its sender. Fails if there is no such ring on this
+ * host, or if it is a leftover of a process that is gone.
+ *
+ */
+bool
+ShmRing::attach(const std::string &name_) {
+    name = name_;
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < SHM_RING_DATA_OFFSET) {
+        ::close(fd);
+        return false;
+    }
+    mapSize = st.st_size;
+    void *addr = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+        return false;
+
+    ShmRingHeader *h = (ShmRingHeader *) addr;
+    bool ok = h->magic == SHM_RING_MAGIC &&
+              SHM_RING_DATA_OFFSET + h->capacity == mapSize &&
+              (kill(h->ownerPid, 0) == 0 || errno == EPERM);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!ok) {
+        munmap(addr, mapSize);
+        return false;
+    }
+
+    owner = false;
+    hdr = h;
+    data = (char *) addr + SHM_RING_DATA_OFFSET;
+    hdr->senderAttached.store(1);
+    return true;
+}
+
+
+void
+ShmRing::close() {
+    if (hdr == NULL)
+        return;
+    munmap(hdr, mapSize);
+    if (owner)
+        shm_unlink(name.c_str());
+    hdr = NULL;
+    data = NULL;
+}
+
+
+bool
+ShmRing::fits(size_t len) const {
+    return sizeof(uint64_t) + padded(len) <= hdr->capacity;
+}
+
+
+bool
+ShmRing::push(const void *msg, size_t len) {
+    uint64_t cap = hdr->capacity;
+    uint64_t need = sizeof(uint64_t) + padded(len);
+    assert(fits(len));
+
+    uint64_t head = hdr->head.load(std::memory_order_relaxed);
+    uint64_t pos = head % cap;
+    uint64_t untilEnd = cap - pos;
+    uint64_t total = untilEnd < need ? untilEnd + need : need;
+    if (head + total - hdr->tail.load(std::memory_order_acquire) > cap)
+        return false;
+
+    if (untilEnd < need) {
+        *(uint64_t *)(data + pos) = SHM_RING_WRAP;
+        head += untilEnd;
+        pos = 0;
+    }
+    *(uint64_t *)(data + pos) = len;
+    memcpy(data + pos + sizeof(uint64_t), msg, len);
+    hdr->head.store(head + need, std::memory_order_release);
+    return true;
+}
+
+
+bool
+ShmRing::pop(zmq::message_t &msg) {
+    uint64_t cap = hdr->capacity;
+    uint64_t tail = hdr->tail.load(std::memory_order_relaxed);
+    uint64_t head = hdr->head.load(std::memory_order_acquire);
+    if (tail == head)
+        return false;
+
+    uint64_t pos = tail % cap;
+    uint64_t len = *(uint64_t *)(data + pos);
+    if (len == SHM_RING_WRAP) {
+        tail += cap - pos;
+        pos = 0;
+        len = *(uint64_t *)data;
+    }
+    msg.rebuild(len);
+    memcpy(msg.data(), data + pos + sizeof(uint64_t), len);
+    hdr->tail.store(tail + sizeof(uint64_t) + padded(len),
+                    std::memory_order_release);
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef __SHM_RING_HPP__
+#define __SHM_RING_HPP__
+
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <zmq.hpp>
+
+
+/** Layout of the head of a ring in shared memory. */
+struct ShmRingHeader {
+    uint64_t magic;                     // Written last by the creator.
+    int32_t ownerPid;
+    std::atomic<uint32_t> senderAttached;
+    uint64_t capacity;                  // Bytes of ring data.
+    alignas(64) std::atomic<uint64_t> head;     // Written by the sender.
+    alignas(64) std::atomic<uint64_t> tail;     // Written by the receiver.
+};
+
+
+/**
+ *
+ * Single-producer single-consumer message ring in POSIX shared memory, between
+ * two graph servers on the same host.
+ *
+ * The receiver creates the ring; the sender attaches to it, which only works
+ * if the ring exists on this host and its creator is alive, so attaching
+ * also tells whether the peer is co-located. Messages are stored as an 8-byte
+ * length followed by the bytes, padded to 8 bytes. A message that does not
+ * fit before the end of the ring leaves a wrap marker and starts over at the
+ * beginning. Callers serialize the pushes (and the pops) themselves.
+ *
+ */
+class ShmRing {
+public:
+    ~ShmRing() { close(); };
+
+    bool create(const std::string &name_, size_t capacity);
+    bool attach(const std::string &name_);
+    void close();
+
+    bool valid() const { return hdr != NULL; }
+    bool hasSender() const { return hdr != NULL && hdr->senderAttached.load(); }
+
+    // Whether a message of `len` bytes fits in the ring at all.
+    bool fits(size_t len) const;
+    // False if the ring is too full right now. The message must fit().
+    bool push(const void *msg, size_t len);
+    // False if the ring is empty.
+    bool pop(zmq::message_t &msg);
+
+private:
+    std::string name;
+    bool owner = false;
+    size_t mapSize = 0;
+    ShmRingHeader *hdr = NULL;
+    char *data = NULL;
+};
+
+
+#endif //__SHM_RING_HPP__
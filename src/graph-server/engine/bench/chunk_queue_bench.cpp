@@ -0,0 +1,120 @@
+/**
+ *
+ * Contention microbenchmark of the pipeline chunk queues.
+ *
+ * Compares a plain mutex protected heap (the queue used before) against
+ * LockChunkQueue with one heap (the default) and with MAX_SHARDS heaps
+ * (--chunkshards). Half of the threads push chunks, the other half pop them,
+ * the same way the stage workers and the lambda callbacks hand chunks over.
+ *
+ * Usage: chunk-queue-bench [max #threads] [#chunks per producer]
+ *
+ * Measured on one core only (`chunk-queue-bench 16 100000`, best of 3 runs):
+ *
+ *      threads    mutex   1 shard   8 shards   (Mops/s)
+ *            2     5.78      5.44       4.82
+ *            4     4.71      5.32       4.05
+ *            8     3.96      4.09       3.64
+ *           16     3.73      3.82       3.38
+ *
+ * With one core the threads never run at the same time, so this only shows
+ * the overhead of the shards, not whether they cut contention. That is why
+ * sharding stays opt-in until many-core numbers show a win.
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../chunk_queue.hpp"
+
+
+/** Baseline: one heap behind one mutex. */
+class MutexChunkQueue {
+public:
+    MutexChunkQueue(const char *name) {}
+
+    void push_atomic(const Chunk &chunk) {
+        std::lock_guard<std::mutex> lk(mtx);
+        cq.push_back(chunk);
+        std::push_heap(cq.begin(), cq.end(), cmp);
+    }
+    bool tryPop(Chunk &chunk) {
+        std::lock_guard<std::mutex> lk(mtx);
+        if (cq.empty()) return false;
+        chunk = cq.front();
+        std::pop_heap(cq.begin(), cq.end(), cmp);
+        cq.pop_back();
+        return true;
+    }
+
+private:
+    std::mutex mtx;
+    ChunkCmp cmp;
+    std::vector<Chunk> cq;
+};
+
+
+// Chunks of a few stages, like the queues of a running pipeline.
+static Chunk makeChunk(unsigned i) {
+    unsigned stage = i % 4;
+    return Chunk { i % 64, i % 64, 0, 1, stage / 2,
+                   PROP_TYPE::FORWARD, 1, stage % 2 == 0 };
+}
+
+static void setShards(MutexChunkQueue &q, unsigned n) {}
+static void setShards(LockChunkQueue &q, unsigned n) { q.setShards(n); }
+
+template <typename Queue>
+static double run(unsigned numThreads, unsigned chunksPerProducer,
+                  unsigned numShards = 1) {
+    Queue q("bench");
+    setShards(q, numShards);
+    unsigned numProducers = std::max(1u, numThreads / 2);
+    unsigned numConsumers = std::max(1u, numThreads - numProducers);
+    unsigned long long total = (unsigned long long)numProducers * chunksPerProducer;
+    std::atomic<unsigned long long> popped(0);
+
+    double stt = getTimer();
+    std::vector<std::thread> thds;
+    for (unsigned p = 0; p < numProducers; ++p) {
+        thds.push_back(std::thread([&, p]() {
+            for (unsigned i = 0; i < chunksPerProducer; ++i)
+                q.push_atomic(makeChunk(p * chunksPerProducer + i));
+        }));
+    }
+    for (unsigned c = 0; c < numConsumers; ++c) {
+        thds.push_back(std::thread([&]() {
+            Chunk chunk;
+            while (popped.load() < total) {
+                if (q.tryPop(chunk))
+                    ++popped;
+            }
+        }));
+    }
+    for (std::thread &t : thds)
+        t.join();
+    double ms = getTimer() - stt;
+
+    return 2 * total / ms / 1000.0;    // Million push+pop per second
+}
+
+int main(int argc, char *argv[]) {
+    unsigned maxThreads = argc > 1 ? atoi(argv[1])
+                        : std::max(2u, std::thread::hardware_concurrency());
+    unsigned chunksPerProducer = argc > 2 ? atoi(argv[2]) : 200000;
+
+    printf("%8s %8s %9s %10s   (Mops/s)\n", "threads", "mutex", "1 shard", "8 shards");
+    for (unsigned t = 2; t <= maxThreads; t *= 2) {
+        double base = run<MutexChunkQueue>(t, chunksPerProducer);
+        double single = run<LockChunkQueue>(t, chunksPerProducer);
+        double sharded = run<LockChunkQueue>(t, chunksPerProducer,
+                                             LockChunkQueue::MAX_SHARDS);
+        printf("%8u %8.2f %9.2f %10.2f\n", t, base, single, sharded);
+    }
+    return 0;
+}
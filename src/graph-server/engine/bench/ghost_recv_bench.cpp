@@ -0,0 +1,182 @@
+/**
+ *
+ * Throughput microbenchmark of the ghost receive path, on synthetic ghost
+ * messages (header + fp32 rows of consecutive slots).
+ *
+ * Compares the decoder threads pulling from one queue behind one lock (like
+ * all the receivers sharing the data subscriber) against one I/O thread that
+ * hands the messages to per-decoder SPSC queues (CommManager recv shards).
+ * The decoders copy the rows into a ghost tensor through a slot map, like
+ * Engine::unpackGhostRows().
+ *
+ * Usage: ghost-recv-bench [max #decoders] [#messages] [featDim] [rows/msg]
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../../utils/spsc_queue.hpp"
+#include "../../utils/utils.hpp"
+
+
+typedef std::vector<char> Message;
+
+struct Traffic {
+    unsigned featDim;
+    unsigned rowsPerMsg;
+    unsigned numSlots;
+    std::vector<unsigned> slotRows;     // Slot -> ghost row.
+    std::vector<Message> templates;     // One per batch of slots.
+};
+
+// Header as in scatter messages: featDim, layer, dir, first slot.
+static Traffic makeTraffic(unsigned featDim, unsigned rowsPerMsg) {
+    Traffic t;
+    t.featDim = featDim;
+    t.rowsPerMsg = rowsPerMsg;
+    unsigned numMsgs = 64;
+    t.numSlots = numMsgs * rowsPerMsg;
+    t.slotRows.resize(t.numSlots);
+    for (unsigned s = 0; s < t.numSlots; ++s)       // Mostly consecutive rows
+        t.slotRows[s] = s + s / 16;
+    for (unsigned m = 0; m < numMsgs; ++m) {
+        Message msg(4 * sizeof(unsigned) + sizeof(FeatType) * featDim * rowsPerMsg);
+        unsigned hdr[4] = { featDim, 1, 0, m * rowsPerMsg };
+        memcpy(msg.data(), hdr, sizeof(hdr));
+        FeatType *rows = (FeatType *)(msg.data() + sizeof(hdr));
+        for (unsigned i = 0; i < featDim * rowsPerMsg; ++i)
+            rows[i] = (FeatType)(m + i);
+        t.templates.push_back(msg);
+    }
+    return t;
+}
+
+static void decode(const Traffic &t, const Message &msg, FeatType *ghosts) {
+    const unsigned *hdr = (const unsigned *)msg.data();
+    unsigned featDim = hdr[0];
+    const unsigned *rows = t.slotRows.data() + hdr[3];
+    const FeatType *src = (const FeatType *)(msg.data() + 4 * sizeof(unsigned));
+    unsigned i = 0;
+    while (i < t.rowsPerMsg) {
+        unsigned runEnd = i + 1;
+        while (runEnd < t.rowsPerMsg && rows[runEnd] == rows[runEnd - 1] + 1)
+            ++runEnd;
+        memcpy(ghosts + (size_t)rows[i] * featDim, src + (size_t)i * featDim,
+               sizeof(FeatType) * featDim * (runEnd - i));
+        i = runEnd;
+    }
+}
+
+/** Baseline: every decoder pulls from one locked queue. */
+static double runShared(const Traffic &t, FeatType *ghosts, unsigned numDecoders,
+                        unsigned numMsgs) {
+    std::mutex mtx;
+    std::deque<Message> q;
+    std::atomic<unsigned> decoded(0);
+
+    double stt = getTimer();
+    std::thread io([&]() {
+        for (unsigned m = 0; m < numMsgs; ++m) {
+            Message msg(t.templates[m % t.templates.size()]);   // "Receive"
+            while (true) {
+                std::lock_guard<std::mutex> lk(mtx);
+                if (q.size() < 256) {
+                    q.push_back(std::move(msg));
+                    break;
+                }
+            }
+        }
+    });
+    std::vector<std::thread> decoders;
+    for (unsigned d = 0; d < numDecoders; ++d) {
+        decoders.push_back(std::thread([&]() {
+            Message msg;
+            while (decoded.load() < numMsgs) {
+                {
+                    std::lock_guard<std::mutex> lk(mtx);
+                    if (q.empty())
+                        continue;
+                    msg = std::move(q.front());
+                    q.pop_front();
+                }
+                decode(t, msg, ghosts);
+                ++decoded;
+            }
+        }));
+    }
+    io.join();
+    for (std::thread &d : decoders)
+        d.join();
+    return getTimer() - stt;
+}
+
+/** Sharded: the I/O thread hands messages to per-decoder SPSC queues. */
+static double runSharded(const Traffic &t, FeatType *ghosts, unsigned numDecoders,
+                         unsigned numMsgs) {
+    std::vector<SPSCQueue<Message> *> shards;
+    for (unsigned d = 0; d < numDecoders; ++d)
+        shards.push_back(new SPSCQueue<Message>(256));
+    std::atomic<unsigned> decoded(0);
+
+    double stt = getTimer();
+    std::thread io([&]() {
+        for (unsigned m = 0; m < numMsgs; ++m) {
+            Message msg(t.templates[m % t.templates.size()]);
+            unsigned firstSlot = ((const unsigned *)msg.data())[3];
+            SPSCQueue<Message> *q = shards[(firstSlot / t.rowsPerMsg) % numDecoders];
+            while (!q->tryPush(std::move(msg)))
+                std::this_thread::yield();
+        }
+    });
+    std::vector<std::thread> decoders;
+    for (unsigned d = 0; d < numDecoders; ++d) {
+        decoders.push_back(std::thread([&, d]() {
+            Message msg;
+            while (decoded.load() < numMsgs) {
+                if (!shards[d]->tryPop(msg)) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                decode(t, msg, ghosts);
+                ++decoded;
+            }
+        }));
+    }
+    io.join();
+    for (std::thread &d : decoders)
+        d.join();
+    double ms = getTimer() - stt;
+
+    for (SPSCQueue<Message> *q : shards)
+        delete q;
+    return ms;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned maxDecoders = argc > 1 ? atoi(argv[1])
+                         : std::max(1u, std::thread::hardware_concurrency());
+    unsigned numMsgs = argc > 2 ? atoi(argv[2]) : 20000;
+    unsigned featDim = argc > 3 ? atoi(argv[3]) : 128;
+    unsigned rowsPerMsg = argc > 4 ? atoi(argv[4]) : 256;
+
+    Traffic t = makeTraffic(featDim, rowsPerMsg);
+    std::vector<FeatType> ghosts((size_t)(t.slotRows.back() + 1) * featDim);
+    double gb = (double)numMsgs * t.templates[0].size() / 1e9;
+
+    printf("%u messages of %u rows x %u floats (%.2f GB)\n",
+           numMsgs, rowsPerMsg, featDim, gb);
+    printf("%9s %18s %18s\n", "decoders", "shared (GB/s)", "sharded (GB/s)");
+    for (unsigned d = 1; d <= maxDecoders; d *= 2) {
+        double shared = runShared(t, ghosts.data(), d, numMsgs);
+        double sharded = runSharded(t, ghosts.data(), d, numMsgs);
+        printf("%9u %18.2f %18.2f\n", d, gb / shared * 1000, gb / sharded * 1000);
+    }
+    return 0;
+}
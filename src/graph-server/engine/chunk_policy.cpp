@@ -0,0 +1,74 @@
+#include "chunk_policy.hpp"
+#include "engine.hpp"
+
+
+/**
+ *
+ * Count, for every chunk, how many (boundary vertex, remote partition) pairs
+ * its scatter has to serve in each direction.
+ *
+ */
+void GhostChunkPolicy::init(Engine *engine, const std::vector<Chunk> &chunks) {
+    Graph &graph = engine->graph;
+    forwardDeps.assign(chunks.size(), 0);
+    backwardDeps.assign(chunks.size(), 0);
+    for (const Chunk &c : chunks) {
+        for (unsigned lvid = c.lowBound; lvid < c.upBound; ++lvid) {
+            auto found = graph.forwardGhostMap.find(lvid);
+            if (found != graph.forwardGhostMap.end())
+                forwardDeps[c.localId] += found->second.size();
+            found = graph.backwardGhostMap.find(lvid);
+            if (found != graph.backwardGhostMap.end())
+                backwardDeps[c.localId] += found->second.size();
+        }
+    }
+}
+
+double GhostChunkPolicy::priority(const Chunk &chunk) const {
+    const std::vector<unsigned> &deps = chunk.dir == PROP_TYPE::FORWARD
+                                      ? forwardDeps : backwardDeps;
+    return chunk.localId < deps.size() ? deps[chunk.localId] : 0.0;
+}
+
+
+void LambdaTimeChunkPolicy::init(Engine *_engine, const std::vector<Chunk> &chunks) {
+    engine = _engine;
+    numAbsLayers = 2 * engine->numLayers;
+    records.assign(chunks.size() * numAbsLayers, 0.0);
+    published = records;
+}
+
+void LambdaTimeChunkPolicy::record(const Chunk &chunk, unsigned exeTime) {
+    unsigned idx = chunk.localId * numAbsLayers + engine->getAbsLayer(chunk);
+    recordLock.lock();
+    if (idx < records.size()) {
+        // Same smoothing as the relaunch timeouts in LambdaComm
+        records[idx] = records[idx] == 0.0
+                     ? exeTime
+                     : records[idx] * 0.95 + exeTime * (1.0 - 0.95);
+    }
+    recordLock.unlock();
+}
+
+void LambdaTimeChunkPolicy::refresh() {
+    recordLock.lock();
+    published = records;
+    recordLock.unlock();
+}
+
+double LambdaTimeChunkPolicy::priority(const Chunk &chunk) const {
+    unsigned idx = chunk.localId * numAbsLayers + engine->getAbsLayer(chunk);
+    return idx < published.size() ? published[idx] : 0.0;
+}
+
+
+ChunkPolicy *createChunkPolicy(const std::string &policyName) {
+    if (policyName == "id") {
+        return new IdChunkPolicy();
+    } else if (policyName == "ghost") {
+        return new GhostChunkPolicy();
+    } else if (policyName == "lambda") {
+        return new LambdaTimeChunkPolicy();
+    }
+    return NULL;
+}
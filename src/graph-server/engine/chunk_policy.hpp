@@ -0,0 +1,116 @@
+#ifndef __CHUNK_POLICY_HPP__
+#define __CHUNK_POLICY_HPP__
+
+#include <string>
+#include <vector>
+
+#include "../parallel/lock.hpp"
+#include "../utils/utils.hpp"
+
+
+class Engine;
+
+/**
+ *
+ * Scheduling policy of chunks.
+ *
+ * Chunks are always ordered by their pipeline stage first (epoch, direction,
+ * layer, vertex/edge, see Chunk::laterStage()). A policy only decides which
+ * chunk goes first among chunks of the same stage. Chunks with a higher
+ * priority are popped first; ties fall back to the chunk ids.
+ *
+ * priority() is called by the chunk queues while holding their locks, so it
+ * must be stable between two calls of refresh(). Measurements should be
+ * buffered in record() and published in refresh(), which the engine calls
+ * with all chunk queues locked.
+ *
+ */
+class ChunkPolicy {
+public:
+    virtual ~ChunkPolicy() {};
+
+    virtual const char *name() const = 0;
+    // Whether its measurements come from the lambdas only.
+    virtual bool needsLambdas() const { return false; }
+
+    // Called once after the engine cuts the local partition into chunks.
+    virtual void init(Engine *engine, const std::vector<Chunk> &chunks) {};
+    // Measured NN execution time (ms) of a vertex chunk.
+    virtual void record(const Chunk &chunk, unsigned exeTime) {};
+    // Publish the measurements recorded so far.
+    virtual void refresh() {};
+
+    virtual double priority(const Chunk &chunk) const { return 0.0; };
+};
+
+/** Original order: lower chunk id first. */
+class IdChunkPolicy : public ChunkPolicy {
+public:
+    const char *name() const { return "id"; };
+};
+
+/**
+ * Chunks with more (boundary vertex, remote partition) pairs first, so the
+ * scatter which unblocks most of the peers starts as early as possible.
+ */
+class GhostChunkPolicy : public ChunkPolicy {
+public:
+    const char *name() const { return "ghost"; };
+
+    void init(Engine *engine, const std::vector<Chunk> &chunks);
+    double priority(const Chunk &chunk) const;
+
+private:
+    std::vector<unsigned> forwardDeps;   // Indexed by chunk local id.
+    std::vector<unsigned> backwardDeps;
+};
+
+/**
+ * Chunks whose NN computation historically takes the longest first, so the
+ * stragglers of a layer are started before the short ones.
+ */
+class LambdaTimeChunkPolicy : public ChunkPolicy {
+public:
+    LambdaTimeChunkPolicy() { recordLock.init(); };
+    ~LambdaTimeChunkPolicy() { recordLock.destroy(); };
+
+    const char *name() const { return "lambda"; };
+    bool needsLambdas() const { return true; }
+
+    void init(Engine *engine, const std::vector<Chunk> &chunks);
+    void record(const Chunk &chunk, unsigned exeTime);
+    void refresh();
+    double priority(const Chunk &chunk) const;
+
+private:
+    Engine *engine = NULL;
+    unsigned numAbsLayers = 0;
+
+    Lock recordLock;
+    std::vector<double> records;    // [chunk local id][abs layer], EMA in ms.
+    std::vector<double> published;
+};
+
+ChunkPolicy *createChunkPolicy(const std::string &policyName);
+
+
+/** Comparator for the chunk heaps. `true` if lhs should be popped after rhs. */
+struct ChunkCmp {
+    ChunkPolicy *policy = NULL;
+
+    bool operator()(const Chunk &lhs, const Chunk &rhs) const {
+        if (lhs.laterStage(rhs))
+            return true;
+        if (!lhs.sameStage(rhs))
+            return false;
+        if (policy) {
+            double lhsPri = policy->priority(lhs);
+            double rhsPri = policy->priority(rhs);
+            if (lhsPri != rhsPri)
+                return lhsPri < rhsPri;
+        }
+        return lhs < rhs;
+    }
+};
+
+#endif // __CHUNK_POLICY_HPP__
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <thread>
+
+#include "chunk_queue.hpp"
+
+
+// Per-thread start position, so that threads spread over the shards.
+static unsigned randomShard(unsigned numShards) {
+    static thread_local unsigned seed =
+        std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed % numShards;
+}
+
+void LockChunkQueue::lock() {
+    for (unsigned i = 0; i < numShards; ++i)
+        shards[i].mtx.lock();
+}
+
+void LockChunkQueue::unlock() {
+    for (unsigned i = 0; i < numShards; ++i)
+        shards[i].mtx.unlock();
+}
+
+void LockChunkQueue::shardPush(Shard &shard, const Chunk &chunk) {
+    assert(chunk.layer < 0xFF);
+    if (Tracer::enabled()) Tracer::instant(name, "enqueue", chunk);
+    shard.heap.push_back(chunk);
+    std::push_heap(shard.heap.begin(), shard.heap.end(), cmp);
+    ++cnt;
+    publish(shard);
+}
+
+void LockChunkQueue::shardPop(Shard &shard) {
+    if (Tracer::enabled()) Tracer::instant(name, "dequeue", shard.heap.front());
+    std::pop_heap(shard.heap.begin(), shard.heap.end(), cmp);
+    shard.heap.pop_back();
+    --cnt;
+    publish(shard);
+}
+
+// The shard holding the top chunk of the whole queue, numShards if empty.
+// Needs the queue locked.
+unsigned LockChunkQueue::bestShard() const {
+    unsigned best = numShards;
+    for (unsigned i = 0; i < numShards; ++i) {
+        if (shards[i].heap.empty())
+            continue;
+        if (best == numShards ||
+            cmp(shards[best].heap.front(), shards[i].heap.front()))
+            best = i;
+    }
+    return best;
+}
+
+const Chunk &LockChunkQueue::top() const {
+    unsigned best = bestShard();
+    assert(best != numShards);
+    return shards[best].heap.front();
+}
+
+void LockChunkQueue::push(const Chunk &chunk) {
+    shardPush(shards[nextShard], chunk);
+    nextShard = (nextShard + 1) % numShards;
+}
+
+void LockChunkQueue::pop() {
+    unsigned best = bestShard();
+    assert(best != numShards);
+    shardPop(shards[best]);
+}
+
+void LockChunkQueue::push_atomic(const Chunk &chunk) {
+    unsigned start = randomShard(numShards);
+    for (unsigned i = 0; i < numShards; ++i) {
+        Shard &shard = shards[(start + i) % numShards];
+        if (shard.mtx.try_lock()) {
+            shardPush(shard, chunk);
+            shard.mtx.unlock();
+            return;
+        }
+    }
+    // All shards busy (or the queue is locked), wait for one
+    Shard &shard = shards[start];
+    std::lock_guard<std::mutex> lk(shard.mtx);
+    shardPush(shard, chunk);
+}
+
+/**
+ *
+ * Pop a chunk of the earliest stage in the queue. Returns false if the queue
+ * is empty.
+ *
+ */
+bool LockChunkQueue::tryPop(Chunk &chunk) {
+    if (numShards == 1) {
+        // The plain mutex protected heap
+        std::lock_guard<std::mutex> lk(shards[0].mtx);
+        if (shards[0].heap.empty())
+            return false;
+        chunk = shards[0].heap.front();
+        shardPop(shards[0]);
+        return true;
+    }
+
+    while (!empty()) {
+        // Shards whose top chunk is of the earliest stage
+        uint64_t minKey = EMPTY_KEY;
+        unsigned candidates[MAX_SHARDS];
+        unsigned numCandidates = 0;
+        for (unsigned i = 0; i < numShards; ++i) {
+            uint64_t key = shards[i].topKey.load();
+            if (key < minKey) {
+                minKey = key;
+                numCandidates = 0;
+            }
+            if (key == minKey && key != EMPTY_KEY)
+                candidates[numCandidates++] = i;
+        }
+        if (numCandidates == 0)
+            return false;
+
+        unsigned start = randomShard(numShards);
+        for (unsigned i = 0; i < numCandidates; ++i) {
+            Shard &shard = shards[candidates[(start + i) % numCandidates]];
+            if (!shard.mtx.try_lock())
+                continue;
+            // The top may have changed since we read the key
+            bool valid = !shard.heap.empty() &&
+                         stageKey(shard.heap.front()) == minKey;
+            if (valid) {
+                chunk = shard.heap.front();
+                shardPop(shard);
+            }
+            shard.mtx.unlock();
+            if (valid)
+                return true;
+        }
+        // All candidates busy or stale, rescan
+        std::this_thread::yield();
+    }
+    return false;
+}
+
+void LockChunkQueue::clear() {
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> lk(shard.mtx);
+        cnt -= shard.heap.size();
+        shard.heap.clear();
+        publish(shard);
+    }
+}
+
+void LockChunkQueue::reorder() {
+    for (Shard &shard : shards) {
+        std::make_heap(shard.heap.begin(), shard.heap.end(), cmp);
+        publish(shard);
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef __CHUNK_QUEUE_HPP__
+#define __CHUNK_QUEUE_HPP__
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "../utils/trace.hpp"
+#include "../utils/utils.hpp"
+#include "chunk_policy.hpp"
+
+
+/**
+ *
+ * Concurrent priority queue of chunks handed between the pipeline stages.
+ *
+ * By default it is one heap behind one mutex. With setShards(n > 1) the chunks
+ * are spread over n heaps with one mutex each (opt in with --chunkshards). Every
+ * shard publishes the pipeline stage of its top chunk in an atomic, so
+ * tryPop() finds the shards holding the earliest stage without taking any
+ * lock and only try-locks one of them; push_atomic() try-locks shards round
+ * the ring until it gets a free one. The stage order is kept strict, while
+ * the ChunkPolicy order inside a stage is relaxed to the order within each
+ * shard. Whether this beats the single mutex on a many-core server is not
+ * measured yet; on one core it is slower (see bench/chunk_queue_bench.cpp).
+ *
+ * lock()/unlock() take every shard, which gives the old exclusive interface
+ * (top/pop/push under the lock, exact ChunkCmp order) to the callers that
+ * need to look at the top chunk before deciding to pop it, e.g. the scheduler.
+ * size() and empty() can be read without the lock.
+ *
+ */
+class LockChunkQueue {
+public:
+    static const unsigned MAX_SHARDS = 8;
+
+    LockChunkQueue(const char *name_) : name(name_) {}
+
+    // Number of heaps, 1 to MAX_SHARDS. The queue must be empty and not shared yet.
+    void setShards(unsigned n) {
+        assert(n >= 1 && n <= MAX_SHARDS && empty());
+        numShards = n;
+    }
+
+    // Exclusive access to the whole queue
+    void lock();
+    void unlock();
+
+    bool empty() const { return cnt.load() == 0; }
+    size_t size() const { return cnt.load(); }
+    // These three need the queue locked (or not shared yet)
+    const Chunk &top() const;
+    void push(const Chunk &chunk);
+    void pop();
+
+    // Concurrent access, no need to lock
+    void push_atomic(const Chunk &chunk);
+    bool tryPop(Chunk &chunk);
+    void clear();
+
+    // Both need the queue locked (or not shared yet)
+    void setPolicy(ChunkPolicy *policy) {
+        cmp.policy = policy;
+        reorder();
+    }
+    void reorder();
+
+    // Pipeline stage of a chunk as an integer, smaller stages go first.
+    // Follows Chunk::laterStage().
+    static uint64_t stageKey(const Chunk &chunk) {
+        uint64_t layerKey = chunk.dir == PROP_TYPE::FORWARD
+                          ? chunk.layer : 0xFF - chunk.layer;
+        bool edgeLater = chunk.dir == PROP_TYPE::FORWARD
+                       ? !chunk.vertex : chunk.vertex;
+        return ((uint64_t)chunk.epoch << 32) | ((uint64_t)chunk.dir << 16) |
+               (layerKey << 8) | (edgeLater ? 1 : 0);
+    }
+
+private:
+    static const uint64_t EMPTY_KEY = UINT64_MAX;
+
+    struct alignas(64) Shard {
+        std::mutex mtx;
+        std::vector<Chunk> heap;
+        std::atomic<uint64_t> topKey{EMPTY_KEY};
+    };
+
+    // Shard ops, the shard must be locked
+    void shardPush(Shard &shard, const Chunk &chunk);
+    void shardPop(Shard &shard);
+    void publish(Shard &shard) {
+        shard.topKey.store(shard.heap.empty()
+                         ? EMPTY_KEY : stageKey(shard.heap.front()));
+    }
+    unsigned bestShard() const;
+
+    const char *name;
+    ChunkCmp cmp;
+    Shard shards[MAX_SHARDS];
+    unsigned numShards = 1;
+    std::atomic<size_t> cnt{0};
+    unsigned nextShard = 0;     // For push() under the exclusive lock.
+};
+
+#endif // __CHUNK_QUEUE_HPP__
@@ -51,6 +51,10 @@ void Engine::init(int argc, char *argv[]) {
     numNodes = nodeManager.getNumNodes();
     assert(numNodes <= 256);  // Cluster size limitation.
     outFile += std::to_string(nodeId);
+    if (!traceDir.empty()) {
+        Tracer::init(nodeId,
+                     traceDir + "/trace." + std::to_string(nodeId) + ".json");
+    }
     // Init data ctx with `dThreads` threads for scatter
     commManager.init(nodeManager, mode == LAMBDA ? dThreads : 1);
 
@@ -61,16 +65,49 @@ void Engine::init(int argc, char *argv[]) {
 
     std::string graphFile =
         datasetDir + "graph." + std::to_string(nodeId) + ".bin";
-    // detect whether preprocessed
+    // Preprocess only if the image is missing or older than its inputs
     {
-        std::ifstream gfile(graphFile.c_str(), std::ios::binary);
-        if (!gfile.good() || forcePreprocess) {
-            DataLoader dl(datasetDir, nodeId, numNodes, undirected);
+        DataLoader dl(datasetDir, nodeId, numNodes, undirected, 0,
+                      hubThreshold);
+        if (forcePreprocess || !dl.upToDate()) {
             dl.preprocess();
         }
     }
-    graph.init(graphFile);
+    if (!graph.init(graphFile)) {
+        printLog(nodeId, "Cannot load partition %s", graphFile.c_str());
+        exit(-1);
+    }
     printGraphMetrics();
+    if (graph.hubThreshold != hubThreshold) {
+        printLog(nodeId, "Partition was cut with hub threshold %u, not %u; "
+                 "preprocess again to change it", graph.hubThreshold, hubThreshold);
+    }
+    // Partial rows are summed into a hub's row once per layer, before AV
+    if (graph.hubThreshold > 0 &&
+        (gnn_type != GNN::GCN ||
+         (mode == LAMBDA && pipeline && staleness != UINT_MAX))) {
+        printLog(nodeId, "Hybrid cut partitions only support synchronous GCN");
+        exit(-1);
+    }
+
+    chunkPolicy = createChunkPolicy(chunkPolicyName);
+    if (chunkPolicy == NULL) {
+        printLog(nodeId, "Unsupported chunk policy: %s", chunkPolicyName.c_str());
+        exit(-1);
+    }
+    // Only LambdaComm records NN times, elsewhere it would silently be "id"
+    if (chunkPolicy->needsLambdas() && mode != LAMBDA) {
+        printLog(nodeId, "Chunk policy %s needs lambdas (MODE 0)", chunkPolicy->name());
+        exit(-1);
+    }
+    printLog(nodeId, "Using chunk policy %s", chunkPolicy->name());
+    for (LockChunkQueue *q : { &schQueue, &GAQueue, &AVQueue,
+                               &SCQueue, &AEQueue, &SCStashQueue }) {
+        q->setShards(chunkShards);
+        q->setPolicy(chunkPolicy);
+    }
+    if (chunkShards > 1)
+        printLog(nodeId, "Chunk queues sharded over %u heaps", chunkShards);
 
     for (unsigned i = 0; i < 2 * numLayers; i++) {
         vecTimeAggregate.push_back(0.0);
@@ -124,16 +161,49 @@ void Engine::init(int argc, char *argv[]) {
     NormAdjMatrixOut->loadSpCSR(cu.spHandle, graph);
 #endif
 
+    exchangeGhostSlots();
+    exchangeMirrorRows();
+    printLog(nodeId, "Ghost rows sent as %s (forward), %s (backward)",
+             ghostCodecName(fwdGhostCodec), ghostCodecName(bwdGhostCodec));
+    if (!ghostDelta.init(ghostDeltaName, deltaThreshold, deltaTopk, numLayers,
+                         graph.forwardGhostMap, graph.backwardGhostMap)) {
+        printLog(nodeId, "Unsupported ghost delta mode: %s", ghostDeltaName.c_str());
+        exit(-1);
+    }
+    if (ghostDelta.enabled()) {
+        printLog(nodeId, "Ghost delta %s (threshold %.3f, topk %.2f) in async epochs",
+                 ghostDelta.name(), deltaThreshold, deltaTopk);
+    }
+    if (scatterAggOn && numNodes > 1) {
+        // Sync epochs count every message sent, see scatterWorkFunc()
+        scatterAgg.init(numNodes, nodeId, &commManager,
+                        [this](unsigned receiver, char *buf, size_t size) {
+                            commManager.dataBufferPushOut(receiver, buf, size);
+                            if (!async)
+                                __sync_fetch_and_add(&recvCnt, 1);
+                        }, AGG_MIN_MSG_SIZE, aggDeadline);
+        printLog(nodeId, "Scatter rows aggregated per peer (%lu to %lu bytes, deadline %.2f ms)",
+                 (size_t)AGG_MIN_MSG_SIZE, scatterAgg.maxMsgSize(), aggDeadline);
+    }
+
     // Initialize synchronization utilities.
     recvCnt = 0;
     recvCntLock.init();
     recvCntCond.init(recvCntLock);
+    chunkTimesLock.init();
+
+    if (rechunkFreq && mode != LAMBDA) {
+        printLog(nodeId, "Re-chunking only applies to lambdas, disabled");
+        rechunkFreq = 0;
+    }
 
     if (nodeId == 0) {
         weightComm = new WeightComm(weightserverIPFile, weightserverPort);
+        // CPU nodes sum up the updates of their chunks locally and send one
+        // update per layer. Lambdas, and the GPU (which computes the whole
+        // partition for every chunk), send one per chunk.
         weightComm->updateChunkCnt(
-            numNodes *
-            numLambdasForward);  // now set up weight servers only once
+            numNodes * (mode == CPU ? 1 : numLambdasForward));
     } else {
         weightComm = NULL;
     }
@@ -162,6 +232,12 @@ void Engine::init(int argc, char *argv[]) {
     }
 #endif
 
+    if (avThreads > 1 && !resComm->concurrentNNCompute()) {
+        printLog(nodeId, "Resource does not support concurrent NN compute, "
+                 "using 1 AV worker");
+        avThreads = 1;
+    }
+
     timeInit += getTimer();
     printLog(nodeId, "Engine initialization complete.");
 }
@@ -173,18 +249,21 @@ void Engine::init(int argc, char *argv[]) {
  */
 void Engine::destroy() {
     // printLog(nodeId, "Destroying the engine...");
-
     nodeManager.destroy();
     commManager.destroy();
 
     recvCntLock.destroy();
     recvCntCond.destroy();
+    chunkTimesLock.destroy();
 
     if (nodeId == 0) {
         weightComm->shutdown();
         delete weightComm;
     }
     delete resComm;
+    delete chunkPolicy;
+    // Every thread that records events is joined by now
+    Tracer::dump();
 
     // delete[] forwardVerticesInitData;
     // delete[] forwardGhostInitData;
@@ -249,19 +328,24 @@ void Engine::runPipeline() {
     auto avWrkrFunc =
         std::bind(&Engine::applyVertexWorkFunc, this, std::placeholders::_1);
     ThreadVector avWrkrThds;
-    for (unsigned tid = 0; tid < 1; ++tid) {
+    for (unsigned tid = 0; tid < avThreads; ++tid) {
         avWrkrThds.push_back(std::thread(avWrkrFunc, tid));
     }
     auto scWrkrFunc =
         std::bind(&Engine::scatterWorkFunc, this, std::placeholders::_1);
     // std::thread swt(scWrkrFunc, 1);
     ThreadVector scWrkrThds;
+    if (scatterAgg.enabled())
+        scatterAgg.start();
     for (unsigned tid = 0; tid < commThdCnt; ++tid) {
         scWrkrThds.push_back(std::thread(scWrkrFunc, tid));
     }
     auto ghstRcvrFunc =
         std::bind(&Engine::ghostReceiverFunc, this, std::placeholders::_1);
     ThreadVector ghstRcvrThds;
+    // One I/O thread receives, the receivers decode their shard of messages.
+    // Messages of the same rows (featDim, layer, dir, first slot) stay in order.
+    commManager.startRecvShards(commThdCnt, DATA_KEY_BYTES);
     for (unsigned tid = 0; tid < commThdCnt; ++tid) {
         ghstRcvrThds.push_back(std::thread(ghstRcvrFunc, tid));
     }
@@ -290,26 +374,30 @@ void Engine::runPipeline() {
     for (unsigned tid = 0; tid < cThreads; ++tid) {
         gaWrkrThds[tid].join();
     }
-    for (unsigned tid = 0; tid < 1; ++tid) {
+    for (unsigned tid = 0; tid < avThreads; ++tid) {
         avWrkrThds[tid].join();
+    }
+    for (unsigned tid = 0; tid < 1; ++tid) {
         aeWrkrThds[tid].join();
     }
     for (unsigned tid = 0; tid < commThdCnt; ++tid)
         scWrkrThds[tid].join();
+    scatterAgg.stop();
     for (unsigned tid = 0; tid < commThdCnt; ++tid)
         ghstRcvrThds[tid].join();
+    commManager.stopRecvShards();
 
     {
-        // clean up
-        unsigned sender, topic;
-        char *msgBuf = new char[MAX_MSG_SIZE];
-        if (commManager.dataPullIn(&sender, &topic, msgBuf,
-                                    MAX_MSG_SIZE)) {
+        // clean up. Aggregated messages can be larger than MAX_MSG_SIZE,
+        // so they are dropped without copying.
+        unsigned sender, topic, valSize;
+        zmq::message_t inMsg;
+        char *value;
+        if (commManager.dataPullIn(&sender, &topic, inMsg, &value, &valSize)) {
             printLog(nodeId, "CLEAN UP: Still msgs in buffer");
         };
-        while (commManager.dataPullIn(&sender, &topic, msgBuf,
-                                    MAX_MSG_SIZE)) {};
-        delete[] msgBuf;
+        while (commManager.dataPullIn(&sender, &topic, inMsg, &value,
+                                      &valSize)) {};
     }
 }
 
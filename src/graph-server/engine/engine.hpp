@@ -1,6 +1,7 @@
 #ifndef __ENGINE_HPP__
 #define __ENGINE_HPP__
 
+#include <algorithm>
 #include <set>
 #include <vector>
 #include <climits>
@@ -18,13 +19,24 @@
 #include "../parallel/lock.hpp"
 #include "../parallel/cond.hpp"
 #include "../utils/utils.hpp"
+#include "../utils/trace.hpp"
 #include "../../common/matrix.hpp"
+#include "chunk_policy.hpp"
+#include "chunk_queue.hpp"
+#include "ghost_codec.hpp"
+#include "ghost_delta.hpp"
+#include "scatter_agg.hpp"
 
-// Max size (bytes) for a message received by the data communicator.
+// Size (bytes) of the rows of a scatter message when not aggregated.
 #define MAX_MSG_SIZE (1 * 1024 * 1024)
 #define NODE_ID_DIGITS 8 // Digits num of node id.
 #define NODE_ID_HEADER "%8X" // Header for node id. For communication.
-#define DATA_HEADER_SIZE (NODE_ID_DIGITS + sizeof(unsigned) * 5)
+#define DATA_HEADER_SIZE (NODE_ID_DIGITS + sizeof(unsigned) * 6)
+#define DATA_KEY_BYTES (sizeof(unsigned) * 4) // featDim, layer, dir, first slot of a scatter value.
+#define GHOST_SLOTS_TOPIC (MAX_IDTYPE - 2) // Slot lists exchanged at startup.
+#define SPARSE_SLOTS UINT_MAX // First slot of messages listing every row's slot.
+#define AGG_MIN_MSG_SIZE (64 * 1024) // Smallest aggregated scatter message.
+#define MULTI_SEGMENTS (1u << 31) // Flag on the first slot of aggregated messages, see ScatterAggregator.
 
 /** Binary features file header struct. */
 struct FeaturesHeaderType {
@@ -36,28 +48,57 @@ struct LabelsHeaderType {
     unsigned labelKinds;
 };
 
-class LockChunkQueue {
-public:
-    void lock() { lk.lock(); }
-    void unlock() { lk.unlock(); }
-
-    bool empty() const { return cq.empty(); }
-    size_t size() const { return cq.size(); }
-    const Chunk &top() const { return cq.top(); }
-    void push(const Chunk &chunk) { cq.push(chunk); }
-    void push_atomic(const Chunk &chunk) {
-        lk.lock();
-        cq.push(chunk);
-        lk.unlock();
+/**
+ *
+ * Header of a per partition features / labels shard (feats.<nid>.bin,
+ * ghostfeats.<nid>.bin, labels.<nid>.bin), written by inputs/shardinputs or
+ * after a full scan of the global files. `idsHash` hashes the gvids of the
+ * rows in order, so a shard of another partitioning is never picked up, and
+ * `srcStamp` is the global file's, so neither is a shard of older inputs.
+ * The ghosts of a hybrid cut exclude the sources of mirrored edges, so ghost
+ * shards also record the hub threshold they were cut for (0 for the others).
+ *
+ */
+#define SHARD_MAGIC 0x44524853u
+#define SHARD_VERSION 3
+struct ShardHeaderType {
+    unsigned magic;
+    unsigned version;
+    unsigned numRows;
+    unsigned rowDim;                // featDim, or labelKinds for labels
+    unsigned long long idsHash;
+    FileStamp srcStamp;
+    unsigned hubThreshold;
+};
+
+/**
+ *
+ * Local vertices every chunk scatters to every node, in flat arrays. The list
+ * of chunk `cid` to node `nid` is
+ * lvids[offsets[cid * numNodes + nid], offsets[cid * numNodes + nid + 1]).
+ *
+ * All the vertices a node sends to `nid`, in ascending lvid order, are the
+ * slots of `nid`. A chunk's list covers consecutive slots starting from
+ * firstSlots[cid * numNodes + nid], so messages only carry the first slot.
+ *
+ */
+struct SendLists {
+    std::vector<unsigned long long> offsets;
+    std::vector<unsigned> lvids;
+    std::vector<unsigned> firstSlots;
+    unsigned numNodes = 0;
+
+    void build(const std::vector<Chunk> &chunks, unsigned numNodes_,
+               const GhostMap &ghostMap);
+    unsigned *list(unsigned cid, unsigned nid) {
+        return lvids.data() + offsets[cid * numNodes + nid];
     }
-    void pop() { cq.pop(); }
-    void clear() {
-        while (!cq.empty())
-            cq.pop();
+    unsigned count(unsigned cid, unsigned nid) const {
+        return offsets[cid * numNodes + nid + 1] - offsets[cid * numNodes + nid];
+    }
+    unsigned firstSlot(unsigned cid, unsigned nid) const {
+        return firstSlots[cid * numNodes + nid];
     }
-private:
-    Lock lk;
-    ChunkQueue cq;
 };
 
 /**
@@ -92,11 +133,11 @@ public:
     void applyVertexGAT(Chunk &chunk);
     void scatterGAT(Chunk &chunk);
     void applyEdgeGAT(Chunk &chunk);
-    LockChunkQueue schQueue;
-    LockChunkQueue GAQueue;
-    LockChunkQueue AVQueue;
-    LockChunkQueue SCQueue;
-    LockChunkQueue AEQueue;
+    LockChunkQueue schQueue{"schQueue"};
+    LockChunkQueue GAQueue{"GAQueue"};
+    LockChunkQueue AVQueue{"AVQueue"};
+    LockChunkQueue SCQueue{"SCQueue"};
+    LockChunkQueue AEQueue{"AEQueue"};
     void gatherWorkFunc(unsigned tid);
     void applyVertexWorkFunc(unsigned tid);
     void scatterWorkFunc(unsigned tid);
@@ -106,7 +147,7 @@ public:
     void applyEdgeWorkFunc(unsigned tid);
     void scheduleFunc(unsigned tid);
     void scheduleAsyncFunc(unsigned tid);
-    LockChunkQueue SCStashQueue;
+    LockChunkQueue SCStashQueue{"SCStashQueue"};
     PROP_TYPE currDir;
     bool pipelineHalt = false;
     bool async = false;
@@ -117,6 +158,18 @@ public:
     bool isLastLayer(const Chunk &c);
 
     void loadChunks();
+    // Publish new chunk priorities and re-sort all chunk queues
+    void reprioritizeChunks();
+    ChunkPolicy *chunkPolicy = NULL;
+    std::string chunkPolicyName;
+    unsigned chunkShards = 1;
+
+    // Dynamic re-chunking (every `rechunkFreq` sync epochs, 0 to disable)
+    void rechunk();
+    void recordChunkTime(const Chunk &c, double time);
+    unsigned rechunkFreq = 0;
+    std::vector<double> chunkTimes; // GA + NN + SC ms, indexed by chunk local id
+    Lock chunkTimesLock;
 
     // TENSOR OPS
     // NOTE: Implementing in engine for now but need to move later
@@ -143,6 +196,7 @@ public:
 
     unsigned dThreads;
     unsigned cThreads;
+    unsigned avThreads = 1;
 
     GNN gnn_type;
 
@@ -172,6 +226,7 @@ public:
     // Read-in files
     std::string datasetDir;
     std::string outFile;
+    std::string traceDir;
     std::string featuresFile;
     std::string layerConfigFile;
     std::string labelsFile;
@@ -189,6 +244,7 @@ public:
     std::string weightserverIPFile;
 
     std::string lambdaName;
+    std::string compressionName = "none";   // See common/compress.hpp
     unsigned numLambdasForward = 0;
     unsigned numEpochs = 0;
     unsigned numSyncEpochs = 0;
@@ -226,9 +282,48 @@ public:
     void calcAcc(FeatType *predicts, FeatType *labels, unsigned vtcsCnt,
                  unsigned featDim);
 
+    // Scatter destinations of the current chunks, rebuilt on (re-)chunking
+    SendLists forwardSendLists;
+    SendLists backwardSendLists;
+    void buildSendLists(const std::vector<Chunk> &chunks);
+    // Ghost rows of the vertices each node sends to me, in the order of the
+    // node's slots: [sender][slot] -> ghost row. Agreed on at startup.
+    std::vector<std::vector<unsigned>> forwardGhostSlots;
+    std::vector<std::vector<unsigned>> backwardGhostSlots;
+    void exchangeGhostSlots();
+    // Wire encoding of the scatter rows, per direction (see ghost_codec.hpp)
+    GhostCodec fwdGhostCodec = GHOST_FP32;
+    GhostCodec bwdGhostCodec = GHOST_FP32;
+    GhostCodec ghostCodec(unsigned dir) {
+        return dir == PROP_TYPE::FORWARD ? fwdGhostCodec : bwdGhostCodec;
+    }
+    // Suppression of barely changed ghost rows in async epochs
+    GhostDelta ghostDelta;
+    std::string ghostDeltaName;
+    float deltaThreshold = 0.01;
+    float deltaTopk = 0.25;
+    bool scatterDelta(Chunk &c, FeatType *scatterTensor, unsigned featDim);
+    // Coalescing of the scatter rows per peer (see scatter_agg.hpp)
+    ScatterAggregator scatterAgg;
+    bool scatterAggOn = false;
+    float aggDeadline = 1.0;
+    bool scatterAggregate(Chunk &c, FeatType *scatterTensor, unsigned featDim);
+    unsigned ghostFeatLayer(Chunk &c);
+    void unpackGhostRows(FeatType *ghostData, unsigned sender, unsigned dir,
+                         unsigned firstSlot, unsigned cnt, unsigned featDim,
+                         char *rows);
+    // Hybrid cut (see DataLoader): partial aggregates of the remote hubs
+    // mirrored here, sent to the hubs' masters after their forward slots
+    unsigned hubThreshold = 0;
+    std::vector<FeatType> mirrorPartials;
+    std::vector<unsigned> mirrorRowIds;
+    void scatterMirrors(unsigned layer, FeatType *vtxFeats, unsigned featDim);
+    void exchangeMirrorRows();
+
     // Worker and communicator thread function.
     void verticesPushOut(unsigned receiver, unsigned totCnt, unsigned *lvids,
-      FeatType *inputTensor, unsigned featDim, Chunk& c);
+      unsigned firstSlot, FeatType *inputTensor, unsigned featDim, Chunk& c,
+      unsigned *rowSlots = NULL);
     void sendEpochUpdate(unsigned currEpoch);
 
     // transform from vtxFeats/edgFeats to edgFeats/vtxFeats
@@ -269,6 +364,11 @@ public:
     void readLayerConfigFile(std::string& layerConfigFileName);
     void readFeaturesFile(std::string& featuresFileName);
     void readLabelsFile(std::string& labelsFileName);
+    std::string shardFile(const char *name);
+    bool readShard(const std::string &filename, const ShardHeaderType &expected,
+                   void *rows, size_t rowBytes);
+    void writeShard(const std::string &filename, const ShardHeaderType &header,
+                    const void *rows, size_t rowBytes);
 
     // Metric printing.
     void printGraphMetrics();
@@ -0,0 +1,178 @@
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "ghost_codec.hpp"
+
+
+static const char *CODEC_NAMES[GHOST_NUM_CODECS] = { "fp32", "fp16", "bf16", "int8" };
+
+GhostCodec parseGhostCodec(const std::string &name) {
+    for (unsigned i = 0; i < GHOST_NUM_CODECS; ++i) {
+        if (name == CODEC_NAMES[i])
+            return (GhostCodec)i;
+    }
+    return GHOST_NUM_CODECS;
+}
+
+const char *ghostCodecName(GhostCodec codec) {
+    return codec < GHOST_NUM_CODECS ? CODEC_NAMES[codec] : "unknown";
+}
+
+unsigned ghostRowSize(GhostCodec codec, unsigned featDim) {
+    switch (codec) {
+        case GHOST_FP16:
+        case GHOST_BF16:
+            return sizeof(uint16_t) * featDim;
+        case GHOST_INT8:
+            return sizeof(float) + sizeof(int8_t) * featDim;
+        default:
+            return sizeof(FeatType) * featDim;
+    }
+}
+
+
+/********************************* Conversions *********************************/
+
+static inline uint32_t floatBits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float bitsFloat(uint32_t u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// Round to nearest even, NaN stays NaN.
+static inline uint16_t floatToBf16(float f) {
+    uint32_t u = floatBits(f);
+    if ((u & 0x7fffffff) > 0x7f800000)
+        return (u >> 16) | 0x40;
+    u += 0x7fff + ((u >> 16) & 1);
+    return u >> 16;
+}
+
+static inline float bf16ToFloat(uint16_t h) {
+    return bitsFloat((uint32_t)h << 16);
+}
+
+// Round to nearest even. Saturates at 65504 rather than overflowing to inf,
+// small values go to (sub)normals.
+static inline uint16_t floatToFp16(float f) {
+    uint32_t u = floatBits(f);
+    uint16_t sign = (u >> 16) & 0x8000;
+    uint32_t absU = u & 0x7fffffff;
+
+    if (absU >= 0x7f800000)                 // Inf or NaN
+        return sign | 0x7c00 | (absU > 0x7f800000 ? 0x200 : 0);
+    if (absU >= 0x477ff000)                 // Rounds above 65504
+        return sign | 0x7bff;
+    if (absU < 0x38800000) {                // Subnormal half
+        if (absU < 0x33000000)
+            return sign;
+        uint32_t mant = (absU & 0x7fffff) | 0x800000;
+        unsigned shift = 126 - (absU >> 23);
+        uint32_t half = mant >> shift;
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t mid = 1u << (shift - 1);
+        if (rem > mid || (rem == mid && (half & 1)))
+            ++half;
+        return sign | half;
+    }
+    absU += 0xfff + ((absU >> 13) & 1);
+    return sign | ((absU - 0x38000000) >> 13);
+}
+
+static inline float fp16ToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+
+    if (exp == 0x1f)                        // Inf or NaN
+        return bitsFloat(sign | 0x7f800000 | (mant << 13));
+    if (exp == 0) {                         // Zero or subnormal
+        float f = std::ldexp((float)mant, -24);
+        return sign ? -f : f;
+    }
+    return bitsFloat(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+
+/********************************* Rows *********************************/
+
+char *encodeGhostRow(GhostCodec codec, const FeatType *row, unsigned featDim,
+                     char *dst) {
+    switch (codec) {
+        case GHOST_FP16:
+        case GHOST_BF16: {
+            for (unsigned i = 0; i < featDim; ++i) {
+                uint16_t h = codec == GHOST_FP16 ? floatToFp16(row[i])
+                                                 : floatToBf16(row[i]);
+                memcpy(dst, &h, sizeof(h));
+                dst += sizeof(h);
+            }
+            return dst;
+        }
+        case GHOST_INT8: {
+            // Scale over the finite values, inf saturates to +-127. A NaN
+            // makes the scale NaN, so the whole row decodes to NaN rather
+            // than to garbage.
+            float maxAbs = 0.0;
+            bool hasNan = false;
+            for (unsigned i = 0; i < featDim; ++i) {
+                if (std::isfinite(row[i]))
+                    maxAbs = std::max(maxAbs, std::fabs(row[i]));
+                else if (std::isnan(row[i]))
+                    hasNan = true;
+            }
+            float scale = hasNan ? std::numeric_limits<float>::quiet_NaN()
+                                 : maxAbs / 127;
+            memcpy(dst, &scale, sizeof(scale));
+            dst += sizeof(scale);
+            float invScale = scale > 0 ? 1 / scale : 0;
+            for (unsigned i = 0; i < featDim; ++i) {
+                long q = 0;
+                if (std::isinf(row[i]))
+                    q = row[i] > 0 ? 127 : -127;
+                else if (!std::isnan(row[i]))
+                    q = std::lrint(row[i] * invScale);
+                *dst++ = (int8_t)std::max(-127l, std::min(127l, q));
+            }
+            return dst;
+        }
+        default:
+            memcpy(dst, row, sizeof(FeatType) * featDim);
+            return dst + sizeof(FeatType) * featDim;
+    }
+}
+
+const char *decodeGhostRow(GhostCodec codec, const char *src, unsigned featDim,
+                           FeatType *row) {
+    switch (codec) {
+        case GHOST_FP16:
+        case GHOST_BF16: {
+            for (unsigned i = 0; i < featDim; ++i) {
+                uint16_t h;
+                memcpy(&h, src, sizeof(h));
+                src += sizeof(h);
+                row[i] = codec == GHOST_FP16 ? fp16ToFloat(h) : bf16ToFloat(h);
+            }
+            return src;
+        }
+        case GHOST_INT8: {
+            float scale;
+            memcpy(&scale, src, sizeof(scale));
+            src += sizeof(scale);
+            for (unsigned i = 0; i < featDim; ++i)
+                row[i] = scale * (int8_t)*src++;
+            return src;
+        }
+        default:
+            memcpy(row, src, sizeof(FeatType) * featDim);
+            return src + sizeof(FeatType) * featDim;
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef __GHOST_CODEC_HPP__
+#define __GHOST_CODEC_HPP__
+
+#include <string>
+
+#include "../utils/utils.hpp"
+
+
+/**
+ *
+ * Wire encoding of the ghost rows sent by scatter.
+ *
+ * FP32 sends the rows as they are. FP16 and BF16 halve the traffic (BF16 keeps
+ * the fp32 range, FP16 keeps more mantissa bits). INT8 quarters it: every row
+ * carries an fp32 scale (max |x| / 127) followed by one signed byte per value.
+ * Encoded rows have no alignment, the decoder copies them out byte-wise.
+ *
+ */
+enum GhostCodec { GHOST_FP32, GHOST_FP16, GHOST_BF16, GHOST_INT8, GHOST_NUM_CODECS };
+
+// GHOST_NUM_CODECS if the name is unknown.
+GhostCodec parseGhostCodec(const std::string &name);
+const char *ghostCodecName(GhostCodec codec);
+
+// Bytes of one encoded row.
+unsigned ghostRowSize(GhostCodec codec, unsigned featDim);
+
+// Both return the position right after the row.
+char *encodeGhostRow(GhostCodec codec, const FeatType *row, unsigned featDim,
+                     char *dst);
+const char *decodeGhostRow(GhostCodec codec, const char *src, unsigned featDim,
+                           FeatType *row);
+
+#endif // __GHOST_CODEC_HPP__
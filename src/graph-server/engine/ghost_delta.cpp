@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "ghost_delta.hpp"
+
+
+static const char *MODE_NAMES[] = { "off", "threshold", "topk" };
+
+bool GhostDelta::init(const std::string &modeName, float threshold_, float topk_,
+                      unsigned numLayers_,
+                      const GhostMap &forwardGhostMap,
+                      const GhostMap &backwardGhostMap) {
+    mode = GHOST_DELTA_NUM_MODES;
+    for (unsigned i = 0; i < GHOST_DELTA_NUM_MODES; ++i) {
+        if (modeName == MODE_NAMES[i])
+            mode = (GhostDeltaMode)i;
+    }
+    if (mode == GHOST_DELTA_NUM_MODES) {
+        mode = GHOST_DELTA_OFF;
+        return false;
+    }
+    if (mode == GHOST_DELTA_OFF)
+        return true;
+
+    threshold = threshold_;
+    topk = std::min(std::max(topk_, 0.0f), 1.0f);
+    numLayers = numLayers_;
+
+    const GhostMap *ghostMaps[2] =
+        { &forwardGhostMap, &backwardGhostMap };
+    for (unsigned dir = 0; dir < 2; ++dir) {
+        boundary[dir].clear();
+        for (auto &kv : *ghostMaps[dir])
+            boundary[dir].push_back(kv.first);
+    }
+    states.clear();
+    states.resize(2 * (numLayers + 1));
+    return true;
+}
+
+const char *GhostDelta::name() const {
+    return MODE_NAMES[mode];
+}
+
+GhostDelta::LayerState &GhostDelta::state(unsigned layer, unsigned dir,
+                                          unsigned featDim) {
+    assert(layer <= numLayers);
+    std::lock_guard<std::mutex> lk(allocMtx);
+    std::unique_ptr<LayerState> &st = states[dir * (numLayers + 1) + layer];
+    if (!st) {
+        st.reset(new LayerState());
+        st->lastSent.resize(boundary[dir].size() * featDim);
+        st->hasSent.assign(boundary[dir].size(), 0);
+    }
+    return *st;
+}
+
+void GhostDelta::select(unsigned layer, unsigned dir, const FeatType *tensor,
+                        unsigned featDim, unsigned lowBound, unsigned upBound,
+                        bool force, std::vector<char> &send) {
+    send.assign(upBound - lowBound, 0);
+    LayerState &st = state(layer, dir, featDim);
+
+    std::vector<unsigned> &vtcs = boundary[dir];
+    unsigned stt = std::lower_bound(vtcs.begin(), vtcs.end(), lowBound) - vtcs.begin();
+    unsigned end = std::lower_bound(vtcs.begin(), vtcs.end(), upBound) - vtcs.begin();
+    if (stt == end)
+        return;
+
+    std::vector<char> suppress(end - stt, 0);
+    if (!force) {
+        // Relative change of every row; rows never sent always go
+        std::vector<float> changes(end - stt);
+        for (unsigned b = stt; b < end; ++b) {
+            if (!st.hasSent[b]) {
+                changes[b - stt] = INFINITY;
+                continue;
+            }
+            const FeatType *row = tensor + (size_t)vtcs[b] * featDim;
+            const FeatType *last = st.lastSent.data() + (size_t)b * featDim;
+            float diff = 0.0, norm = 0.0;
+            for (unsigned j = 0; j < featDim; ++j) {
+                diff += (row[j] - last[j]) * (row[j] - last[j]);
+                norm += last[j] * last[j];
+            }
+            changes[b - stt] = std::sqrt(diff) / std::max(std::sqrt(norm), 1e-12f);
+        }
+
+        float cutoff = threshold;
+        if (mode == GHOST_DELTA_TOPK) {
+            unsigned k = std::ceil(topk * changes.size());
+            if (k == 0) {
+                cutoff = INFINITY;
+            } else {
+                std::vector<float> sorted(changes);
+                std::nth_element(sorted.begin(), sorted.begin() + (k - 1),
+                                 sorted.end(), std::greater<float>());
+                // Ties with the k-th row all go
+                cutoff = std::nextafter(sorted[k - 1], -INFINITY);
+            }
+        }
+        for (unsigned b = stt; b < end; ++b)
+            suppress[b - stt] = st.hasSent[b] && changes[b - stt] <= cutoff;
+    }
+
+    unsigned long long numSent = 0;
+    for (unsigned b = stt; b < end; ++b) {
+        if (suppress[b - stt])
+            continue;
+        const FeatType *row = tensor + (size_t)vtcs[b] * featDim;
+        memcpy(st.lastSent.data() + (size_t)b * featDim, row,
+               sizeof(FeatType) * featDim);
+        st.hasSent[b] = 1;
+        send[vtcs[b] - lowBound] = 1;
+        ++numSent;
+    }
+
+    if (!force) {
+        st.considered += end - stt;
+        st.sent += numSent;
+    }
+}
+
+void GhostDelta::report(unsigned nodeId) {
+    if (!enabled())
+        return;
+    for (unsigned dir = 0; dir < 2; ++dir) {
+        for (unsigned layer = 0; layer <= numLayers; ++layer) {
+            std::unique_ptr<LayerState> &st = states[dir * (numLayers + 1) + layer];
+            if (!st || st->considered == 0)
+                continue;
+            unsigned long long considered = st->considered;
+            unsigned long long sent = st->sent;
+            printLog(nodeId, "<EM>: Ghost delta (%s) layer %u %s: suppressed "
+                     "%llu / %llu rows (%.1lf%%)", name(), layer,
+                     dir == PROP_TYPE::FORWARD ? "forward" : "backward",
+                     considered - sent, considered,
+                     100.0 * (considered - sent) / considered);
+        }
+    }
+}
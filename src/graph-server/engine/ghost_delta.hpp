@@ -0,0 +1,76 @@
+#ifndef __GHOST_DELTA_HPP__
+#define __GHOST_DELTA_HPP__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../graph/graph.hpp"
+#include "../utils/utils.hpp"
+
+
+/**
+ *
+ * Suppression of ghost rows that barely changed since they were last sent.
+ *
+ * Keeps the last-sent value of every boundary vertex per (layer, direction).
+ * In async epochs scatter only sends the rows that changed enough, and the
+ * receivers keep the stale value of the others, which the bounded staleness
+ * already allows:
+ *   threshold: rows with ||x - last|| > threshold * ||last||.
+ *   topk:      the `topk` fraction of each chunk's rows that changed most.
+ * Rows never sent before are always sent. Sync epochs send every row but
+ * still refresh the last-sent values.
+ *
+ * Chunks are disjoint ranges of vertices, so several scatter threads can call
+ * select() at the same time.
+ *
+ */
+enum GhostDeltaMode { GHOST_DELTA_OFF, GHOST_DELTA_THRESHOLD, GHOST_DELTA_TOPK,
+                      GHOST_DELTA_NUM_MODES };
+
+class GhostDelta {
+public:
+    // False if the mode name is unknown.
+    bool init(const std::string &modeName, float threshold_, float topk_,
+              unsigned numLayers_,
+              const GhostMap &forwardGhostMap,
+              const GhostMap &backwardGhostMap);
+    bool enabled() const { return mode != GHOST_DELTA_OFF; }
+    const char *name() const;
+
+    // Decide which vertices of [lowBound, upBound) to send. Sets
+    // send[lvid - lowBound] for them and remembers their values. `force` sends
+    // all the boundary vertices.
+    void select(unsigned layer, unsigned dir, const FeatType *tensor,
+                unsigned featDim, unsigned lowBound, unsigned upBound,
+                bool force, std::vector<char> &send);
+
+    // Suppression rates of the async epochs, per layer and direction.
+    void report(unsigned nodeId);
+
+private:
+    struct LayerState {
+        std::vector<FeatType> lastSent;     // One row per boundary vertex.
+        std::vector<char> hasSent;
+        std::atomic<unsigned long long> considered{0};
+        std::atomic<unsigned long long> sent{0};
+    };
+    LayerState &state(unsigned layer, unsigned dir, unsigned featDim);
+
+    GhostDeltaMode mode = GHOST_DELTA_OFF;
+    float threshold = 0.0;
+    float topk = 1.0;
+    unsigned numLayers = 0;
+
+    // Per direction: boundary vertices in ascending order; their rows in the
+    // layer states follow the same order.
+    std::vector<unsigned> boundary[2];
+
+    std::mutex allocMtx;
+    std::vector<std::unique_ptr<LayerState>> states;  // [dir * (numLayers + 1) + layer]
+};
+
+#endif // __GHOST_DELTA_HPP__
@@ -286,40 +286,36 @@ void Engine::scatterGAT(Chunk &c) {
     FeatType *scatterTensor =
         savedNNTensors[outputLayer][tensorName].getData();
 
-    unsigned startId = c.lowBound;
-    unsigned endId = c.upBound;
     unsigned featDim = getFeatDim(featLayer);
 
-    std::map<unsigned, std::vector<unsigned>> &ghostMap =
-        c.dir == PROP_TYPE::FORWARD ? graph.forwardGhostMap
-                                    : graph.backwardGhostMap;
+    if (scatterDelta(c, scatterTensor, featDim))
+        return;
+    if (scatterAggregate(c, scatterTensor, featDim))
+        return;
+
+    SendLists &sendLists = c.dir == PROP_TYPE::FORWARD ? forwardSendLists
+                                                       : backwardSendLists;
 
     // batch sendouts similar to the sequential version
     const unsigned BATCH_SIZE = std::max(
         (MAX_MSG_SIZE - DATA_HEADER_SIZE) /
-            (sizeof(unsigned) + sizeof(FeatType) * featDim),
+            ghostRowSize(ghostCodec(c.dir), featDim),
         1ul);  // at least send one vertex
-    // Create a series of buckets for batching sendout messages to nodes
-    auto *batchedIds = new std::vector<unsigned>[numNodes];
-    for (unsigned lvid = startId; lvid < endId; ++lvid) {
-        for (unsigned nid : ghostMap[lvid]) {
-            batchedIds[nid].push_back(lvid);
-        }
-    }
 
     for (unsigned nid = 0; nid < numNodes; ++nid) {
         if (nid == nodeId)
             continue;
-        unsigned ghostVCnt = batchedIds[nid].size();
+        unsigned ghostVCnt = sendLists.count(c.localId, nid);
+        unsigned *ghostIds = sendLists.list(c.localId, nid);
+        unsigned firstSlot = sendLists.firstSlot(c.localId, nid);
 #if false && (defined(_CPU_ENABLED_) || defined(_GPU_ENABLED_))
 #pragma omp parallel for
 #endif
         for (unsigned ib = 0; ib < ghostVCnt; ib += BATCH_SIZE) {
             unsigned sendBatchSize = (ghostVCnt - ib) < BATCH_SIZE
                                    ? (ghostVCnt - ib) : BATCH_SIZE;
-            verticesPushOut(nid, sendBatchSize,
-                            batchedIds[nid].data() + ib, scatterTensor,
-                            featDim, c);
+            verticesPushOut(nid, sendBatchSize, ghostIds + ib,
+                            firstSlot + ib, scatterTensor, featDim, c);
             if (!async) {
                 // recvCntLock.lock();
                 // recvCnt++;
@@ -328,33 +324,35 @@ void Engine::scatterGAT(Chunk &c) {
             }
         }
     }
-
-    delete[] batchedIds;
 }
 
 void Engine::ghostReceiverGAT(unsigned tid) {
     // printLog(nodeId, "RECEIVER: Starting");
     BackoffSleeper bs;
     unsigned sender, topic;
-    FeatType *msgBuf = (FeatType *)new char[MAX_MSG_SIZE];
+    // My shard of the messages, parsed in place (see runPipeline())
+    zmq::message_t inMsg;
+    char *msgBuf;
+    unsigned msgSize;
 
     // While loop, looping infinitely to get the next message.
     while (true) {
         // No message in queue.
-        if (!commManager.dataPullIn(&sender, &topic, msgBuf, MAX_MSG_SIZE)) {
+        if (!commManager.dataPullIn(tid, &sender, &topic, inMsg, &msgBuf, &msgSize)) {
             bs.sleep();
             if (pipelineHalt) {
                 break;
             }
             // Pull in the next message, and process this message.
         } else {
+            TraceScope trace("ghost recv", "comm");
             // A normal ghost value broadcast.
             if (topic < MAX_IDTYPE - 1) {
                 if (!async) {
                     // Using MAX_IDTYPE - 1 as the receive signal.
                     commManager.dataPushOut(sender, nodeId, MAX_IDTYPE - 1, NULL, 0);
                 }
-                char *bufPtr = (char *)msgBuf;
+                char *bufPtr = msgBuf;
                 unsigned recvGhostVCnt = topic;
                 unsigned featDim = *(unsigned *)bufPtr;
                 bufPtr += sizeof(unsigned);
@@ -362,13 +360,11 @@ void Engine::ghostReceiverGAT(unsigned tid) {
                 bufPtr += sizeof(unsigned);
                 unsigned dir = *(unsigned *)bufPtr;
                 bufPtr += sizeof(unsigned);
+                unsigned firstSlot = *(unsigned *)bufPtr;
+                bufPtr += sizeof(unsigned);
                 // Get proper variables depending on forward or backward
                 std::string tensorName = dir == PROP_TYPE::FORWARD
                                        ? "fg_z" : "bg_d";
-                std::map<unsigned, unsigned> &globalToGhostVtcs =
-                    dir == PROP_TYPE::FORWARD ? graph.srcGhostVtcs
-                                              : graph.dstGhostVtcs;
-
                 // printLog(nodeId, "RECEIVER: Got msg %u:%s", layer,
                 //   dir == PROP_TYPE::FORWARD ? "F" : "B");
                 FeatType *ghostData =
@@ -380,15 +376,8 @@ void Engine::ghostReceiverGAT(unsigned tid) {
                 }
 
                 // Update ghost vertices
-                for (unsigned i = 0; i < recvGhostVCnt; ++i) {
-                    unsigned gvid = *(unsigned *)bufPtr;
-                    bufPtr += sizeof(unsigned);
-                    FeatType *dataPtr = getVtxFeat(
-                        ghostData, globalToGhostVtcs[gvid] - graph.localVtxCnt,
-                        featDim);
-                    memcpy(dataPtr, bufPtr, sizeof(FeatType) * featDim);
-                    bufPtr += sizeof(FeatType) * featDim;
-                }
+                unpackGhostRows(ghostData, sender, dir, firstSlot,
+                                recvGhostVCnt, featDim, bufPtr);
 
                 if (!async) {
                     // recvCntLock.lock();
@@ -425,13 +414,12 @@ void Engine::ghostReceiverGAT(unsigned tid) {
         }
     }
 
-    if (commManager.dataPullIn(&sender, &topic, msgBuf, MAX_MSG_SIZE)) {
+    if (commManager.dataPullIn(tid, &sender, &topic, inMsg, &msgBuf, &msgSize)) {
         printLog(nodeId, "CLEAN UP: Still messages in buffer");
         // clean up
-        while (commManager.dataPullIn(&sender, &topic, msgBuf,
-                                        MAX_MSG_SIZE)) {};
+        while (commManager.dataPullIn(tid, &sender, &topic, inMsg, &msgBuf,
+                                      &msgSize)) {};
     }
-    delete[] msgBuf;
 }
 
 void Engine::applyEdgeGAT(Chunk &c) {
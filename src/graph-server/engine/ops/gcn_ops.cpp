@@ -213,40 +213,36 @@ void Engine::scatterGCN(Chunk &c) {
     FeatType *scatterTensor =
         savedNNTensors[outputLayer][tensorName].getData();
 
-    unsigned startId = c.lowBound;
-    unsigned endId = c.upBound;
     unsigned featDim = getFeatDim(c.layer);
 
-    std::map<unsigned, std::vector<unsigned>> &ghostMap =
-        c.dir == PROP_TYPE::FORWARD ? graph.forwardGhostMap
-                                    : graph.backwardGhostMap;
+    if (scatterDelta(c, scatterTensor, featDim))
+        return;
+    if (scatterAggregate(c, scatterTensor, featDim))
+        return;
+
+    SendLists &sendLists = c.dir == PROP_TYPE::FORWARD ? forwardSendLists
+                                                       : backwardSendLists;
 
     // batch sendouts similar to the sequential version
     const unsigned BATCH_SIZE = std::max(
         (MAX_MSG_SIZE - DATA_HEADER_SIZE) /
-            (sizeof(unsigned) + sizeof(FeatType) * featDim),
+            ghostRowSize(ghostCodec(c.dir), featDim),
         1ul);  // at least send one vertex
-    // Create a series of buckets for batching sendout messages to nodes
-    auto *batchedIds = new std::vector<unsigned>[numNodes];
-    for (unsigned lvid = startId; lvid < endId; ++lvid) {
-        for (unsigned nid : ghostMap[lvid]) {
-            batchedIds[nid].push_back(lvid);
-        }
-    }
 
     for (unsigned nid = 0; nid < numNodes; ++nid) {
         if (nid == nodeId)
             continue;
-        unsigned ghostVCnt = batchedIds[nid].size();
+        unsigned ghostVCnt = sendLists.count(c.localId, nid);
+        unsigned *ghostIds = sendLists.list(c.localId, nid);
+        unsigned firstSlot = sendLists.firstSlot(c.localId, nid);
 #if defined(_GPU_ENABLED_)
 #pragma omp parallel for
 #endif
         for (unsigned ib = 0; ib < ghostVCnt; ib += BATCH_SIZE) {
             unsigned sendBatchSize = (ghostVCnt - ib) < BATCH_SIZE
                                    ? (ghostVCnt - ib) : BATCH_SIZE;
-            verticesPushOut(nid, sendBatchSize,
-                            batchedIds[nid].data() + ib, scatterTensor,
-                            featDim, c);
+            verticesPushOut(nid, sendBatchSize, ghostIds + ib,
+                            firstSlot + ib, scatterTensor, featDim, c);
             if (!async) {
                 // recvCntLock.lock();
                 // recvCnt++;
@@ -255,33 +251,95 @@ void Engine::scatterGCN(Chunk &c) {
             }
         }
     }
+}
+
+/**
+ *
+ * Hybrid cut: aggregate the mirrored in edges of every remote hub into one
+ * partial row, and send the rows to the hubs' masters. The master adds them
+ * up in its hub's CSC column like any ghost row, before apply-vertex.
+ *
+ * Called once all the chunks of the layer are scattered, as a partial row
+ * sums over vertices of every chunk.
+ *
+ */
+void Engine::scatterMirrors(unsigned layer, FeatType *vtxFeats,
+                            unsigned featDim) {
+    const CSCMatrix<EdgeType> &adj = graph.mirrorAdj;
+    if (mirrorPartials.size() < (size_t)adj.columnCnt * featDim)
+        mirrorPartials.resize((size_t)adj.columnCnt * featDim);
+    if (mirrorRowIds.size() != adj.columnCnt) {
+        mirrorRowIds.resize(adj.columnCnt);
+        for (unsigned i = 0; i < adj.columnCnt; ++i)
+            mirrorRowIds[i] = i;
+    }
+
+#ifdef _CPU_ENABLED_
+#pragma omp parallel for
+#endif
+    for (unsigned hub = 0; hub < adj.columnCnt; ++hub) {
+        FeatType *partial = getVtxFeat(mirrorPartials.data(), hub, featDim);
+        std::memset(partial, 0, sizeof(FeatType) * featDim);
+        for (uint64_t eid = adj.columnPtrs[hub];
+             eid < adj.columnPtrs[hub + 1]; ++eid) {
+            EdgeType normFactor = adj.values[eid];
+            FeatType *srcData = getVtxFeat(vtxFeats, adj.rowIdxs[eid], featDim);
+            for (unsigned j = 0; j < featDim; ++j) {
+                partial[j] += srcData[j] * normFactor;
+            }
+        }
+    }
 
-    delete[] batchedIds;
+    Chunk c = { 0, 0, 0, 0, layer, PROP_TYPE::FORWARD, currEpoch, true };
+    const unsigned BATCH_SIZE = std::max(
+        (MAX_MSG_SIZE - DATA_HEADER_SIZE) /
+            ghostRowSize(ghostCodec(c.dir), featDim),
+        1ul);
+    for (unsigned nid = 0; nid < numNodes; ++nid) {
+        if (nid == nodeId)
+            continue;
+        unsigned first = graph.mirrorHubPtrs[nid];
+        unsigned hubCnt = graph.mirrorHubPtrs[nid + 1] - first;
+        // Mirror slots follow the plain forward slots, see exchangeGhostSlots()
+        unsigned firstSlot = graph.forwardLocalVtxDsts[nid].size();
+        for (unsigned ib = 0; ib < hubCnt; ib += BATCH_SIZE) {
+            unsigned sendBatchSize = std::min(hubCnt - ib, BATCH_SIZE);
+            verticesPushOut(nid, sendBatchSize, mirrorRowIds.data() + first + ib,
+                            firstSlot + ib, mirrorPartials.data(), featDim, c);
+            if (!async) {
+                __sync_fetch_and_add(&recvCnt, 1);
+            }
+        }
+    }
 }
 
 void Engine::ghostReceiverGCN(unsigned tid) {
     // printLog(nodeId, "RECEIVER: Starting");
     BackoffSleeper bs;
     unsigned sender, topic;
-    FeatType *msgBuf = (FeatType *)new char[MAX_MSG_SIZE];
+    // My shard of the messages, parsed in place (see runPipeline())
+    zmq::message_t inMsg;
+    char *msgBuf;
+    unsigned msgSize;
 
     // While loop, looping infinitely to get the next message.
     while (true) {
         // No message in queue.
-        if (!commManager.dataPullIn(&sender, &topic, msgBuf, MAX_MSG_SIZE)) {
+        if (!commManager.dataPullIn(tid, &sender, &topic, inMsg, &msgBuf, &msgSize)) {
             bs.sleep();
             if (pipelineHalt) {
                 break;
             }
             // Pull in the next message, and process this message.
         } else {
+            TraceScope trace("ghost recv", "comm");
             // A normal ghost value broadcast.
             if (topic < MAX_IDTYPE - 1) {
                 if (!async) {
                     // Using MAX_IDTYPE - 1 as the receive signal.
                     commManager.dataPushOut(sender, nodeId, MAX_IDTYPE - 1, NULL, 0);
                 }
-                char *bufPtr = (char *)msgBuf;
+                char *bufPtr = msgBuf;
                 unsigned recvGhostVCnt = topic;
                 unsigned featDim = *(unsigned *)bufPtr;
                 bufPtr += sizeof(unsigned);
@@ -289,13 +347,11 @@ void Engine::ghostReceiverGCN(unsigned tid) {
                 bufPtr += sizeof(unsigned);
                 unsigned dir = *(unsigned *)bufPtr;
                 bufPtr += sizeof(unsigned);
+                unsigned firstSlot = *(unsigned *)bufPtr;
+                bufPtr += sizeof(unsigned);
                 // Get proper variables depending on forward or backward
                 std::string tensorName = dir == PROP_TYPE::FORWARD
                                        ? "fg" : "bg";
-                std::map<unsigned, unsigned> &globalToGhostVtcs =
-                    dir == PROP_TYPE::FORWARD ? graph.srcGhostVtcs
-                                              : graph.dstGhostVtcs;
-
                 // printLog(nodeId, "RECEIVER: Got msg %u:%s", layer,
                 //   dir == PROP_TYPE::FORWARD ? "F" : "B");
                 FeatType *ghostData =
@@ -307,15 +363,8 @@ void Engine::ghostReceiverGCN(unsigned tid) {
                 }
 
                 // Update ghost vertices
-                for (unsigned i = 0; i < recvGhostVCnt; ++i) {
-                    unsigned gvid = *(unsigned *)bufPtr;
-                    bufPtr += sizeof(unsigned);
-                    FeatType *dataPtr = getVtxFeat(
-                        ghostData, globalToGhostVtcs[gvid] - graph.localVtxCnt,
-                        featDim);
-                    memcpy(dataPtr, bufPtr, sizeof(FeatType) * featDim);
-                    bufPtr += sizeof(FeatType) * featDim;
-                }
+                unpackGhostRows(ghostData, sender, dir, firstSlot,
+                                recvGhostVCnt, featDim, bufPtr);
 
                 if (!async) {
                     // recvCntLock.lock();
@@ -352,13 +401,12 @@ void Engine::ghostReceiverGCN(unsigned tid) {
         }
     }
 
-    if (commManager.dataPullIn(&sender, &topic, msgBuf, MAX_MSG_SIZE)) {
+    if (commManager.dataPullIn(tid, &sender, &topic, inMsg, &msgBuf, &msgSize)) {
         printLog(nodeId, "CLEAN UP: Still messages in buffer");
         // clean up
-        while (commManager.dataPullIn(&sender, &topic, msgBuf,
-                                        MAX_MSG_SIZE)) {};
+        while (commManager.dataPullIn(tid, &sender, &topic, inMsg, &msgBuf,
+                                      &msgSize)) {};
     }
-    delete[] msgBuf;
 }
 
 void Engine::applyEdgeGCN(Chunk &chunk) {
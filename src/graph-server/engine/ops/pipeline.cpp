@@ -1,3 +1,5 @@
+#include <omp.h>
+
 #include "../engine.hpp"
 
 #pragma GCC diagnostic push
@@ -9,6 +11,7 @@ void Engine::scheduleAsyncFunc(unsigned tid) {
     // unsigned numAsyncEpochs = 0;
     const bool BLOCK = true;
     bool block = BLOCK;
+    Tracer::setThreadName("scheduler");
 
     BackoffSleeper bs;
     while (!pipelineHalt) {
@@ -107,6 +110,10 @@ void Engine::scheduleAsyncFunc(unsigned tid) {
                     schQueue.unlock();
                     // Only master thread will call barrier
                     nodeManager.barrier();
+                    if (rechunkFreq && currEpoch > START_EPOCH &&
+                        currEpoch % rechunkFreq == 0) {
+                        rechunk();
+                    }
                     block = false;
                 } else { // Waiting all chunks finish or not master thd
                     schQueue.unlock();
@@ -154,6 +161,8 @@ void Engine::scheduleAsyncFunc(unsigned tid) {
             ++currEpoch;
             schQueue.pop();
             schQueue.unlock();
+            // Chunks of the new epoch are scheduled with the latest records
+            reprioritizeChunks();
 
             // some initialization...
             layer = 0;
@@ -182,20 +191,18 @@ void Engine::scheduleAsyncFunc(unsigned tid) {
 #pragma GCC diagnostic pop
 
 void Engine::gatherWorkFunc(unsigned tid) {
+    Tracer::setThreadName("GA");
     BackoffSleeper bs;
     while (!pipelineHalt) {
-        GAQueue.lock();
-        if (GAQueue.empty()) {
-            GAQueue.unlock();
+        Chunk c;
+        if (!GAQueue.tryPop(c)) {
             bs.sleep();
             continue;
         }
-
-        Chunk c = GAQueue.top();
         // printLog(nodeId, "GA: Got %s", c.str().c_str());
-        GAQueue.pop();
-        GAQueue.unlock();
 
+        TraceScope trace("GA", "stage", c);
+        double gaStt = getTimer();
         if (gnn_type == GNN::GCN) {
             aggregateGCN(c);
             // applyVertexGCN(c);
@@ -214,6 +221,7 @@ void Engine::gatherWorkFunc(unsigned tid) {
         } else {
             abort();
         }
+        recordChunkTime(c, getTimer() - gaStt);
 
         bs.reset();
     }
@@ -222,22 +230,26 @@ void Engine::gatherWorkFunc(unsigned tid) {
 
 // We could merge GA and AV since GA always calls AV
 void Engine::applyVertexWorkFunc(unsigned tid) {
+    // Split the OpenMP (and OpenMP BLAS) threads among the AV workers so that
+    // concurrent chunks do not oversubscribe the cores.
+    if (avThreads > 1) {
+        omp_set_num_threads(std::max(1, omp_get_num_procs() / (int)avThreads));
+    }
+    Tracer::setThreadName("AV");
+
     BackoffSleeper bs;
     while (!pipelineHalt) {
-        AVQueue.lock();
-        if (AVQueue.empty()) {
-            AVQueue.unlock();
+        Chunk c;
+        if (!AVQueue.tryPop(c)) {
             bs.sleep();
             continue;
         }
-
-        Chunk c = AVQueue.top();
         c.vertex = true;
         // Note: here the chunk layer may be wrong for AVB, because AVB has a
         // pre-barrier inside applyVertex[GCN|GAT] to update the chunk layer.
         // printLog(nodeId, "AV: Got %s", c.str().c_str());
-        AVQueue.pop();
-        AVQueue.unlock();
+
+        TraceScope trace("AV", "stage", c);
 
         if (gnn_type == GNN::GCN)
             applyVertexGCN(c);
@@ -254,6 +266,7 @@ void Engine::applyVertexWorkFunc(unsigned tid) {
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-but-set-variable"
 void Engine::scatterWorkFunc(unsigned tid) {
+    Tracer::setThreadName("SC");
     BackoffSleeper bs;
     const bool BLOCK = true;
     bool block = BLOCK;
@@ -261,22 +274,31 @@ void Engine::scatterWorkFunc(unsigned tid) {
         // Sync all nodes during scatter
         if (SCStashQueue.size() == numLambdasForward) {
             if (tid == 0) {
+                // Rows still waiting in the aggregator count as sent
+                scatterAgg.flushAll();
+                // Hybrid cut: partial rows sum over every chunk of the layer
+                if (graph.hubThreshold > 0 && currDir == PROP_TYPE::FORWARD) {
+                    scatterMirrors(layer, savedNNTensors[layer - 1]["h"].getData(),
+                                   getFeatDim(layer));
+                }
                 unsigned totalGhostCnt = currDir == PROP_TYPE::FORWARD
                                        ? graph.srcGhostCnt
                                        : graph.dstGhostCnt;
-                recvCntLock.lock();
-                while (recvCnt > 0 || ghostVtcsRecvd != totalGhostCnt) {
-                    recvCntCond.wait();
-                    // usleep(1000 * 1000);
+                {
+                    TraceScope trace("ghost wait", "sync");
+                    recvCntLock.lock();
+                    while (recvCnt > 0 || ghostVtcsRecvd != totalGhostCnt) {
+                        recvCntCond.wait();
+                        // usleep(1000 * 1000);
+                    }
+                    recvCntLock.unlock();
                 }
-                recvCntLock.unlock();
                 nodeManager.barrier();
                 block = BLOCK;
                 recvCnt = 0;
                 ghostVtcsRecvd = 0;
-                while (!SCStashQueue.empty()) {
-                    Chunk sc = SCStashQueue.top();
-                    SCStashQueue.pop();
+                Chunk sc;
+                while (SCStashQueue.tryPop(sc)) {
                     AEQueue.push_atomic(sc);
                 }
             } else {
@@ -320,6 +342,8 @@ void Engine::scatterWorkFunc(unsigned tid) {
         SCQueue.pop();
         SCQueue.unlock();
 
+        TraceScope trace("SC", "stage", c);
+        double scStt = getTimer();
         if (gnn_type == GNN::GCN) {
             scatterGCN(c);
         } else if (gnn_type == GNN::GAT) {
@@ -327,6 +351,7 @@ void Engine::scatterWorkFunc(unsigned tid) {
         } else {
             abort();
         }
+        recordChunkTime(c, getTimer() - scStt);
 
         // Sync-Scatter for sync-pipeline and
         // the first epoch in asyn-pipeline only
@@ -343,6 +368,7 @@ void Engine::scatterWorkFunc(unsigned tid) {
 #pragma GCC diagnostic pop
 
 void Engine::ghostReceiverFunc(unsigned tid) {
+    Tracer::setThreadName("ghost receiver");
     switch (gnn_type) {
         case GNN::GCN:
             ghostReceiverGCN(tid);
@@ -357,20 +383,18 @@ void Engine::ghostReceiverFunc(unsigned tid) {
 
 // Only for single thread because of the barrier
 void Engine::applyEdgeWorkFunc(unsigned tid) {
+    Tracer::setThreadName("AE");
     BackoffSleeper bs;
     while (!pipelineHalt) {
-        AEQueue.lock();
-        if (AEQueue.empty()) {
-            AEQueue.unlock();
+        Chunk c;
+        if (!AEQueue.tryPop(c)) {
             bs.sleep();
             continue;
         }
-
-        Chunk c = AEQueue.top();
         c.vertex = false;
         // printLog(nodeId, "AE: Got %s", c.str().c_str());
-        AEQueue.pop();
-        AEQueue.unlock();
+
+        TraceScope trace("AE", "stage", c);
 
         if (gnn_type == GNN::GCN) {
             applyEdgeGCN(c); // do nothing but push chunk to GAQueue
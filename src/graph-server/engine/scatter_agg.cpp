@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+#include "engine.hpp"
+#include "scatter_agg.hpp"
+
+
+// Value header (featDim, layer, dir, MULTI_SEGMENTS | first slot) and segment header.
+static const size_t AGG_HEADER_SIZE = NODE_ID_DIGITS + sizeof(unsigned) * 6;
+static const size_t SEG_HEADER_SIZE = sizeof(unsigned) * 2;
+
+static inline void putUnsigned(char *dst, unsigned val) {
+    memcpy(dst, &val, sizeof(unsigned));
+}
+
+
+void ScatterAggregator::init(unsigned numNodes_, unsigned nodeId_,
+                             CommManager *comm_, SendFunc send_,
+                             size_t minSize_, double deadline_) {
+    numNodes = numNodes_;
+    nodeId = nodeId_;
+    comm = comm_;
+    send = send_;
+    maxSize = std::min(comm->dataBufferSize(), comm->maxDataMsgSize());
+    minSize = std::min(minSize_, maxSize);
+    deadline = deadline_;
+    peers = std::vector<Peer>(numNodes);
+    for (Peer &peer : peers)
+        peer.target = minSize;
+}
+
+
+/**
+ *
+ * The open stream of (layer, dir) to a peer; opens one if needed. The peer
+ * must be locked.
+ *
+ */
+ScatterAggregator::Stream &
+ScatterAggregator::stream(Peer &peer, unsigned receiver, unsigned layer,
+                          unsigned dir, unsigned featDim, GhostCodec codec) {
+    for (Stream &s : peer.streams) {
+        if (s.layer == layer && s.dir == dir)
+            return s;
+    }
+
+    Stream s;
+    s.layer = layer;
+    s.dir = dir;
+    s.featDim = featDim;
+    s.codec = codec;
+    s.buf = comm->dataBuffer();
+    s.size = AGG_HEADER_SIZE;
+    s.rows = 0;
+    s.segOffset = 0;
+    s.segNextSlot = UINT_MAX;
+    s.openTime = getTimer();
+
+    sprintf(s.buf, NODE_ID_HEADER, receiver);
+    // The topic (row count) is filled in on flush
+    // The first slot is filled in by the first segment
+    populateHeader(s.buf + NODE_ID_DIGITS, nodeId, 0u, featDim, layer, dir);
+    peer.streams.push_back(s);
+    return peer.streams.back();
+}
+
+
+void ScatterAggregator::add(unsigned receiver, unsigned layer, unsigned dir,
+                            unsigned featDim, GhostCodec codec,
+                            unsigned firstSlot, const unsigned *lvids,
+                            unsigned cnt, const FeatType *tensor) {
+    Peer &peer = peers[receiver];
+    size_t rowSize = ghostRowSize(codec, featDim);
+    assert(AGG_HEADER_SIZE + SEG_HEADER_SIZE + rowSize <= maxSize);
+    assert(firstSlot + cnt <= MULTI_SEGMENTS);
+
+    std::lock_guard<std::mutex> lk(peer.mtx);
+    updateTarget(peer, rowSize * cnt);
+    while (cnt > 0) {
+        size_t i;
+        {
+            Stream &s = stream(peer, receiver, layer, dir, featDim, codec);
+            i = &s - peer.streams.data();
+        }
+        Stream &s = peer.streams[i];
+
+        bool extend = s.segOffset != 0 && s.segNextSlot == firstSlot;
+        size_t used = s.size + (extend ? 0 : SEG_HEADER_SIZE);
+        unsigned n = used >= maxSize ? 0
+                   : std::min((size_t)cnt, (maxSize - used) / rowSize);
+        if (n == 0) {
+            flush(receiver, peer, i);
+            continue;
+        }
+
+        if (!extend) {
+            if (s.size == AGG_HEADER_SIZE) {
+                putUnsigned(s.buf + NODE_ID_DIGITS + sizeof(unsigned) * 5,
+                            MULTI_SEGMENTS | firstSlot);
+            }
+            s.segOffset = s.size;
+            putUnsigned(s.buf + s.size, firstSlot);
+            putUnsigned(s.buf + s.size + sizeof(unsigned), 0);
+            s.size += SEG_HEADER_SIZE;
+        }
+        unsigned segCnt;
+        memcpy(&segCnt, s.buf + s.segOffset + sizeof(unsigned), sizeof(unsigned));
+        putUnsigned(s.buf + s.segOffset + sizeof(unsigned), segCnt + n);
+
+        char *dst = s.buf + s.size;
+        for (unsigned r = 0; r < n; ++r) {
+            dst = encodeGhostRow(codec, tensor + (size_t)lvids[r] * featDim,
+                                 featDim, dst);
+        }
+        s.size = dst - s.buf;
+        s.rows += n;
+        s.segNextSlot = firstSlot + n;
+
+        firstSlot += n;
+        lvids += n;
+        cnt -= n;
+        if (s.size >= peer.target)
+            flush(receiver, peer, i);
+    }
+}
+
+
+// Send stream `i` of a peer. The peer must be locked.
+void ScatterAggregator::flush(unsigned receiver, Peer &peer, size_t i) {
+    Stream &s = peer.streams[i];
+    putUnsigned(s.buf + NODE_ID_DIGITS + sizeof(unsigned), s.rows);
+    if (s.rows > 0)
+        send(receiver, s.buf, s.size);
+    else
+        comm->dataBufferPut(s.buf);
+    peer.streams.erase(peer.streams.begin() + i);
+}
+
+
+// Track the rate of bytes to a peer over windows of a few deadlines, and aim
+// the messages at what comes in within one deadline. The peer must be locked.
+void ScatterAggregator::updateTarget(Peer &peer, size_t bytes) {
+    double now = getTimer();
+    if (peer.windowStt == 0.0)
+        peer.windowStt = now;
+    peer.windowBytes += bytes;
+    double elapsed = now - peer.windowStt;
+    if (elapsed < 4 * deadline)
+        return;
+
+    double rate = peer.windowBytes / elapsed;
+    peer.rate = peer.rate == 0.0 ? rate : 0.5 * peer.rate + 0.5 * rate;
+    peer.target = std::min(maxSize, std::max(minSize,
+                           (size_t)(peer.rate * deadline)));
+    peer.windowStt = now;
+    peer.windowBytes = 0;
+}
+
+
+void ScatterAggregator::flushAll() {
+    for (unsigned nid = 0; nid < numNodes; ++nid) {
+        Peer &peer = peers[nid];
+        std::lock_guard<std::mutex> lk(peer.mtx);
+        while (!peer.streams.empty())
+            flush(nid, peer, peer.streams.size() - 1);
+    }
+}
+
+
+void ScatterAggregator::start() {
+    running = true;
+    flusher = std::thread(&ScatterAggregator::flushLoop, this);
+}
+
+
+void ScatterAggregator::stop() {
+    if (!running)
+        return;
+    running = false;
+    flusher.join();
+    flushAll();
+}
+
+
+void ScatterAggregator::flushLoop() {
+    auto period = std::chrono::microseconds(
+        std::max(50, (int)(deadline * 1000 / 2)));
+    while (running) {
+        std::this_thread::sleep_for(period);
+        double now = getTimer();
+        for (unsigned nid = 0; nid < numNodes; ++nid) {
+            Peer &peer = peers[nid];
+            std::lock_guard<std::mutex> lk(peer.mtx);
+            for (size_t i = peer.streams.size(); i-- > 0;) {
+                if (now - peer.streams[i].openTime >= deadline)
+                    flush(nid, peer, i);
+            }
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef __SCATTER_AGG_HPP__
+#define __SCATTER_AGG_HPP__
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../commmanager/commmanager.hpp"
+#include "../utils/utils.hpp"
+#include "ghost_codec.hpp"
+
+
+/**
+ *
+ * Per-peer outgoing aggregator of ghost rows.
+ *
+ * Scatter hands the rows of every chunk to add(). Rows going to the same peer
+ * with the same (layer, dir) are appended to one message in a pooled send
+ * buffer. A message is sent once it reaches the peer's target size, or once
+ * its first rows are older than the deadline (checked by a flusher thread).
+ * The message value is [featDim, layer, dir, MULTI_SEGMENTS | s] followed by
+ * segments [first slot, #rows, rows...], s being the first slot of the first
+ * segment (so the receive shards key the message by it); rows of consecutive
+ * slots (e.g. of chunks scattered in order) extend the current segment. The
+ * topic is the total row count, as for plain scatter messages.
+ *
+ * The target size follows the rate at which rows to the peer come in: about
+ * what arrives within one deadline, between minSize and the max message size.
+ * So heavy traffic goes out in big messages and a trickle still leaves within
+ * the deadline.
+ *
+ */
+class ScatterAggregator {
+public:
+    // Called for every message, with the buffer (from CommManager) to send.
+    typedef std::function<void(unsigned receiver, char *buf, size_t size)> SendFunc;
+
+    void init(unsigned numNodes_, unsigned nodeId_, CommManager *comm_,
+              SendFunc send_, size_t minSize_, double deadline_);
+    bool enabled() const { return comm != NULL; }
+    size_t maxMsgSize() const { return maxSize; }
+
+    void add(unsigned receiver, unsigned layer, unsigned dir, unsigned featDim,
+             GhostCodec codec, unsigned firstSlot, const unsigned *lvids,
+             unsigned cnt, const FeatType *tensor);
+    // Send everything buffered.
+    void flushAll();
+
+    // The flusher thread; stop() flushes what is left.
+    void start();
+    void stop();
+
+private:
+    struct Stream {
+        unsigned layer;
+        unsigned dir;
+        unsigned featDim;
+        GhostCodec codec;
+        char *buf;
+        size_t size;            // Bytes written, headers included.
+        unsigned rows;
+        size_t segOffset;       // Header of the last segment.
+        unsigned segNextSlot;   // Slot that would extend the last segment.
+        double openTime;
+    };
+    struct Peer {
+        std::mutex mtx;
+        std::vector<Stream> streams;
+        double windowStt = 0.0;
+        size_t windowBytes = 0;
+        double rate = 0.0;      // Bytes per ms, EWMA.
+        size_t target = 0;
+    };
+
+    Stream &stream(Peer &peer, unsigned receiver, unsigned layer, unsigned dir,
+                   unsigned featDim, GhostCodec codec);
+    void flush(unsigned receiver, Peer &peer, size_t i);
+    void updateTarget(Peer &peer, size_t bytes);
+    void flushLoop();
+
+    unsigned numNodes = 0;
+    unsigned nodeId = 0;
+    CommManager *comm = NULL;
+    SendFunc send;
+    size_t minSize = 0;
+    size_t maxSize = 0;
+    double deadline = 1.0;      // ms.
+
+    std::vector<Peer> peers;
+    std::atomic<bool> running{false};
+    std::thread flusher;
+};
+
+#endif // __SCATTER_AGG_HPP__
@@ -288,6 +288,11 @@ void Engine::printEngineMetrics() {
     nodeManager.barrier();
     printLog(nodeId, "<EM>: Average async epoch time %.3lf ms",
             asyncAvgEpochTime);
+    ghostDelta.report(nodeId);
+    if (compressionName != "none") {
+        printLog(nodeId, "<EM>: Ghost messages %s",
+                 commManager.dataCompressionReport().c_str());
+    }
 }
 
 /**
@@ -303,6 +308,11 @@ void Engine::printGraphMetrics() {
              graph.globalVtxCnt, graph.globalEdgeCnt, graph.localVtxCnt,
              graph.localInEdgeCnt, graph.localOutEdgeCnt,
              graph.srcGhostCnt, graph.dstGhostCnt);
+    if (graph.hubThreshold > 0) {
+        printLog(nodeId, "<GM>: hybrid cut (hubs above %u in edges), %u partial rows in, "
+                 "%u hubs mirrored (%llu edges)", graph.hubThreshold,
+                 graph.mirrorGhostCnt, graph.mirrorHubCnt, graph.mirrorAdj.nnz);
+    }
 }
 
 /**
@@ -325,6 +335,7 @@ Engine::parseArgs(int argc, char *argv[]) {
     ("pubipfile", boost::program_options::value<std::string>(), "File containing my public ip")
 
     ("tmpdir", boost::program_options::value<std::string>(), "Temporary directory")
+    ("tracedir", boost::program_options::value<std::string>()->default_value(std::string(""), ""), "Directory of the chunk traces (empty to disable tracing)")
 
     ("dataserverport", boost::program_options::value<unsigned>(), "The port exposing to the lambdas")
     ("weightserverport", boost::program_options::value<unsigned>(), "The port of the listener on the lambdas")
@@ -335,8 +346,17 @@ Engine::parseArgs(int argc, char *argv[]) {
 
     ("dthreads", boost::program_options::value<unsigned>(), "Number of data threads")
     ("cthreads", boost::program_options::value<unsigned>(), "Number of compute threads")
+    ("avthreads", boost::program_options::value<unsigned>()->default_value(unsigned(1), "1"), "Number of concurrent apply vertex workers")
 
     ("dataport", boost::program_options::value<unsigned>(), "Port for data communication")
+    ("dataplane", boost::program_options::value<std::string>()->default_value(std::string("pubsub")),
+        "Data plane between graph servers: [pubsub | p2p] (p2p also uses dataport + 1)")
+    ("shmghosts", boost::program_options::value<unsigned>()->default_value(unsigned(0), "0"),
+        "Send ghost rows to graph servers on the same host through shared memory")
+    ("compression", boost::program_options::value<std::string>()->default_value(std::string("none")),
+        "Lossless compression of ghost messages and lambda tensors: [none | lz4 | zstd | auto]")
+    ("maxmsgsize", boost::program_options::value<unsigned>()->default_value(unsigned(4 * 1024 * 1024), "4194304"),
+        "Max size (bytes) of an aggregated scatter message")
     ("ctrlport", boost::program_options::value<unsigned>(), "Port start for control communication")
     ("nodeport", boost::program_options::value<unsigned>(), "Port for node manager")
 
@@ -351,6 +371,30 @@ Engine::parseArgs(int argc, char *argv[]) {
       "Bound on staleness")
     ("timeout_ratio", boost::program_options::value<unsigned>()->default_value(unsigned(1)),
         "How long to wait for relaunch")
+    ("chunkpolicy", boost::program_options::value<std::string>()->default_value(std::string("id")),
+        "Chunk scheduling policy: [id | ghost | lambda (lambda mode only)]")
+    ("chunkshards", boost::program_options::value<unsigned>()->default_value(unsigned(1)),
+        "Heaps per chunk queue, each with its own lock (1: one mutex per queue)")
+    ("rechunk", boost::program_options::value<unsigned>()->default_value(unsigned(0)),
+        "Re-chunk every N sync epochs based on measured chunk times (0: never)")
+    ("fwdghostcodec", boost::program_options::value<std::string>()->default_value(std::string("fp32")),
+        "Encoding of the forward ghost rows: [fp32 | fp16 | bf16 | int8]")
+    ("bwdghostcodec", boost::program_options::value<std::string>()->default_value(std::string("fp32")),
+        "Encoding of the backward ghost rows: [fp32 | fp16 | bf16 | int8]")
+    ("ghostdelta", boost::program_options::value<std::string>()->default_value(std::string("off")),
+        "Suppress ghost rows that barely changed in async epochs: [off | threshold | topk]")
+    ("deltathreshold", boost::program_options::value<float>()->default_value(float(0.01), "0.01"),
+        "ghostdelta=threshold: min relative change of a row to be sent")
+    ("deltatopk", boost::program_options::value<float>()->default_value(float(0.25), "0.25"),
+        "ghostdelta=topk: fraction of the rows of a chunk sent")
+    ("scatteragg", boost::program_options::value<unsigned>()->default_value(unsigned(0), "0"),
+        "Coalesce the scatter rows of all chunks per peer into adaptively sized messages")
+    ("aggdeadline", boost::program_options::value<float>()->default_value(float(1.0), "1.0"),
+        "scatteragg: max time (ms) rows wait to be sent")
+    ("preprocess", boost::program_options::value<unsigned>()->default_value(unsigned(0), "0"),
+        "Preprocess the partition even if its image is up to date with the inputs")
+    ("hubthreshold", boost::program_options::value<unsigned>()->default_value(unsigned(0), "0"),
+        "Hybrid cut when preprocessing: in edges of vertices with more in edges than this are aggregated on the source partitions (0: edge cut)")
     ;
 
     boost::program_options::variables_map vm;
@@ -368,6 +412,9 @@ Engine::parseArgs(int argc, char *argv[]) {
     assert(vm.count("cthreads"));
     cThreads = vm["cthreads"].as<unsigned>();   // Computation threads.
 
+    assert(vm.count("avthreads"));
+    avThreads = std::max(1u, vm["avthreads"].as<unsigned>());
+
     assert(vm.count("datasetdir"));
     datasetDir = vm["datasetdir"].as<std::string>();
 
@@ -389,6 +436,9 @@ Engine::parseArgs(int argc, char *argv[]) {
     assert(vm.count("tmpdir"));
     outFile = vm["tmpdir"].as<std::string>() + "/output_";  // Still needs to append the node id, after node manager set up.
 
+    assert(vm.count("tracedir"));
+    traceDir = vm["tracedir"].as<std::string>();
+
     assert(vm.count("dataserverport"));
     dataserverPort = vm["dataserverport"].as<unsigned>();
 
@@ -405,6 +455,21 @@ Engine::parseArgs(int argc, char *argv[]) {
     unsigned data_port = vm["dataport"].as<unsigned>();
     commManager.setDataPort(data_port);
 
+    assert(vm.count("dataplane"));
+    std::string dataPlane = vm["dataplane"].as<std::string>();
+    assert(dataPlane == "pubsub" || dataPlane == "p2p");
+    commManager.setDataPlane(dataPlane == "p2p" ? DATA_P2P : DATA_PUBSUB);
+
+    assert(vm.count("shmghosts"));
+    commManager.setShmGhosts(vm["shmghosts"].as<unsigned>() != 0);
+
+    assert(vm.count("compression"));
+    compressionName = vm["compression"].as<std::string>();
+    if (!commManager.setDataCompression(compressionName, DATA_KEY_BYTES)) {
+        printLog(nodeId, "Unsupported compression: %s", compressionName.c_str());
+        exit(-1);
+    }
+
     assert(vm.count("ctrlport"));
     unsigned ctrl_port = vm["ctrlport"].as<unsigned>();
     commManager.setControlPortStart(ctrl_port);
@@ -445,6 +510,60 @@ Engine::parseArgs(int argc, char *argv[]) {
     assert(vm.count("timeout_ratio"));
     timeoutRatio = vm["timeout_ratio"].as<unsigned>();
 
+    assert(vm.count("chunkpolicy"));
+    chunkPolicyName = vm["chunkpolicy"].as<std::string>();
+
+    assert(vm.count("chunkshards"));
+    chunkShards = vm["chunkshards"].as<unsigned>();
+    if (chunkShards < 1 || chunkShards > LockChunkQueue::MAX_SHARDS) {
+        printLog(nodeId, "Chunk shards must be 1 to %u", LockChunkQueue::MAX_SHARDS);
+        exit(-1);
+    }
+
+    assert(vm.count("rechunk"));
+    rechunkFreq = vm["rechunk"].as<unsigned>();
+
+    assert(vm.count("fwdghostcodec"));
+    fwdGhostCodec = parseGhostCodec(vm["fwdghostcodec"].as<std::string>());
+    if (fwdGhostCodec == GHOST_NUM_CODECS) {
+        printLog(nodeId, "Unsupported ghost codec: %s",
+                 vm["fwdghostcodec"].as<std::string>().c_str());
+        exit(-1);
+    }
+
+    assert(vm.count("bwdghostcodec"));
+    bwdGhostCodec = parseGhostCodec(vm["bwdghostcodec"].as<std::string>());
+    if (bwdGhostCodec == GHOST_NUM_CODECS) {
+        printLog(nodeId, "Unsupported ghost codec: %s",
+                 vm["bwdghostcodec"].as<std::string>().c_str());
+        exit(-1);
+    }
+
+    assert(vm.count("ghostdelta"));
+    ghostDeltaName = vm["ghostdelta"].as<std::string>();
+
+    assert(vm.count("deltathreshold"));
+    deltaThreshold = vm["deltathreshold"].as<float>();
+
+    assert(vm.count("deltatopk"));
+    deltaTopk = vm["deltatopk"].as<float>();
+
+    assert(vm.count("scatteragg"));
+    scatterAggOn = vm["scatteragg"].as<unsigned>() != 0;
+
+    assert(vm.count("maxmsgsize"));
+    if (scatterAggOn)
+        commManager.setMaxMsgSize(vm["maxmsgsize"].as<unsigned>());
+
+    assert(vm.count("aggdeadline"));
+    aggDeadline = vm["aggdeadline"].as<float>();
+
+    assert(vm.count("preprocess"));
+    forcePreprocess = vm["preprocess"].as<unsigned>() != 0;
+
+    assert(vm.count("hubthreshold"));
+    hubThreshold = vm["hubthreshold"].as<unsigned>();
+
     printLog(404, "Parsed configuration: dThreads = %u, cThreads = %u, datasetDir = %s, featuresFile = %s, dshMachinesFile = %s, "
              "myPrIpFile = %s, undirected = %s, data port set -> %u, control port set -> %u, node port set -> %u",
              dThreads, cThreads, datasetDir.c_str(), featuresFile.c_str(), dshMachinesFile.c_str(),
@@ -478,27 +597,95 @@ void Engine::readLayerConfigFile(std::string &layerConfigFileName) {
     assert(layerConfig.size() > 1);
 }
 
+/** Hash of the gvids of the rows of a shard, see ShardHeaderType. */
+static unsigned long long hashGvids(const unsigned *gvids, size_t cnt) {
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < cnt; ++i)
+        hash = (hash ^ gvids[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+std::string Engine::shardFile(const char *name) {
+    return datasetDir + name + "." + std::to_string(nodeId) + ".bin";
+}
+
 /**
  *
- * Read in the initial features file.
+ * Read the rows of a shard with a single read, if its header matches the
+ * expected one. A missing or stale shard is not an error, the caller then
+ * falls back to the global file. Without the global file (a zero stamp
+ * expected) the shard is all there is, whatever it was built from.
+ *
+ */
+bool Engine::readShard(const std::string &filename, const ShardHeaderType &expected,
+                       void *rows, size_t rowBytes) {
+    std::ifstream infile(filename.c_str(), std::ios::binary);
+    if (!infile.good())
+        return false;
+    ShardHeaderType header;
+    infile.read((char *)&header, sizeof(ShardHeaderType));
+    if (!infile.good() || header.magic != expected.magic ||
+        header.version != expected.version || header.numRows != expected.numRows ||
+        header.rowDim != expected.rowDim || header.idsHash != expected.idsHash ||
+        header.hubThreshold != expected.hubThreshold) {
+        printLog(nodeId, "Shard %s does not match this partition, ignoring it", filename.c_str());
+        return false;
+    }
+    if (expected.srcStamp.size != 0 && header.srcStamp != expected.srcStamp) {
+        printLog(nodeId, "Shard %s is older than its source file, ignoring it", filename.c_str());
+        return false;
+    }
+    infile.read((char *)rows, rowBytes * header.numRows);
+    if ((size_t)infile.gcount() != rowBytes * header.numRows) {
+        printLog(nodeId, "Shard %s is truncated, ignoring it", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+void Engine::writeShard(const std::string &filename, const ShardHeaderType &header,
+                        const void *rows, size_t rowBytes) {
+    std::ofstream outfile(filename.c_str(), std::ios::binary);
+    if (!outfile.good()) {
+        printLog(nodeId, "Cannot open output shard file: %s [Reason: %s]",
+                 filename.c_str(), std::strerror(errno));
+        return;
+    }
+    outfile.write((const char *)&header, sizeof(ShardHeaderType));
+    outfile.write((const char *)rows, rowBytes * header.numRows);
+    outfile.close();
+}
+
+/**
+ *
+ * Read in the initial features of the local and ghost vertices. Prefer the
+ * partition's shards; without them, scan the global features file once and
+ * write the shards for the next run.
  *
  */
 void Engine::readFeaturesFile(std::string &featuresFileName) {
-    bool cache = true;
-    if (cache) {
-        std::string cacheFeatsFile = datasetDir + "feats" + std::to_string(layerConfig[0]) + "." + std::to_string(nodeId) + ".bin";
-        std::ifstream infile(cacheFeatsFile.c_str());
-        if (!infile.good()) {
-            printLog(nodeId, "No feature cache, loading raw data...",
-                     cacheFeatsFile.c_str(), std::strerror(errno));
-        } else {
-            printLog(nodeId, "Loading feature cache from %s...", cacheFeatsFile.c_str());
-            infile.read((char *)forwardVerticesInitData, sizeof(FeatType) * graph.localVtxCnt * layerConfig[0]);
-            infile.read((char *)forwardGhostInitData, sizeof(FeatType) * graph.srcGhostCnt * layerConfig[0]);
-            infile.close();
-            return;
-        }
+    const unsigned featDim = layerConfig[0];
+    const size_t rowBytes = sizeof(FeatType) * featDim;
+    // Mirror rows (hybrid cut) come from the other nodes, see exchangeMirrorRows()
+    const unsigned ghostCnt = graph.srcGhostVtcs.size();
+    std::vector<unsigned> ghostGvids(ghostCnt);
+    for (auto &kv : graph.srcGhostVtcs)
+        ghostGvids[kv.second - graph.localVtxCnt] = kv.first;
+    FileStamp srcStamp = getFileStamp(featuresFileName);
+    ShardHeaderType localHeader { SHARD_MAGIC, SHARD_VERSION, graph.localVtxCnt, featDim,
+        hashGvids(graph.localToGlobalId.data(), graph.localVtxCnt), srcStamp, 0 };
+    ShardHeaderType ghostHeader { SHARD_MAGIC, SHARD_VERSION, ghostCnt, featDim,
+        hashGvids(ghostGvids.data(), ghostCnt), srcStamp, graph.hubThreshold };
+
+    std::string localShard = shardFile("feats");
+    std::string ghostShard = shardFile("ghostfeats");
+    if (readShard(localShard, localHeader, forwardVerticesInitData, rowBytes) &&
+        readShard(ghostShard, ghostHeader, forwardGhostInitData, rowBytes)) {
+        printLog(nodeId, "Loaded features from shards %s, %s", localShard.c_str(), ghostShard.c_str());
+        return;
     }
+    printLog(nodeId, "No feature shards, loading raw data...");
+
     std::ifstream infile(featuresFileName.c_str());
     if (!infile.good())
         printLog(nodeId, "Cannot open features file: %s [Reason: %s]",
@@ -507,106 +694,115 @@ void Engine::readFeaturesFile(std::string &featuresFileName) {
 
     FeaturesHeaderType fHeader;
     infile.read((char *)&fHeader, sizeof(FeaturesHeaderType));
-    assert(fHeader.numFeatures == layerConfig[0]);
+    assert(fHeader.numFeatures == featDim);
 
     unsigned gvid = 0;
 
-    unsigned featDim = fHeader.numFeatures;
     std::vector<FeatType> feature_vec;
 
     feature_vec.resize(featDim);
-    while (infile.read(reinterpret_cast<char *>(&feature_vec[0]),
-                       sizeof(FeatType) * featDim)) {
+    // Both ID maps are sorted by gvid, so walk them along with the file
+    // instead of searching them for every vertex.
+    auto ghostIt = graph.srcGhostVtcs.begin();
+    auto localIt = graph.globaltoLocalId.begin();
+    while (infile.read(reinterpret_cast<char *>(&feature_vec[0]), rowBytes)) {
         // Set the vertex's initial values, if it is one of my local vertices /
         // ghost vertices.
-        if (graph.containsSrcGhostVtx(gvid)) {  // Ghost vertex.
+        if (ghostIt != graph.srcGhostVtcs.end() && ghostIt->first == gvid) {  // Ghost vertex.
             FeatType *actDataPtr = getVtxFeat(
                 forwardGhostInitData,
-                graph.srcGhostVtcs[gvid] - graph.localVtxCnt, featDim);
-            memcpy(actDataPtr, feature_vec.data(), featDim * sizeof(FeatType));
-        } else if (graph.containsVtx(gvid)) {  // Local vertex.
+                ghostIt->second - graph.localVtxCnt, featDim);
+            memcpy(actDataPtr, feature_vec.data(), rowBytes);
+            ++ghostIt;
+        } else if (localIt != graph.globaltoLocalId.end() && localIt->first == gvid) {  // Local vertex.
             FeatType *actDataPtr = getVtxFeat(
-                forwardVerticesInitData, graph.globaltoLocalId[gvid], featDim);
-            memcpy(actDataPtr, feature_vec.data(), featDim * sizeof(FeatType));
+                forwardVerticesInitData, localIt->second, featDim);
+            memcpy(actDataPtr, feature_vec.data(), rowBytes);
+            ++localIt;
         }
         ++gvid;
     }
     infile.close();
     assert(gvid == graph.globalVtxCnt);
 
-    if (cache) {
-        std::string cacheFeatsFile = datasetDir + "feats" + std::to_string(layerConfig[0]) + "." + std::to_string(nodeId) + ".bin";
-        std::ifstream infile(cacheFeatsFile.c_str());
-        if (infile.good()) {
-            return;
-        }
-        std::ofstream outfile(cacheFeatsFile.c_str());
-        if (!outfile.good()) {
-            printLog(nodeId, "Cannot open output cache file: %s [Reason: %s]",
-                     cacheFeatsFile.c_str(), std::strerror(errno));
-        }
-        outfile.write((char *)forwardVerticesInitData, sizeof(FeatType) * graph.localVtxCnt * layerConfig[0]);
-        outfile.write((char *)forwardGhostInitData, sizeof(FeatType) * graph.srcGhostCnt * layerConfig[0]);
-        outfile.close();
-    }
+    writeShard(localShard, localHeader, forwardVerticesInitData, rowBytes);
+    writeShard(ghostShard, ghostHeader, forwardGhostInitData, rowBytes);
 }
 
 /**
  *
- * Read in the labels file, store the labels in one-hot format.
+ * Read in the labels file, store the labels in one-hot format. Like the
+ * features, from the partition's shard if there is one.
  *
  */
 void Engine::readLabelsFile(std::string &labelsFileName) {
-    std::ifstream infile(labelsFileName.c_str());
-    if (!infile.good())
-        printLog(nodeId, "Cannot open labels file: %s [Reason: %s]",
-                 labelsFileName.c_str(), std::strerror(errno));
-
-    assert(infile.good());
-
-    LabelsHeaderType fHeader;
-    infile.read((char *)&fHeader, sizeof(LabelsHeaderType));
-    assert(fHeader.labelKinds == layerConfig[numLayers]);
-
-    unsigned gvid = 0;
+    const unsigned lKinds = layerConfig[numLayers];
+    ShardHeaderType labelsHeader { SHARD_MAGIC, SHARD_VERSION, graph.localVtxCnt, lKinds,
+        hashGvids(graph.localToGlobalId.data(), graph.localVtxCnt),
+        getFileStamp(labelsFileName), 0 };
+    std::vector<unsigned> labels(graph.localVtxCnt);
+
+    std::string labelsShard = shardFile("labels");
+    if (readShard(labelsShard, labelsHeader, labels.data(), sizeof(unsigned))) {
+        printLog(nodeId, "Loaded labels from shard %s", labelsShard.c_str());
+    } else {
+        std::ifstream infile(labelsFileName.c_str());
+        if (!infile.good())
+            printLog(nodeId, "Cannot open labels file: %s [Reason: %s]",
+                     labelsFileName.c_str(), std::strerror(errno));
+
+        assert(infile.good());
+
+        LabelsHeaderType fHeader;
+        infile.read((char *)&fHeader, sizeof(LabelsHeaderType));
+        assert(fHeader.labelKinds == lKinds);
+
+        unsigned gvid = 0;
+        unsigned curr;
+        auto localIt = graph.globaltoLocalId.begin();
+        while (infile.read(reinterpret_cast<char *>(&curr), sizeof(unsigned))) {
+            // Keep the label if it is one of my local vertices.
+            if (localIt != graph.globaltoLocalId.end() && localIt->first == gvid) {
+                labels[localIt->second] = curr;
+                ++localIt;
+            }
 
-    unsigned lKinds = fHeader.labelKinds;
-    unsigned curr;
-    FeatType one_hot_arr[lKinds] = {0};
-
-    while (infile.read(reinterpret_cast<char *>(&curr), sizeof(unsigned))) {
-        // Set the vertex's label values, if it is one of my local vertices & is
-        // labeled.
-        if (graph.containsVtx(gvid)) {
-            // Convert into a one-hot array.
-            assert(curr < lKinds);
-            memset(one_hot_arr, 0, lKinds * sizeof(FeatType));
-            one_hot_arr[curr] = 1.0;
-
-            FeatType *labelPtr =
-                localVertexLabelsPtr(graph.globaltoLocalId[gvid]);
-            memcpy(labelPtr, one_hot_arr, lKinds * sizeof(FeatType));
+            ++gvid;
         }
 
-        ++gvid;
+        infile.close();
+        assert(gvid == graph.globalVtxCnt);
+        writeShard(labelsShard, labelsHeader, labels.data(), sizeof(unsigned));
     }
 
-    infile.close();
-    assert(gvid == graph.globalVtxCnt);
+    // Convert into one-hot arrays.
+    memset(localVerticesLabels, 0, sizeof(FeatType) * lKinds * graph.localVtxCnt);
+    for (unsigned lvid = 0; lvid < graph.localVtxCnt; ++lvid) {
+        assert(labels[lvid] < lKinds);
+        localVertexLabelsPtr(lvid)[labels[lvid]] = 1.0;
+    }
 }
 
 void Engine::loadChunks() {
     unsigned vtcsCnt = graph.localVtxCnt;
+    std::vector<Chunk> chunks;
     for (unsigned cid = 0; cid < numLambdasForward; ++cid) {
         unsigned chunkSize =
             (vtcsCnt + numLambdasForward - 1) / numLambdasForward;
         unsigned lowBound = cid * chunkSize;
         unsigned upBound = std::min(lowBound + chunkSize, vtcsCnt);
 
-        schQueue.push(Chunk { cid, nodeId * numLambdasForward + cid,
-                            lowBound, upBound, 0, PROP_TYPE::FORWARD,
-                            START_EPOCH + 1, true });
+        chunks.push_back(Chunk { cid, nodeId * numLambdasForward + cid,
+                                 lowBound, upBound, 0, PROP_TYPE::FORWARD,
+                                 START_EPOCH + 1, true });
+    }
+
+    chunkPolicy->init(this, chunks);
+    buildSendLists(chunks);
+    for (Chunk &c : chunks) {
+        schQueue.push(c);
     }
+    chunkTimes.assign(chunks.size(), 0.0);
 
     currEpoch = START_EPOCH;
     // Set the initial bound chunk as epoch 1 layer 0
@@ -619,16 +815,497 @@ void Engine::loadChunks() {
     finishedChunks = 0;
 }
 
+void Engine::reprioritizeChunks() {
+    LockChunkQueue *queues[] = { &schQueue, &GAQueue, &AVQueue,
+                                 &SCQueue, &AEQueue, &SCStashQueue };
+    for (LockChunkQueue *q : queues)
+        q->lock();
+    chunkPolicy->refresh();
+    for (LockChunkQueue *q : queues)
+        q->reorder();
+    for (LockChunkQueue *q : queues)
+        q->unlock();
+}
+
+void Engine::recordChunkTime(const Chunk &c, double time) {
+    chunkTimesLock.lock();
+    if (c.localId < chunkTimes.size())
+        chunkTimes[c.localId] += time;
+    chunkTimesLock.unlock();
+}
+
+/**
+ *
+ * Re-cut the local partition with the GA + NN + SC times measured since the
+ * last re-chunking: chunks taking more than RECHUNK_SPLIT x the average are
+ * split evenly, neighbours below RECHUNK_MERGE x the average are merged as
+ * long as they stay under the average.
+ *
+ * Must be called by the scheduler on all nodes at a sync epoch boundary, when
+ * every chunk is parked in schQueue. Chunk global ids are kept consecutive
+ * across nodes so that the weight server assignment in LambdaComm matches the
+ * counts WeightComm hands out.
+ *
+ */
+void Engine::rechunk() {
+    const double RECHUNK_SPLIT = 1.5;
+    const double RECHUNK_MERGE = 0.5;
+
+    std::vector<Chunk> oldChunks;
+    schQueue.lock();
+    while (!schQueue.empty()) {
+        oldChunks.push_back(schQueue.top());
+        schQueue.pop();
+    }
+    schQueue.unlock();
+    std::sort(oldChunks.begin(), oldChunks.end(),
+              [](const Chunk &a, const Chunk &b) { return a.lowBound < b.lowBound; });
+
+    chunkTimesLock.lock();
+    std::vector<double> times = chunkTimes;
+    chunkTimesLock.unlock();
+    double avgTime = 0.0;
+    for (Chunk &c : oldChunks)
+        avgTime += times[c.localId];
+    avgTime /= oldChunks.size();
+
+    // (1) Split. pieces[i] covers [pieces[i].first, pieces[i + 1].first)
+    std::vector<std::pair<unsigned, double>> pieces; // (lowBound, est time)
+    for (Chunk &c : oldChunks) {
+        unsigned vtcsCnt = c.upBound - c.lowBound;
+        double time = times[c.localId];
+        unsigned nPieces = 1;
+        if (avgTime > 0.0 && time > RECHUNK_SPLIT * avgTime)
+            nPieces = std::min(vtcsCnt, (unsigned)std::ceil(time / avgTime));
+        nPieces = std::max(nPieces, 1u);
+        for (unsigned i = 0; i < nPieces; ++i) {
+            pieces.push_back(std::make_pair(c.lowBound + vtcsCnt * i / nPieces,
+                                            time / nPieces));
+        }
+    }
+
+    // (2) Merge
+    std::vector<std::pair<unsigned, double>> merged;
+    for (auto &p : pieces) {
+        if (!merged.empty() && avgTime > 0.0) {
+            double &last = merged.back().second;
+            bool tiny = last < RECHUNK_MERGE * avgTime ||
+                        p.second < RECHUNK_MERGE * avgTime;
+            if (tiny && last + p.second <= avgTime) {
+                last += p.second;
+                continue;
+            }
+        }
+        merged.push_back(p);
+    }
+
+    // (3) Agree on global ids with other nodes
+    unsigned chunkCnt = merged.size();
+    std::vector<unsigned> cnts = nodeManager.syncChunkCnts(chunkCnt);
+    unsigned offset = 0;
+    unsigned totalCnt = 0;
+    for (unsigned nid = 0; nid < cnts.size(); ++nid) {
+        if (nid < nodeId)
+            offset += cnts[nid];
+        totalCnt += cnts[nid];
+    }
+
+    const Chunk &tmpl = oldChunks[0];
+    std::vector<Chunk> chunks;
+    for (unsigned cid = 0; cid < chunkCnt; ++cid) {
+        unsigned upBound = cid + 1 < chunkCnt ? merged[cid + 1].first
+                                              : graph.localVtxCnt;
+        chunks.push_back(Chunk { cid, offset + cid, merged[cid].first, upBound,
+                                 tmpl.layer, tmpl.dir, tmpl.epoch, tmpl.vertex });
+    }
+
+    printLog(nodeId, "Re-chunk at epoch %u: %u -> %u chunks (%u in total), avg chunk time %.2lfms",
+             currEpoch, (unsigned)oldChunks.size(), chunkCnt, totalCnt, avgTime);
+    numLambdasForward = chunkCnt;
+    resComm->setChunkCnt(chunkCnt);
+    if (nodeId == 0) {
+        weightComm->updateChunkCnt(totalCnt);
+    }
+    // Weight servers must know the new count before any new chunk pushes
+    nodeManager.barrier();
+
+    chunkPolicy->init(this, chunks);
+    buildSendLists(chunks);
+    chunkTimesLock.lock();
+    chunkTimes.assign(chunkCnt, 0.0);
+    chunkTimesLock.unlock();
+    schQueue.lock();
+    for (Chunk &c : chunks) {
+        schQueue.push(c);
+    }
+    schQueue.unlock();
+}
+
 /********************************* SC utils *********************************/
-void Engine::verticesPushOut(unsigned receiver, unsigned totCnt,
-                             unsigned *lvids, FeatType *inputTensor,
-                             unsigned featDim, Chunk &c) {
-    zmq::message_t msg(DATA_HEADER_SIZE +
-                       (sizeof(unsigned) + sizeof(FeatType) * featDim) *
-                           totCnt);
-    char *msgPtr = (char *)(msg.data());
-    sprintf(msgPtr, NODE_ID_HEADER, receiver);
-    msgPtr += NODE_ID_DIGITS;
+void SendLists::build(const std::vector<Chunk> &chunks, unsigned numNodes_,
+                      const GhostMap &ghostMap) {
+    numNodes = numNodes_;
+    offsets.assign(chunks.size() * numNodes + 1, 0);
+    // Count, prefix sum, then fill. Only boundary vertices are in ghostMap.
+    for (const Chunk &c : chunks) {
+        auto stt = ghostMap.lower_bound(c.lowBound);
+        auto end = ghostMap.lower_bound(c.upBound);
+        for (auto it = stt; it != end; ++it) {
+            for (unsigned nid : it->second)
+                ++offsets[c.localId * numNodes + nid + 1];
+        }
+    }
+    for (unsigned i = 1; i < offsets.size(); ++i)
+        offsets[i] += offsets[i - 1];
+
+    lvids.resize(offsets.back());
+    std::vector<unsigned long long> pos(offsets.begin(), offsets.end() - 1);
+    for (const Chunk &c : chunks) {
+        auto stt = ghostMap.lower_bound(c.lowBound);
+        auto end = ghostMap.lower_bound(c.upBound);
+        for (auto it = stt; it != end; ++it) {
+            for (unsigned nid : it->second)
+                lvids[pos[c.localId * numNodes + nid]++] = it->first;
+        }
+    }
+
+    // Slots of a node follow the lvid order, i.e. the order of the chunks
+    std::vector<const Chunk *> sorted;
+    for (const Chunk &c : chunks)
+        sorted.push_back(&c);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const Chunk *lhs, const Chunk *rhs) {
+                  return lhs->lowBound < rhs->lowBound;
+              });
+    firstSlots.assign(chunks.size() * numNodes, 0);
+    std::vector<unsigned> nextSlot(numNodes, 0);
+    for (const Chunk *c : sorted) {
+        for (unsigned nid = 0; nid < numNodes; ++nid) {
+            firstSlots[c->localId * numNodes + nid] = nextSlot[nid];
+            nextSlot[nid] += count(c->localId, nid);
+        }
+    }
+}
+
+void Engine::buildSendLists(const std::vector<Chunk> &chunks) {
+    forwardSendLists.build(chunks, numNodes, graph.forwardGhostMap);
+    backwardSendLists.build(chunks, numNodes, graph.backwardGhostMap);
+}
+
+/**
+ *
+ * Agree with every other node on the order of the ghost rows it sends me.
+ * Each node sends the gvids of its slots for the receiver (per direction),
+ * which the receiver maps to ghost rows once. Scatter messages then carry
+ * the rows in slot order without any vertex ids.
+ *
+ */
+void Engine::exchangeGhostSlots() {
+    forwardGhostSlots.assign(numNodes, std::vector<unsigned>());
+    backwardGhostSlots.assign(numNodes, std::vector<unsigned>());
+    if (numNodes == 1) return;
+
+    // Message: [dir, total slots, first slot, gvids...]
+    const unsigned SLOTS_HDR = 3;
+    const unsigned MAX_SLOTS = MAX_MSG_SIZE / sizeof(unsigned) - SLOTS_HDR;
+
+    // Hybrid cut: hubs I send partial rows of, slotted after the forward rows
+    const unsigned MIRROR_DIR = PROP_TYPE::BACKWARD + 1;
+    const bool hybrid = graph.hubThreshold > 0;
+    const unsigned numLists = hybrid ? 3 : 2;
+
+    auto sendSlots = [&](unsigned nid, unsigned dir, const unsigned *gvids,
+                         unsigned total) {
+        unsigned first = 0;
+        do {
+            unsigned cnt = std::min(total - first, MAX_SLOTS);
+            std::vector<unsigned> msg { dir, total, first };
+            msg.insert(msg.end(), gvids + first, gvids + first + cnt);
+            commManager.dataPushOut(nid, nodeId, GHOST_SLOTS_TOPIC,
+                                    msg.data(),
+                                    msg.size() * sizeof(unsigned));
+            first += cnt;
+        } while (first < total);
+    };
+
+    // Everyone's sockets are up before anything is sent
+    nodeManager.barrier();
+    for (unsigned dir = PROP_TYPE::FORWARD; dir <= PROP_TYPE::BACKWARD; ++dir) {
+        const GhostMap &ghostMap =
+            dir == PROP_TYPE::FORWARD ? graph.forwardGhostMap
+                                      : graph.backwardGhostMap;
+        std::vector<std::vector<unsigned>> slotGvids(numNodes);
+        for (auto &kv : ghostMap) {
+            for (unsigned nid : kv.second)
+                slotGvids[nid].push_back(graph.localToGlobalId[kv.first]);
+        }
+
+        for (unsigned nid = 0; nid < numNodes; ++nid) {
+            if (nid == nodeId)
+                continue;
+            sendSlots(nid, dir, slotGvids[nid].data(), slotGvids[nid].size());
+        }
+    }
+    for (unsigned nid = 0; hybrid && nid < numNodes; ++nid) {
+        if (nid == nodeId)
+            continue;
+        sendSlots(nid, MIRROR_DIR, graph.mirrorHubs.data() + graph.mirrorHubPtrs[nid],
+                  graph.mirrorHubPtrs[nid + 1] - graph.mirrorHubPtrs[nid]);
+    }
+
+    unsigned *msgBuf = new unsigned[MAX_MSG_SIZE / sizeof(unsigned)];
+    std::vector<unsigned> recvd(numLists * numNodes, 0);
+    std::vector<std::vector<unsigned>> mirrorSlots(numNodes);
+    unsigned remaining = numLists * (numNodes - 1);
+    BackoffSleeper bs;
+    while (remaining > 0) {
+        unsigned sender, topic;
+        if (!commManager.dataPullIn(&sender, &topic, msgBuf, MAX_MSG_SIZE)) {
+            bs.sleep();
+            continue;
+        }
+        assert(topic == GHOST_SLOTS_TOPIC);
+
+        unsigned dir = msgBuf[0];
+        unsigned total = msgBuf[1];
+        unsigned first = msgBuf[2];
+        unsigned cnt = std::min(total - first, MAX_SLOTS);
+        if (dir == MIRROR_DIR) {
+            // Partial rows of my hubs, in the order of the sender's mirror group
+            const unsigned *grpStt = graph.mirrorGhostHubs.data() + graph.mirrorGhostPtrs[sender];
+            const unsigned *grpEnd = graph.mirrorGhostHubs.data() + graph.mirrorGhostPtrs[sender + 1];
+            std::vector<unsigned> &slots = mirrorSlots[sender];
+            slots.resize(total);
+            for (unsigned i = 0; i < cnt; ++i) {
+                auto lvid = graph.globaltoLocalId.find(msgBuf[SLOTS_HDR + i]);
+                assert(lvid != graph.globaltoLocalId.end());
+                const unsigned *found = std::lower_bound(grpStt, grpEnd, lvid->second);
+                assert(found != grpEnd && *found == lvid->second);
+                slots[first + i] = graph.srcGhostVtcs.size() +
+                                   graph.mirrorGhostPtrs[sender] + (found - grpStt);
+            }
+        } else {
+            const IdMap &globalToGhostVtcs =
+                dir == PROP_TYPE::FORWARD ? graph.srcGhostVtcs
+                                          : graph.dstGhostVtcs;
+            std::vector<unsigned> &slots = dir == PROP_TYPE::FORWARD
+                                         ? forwardGhostSlots[sender]
+                                         : backwardGhostSlots[sender];
+            slots.resize(total);
+            for (unsigned i = 0; i < cnt; ++i) {
+                auto found = globalToGhostVtcs.find(msgBuf[SLOTS_HDR + i]);
+                assert(found != globalToGhostVtcs.end());
+                slots[first + i] = found->second - graph.localVtxCnt;
+            }
+        }
+
+        recvd[dir * numNodes + sender] += cnt;
+        if (recvd[dir * numNodes + sender] == total)
+            --remaining;
+        bs.reset();
+    }
+    delete[] msgBuf;
+    for (unsigned nid = 0; nid < numNodes; ++nid) {
+        forwardGhostSlots[nid].insert(forwardGhostSlots[nid].end(),
+                                      mirrorSlots[nid].begin(), mirrorSlots[nid].end());
+    }
+
+    unsigned fwdSlots = 0, bwdSlots = 0;
+    for (unsigned nid = 0; nid < numNodes; ++nid) {
+        fwdSlots += forwardGhostSlots[nid].size();
+        bwdSlots += backwardGhostSlots[nid].size();
+    }
+    if (fwdSlots != graph.srcGhostCnt || bwdSlots != graph.dstGhostCnt) {
+        printLog(nodeId, "Ghost slots (%u, %u) do not match ghost counts (%u, %u)",
+                 fwdSlots, bwdSlots, graph.srcGhostCnt, graph.dstGhostCnt);
+    }
+}
+
+/**
+ *
+ * Hybrid cut: exchange the partial rows of the input features, the only
+ * layer 0 ghost rows that are not in the features file. Later layers send
+ * theirs at the end of each forward scatter, see scatterWorkFunc().
+ *
+ */
+void Engine::exchangeMirrorRows() {
+    if (graph.hubThreshold == 0 || numNodes == 1) return;
+    const unsigned featDim = getFeatDim(0);
+
+    // Everyone has its slots before the rows arrive
+    nodeManager.barrier();
+    scatterMirrors(0, forwardVerticesInitData, featDim);
+
+    BackoffSleeper bs;
+    zmq::message_t inMsg;
+    char *msgBuf;
+    unsigned msgSize;
+    unsigned rowsRecvd = 0;
+    while (rowsRecvd < graph.mirrorGhostCnt) {
+        unsigned sender, topic;
+        if (!commManager.dataPullIn(&sender, &topic, inMsg, &msgBuf, &msgSize)) {
+            bs.sleep();
+            continue;
+        }
+        // [featDim, layer, dir, first slot, rows...], see verticesPushOut()
+        unsigned *hdr = (unsigned *)msgBuf;
+        assert(topic < MAX_IDTYPE - 1 && hdr[0] == featDim && hdr[1] == 0);
+        unpackGhostRows(forwardGhostInitData, sender, hdr[2], hdr[3], topic,
+                        featDim, msgBuf + 4 * sizeof(unsigned));
+        rowsRecvd += topic;
+        bs.reset();
+    }
+    // Not acked, the pipeline starts counting from scratch
+    recvCnt = 0;
+}
+
+// Copy the rows of a scatter message into the ghost tensor. Consecutive
+// slots mostly map to consecutive ghost rows, which are copied in one go
+// when the rows are sent as they are.
+void Engine::unpackGhostRows(FeatType *ghostData, unsigned sender,
+                             unsigned dir, unsigned firstSlot, unsigned cnt,
+                             unsigned featDim, char *rows) {
+    std::vector<unsigned> &slots = dir == PROP_TYPE::FORWARD
+                                 ? forwardGhostSlots[sender]
+                                 : backwardGhostSlots[sender];
+    if (firstSlot != SPARSE_SLOTS && (firstSlot & MULTI_SEGMENTS)) {
+        // [first slot, #rows, rows...] segments, see ScatterAggregator
+        size_t rowSize = ghostRowSize(ghostCodec(dir), featDim);
+        unsigned segHdr[2];
+        while (cnt > 0) {
+            memcpy(segHdr, rows, sizeof(segHdr));
+            rows += sizeof(segHdr);
+            assert(segHdr[1] <= cnt);
+            unpackGhostRows(ghostData, sender, dir, segHdr[0], segHdr[1],
+                            featDim, rows);
+            rows += rowSize * segHdr[1];
+            cnt -= segHdr[1];
+        }
+        return;
+    }
+
+    std::vector<unsigned> sparseRows;
+    const unsigned *ghostRows;
+    if (firstSlot == SPARSE_SLOTS) {
+        // The slot of every row precedes the rows, see scatterDelta()
+        const unsigned *rowSlots = (const unsigned *)rows;
+        rows += sizeof(unsigned) * cnt;
+        sparseRows.resize(cnt);
+        for (unsigned i = 0; i < cnt; ++i) {
+            assert(rowSlots[i] < slots.size());
+            sparseRows[i] = slots[rowSlots[i]];
+        }
+        ghostRows = sparseRows.data();
+    } else {
+        assert(firstSlot + cnt <= slots.size());
+        ghostRows = slots.data() + firstSlot;
+    }
+
+    GhostCodec codec = ghostCodec(dir);
+    if (codec != GHOST_FP32) {
+        const char *rowPtr = rows;
+        for (unsigned i = 0; i < cnt; ++i) {
+            rowPtr = decodeGhostRow(codec, rowPtr, featDim,
+                       getVtxFeat(ghostData, ghostRows[i], featDim));
+        }
+        return;
+    }
+
+    FeatType *rowPtr = (FeatType *)rows;
+    unsigned i = 0;
+    while (i < cnt) {
+        unsigned runEnd = i + 1;
+        while (runEnd < cnt && ghostRows[runEnd] == ghostRows[runEnd - 1] + 1)
+            ++runEnd;
+        memcpy(getVtxFeat(ghostData, ghostRows[i], featDim),
+               rowPtr + i * featDim,
+               sizeof(FeatType) * featDim * (runEnd - i));
+        i = runEnd;
+    }
+}
+
+/**
+ *
+ * Scatter only the rows the ghost delta filter lets through (async epochs).
+ * The rows of a message are no longer consecutive slots, so each message
+ * carries the slot of every row. Returns false if the caller has to send
+ * all the rows itself.
+ *
+ */
+bool Engine::scatterDelta(Chunk &c, FeatType *scatterTensor, unsigned featDim) {
+    if (!ghostDelta.enabled())
+        return false;
+    // Sync epochs send every row, but the last-sent values are kept up to date
+    std::vector<char> send;
+    ghostDelta.select(c.layer, c.dir, scatterTensor, featDim, c.lowBound,
+                      c.upBound, !async, send);
+    if (!async)
+        return false;
+
+    SendLists &sendLists = c.dir == PROP_TYPE::FORWARD ? forwardSendLists
+                                                       : backwardSendLists;
+    const unsigned BATCH_SIZE = std::max(
+        (MAX_MSG_SIZE - DATA_HEADER_SIZE) /
+            (sizeof(unsigned) + ghostRowSize(ghostCodec(c.dir), featDim)),
+        1ul);  // at least send one vertex
+
+    std::vector<unsigned> lvids;
+    std::vector<unsigned> rowSlots;
+    for (unsigned nid = 0; nid < numNodes; ++nid) {
+        if (nid == nodeId)
+            continue;
+        unsigned ghostVCnt = sendLists.count(c.localId, nid);
+        unsigned *ghostIds = sendLists.list(c.localId, nid);
+        unsigned firstSlot = sendLists.firstSlot(c.localId, nid);
+        lvids.clear();
+        rowSlots.clear();
+        for (unsigned i = 0; i < ghostVCnt; ++i) {
+            if (send[ghostIds[i] - c.lowBound]) {
+                lvids.push_back(ghostIds[i]);
+                rowSlots.push_back(firstSlot + i);
+            }
+        }
+
+        for (unsigned ib = 0; ib < lvids.size(); ib += BATCH_SIZE) {
+            unsigned sendBatchSize = std::min((unsigned)lvids.size() - ib,
+                                              BATCH_SIZE);
+            verticesPushOut(nid, sendBatchSize, lvids.data() + ib, 0,
+                            scatterTensor, featDim, c, rowSlots.data() + ib);
+        }
+    }
+    return true;
+}
+
+/**
+ *
+ * Hand the rows of a chunk to the per-peer aggregator instead of sending
+ * them in messages of their own. Returns false if aggregation is off.
+ *
+ */
+bool Engine::scatterAggregate(Chunk &c, FeatType *scatterTensor,
+                              unsigned featDim) {
+    if (!scatterAgg.enabled())
+        return false;
+
+    SendLists &sendLists = c.dir == PROP_TYPE::FORWARD ? forwardSendLists
+                                                       : backwardSendLists;
+    unsigned featLayer = ghostFeatLayer(c);
+    for (unsigned nid = 0; nid < numNodes; ++nid) {
+        if (nid == nodeId)
+            continue;
+        unsigned ghostVCnt = sendLists.count(c.localId, nid);
+        if (ghostVCnt == 0)
+            continue;
+        scatterAgg.add(nid, featLayer, c.dir, featDim, ghostCodec(c.dir),
+                       sendLists.firstSlot(c.localId, nid),
+                       sendLists.list(c.localId, nid), ghostVCnt,
+                       scatterTensor);
+    }
+    return true;
+}
+
+// Layer of the ghost tensor the scattered rows of a chunk go to.
+unsigned Engine::ghostFeatLayer(Chunk &c) {
     unsigned featLayer;
     if (gnn_type == GNN::GCN) { // YIFAN: fix this
         featLayer = c.dir == PROP_TYPE::FORWARD
@@ -636,17 +1313,56 @@ void Engine::verticesPushOut(unsigned receiver, unsigned totCnt,
     } else if (gnn_type == GNN::GAT) {
         featLayer = c.layer - 1;
     }
-    populateHeader(msgPtr, nodeId, totCnt, featDim, featLayer, c.dir);
-    msgPtr += sizeof(unsigned) * 5;
+    return featLayer;
+}
 
-    for (unsigned i = 0; i < totCnt; ++i) {
-        *(unsigned *)msgPtr = graph.localToGlobalId[lvids[i]];
+void Engine::verticesPushOut(unsigned receiver, unsigned totCnt,
+                             unsigned *lvids, unsigned firstSlot,
+                             FeatType *inputTensor, unsigned featDim,
+                             Chunk &c, unsigned *rowSlots) {
+    GhostCodec codec = ghostCodec(c.dir);
+    // Rows are written straight into a pooled send buffer
+    zmq::message_t msg = commManager.dataMessage(DATA_HEADER_SIZE +
+                           (rowSlots ? sizeof(unsigned) * totCnt : 0) +
+                           ghostRowSize(codec, featDim) * totCnt);
+    char *msgPtr = (char *)(msg.data());
+    sprintf(msgPtr, NODE_ID_HEADER, receiver);
+    msgPtr += NODE_ID_DIGITS;
+    populateHeader(msgPtr, nodeId, totCnt, featDim, ghostFeatLayer(c), c.dir);
+    msgPtr += sizeof(unsigned) * 5;
+    // Rows are in slot order, see exchangeGhostSlots()
+    if (rowSlots) {
+        *(unsigned *)msgPtr = SPARSE_SLOTS;
+        msgPtr += sizeof(unsigned);
+        memcpy(msgPtr, rowSlots, sizeof(unsigned) * totCnt);
+        msgPtr += sizeof(unsigned) * totCnt;
+    } else {
+        *(unsigned *)msgPtr = firstSlot;
         msgPtr += sizeof(unsigned);
+    }
+
+    if (codec != GHOST_FP32) {
+        for (unsigned i = 0; i < totCnt; ++i) {
+            msgPtr = encodeGhostRow(codec,
+                       getVtxFeat(inputTensor, lvids[i], featDim),
+                       featDim, msgPtr);
+        }
+        commManager.rawMsgPushOut(receiver, msg);
+        return;
+    }
+
+    // Copy runs of consecutive vertices at once
+    unsigned i = 0;
+    while (i < totCnt) {
+        unsigned runEnd = i + 1;
+        while (runEnd < totCnt && lvids[runEnd] == lvids[runEnd - 1] + 1)
+            ++runEnd;
         FeatType *dataPtr = getVtxFeat(inputTensor, lvids[i], featDim);
-        memcpy(msgPtr, dataPtr, sizeof(FeatType) * featDim);
-        msgPtr += sizeof(FeatType) * featDim;
+        memcpy(msgPtr, dataPtr, sizeof(FeatType) * featDim * (runEnd - i));
+        msgPtr += sizeof(FeatType) * featDim * (runEnd - i);
+        i = runEnd;
     }
-    commManager.rawMsgPushOut(msg);
+    commManager.rawMsgPushOut(receiver, msg);
 }
 /********************************* AE utils *********************************/
 // reshape vtcs tensor to edgs tensor. Each element in edgsTensor is a reference
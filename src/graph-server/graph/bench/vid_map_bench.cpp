@@ -0,0 +1,126 @@
+/**
+ *
+ * Microbenchmark of the vertex ID maps.
+ *
+ * Builds the global -> local map of one partition (every #partitions-th
+ * vertex of a shuffled graph, like a hash partitioning) with std::map (the
+ * maps used before), VidMap (hashed and dense, what the preprocessor uses)
+ * and the sorted arrays of IdMap (what Graph maps from the partition image).
+ * Then looks up random IDs, half of which are local, the way processEdge()
+ * and the ghost receivers resolve incoming gvids.
+ *
+ * Usage: vid-map-bench [#global vertices] [#partitions] [#lookups]
+ *
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "../graph.hpp"
+#include "../../utils/vid_map.hpp"
+
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point stt) {
+    return std::chrono::duration<double>(Clock::now() - stt).count();
+}
+
+static void report(const char *name, double loadSec, double lookupSec,
+                   unsigned numLookups, size_t bytes, size_t entries,
+                   unsigned long long checksum) {
+    printf("%-14s load %8.3f s  lookup %8.2f M/s  %6.1f B/entry  (checksum %llu)\n",
+           name, loadSec, numLookups / lookupSec / 1e6,
+           (double)bytes / entries, checksum);
+}
+
+int main(int argc, char *argv[]) {
+    unsigned numVtcs = argc > 1 ? std::atoi(argv[1]) : 10000000;
+    unsigned numParts = argc > 2 ? std::atoi(argv[2]) : 8;
+    unsigned numLookups = argc > 3 ? std::atoi(argv[3]) : 10000000;
+
+    std::mt19937 rng(42);
+    std::vector<unsigned> perm(numVtcs);
+    for (unsigned i = 0; i < numVtcs; ++i)
+        perm[i] = i;
+    std::shuffle(perm.begin(), perm.end(), rng);
+    std::vector<unsigned> localToGlobal;
+    for (unsigned i = 0; i < numVtcs; i += numParts)
+        localToGlobal.push_back(perm[i]);
+    std::sort(localToGlobal.begin(), localToGlobal.end());
+    const unsigned numLocal = localToGlobal.size();
+
+    std::vector<unsigned> queries(numLookups);
+    for (unsigned i = 0; i < numLookups; ++i) {
+        queries[i] = (i % 2) ? localToGlobal[rng() % numLocal] : rng() % numVtcs;
+    }
+    printf("%u vertices, %u partitions, %u local, %u lookups\n",
+           numVtcs, numParts, numLocal, numLookups);
+
+    {
+        Clock::time_point stt = Clock::now();
+        std::map<unsigned, unsigned> m;
+        for (unsigned lvid = 0; lvid < numLocal; ++lvid)
+            m[localToGlobal[lvid]] = lvid;
+        double loadSec = secondsSince(stt);
+        unsigned long long sum = 0;
+        stt = Clock::now();
+        for (unsigned gvid : queries) {
+            auto found = m.find(gvid);
+            if (found != m.end()) sum += found->second;
+        }
+        // Node + red-black tree overhead of libstdc++
+        report("std::map", loadSec, secondsSince(stt), numLookups,
+               m.size() * 48, numLocal, sum);
+    }
+
+    for (unsigned universe : { 0u, numVtcs }) {
+        Clock::time_point stt = Clock::now();
+        VidMap<unsigned> m;
+        m.reserve(numLocal, universe);
+        for (unsigned lvid = 0; lvid < numLocal; ++lvid)
+            m[localToGlobal[lvid]] = lvid;
+        double loadSec = secondsSince(stt);
+        unsigned long long sum = 0;
+        stt = Clock::now();
+        for (unsigned gvid : queries) {
+            auto found = m.find(gvid);
+            if (found != m.end()) sum += found->second;
+        }
+        report(m.isDense() ? "VidMap dense" : "VidMap hashed", loadSec,
+               secondsSince(stt), numLookups,
+               m.indexBytes() + m.size() * sizeof(VidMap<unsigned>::Entry),
+               numLocal, sum);
+    }
+
+    {
+        Clock::time_point stt = Clock::now();
+        std::vector<std::pair<unsigned, unsigned>> pairs(numLocal);
+        for (unsigned lvid = 0; lvid < numLocal; ++lvid)
+            pairs[lvid] = std::make_pair(localToGlobal[lvid], lvid);
+        std::sort(pairs.begin(), pairs.end());
+        std::vector<unsigned> keys(numLocal), vals(numLocal);
+        for (unsigned i = 0; i < numLocal; ++i) {
+            keys[i] = pairs[i].first;
+            vals[i] = pairs[i].second;
+        }
+        IdMap m;
+        m.attach(keys.data(), vals.data(), numLocal);
+        // Built by the preprocessor; Graph::init only maps it
+        double loadSec = secondsSince(stt);
+        unsigned long long sum = 0;
+        stt = Clock::now();
+        for (unsigned gvid : queries) {
+            auto found = m.find(gvid);
+            if (found != m.end()) sum += found->second;
+        }
+        report("IdMap sorted", loadSec, secondsSince(stt), numLookups,
+               2 * numLocal * sizeof(unsigned), numLocal, sum);
+    }
+
+    return 0;
+}
@@ -1,18 +1,57 @@
+#include <algorithm>
 #include <cerrno>
 #include <cmath>
 #include <cassert>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "dataloader.hpp"
 #include "../../common/utils.hpp"
 
 
-DataLoader::DataLoader(std::string datasetDir, unsigned _nodeId, unsigned _numNodes, bool _undirected) :
+/** Ghost flags of a vertex. */
+#define IN_GHOST  0x1
+#define OUT_GHOST 0x2
+
+
+/**
+ *
+ * Run fn(0) ... fn(cnt - 1) on numThreads threads, handing out the indices
+ * in order as threads become free.
+ *
+ */
+static void parallelFor(unsigned numThreads, unsigned cnt,
+                        const std::function<void(unsigned)> &fn) {
+    std::atomic<unsigned> next(0);
+    std::vector<std::thread> thds;
+    for (unsigned t = 0; t < std::min(numThreads, cnt); ++t) {
+        thds.push_back(std::thread([&]() {
+            for (unsigned i = next++; i < cnt; i = next++)
+                fn(i);
+        }));
+    }
+    for (std::thread &t : thds)
+        t.join();
+}
+
+
+DataLoader::DataLoader(std::string datasetDir, unsigned _nodeId, unsigned _numNodes, bool _undirected,
+                       unsigned _numThreads, unsigned _hubThreshold) :
                         graphFile(datasetDir + RAWGRAPH_EXT + EDGES_EXT), partsFile(datasetDir + RAWGRAPH_EXT + PARTS_EXT),
-                        nodeId(_nodeId), numNodes(_numNodes), undirected(_undirected),
+                        nodeId(_nodeId), numNodes(_numNodes), numThreads(_numThreads), hubThreshold(_hubThreshold),
+                        undirected(_undirected),
                         forwardDstTables(NULL), backwardDstTables(NULL) {
     char outfileName[50];
     sprintf(outfileName, "graph.%u.bin", nodeId);
     processedGraphFile = datasetDir + std::string(outfileName);
 
+    if (numThreads == 0)
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    rawGraph.hubThreshold = hubThreshold;
     rawGraph.forwardGhostsList = new std::vector<unsigned>[numNodes];
     rawGraph.backwardGhostsList = new std::vector<unsigned> [numNodes];
 }
@@ -20,9 +59,6 @@ DataLoader::DataLoader(std::string datasetDir, unsigned _nodeId, unsigned _numNo
 DataLoader::~DataLoader() {
     if (forwardDstTables) {
         for (unsigned i = 0; i < numNodes; ++i) {
-            if (i == nodeId) {
-                continue;
-            }
             if (forwardDstTables[i]) {
                 delete[] forwardDstTables[i];
             }
@@ -31,9 +67,6 @@ DataLoader::~DataLoader() {
     }
     if (backwardDstTables) {
         for (unsigned i = 0; i < numNodes; ++i) {
-            if (i == nodeId) {
-                continue;
-            }
             if (backwardDstTables[i]) {
                 delete[] backwardDstTables[i];
             }
@@ -74,213 +107,498 @@ void DataLoader::readPartsFile() {
         rawGraph.appendVertexPartitionId(partId);
 
         if (partId == nodeId) {
-            rawGraph.localToGlobalId[lvid] = gvid;
-            rawGraph.globalToLocalId[gvid] = lvid;
-
+            rawGraph.localToGlobalId.push_back(gvid);
             ++lvid;
         }
         ++gvid;
     }
 
+    // Sized once the partition is known: dense if the local vertices are a
+    // large enough share of the graph, hashed otherwise.
+    rawGraph.globalToLocalId.reserve(lvid, gvid);
+    for (unsigned i = 0; i < lvid; ++i)
+        rawGraph.globalToLocalId[rawGraph.localToGlobalId[i]] = i;
+
     rawGraph.setNumGlobalVertices(gvid);
     rawGraph.setNumLocalVertices(lvid);
 }
 
 /**
  *
- * Process an edge read from the binary snap file.
+ * Read edges [firstEdge, lastEdge) of the binary snap file in blocks and
+ * call fn(from, to) on each of them but the self edges. Returns the number
+ * of edges fn was called on.
  *
  */
-void DataLoader::processEdge(unsigned &from, unsigned &to) {
-    if (rawGraph.getVertexPartitionId(from) == nodeId) {
-        unsigned lFromId = rawGraph.globalToLocalId[from];
-        unsigned toId;
-        EdgeLocationType eLocation;
-
-        unsigned toPartition = rawGraph.getVertexPartitionId(to);
-        if (toPartition == nodeId) {
-            toId = rawGraph.globalToLocalId[to];
-            eLocation = LOCAL_EDGE_TYPE;
-        } else {
-            toId = to;
-            eLocation = REMOTE_EDGE_TYPE;
-            rawGraph.getVertex(lFromId).setVertexLocation(BOUNDARY_VERTEX);
-
-            if (!rawGraph.containsOutEdgeGhostVertex(to)) {
-                rawGraph.getOutEdgeGhostVertices()[to] = GhostVertex();
+template <typename Fn>
+static unsigned long long scanEdges(unsigned nodeId, const std::string &graphFile, int fd,
+                                    unsigned long long firstEdge, unsigned long long lastEdge,
+                                    Fn fn) {
+    std::vector<unsigned> buf(2 * INGEST_BLOCK_EDGES);
+    unsigned long long cnt = 0;
+    for (unsigned long long e = firstEdge; e < lastEdge; e += INGEST_BLOCK_EDGES) {
+        const size_t n = std::min((unsigned long long)INGEST_BLOCK_EDGES, lastEdge - e);
+        char *dst = reinterpret_cast<char *>(buf.data());
+        size_t left = n * 2 * sizeof(unsigned);
+        off_t off = sizeof(BSHeaderType) + e * 2 * sizeof(unsigned);
+        while (left > 0) {
+            ssize_t got = pread(fd, dst, left, off);
+            if (got <= 0) {
+                printLog(nodeId, "Failed reading BinarySnap file: %s [Reason: %s]",
+                         graphFile.c_str(), std::strerror(errno));
+                abort();
             }
-            rawGraph.getOutEdgeGhostVertex(to).addAssocEdge(lFromId);
-
-            forwardDstTables[toPartition][lFromId] = true;
+            dst += got;
+            off += got;
+            left -= got;
         }
 
-        rawGraph.getVertex(lFromId)
-                .addOutEdge(OutEdge(toId, eLocation, EdgeType()));
-        rawGraph.incrementNumLocalOutEdges();
-    }
-
-    if (rawGraph.getVertexPartitionId(to) == nodeId) {
-        unsigned lToId = rawGraph.globalToLocalId[to];
-        unsigned fromId;
-        EdgeLocationType eLocation;
-
-        unsigned fromPartition = rawGraph.getVertexPartitionId(from);
-        if (fromPartition == nodeId) {
-            fromId = rawGraph.globalToLocalId[from];
-            eLocation = LOCAL_EDGE_TYPE;
-        } else {
-            fromId = from;
-            eLocation = REMOTE_EDGE_TYPE;
-
-            if (!rawGraph.containsInEdgeGhostVertex(from)) {
-                rawGraph.getInEdgeGhostVertices()[from] = GhostVertex();
-            }
-            rawGraph.getInEdgeGhostVertex(from).addAssocEdge(lToId);
-
-            backwardDstTables[fromPartition][lToId] = true;
+        for (size_t i = 0; i < n; ++i) {
+            unsigned from = buf[2 * i];
+            unsigned to = buf[2 * i + 1];
+            if (from == to)
+                continue;
+            fn(from, to);
+            ++cnt;
         }
+    }
+    return cnt;
+}
 
-        rawGraph.getVertex(lToId).addInEdge(InEdge(fromId, eLocation, EdgeType()));
-        rawGraph.incrementNumLocalInEdges();
+/**
+ *
+ * Read the binary snap edge file in parallel. Each thread takes a contiguous
+ * range of edges and reads it in blocks, appending the local endpoints to
+ * its own buckets (by lvid range), so no locks are taken and every bucket
+ * keeps the file order of its edges.
+ *
+ */
+void DataLoader::ingestEdges() {
+    int fd = open(graphFile.c_str(), O_RDONLY);
+    if (fd < 0) {
+        printLog(nodeId, "Cannot open BinarySnap file: %s [Reason: %s]",
+                 graphFile.c_str(), std::strerror(errno));
+        abort();
+    }
+    BSHeaderType bSHeader;
+    struct stat st;
+    if (pread(fd, &bSHeader, sizeof(bSHeader), 0) != sizeof(bSHeader) || fstat(fd, &st) != 0) {
+        printLog(nodeId, "Cannot read BinarySnap file: %s", graphFile.c_str());
+        abort();
     }
+    assert(bSHeader.sizeOfVertexType == sizeof(unsigned));
+    const unsigned long long numEdges =
+        (st.st_size - sizeof(BSHeaderType)) / (2 * sizeof(unsigned));
+
+    const unsigned numLocal = rawGraph.getNumLocalVertices();
+    const unsigned numGlobal = rawGraph.getNumGlobalVertices();
+    numBuckets = numThreads * INGEST_BUCKETS_PER_THREAD;
+    bucketSize = std::max(1u, (numLocal + numBuckets - 1) / numBuckets);
+    inEdges.assign(numThreads, std::vector<EdgeBucket>(numBuckets));
+    outEdges.assign(numThreads, std::vector<EdgeBucket>(numBuckets));
+    globalEdgeCnts.assign(numThreads, 0);
+    std::vector<std::atomic<unsigned>>(numGlobal).swap(remoteDegrees);
+    std::vector<std::atomic<unsigned char>>(numGlobal).swap(ghostFlags);
+    hubInEdges.assign(numThreads, std::vector<EdgeBucket>(numBuckets));
+    hubOutEdges.assign(numThreads, EdgeBucket());
+    if (hubThreshold > 0)
+        findHubs(fd, numEdges);
+
+    parallelFor(numThreads, numThreads, [&](unsigned r) {
+        ingestRange(r, fd, numEdges * r / numThreads, numEdges * (r + 1) / numThreads);
+    });
+    close(fd);
+
+    unsigned long long numGlobalEdges = 0;
+    for (unsigned long long cnt : globalEdgeCnts)
+        numGlobalEdges += cnt;
+    rawGraph.setNumGlobalEdges(numGlobalEdges);
 }
 
 /**
  *
- * Set the normalization factors on all edges.
+ * Mark the vertices with more than hubThreshold in edges as hubs, with an
+ * extra pass over the edge file.
  *
  */
-void DataLoader::setEdgeNormalizations() {
-    for (Vertex &vertex : rawGraph.getVertices()) {
-        unsigned vtxDeg = vertex.getNumInEdges() + 1;
-        float vtxNorm = std::pow(vtxDeg, -.5);
-        vertex.setNormFactor(vtxNorm * vtxNorm);
-        for (unsigned i = 0; i < vertex.getNumInEdges(); ++i) {
-            InEdge &e = vertex.getInEdge(i);
-            unsigned vid = e.getSourceId();
-            if (e.getEdgeLocation() == LOCAL_EDGE_TYPE) {
-                unsigned srcDeg = rawGraph.getVertex(vid).getNumInEdges() + 1;
-                float srcNorm = std::pow(srcDeg, -.5);
-                e.setData(srcNorm * vtxNorm);
-            } else {
-                unsigned ghostDeg = rawGraph.getInEdgeGhostVertex(vid).getDegree() + 1;
-                float ghostNorm = std::pow(ghostDeg, -.5);
-                e.setData(ghostNorm * vtxNorm);
-            }
+void DataLoader::findHubs(int fd, unsigned long long numEdges) {
+    const unsigned numGlobal = rawGraph.getNumGlobalVertices();
+    std::vector<std::atomic<unsigned>> inDegrees(numGlobal);
+    parallelFor(numThreads, numThreads, [&](unsigned r) {
+        scanEdges(nodeId, graphFile, fd, numEdges * r / numThreads, numEdges * (r + 1) / numThreads,
+                  [&](unsigned from, unsigned to) {
+                      inDegrees[to].fetch_add(1, std::memory_order_relaxed);
+                      if (undirected)
+                          inDegrees[from].fetch_add(1, std::memory_order_relaxed);
+                  });
+    });
+
+    hubs.assign(numGlobal, 0);
+    unsigned hubCnt = 0;
+    for (unsigned gvid = 0; gvid < numGlobal; ++gvid) {
+        if (inDegrees[gvid].load(std::memory_order_relaxed) > hubThreshold) {
+            hubs[gvid] = 1;
+            ++hubCnt;
         }
-        for (unsigned i = 0; i < vertex.getNumOutEdges(); ++i) {
-            OutEdge &e = vertex.getOutEdge(i);
-            unsigned vid = e.getDestId();
-            if (e.getEdgeLocation() == LOCAL_EDGE_TYPE) {
-                unsigned dstDeg = rawGraph.getVertex(vid).getNumInEdges() + 1;
-                float dstNorm = std::pow(dstDeg, -.5);
-                e.setData(vtxNorm * dstNorm);
-            } else {
-                unsigned ghostDeg = rawGraph.getOutEdgeGhostVertex(vid).getDegree() + 1;
-                float ghostNorm = std::pow(ghostDeg, -.5);
-                e.setData(vtxNorm * ghostNorm);
+    }
+    printLog(nodeId, "Hybrid cut: %u hubs with more than %u in edges", hubCnt, hubThreshold);
+}
+
+void DataLoader::ingestRange(unsigned r, int fd, unsigned long long firstEdge,
+                             unsigned long long lastEdge) {
+    globalEdgeCnts[r] = scanEdges(nodeId, graphFile, fd, firstEdge, lastEdge,
+        [&](unsigned from, unsigned to) {
+            // In degree of remote vertices, for the norms of ghosts. The
+            // reverse edges of an undirected graph count too, so a ghost has
+            // the same norm as on its own partition.
+            if (rawGraph.getVertexPartitionId(to) != nodeId)
+                remoteDegrees[to].fetch_add(1, std::memory_order_relaxed);
+            emitEdge(r, from, to);
+            if (undirected) {
+                if (rawGraph.getVertexPartitionId(from) != nodeId)
+                    remoteDegrees[from].fetch_add(1, std::memory_order_relaxed);
+                emitEdge(r, to, from);
             }
-        }
+        });
+}
+
+/**
+ *
+ * Record an edge in the buckets of its local endpoint(s), and flag the
+ * remote endpoint as a ghost of that direction.
+ *
+ * An edge into a hub from another partition is mirrored: its source's
+ * partition aggregates it into a partial row of the hub, so it is no in
+ * edge of the hub's master and its source no ghost there. The backward
+ * pass still sees it as a plain out edge of the source.
+ *
+ */
+void DataLoader::emitEdge(unsigned r, unsigned from, unsigned to) {
+    const VidMap<unsigned> &g2l = rawGraph.globalToLocalId;
+    const unsigned fromPartition = rawGraph.getVertexPartitionId(from);
+    const unsigned toPartition = rawGraph.getVertexPartitionId(to);
+    const bool localFrom = fromPartition == nodeId;
+    const bool localTo = toPartition == nodeId;
+    const bool mirrored = fromPartition != toPartition && isHub(to);
+
+    if (localFrom) {
+        unsigned lFromId = g2l.find(from)->second;
+        outEdges[r][bucketOf(lFromId)].push_back(EdgeRec { lFromId, to });
+        if (!localTo && !(ghostFlags[to].load(std::memory_order_relaxed) & OUT_GHOST))
+            ghostFlags[to].fetch_or(OUT_GHOST, std::memory_order_relaxed);
+        if (mirrored)
+            hubOutEdges[r].push_back(EdgeRec { lFromId, to });
+    }
+    if (localTo && mirrored) {
+        unsigned lToId = g2l.find(to)->second;
+        hubInEdges[r][bucketOf(lToId)].push_back(EdgeRec { lToId, from });
+    } else if (localTo) {
+        unsigned lToId = g2l.find(to)->second;
+        inEdges[r][bucketOf(lToId)].push_back(EdgeRec { lToId, from });
+        if (!localFrom && !(ghostFlags[from].load(std::memory_order_relaxed) & IN_GHOST))
+            ghostFlags[from].fetch_or(IN_GHOST, std::memory_order_relaxed);
     }
 }
 
 /**
  *
- * Finds the in degree of all ghost vertices.
+ * Number the ghost vertices of each direction after the local ones, in
+ * gvid order, and compute their norms from their in degree.
  *
  */
-void DataLoader::findGhostDegrees() {
-    std::ifstream infile(graphFile.c_str(), std::ios::binary);
-    if (!infile.good())
-        printLog(nodeId, "Cannot open BinarySnap file: %s", graphFile.c_str());
+void DataLoader::numberGhosts() {
+    const unsigned numLocal = rawGraph.getNumLocalVertices();
+    const unsigned numGlobal = rawGraph.getNumGlobalVertices();
+    std::vector<unsigned> &inGhosts = rawGraph.inEdgeGhostVertices;
+    std::vector<unsigned> &outGhosts = rawGraph.outEdgeGhostVertices;
+    for (unsigned gvid = 0; gvid < numGlobal; ++gvid) {
+        unsigned char flags = ghostFlags[gvid].load(std::memory_order_relaxed);
+        if (flags & IN_GHOST)
+            inGhosts.push_back(gvid);
+        if (flags & OUT_GHOST)
+            outGhosts.push_back(gvid);
+    }
 
-    assert(infile.good());
+    inGhostIds.reserve(inGhosts.size(), numGlobal);
+    inGhostNorms.resize(inGhosts.size());
+    for (unsigned i = 0; i < inGhosts.size(); ++i) {
+        inGhostIds[inGhosts[i]] = numLocal + i;
+        unsigned ghostDeg = remoteDegrees[inGhosts[i]].load() + 1;
+        inGhostNorms[i] = std::pow(ghostDeg, -.5);
+    }
+    outGhostIds.reserve(outGhosts.size(), numGlobal);
+    outGhostNorms.resize(outGhosts.size());
+    for (unsigned i = 0; i < outGhosts.size(); ++i) {
+        outGhostIds[outGhosts[i]] = numLocal + i;
+        unsigned ghostDeg = remoteDegrees[outGhosts[i]].load() + 1;
+        outGhostNorms[i] = std::pow(ghostDeg, -.5);
+    }
 
-    BSHeaderType bsHeader;
-    infile.read((char *)&bsHeader, sizeof(bsHeader));
+    std::vector<std::atomic<unsigned>>().swap(remoteDegrees);
+    std::vector<std::atomic<unsigned char>>().swap(ghostFlags);
+}
 
-    unsigned srcdst[2];
-    while (infile.read((char *)srcdst, bsHeader.sizeOfVertexType * 2)) {
-        if (srcdst[0] == srcdst[1]) {
-            continue;
+/**
+ *
+ * Count the in / out degrees of the vertices of a bucket, and mark which
+ * of them have to be sent to which node. Every vertex also gets its norm,
+ * as all its in edges are in this bucket. Mirrored in edges of a hub count
+ * in its norm, but the hub's column only gets one edge per mirror node.
+ *
+ */
+void DataLoader::countBucket(unsigned bkt) {
+    const unsigned lo = bkt * bucketSize;
+    const unsigned hi = std::min(rawGraph.getNumLocalVertices(), lo + bucketSize);
+    unsigned long long *columnPtrs = rawGraph.forwardAdj.columnPtrs;
+    unsigned long long *rowPtrs = rawGraph.backwardAdj.rowPtrs;
+    for (unsigned r = 0; r < numThreads; ++r) {
+        for (const EdgeRec &rec : inEdges[r][bkt]) {
+            ++columnPtrs[rec.lvid + 1];
+            unsigned fromPartition = rawGraph.getVertexPartitionId(rec.gvid);
+            if (fromPartition != nodeId)
+                backwardDstTables[fromPartition][rec.lvid] = true;
         }
-
-        // YIFAN: we count in degree for both outEdgeGhosts and inEdgeGhosts
-        if (rawGraph.containsOutEdgeGhostVertex(srcdst[1])) {
-            rawGraph.getOutEdgeGhostVertex(srcdst[1]).incrementDegree();
+        for (const EdgeRec &rec : outEdges[r][bkt]) {
+            ++rowPtrs[rec.lvid + 1];
+            unsigned toPartition = rawGraph.getVertexPartitionId(rec.gvid);
+            if (toPartition != nodeId && !isHub(rec.gvid))
+                forwardDstTables[toPartition][rec.lvid] = true;
         }
-        if (rawGraph.containsInEdgeGhostVertex(srcdst[1])) {
-            rawGraph.getInEdgeGhostVertex(srcdst[1]).incrementDegree();
+    }
+
+    std::vector<unsigned> hubInDegs(hi > lo ? hi - lo : 0, 0);
+    std::vector<std::pair<unsigned, unsigned>> &mirrors = mirrorGhosts[bkt];
+    for (unsigned r = 0; r < numThreads; ++r) {
+        for (const EdgeRec &rec : hubInEdges[r][bkt]) {
+            unsigned fromPartition = rawGraph.getVertexPartitionId(rec.gvid);
+            ++hubInDegs[rec.lvid - lo];
+            backwardDstTables[fromPartition][rec.lvid] = true;
+            mirrors.push_back(std::make_pair(rec.lvid, fromPartition));
         }
+        EdgeBucket().swap(hubInEdges[r][bkt]);
     }
+    std::sort(mirrors.begin(), mirrors.end());
+    mirrors.erase(std::unique(mirrors.begin(), mirrors.end()), mirrors.end());
 
-    infile.close();
+    for (unsigned lvid = lo; lvid < hi; ++lvid) {
+        unsigned vtxDeg = columnPtrs[lvid + 1] + hubInDegs[lvid - lo] + 1;
+        float vtxNorm = std::pow(vtxDeg, -.5);
+        localNorms[lvid] = vtxNorm;
+        rawGraph.normFactors[lvid] = vtxNorm * vtxNorm;
+    }
+    for (const std::pair<unsigned, unsigned> &m : mirrors)
+        ++columnPtrs[m.first + 1];
 }
 
 /**
  *
- * Read and parse the graph from the graph binary snap file.
+ * Number the mirror rows after the src ghosts: grouped by the node sending
+ * them, then by hub lvid.
  *
  */
-void DataLoader::preprocess() {
-    printLog(nodeId, "Preprocessing... Output to %s", processedGraphFile.c_str());
-
-    // Read in the partition file.
-    readPartsFile();
-
-    // Initialize the graph based on the partition info.
-    rawGraph.getVertices().resize(rawGraph.getNumLocalVertices());
-    for (unsigned i = 0; i < rawGraph.getNumLocalVertices(); ++i) {
-        rawGraph.getVertex(i).setLocalId(i);
-        rawGraph.getVertex(i).setGlobalId(rawGraph.localToGlobalId[i]);
-        rawGraph.getVertex(i).setVertexLocation(INTERNAL_VERTEX);
-        rawGraph.getVertex(i).setGraphPtr(&rawGraph);
+void DataLoader::numberMirrorGhosts() {
+    std::vector<unsigned long long> &ptrs = rawGraph.mirrorGhostPtrs;
+    std::vector<unsigned> &ghostHubs = rawGraph.mirrorGhostHubs;
+    ptrs.assign(numNodes + 1, 0);
+    for (unsigned bkt = 0; bkt < numBuckets; ++bkt) {
+        for (const std::pair<unsigned, unsigned> &m : mirrorGhosts[bkt])
+            ++ptrs[m.second + 1];
     }
+    for (unsigned nid = 0; nid < numNodes; ++nid)
+        ptrs[nid + 1] += ptrs[nid];
+
+    ghostHubs.resize(ptrs[numNodes]);
+    std::vector<unsigned long long> pos(ptrs.begin(), ptrs.end() - 1);
+    for (unsigned bkt = 0; bkt < numBuckets; ++bkt) {
+        for (const std::pair<unsigned, unsigned> &m : mirrorGhosts[bkt])
+            ghostHubs[pos[m.second]++] = m.first;
+    }
+}
 
-    // Read in the binary snap edge file.
-    std::ifstream infile(graphFile.c_str(), std::ios::binary);
-    if (!infile.good())
-        printLog(nodeId, "Cannot open BinarySnap file: %s", graphFile.c_str());
-
-    assert(infile.good());
+/**
+ *
+ * Place the edges of a bucket into their columns (CSC) / rows (CSR). Buckets
+ * are walked in file order, so edges keep the order of the edge file within
+ * a column / row, like a stable counting sort.
+ *
+ */
+void DataLoader::fillBucket(unsigned bkt) {
+    const unsigned numLocal = rawGraph.getNumLocalVertices();
+    const unsigned lo = bkt * bucketSize;
+    const unsigned hi = std::min(numLocal, lo + bucketSize);
+    if (lo >= hi)
+        return;
+    const VidMap<unsigned> &g2l = rawGraph.globalToLocalId;
+    CSCMatrix<EdgeType> &csc = rawGraph.forwardAdj;
+    CSRMatrix<EdgeType> &csr = rawGraph.backwardAdj;
+    std::vector<unsigned long long> colPos(csc.columnPtrs + lo, csc.columnPtrs + hi);
+    std::vector<unsigned long long> rowPos(csr.rowPtrs + lo, csr.rowPtrs + hi);
+
+    for (unsigned r = 0; r < numThreads; ++r) {
+        for (const EdgeRec &rec : inEdges[r][bkt]) {
+            unsigned long long eid = colPos[rec.lvid - lo]++;
+            unsigned srcId;
+            float srcNorm;
+            if (rawGraph.getVertexPartitionId(rec.gvid) == nodeId) {
+                srcId = g2l.find(rec.gvid)->second;
+                srcNorm = localNorms[srcId];
+            } else {
+                srcId = inGhostIds.find(rec.gvid)->second;
+                srcNorm = inGhostNorms[srcId - numLocal];
+            }
+            csc.rowIdxs[eid] = srcId;
+            csc.values[eid] = srcNorm * localNorms[rec.lvid];
+        }
+        EdgeBucket().swap(inEdges[r][bkt]);
+
+        for (const EdgeRec &rec : outEdges[r][bkt]) {
+            unsigned long long eid = rowPos[rec.lvid - lo]++;
+            unsigned dstId;
+            float dstNorm;
+            if (rawGraph.getVertexPartitionId(rec.gvid) == nodeId) {
+                dstId = g2l.find(rec.gvid)->second;
+                dstNorm = localNorms[dstId];
+            } else {
+                dstId = outGhostIds.find(rec.gvid)->second;
+                dstNorm = outGhostNorms[dstId - numLocal];
+            }
+            csr.columnIdxs[eid] = dstId;
+            csr.values[eid] = localNorms[rec.lvid] * dstNorm;
+        }
+        EdgeBucket().swap(outEdges[r][bkt]);
+    }
 
-    BSHeaderType bSHeader;
-    infile.read((char *)&bSHeader, sizeof(bSHeader));
-    assert(bSHeader.sizeOfVertexType == sizeof(unsigned));
+    // Partial rows already carry the norms, see buildMirrorAdj()
+    const unsigned firstMirror = numLocal + rawGraph.inEdgeGhostVertices.size();
+    const std::vector<unsigned long long> &mirrorPtrs = rawGraph.mirrorGhostPtrs;
+    const unsigned *ghostHubs = rawGraph.mirrorGhostHubs.data();
+    for (const std::pair<unsigned, unsigned> &m : mirrorGhosts[bkt]) {
+        const unsigned *grpStt = ghostHubs + mirrorPtrs[m.second];
+        const unsigned *grpEnd = ghostHubs + mirrorPtrs[m.second + 1];
+        unsigned long long eid = colPos[m.first - lo]++;
+        csc.rowIdxs[eid] = firstMirror + mirrorPtrs[m.second] +
+                           (std::lower_bound(grpStt, grpEnd, m.first) - grpStt);
+        csc.values[eid] = 1.0;
+    }
+    std::vector<std::pair<unsigned, unsigned>>().swap(mirrorGhosts[bkt]);
+}
 
+/**
+ *
+ * Build the CSC and CSR from the buckets: count per bucket, prefix sum,
+ * then fill per bucket.
+ *
+ */
+void DataLoader::buildAdjs() {
+    const unsigned numLocal = rawGraph.getNumLocalVertices();
     forwardDstTables = new bool *[numNodes];
     backwardDstTables = new bool *[numNodes];
     for (unsigned i = 0; i < numNodes; ++i) {
+        forwardDstTables[i] = NULL;
+        backwardDstTables[i] = NULL;
         if (i == nodeId) {
             continue;
         }
-        forwardDstTables[i] = new bool[rawGraph.getNumLocalVertices()];
-        memset(forwardDstTables[i], 0,
-                     sizeof(bool) * rawGraph.getNumLocalVertices());
-        backwardDstTables[i] = new bool[rawGraph.getNumLocalVertices()];
-        memset(backwardDstTables[i], 0,
-                     sizeof(bool) * rawGraph.getNumLocalVertices());
+        forwardDstTables[i] = new bool[numLocal];
+        memset(forwardDstTables[i], 0, sizeof(bool) * numLocal);
+        backwardDstTables[i] = new bool[numLocal];
+        memset(backwardDstTables[i], 0, sizeof(bool) * numLocal);
     }
 
-    // Loop through all edges and process them.
-    unsigned srcdst[2];
-    while (infile.read((char *)srcdst, bSHeader.sizeOfVertexType * 2)) {
-        if (srcdst[0] == srcdst[1])
-            continue;
+    CSCMatrix<EdgeType> &csc = rawGraph.forwardAdj;
+    CSRMatrix<EdgeType> &csr = rawGraph.backwardAdj;
+    csc.columnCnt = numLocal;
+    csc.columnPtrs = new unsigned long long[numLocal + 1]();
+    csr.rowCnt = numLocal;
+    csr.rowPtrs = new unsigned long long[numLocal + 1]();
+    localNorms.resize(numLocal);
+    rawGraph.normFactors.resize(numLocal);
+    mirrorGhosts.assign(numBuckets, std::vector<std::pair<unsigned, unsigned>>());
+
+    parallelFor(numThreads, numBuckets, [&](unsigned bkt) { countBucket(bkt); });
+    numberMirrorGhosts();
+
+    for (unsigned lvid = 0; lvid < numLocal; ++lvid) {
+        csc.columnPtrs[lvid + 1] += csc.columnPtrs[lvid];
+        csr.rowPtrs[lvid + 1] += csr.rowPtrs[lvid];
+    }
+    csc.nnz = csc.columnPtrs[numLocal];
+    csc.values = new EdgeType[csc.nnz];
+    csc.rowIdxs = new unsigned[csc.nnz];
+    csr.nnz = csr.rowPtrs[numLocal];
+    csr.values = new EdgeType[csr.nnz];
+    csr.columnIdxs = new unsigned[csr.nnz];
+    rawGraph.setNumLocalInEdges(csc.nnz);
+    rawGraph.setNumLocalOutEdges(csr.nnz);
+
+    parallelFor(numThreads, numBuckets, [&](unsigned bkt) { fillBucket(bkt); });
+}
 
-        processEdge(srcdst[0], srcdst[1]);
-        if (undirected)
-            processEdge(srcdst[1], srcdst[0]);
-        rawGraph.incrementNumGlobalEdges();
+/**
+ *
+ * Build the partial aggregation of the remote hubs: one column per hub
+ * grouped by master node, holding the mirrored in edges from my vertices
+ * with the norms the master would have applied.
+ *
+ */
+void DataLoader::buildMirrorAdj() {
+    const unsigned numLocal = rawGraph.getNumLocalVertices();
+    EdgeBucket recs;
+    for (unsigned r = 0; r < numThreads; ++r) {
+        recs.insert(recs.end(), hubOutEdges[r].begin(), hubOutEdges[r].end());
+        EdgeBucket().swap(hubOutEdges[r]);
     }
+    std::stable_sort(recs.begin(), recs.end(), [&](const EdgeRec &lhs, const EdgeRec &rhs) {
+        unsigned lPart = rawGraph.getVertexPartitionId(lhs.gvid);
+        unsigned rPart = rawGraph.getVertexPartitionId(rhs.gvid);
+        return lPart < rPart || (lPart == rPart && lhs.gvid < rhs.gvid);
+    });
+
+    CSCMatrix<EdgeType> &adj = rawGraph.mirrorAdj;
+    std::vector<unsigned> &mirrorHubs = rawGraph.mirrorHubs;
+    std::vector<unsigned long long> &hubPtrs = rawGraph.mirrorHubPtrs;
+    std::vector<unsigned long long> colPtrs;
+    hubPtrs.assign(numNodes + 1, 0);
+    adj.nnz = recs.size();
+    adj.rowIdxs = new unsigned[adj.nnz];
+    adj.values = new EdgeType[adj.nnz];
+    for (unsigned long long eid = 0; eid < recs.size(); ++eid) {
+        const EdgeRec &rec = recs[eid];
+        if (mirrorHubs.empty() || mirrorHubs.back() != rec.gvid) {
+            mirrorHubs.push_back(rec.gvid);
+            colPtrs.push_back(eid);
+            ++hubPtrs[rawGraph.getVertexPartitionId(rec.gvid) + 1];
+        }
+        unsigned hubId = outGhostIds.find(rec.gvid)->second;
+        adj.rowIdxs[eid] = rec.lvid;
+        adj.values[eid] = localNorms[rec.lvid] * outGhostNorms[hubId - numLocal];
+    }
+    colPtrs.push_back(adj.nnz);
+    for (unsigned nid = 0; nid < numNodes; ++nid)
+        hubPtrs[nid + 1] += hubPtrs[nid];
+    adj.columnCnt = mirrorHubs.size();
+    adj.columnPtrs = new unsigned long long[colPtrs.size()];
+    std::copy(colPtrs.begin(), colPtrs.end(), adj.columnPtrs);
+
+    if (hubThreshold > 0) {
+        printLog(nodeId, "Hybrid cut: %u partial rows in, %u hubs mirrored (%llu edges)",
+                 (unsigned)rawGraph.mirrorGhostHubs.size(), adj.columnCnt, adj.nnz);
+    }
+}
 
-    for (unsigned i = 0; i < numNodes; ++i) {
+/**
+ *
+ * Turn the destination tables into the sorted lists of local vertices each
+ * node needs, per direction.
+ *
+ */
+void DataLoader::buildGhostsLists() {
+    const unsigned numLocal = rawGraph.getNumLocalVertices();
+    parallelFor(numThreads, numNodes, [&](unsigned i) {
         if (i == nodeId) {
-            continue;
+            return;
         }
-        rawGraph.forwardGhostsList[i].reserve(rawGraph.getNumLocalVertices());
-        rawGraph.backwardGhostsList[i].reserve(rawGraph.getNumLocalVertices());
-        for (unsigned j = 0; j < rawGraph.getNumLocalVertices(); ++j) {
+        for (unsigned j = 0; j < numLocal; ++j) {
             if (forwardDstTables[i][j]) {
                 rawGraph.forwardGhostsList[i].push_back(j);
             }
@@ -294,35 +612,74 @@ void DataLoader::preprocess() {
         delete[] backwardDstTables[i];
         forwardDstTables[i] = NULL;
         backwardDstTables[i] = NULL;
+    });
+}
+
+/**
+ *
+ * Check the header of the partition image against the inputs and options
+ * it would be preprocessed from now. Without the raw inputs an existing
+ * image is used as is, as it cannot be rebuilt anyway.
+ *
+ */
+bool DataLoader::upToDate() {
+    struct stat st;
+    if (stat(processedGraphFile.c_str(), &st) != 0)
+        return false;
+    FileStamp edgesStamp = getFileStamp(graphFile);
+    FileStamp partsStamp = getFileStamp(partsFile);
+    if (edgesStamp.size == 0 || partsStamp.size == 0) {
+        printLog(nodeId, "No raw inputs of %s, using it as is", processedGraphFile.c_str());
+        return true;
     }
-    delete[] forwardDstTables;
-    delete[] backwardDstTables;
-    forwardDstTables = NULL;
-    backwardDstTables = NULL;
-
-    infile.close();
-
-    // Extra works added.
-    rawGraph.setNumInEdgeGhostVertices(rawGraph.getInEdgeGhostVertices().size());
-    rawGraph.setNumOutEdgeGhostVertices(rawGraph.getOutEdgeGhostVertices().size());
-    findGhostDegrees();
-    setEdgeNormalizations();
-
-    // Set a local index for all ghost vertices along the way. This index is used
-    // for indexing within the ghost data arrays.
-    unsigned ghostCount = rawGraph.getNumLocalVertices();
-    for (auto it = rawGraph.getInEdgeGhostVertices().begin();
-             it != rawGraph.getInEdgeGhostVertices().end(); it++) {
-        it->second.setLocalId(ghostCount++);
-    }
-    ghostCount = rawGraph.getNumLocalVertices();
-    for (auto it = rawGraph.getOutEdgeGhostVertices().begin();
-             it != rawGraph.getOutEdgeGhostVertices().end(); it++) {
-        it->second.setLocalId(ghostCount++);
+
+    GraphImageHeader hdr;
+    std::ifstream infile(processedGraphFile.c_str(), std::ios::binary);
+    infile.read(reinterpret_cast<char *>(&hdr), sizeof(GraphImageHeader));
+    const char *stale = NULL;
+    if (!infile.good() || hdr.magic != GRAPH_IMAGE_MAGIC ||
+        hdr.version != GRAPH_IMAGE_VERSION || hdr.edgeTypeSize != sizeof(EdgeType) ||
+        hdr.totalSize != (unsigned long long)st.st_size)
+        stale = "not a current partition image";
+    else if (hdr.edgesStamp != edgesStamp)
+        stale = "edges file changed";
+    else if (hdr.partsStamp != partsStamp)
+        stale = "partition file changed";
+    else if (hdr.numNodes != numNodes)
+        stale = "number of nodes changed";
+    else if ((hdr.undirected != 0) != undirected)
+        stale = "undirected changed";
+    else if (hdr.hubThreshold != hubThreshold)
+        stale = "hub threshold changed";
+    if (stale) {
+        printLog(nodeId, "Partition image %s is stale (%s)", processedGraphFile.c_str(), stale);
+        return false;
     }
+    printLog(nodeId, "Partition image %s is up to date", processedGraphFile.c_str());
+    return true;
+}
+
+/**
+ *
+ * Read and parse the graph from the graph binary snap file.
+ *
+ */
+void DataLoader::preprocess() {
+    printLog(nodeId, "Preprocessing with %u threads... Output to %s",
+             numThreads, processedGraphFile.c_str());
+    // Stamped before reading, so inputs changed meanwhile make it stale
+    rawGraph.edgesStamp = getFileStamp(graphFile);
+    rawGraph.partsStamp = getFileStamp(partsFile);
+    rawGraph.undirected = undirected;
 
-    rawGraph.forwardAdj.init(rawGraph);
-    rawGraph.backwardAdj.init(rawGraph);
+    // Read in the partition file.
+    readPartsFile();
+    // Read in the binary snap edge file.
+    ingestEdges();
+    numberGhosts();
+    buildAdjs();
+    buildMirrorAdj();
+    buildGhostsLists();
 
     rawGraph.dump(processedGraphFile, numNodes);
 
@@ -1,4 +1,7 @@
+#include <atomic>
 #include <fstream>
+#include <utility>
+#include <vector>
 #include "graph.hpp"
 
 
@@ -7,6 +10,11 @@
 #define EDGES_EXT ".edges"
 #define PARTS_EXT ".parts"
 
+/** Edges read per pread() of an ingestion thread. */
+#define INGEST_BLOCK_EDGES (1 << 20)
+/** Vertex range buckets per ingestion thread, for balancing the CSC/CSR build. */
+#define INGEST_BUCKETS_PER_THREAD 4
+
 /** Binary snap file header struct. */
 struct BSHeaderType {
     int sizeOfVertexType;
@@ -17,18 +25,43 @@ struct BSHeaderType {
 
 class DataLoader {
 public:
-    DataLoader(std::string datasetDir, unsigned _nodeId, unsigned _numNodes, bool _undirected);
+    DataLoader(std::string datasetDir, unsigned _nodeId, unsigned _numNodes, bool _undirected,
+               unsigned _numThreads = 0, unsigned _hubThreshold = 0);
     ~DataLoader();
 
     void readPartsFile();
-    void processEdge(unsigned &from, unsigned &to);
-    void findGhostDegrees();
-    void setEdgeNormalizations();
     void preprocess();
+    // Whether the partition image was preprocessed from the current inputs
+    // with the same options, so preprocess() can be skipped
+    bool upToDate();
 
 private:
+    /** A local endpoint (lvid) of an edge and the gvid of the other one. */
+    struct EdgeRec {
+        unsigned lvid;
+        unsigned gvid;
+    };
+    typedef std::vector<EdgeRec> EdgeBucket;
+
+    void ingestEdges();
+    void findHubs(int fd, unsigned long long numEdges);
+    void ingestRange(unsigned tid, int fd, unsigned long long firstEdge,
+                     unsigned long long lastEdge);
+    void emitEdge(unsigned tid, unsigned from, unsigned to);
+    void numberGhosts();
+    void countBucket(unsigned bkt);
+    void fillBucket(unsigned bkt);
+    void numberMirrorGhosts();
+    void buildAdjs();
+    void buildMirrorAdj();
+    void buildGhostsLists();
+    unsigned bucketOf(unsigned lvid) { return lvid / bucketSize; }
+    bool isHub(unsigned gvid) { return !hubs.empty() && hubs[gvid]; }
+
     unsigned nodeId;
     unsigned numNodes;
+    unsigned numThreads;
+    unsigned hubThreshold;
 
     std::string graphFile;
     std::string partsFile;
@@ -40,4 +73,28 @@ private:
 
     bool **forwardDstTables;
     bool **backwardDstTables;
+
+    // Ingestion state, [tid][bucket] for the edge buckets
+    unsigned numBuckets;
+    unsigned bucketSize;
+    std::vector<std::vector<EdgeBucket>> inEdges;   // lvid = dst
+    std::vector<std::vector<EdgeBucket>> outEdges;  // lvid = src
+    std::vector<unsigned long long> globalEdgeCnts;
+    // In-degree in the edge file of every remote vertex (for ghost norms)
+    std::vector<std::atomic<unsigned>> remoteDegrees;
+    // IN_GHOST / OUT_GHOST flags of every vertex
+    std::vector<std::atomic<unsigned char>> ghostFlags;
+    VidMap<unsigned> inGhostIds;
+    VidMap<unsigned> outGhostIds;
+    std::vector<EdgeType> localNorms;
+    std::vector<EdgeType> inGhostNorms;
+    std::vector<EdgeType> outGhostNorms;
+
+    // Hybrid cut: vertices with more than hubThreshold in edges are hubs,
+    // and the in edges of a hub from another partition are aggregated there
+    std::vector<char> hubs;                         // by gvid
+    std::vector<std::vector<EdgeBucket>> hubInEdges;    // lvid = local hub
+    std::vector<EdgeBucket> hubOutEdges;            // [tid], lvid = src
+    // Distinct (hub lvid, node) pairs of every bucket, i.e. mirror rows
+    std::vector<std::vector<std::pair<unsigned, unsigned>>> mirrorGhosts;
 };
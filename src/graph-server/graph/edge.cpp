@@ -1,7 +0,0 @@
-#include <cstring>
-#include "edge.hpp"
-
-
-///////////////////////////////////////////////////////////////////////
-// Edges current have no complicated methods to be implemented here. //
-///////////////////////////////////////////////////////////////////////
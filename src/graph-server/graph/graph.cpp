@@ -2,15 +2,84 @@
 #include "graph.hpp"
 #include <fstream>
 #include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
-void Graph::init(std::string graphFile) {
+Graph::~Graph() {
+    // Views in forwardAdj / backwardAdj point into the image
+    if (mapped && image)
+        munmap(image, imageSize);
+}
+
+/**
+ *
+ * Load a partition. Images produced by the preprocessor are mapped directly.
+ * Partitions in the old stream format are converted once; the converted
+ * image is cached next to them (graphFile + GRAPH_IMAGE_EXT) so later runs
+ * map it instead.
+ *
+ */
+bool Graph::init(std::string graphFile) {
+    if (isGraphImage(graphFile))
+        return mapImage(graphFile);
+
+    std::string imageFile = graphFile + GRAPH_IMAGE_EXT;
+    struct stat srcStat, imgStat;
+    if (stat(graphFile.c_str(), &srcStat) == 0 && stat(imageFile.c_str(), &imgStat) == 0 &&
+        imgStat.st_mtime >= srcStat.st_mtime && isGraphImage(imageFile) && mapImage(imageFile)) {
+        return true;
+    }
+    return loadLegacy(graphFile);
+}
+
+/**
+ *
+ * Map an image privately. Pages are shared with the page cache until
+ * written; the few in-place writers (e.g. GAT reusing forwardAdj.values as
+ * its attention tensor) get copy-on-write pages and never touch the file.
+ *
+ */
+bool Graph::mapImage(const std::string &filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Cannot open input file: " << filename << ", [Reason: " << std::strerror(errno) << "]" << std::endl;
+        return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    void *addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        std::cout << "Cannot mmap input file: " << filename << ", [Reason: " << std::strerror(errno) << "]" << std::endl;
+        return false;
+    }
+    if (!validGraphImage(reinterpret_cast<const char *>(addr), st.st_size)) {
+        std::cout << "Corrupted graph image: " << filename << std::endl;
+        munmap(addr, st.st_size);
+        return false;
+    }
+
+    image = reinterpret_cast<char *>(addr);
+    imageSize = st.st_size;
+    mapped = true;
+    attachImage();
+    return true;
+}
+
+/**
+ *
+ * Parse a partition in the old stream format and turn it into an image in
+ * memory. The image is also saved for the next run, best effort.
+ *
+ */
+bool Graph::loadLegacy(const std::string &graphFile) {
     std::ifstream infile(graphFile.c_str(), std::ios::binary);
     if (!infile.good()) {
         std::cout << "Cannot open input file: " << graphFile << ", [Reason: " << std::strerror(errno) << "]" << std::endl;
-        return;
+        return false;
     }
-    assert(infile.good());
     // vertex count
     infile.read(reinterpret_cast<char *>(&localVtxCnt), sizeof(unsigned));
     infile.read(reinterpret_cast<char *>(&globalVtxCnt), sizeof(unsigned));
@@ -21,97 +90,145 @@ void Graph::init(std::string graphFile) {
     infile.read(reinterpret_cast<char *>(&localOutEdgeCnt), sizeof(unsigned long long));
     infile.read(reinterpret_cast<char *>(&globalEdgeCnt), sizeof(unsigned long long));
 
-    localToGlobalId.resize(localVtxCnt);
-    // local vertex global IDs
-    infile.read(reinterpret_cast<char *>(localToGlobalId.data()), sizeof(unsigned) * localVtxCnt);
-    // construct mapping of local vertex global IDs to local IDs
-    for (unsigned lvid = 0; lvid < localVtxCnt; ++lvid) {
-        globaltoLocalId[localToGlobalId[lvid]] = lvid;
-    }
-    vtxDataVec.resize(localVtxCnt);
-    // vertex data (normFactor for GCN)
-    infile.read(reinterpret_cast<char *>(vtxDataVec.data()), sizeof(EdgeType) * localVtxCnt);
-    // mapping of src ghost vertex global IDs to local IDs
-    for (unsigned i = 0; i < srcGhostCnt; ++i) {
-        unsigned gvid = 0;
-        unsigned lvid = 0;
-        infile.read(reinterpret_cast<char *>(&gvid), sizeof(unsigned));
-        infile.read(reinterpret_cast<char *>(&lvid), sizeof(unsigned));
-        srcGhostVtcs[gvid] = lvid;
-    }
-    // mapping of dst ghost vertex global IDs to local IDs
-    for (unsigned i = 0; i < dstGhostCnt; ++i) {
-        unsigned gvid = 0;
-        unsigned lvid = 0;
-        infile.read(reinterpret_cast<char *>(&gvid), sizeof(unsigned));
-        infile.read(reinterpret_cast<char *>(&lvid), sizeof(unsigned));
-        dstGhostVtcs[gvid] = lvid;
-    }
-    // destination of local vertices during forward
+    GraphImageWriter writer;
+    // local vertex global IDs and vertex data (normFactor for GCN)
+    std::vector<unsigned> l2g(localVtxCnt);
+    std::vector<EdgeType> vtxData(localVtxCnt);
+    infile.read(reinterpret_cast<char *>(l2g.data()), sizeof(unsigned) * localVtxCnt);
+    infile.read(reinterpret_cast<char *>(vtxData.data()), sizeof(EdgeType) * localVtxCnt);
+    writer.setVertices(localVtxCnt, globalVtxCnt, l2g.data(), vtxData.data());
+    writer.setEdgeCounts(localInEdgeCnt, localOutEdgeCnt, globalEdgeCnt);
+    // mapping of src / dst ghost vertex global IDs to local IDs
+    std::vector<std::pair<unsigned, unsigned>> srcGhosts(srcGhostCnt), dstGhosts(dstGhostCnt);
+    infile.read(reinterpret_cast<char *>(srcGhosts.data()), 2 * sizeof(unsigned) * srcGhostCnt);
+    infile.read(reinterpret_cast<char *>(dstGhosts.data()), 2 * sizeof(unsigned) * dstGhostCnt);
+    writer.setGhostVtcs(PROP_TYPE::FORWARD, srcGhosts);
+    writer.setGhostVtcs(PROP_TYPE::BACKWARD, dstGhosts);
+    // destination of local vertices during forward / backward
     unsigned numNodes = 0;
     infile.read(reinterpret_cast<char *>(&numNodes), sizeof(unsigned));
-    for (unsigned i = 0; i < numNodes; ++i) {
-        unsigned size = 0;
-        infile.read(reinterpret_cast<char *>(&size), sizeof(unsigned));
-        forwardLocalVtxDsts.push_back(std::vector<unsigned>(size));
-        infile.read(reinterpret_cast<char *>(forwardLocalVtxDsts[i].data()), sizeof(unsigned) * size);
-    }
-    // destination of local vertices during backward
-    for (unsigned i = 0; i < numNodes; ++i) {
-        unsigned size = 0;
-        infile.read(reinterpret_cast<char *>(&size), sizeof(unsigned));
-        backwardLocalVtxDsts.push_back(std::vector<unsigned>(size));
-        infile.read(reinterpret_cast<char *>(backwardLocalVtxDsts[i].data()), sizeof(unsigned) * size);
+    std::vector<std::vector<unsigned>> dsts[2];
+    for (unsigned dir = 0; dir < 2; ++dir) {
+        dsts[dir].resize(numNodes);
+        for (unsigned i = 0; i < numNodes; ++i) {
+            unsigned size = 0;
+            infile.read(reinterpret_cast<char *>(&size), sizeof(unsigned));
+            dsts[dir][i].resize(size);
+            infile.read(reinterpret_cast<char *>(dsts[dir][i].data()), sizeof(unsigned) * size);
+        }
+        writer.setLocalVtxDsts((PROP_TYPE)dir, numNodes, dsts[dir].data());
     }
 
-    // Create alternate representation of local vertex destinations for pipelined version
-    for (unsigned nid = 0; nid < numNodes; ++nid) {
-        std::vector<unsigned>& vids = forwardLocalVtxDsts[nid];
-        for (unsigned i = 0; i < vids.size(); ++i) {
-            if (forwardGhostMap.find(vids[i]) == forwardGhostMap.end()) {
-                forwardGhostMap[vids[i]] = std::vector<unsigned>();
-            }
+    // CSC representation of graph
+    CSCMatrix<EdgeType> csc;
+    infile.read(reinterpret_cast<char *>(&csc.columnCnt), sizeof(unsigned));
+    infile.read(reinterpret_cast<char *>(&csc.nnz), sizeof(unsigned long long));
+    csc.values = new EdgeType[csc.nnz];
+    csc.columnPtrs = new unsigned long long[localVtxCnt + 1];
+    csc.rowIdxs = new unsigned[csc.nnz];
+    infile.read(reinterpret_cast<char *>(csc.values), sizeof(EdgeType) * csc.nnz);
+    infile.read(reinterpret_cast<char *>(csc.columnPtrs), sizeof(unsigned long long) * (localVtxCnt + 1));
+    infile.read(reinterpret_cast<char *>(csc.rowIdxs), sizeof(unsigned) * csc.nnz);
 
-            forwardGhostMap[vids[i]].push_back(nid);
-        }
+    // CSR representation of grpah
+    CSRMatrix<EdgeType> csr;
+    infile.read(reinterpret_cast<char *>(&csr.rowCnt), sizeof(unsigned));
+    infile.read(reinterpret_cast<char *>(&csr.nnz), sizeof(unsigned long long));
+    csr.values = new EdgeType[csr.nnz];
+    csr.rowPtrs = new unsigned long long[localVtxCnt + 1];
+    csr.columnIdxs = new unsigned[csr.nnz];
+    infile.read(reinterpret_cast<char *>(csr.values), sizeof(EdgeType) * csr.nnz);
+    infile.read(reinterpret_cast<char *>(csr.rowPtrs), sizeof(unsigned long long) * (localVtxCnt + 1));
+    infile.read(reinterpret_cast<char *>(csr.columnIdxs), sizeof(unsigned) * csr.nnz);
+    if (!infile.good()) {
+        std::cout << "Truncated graph file: " << graphFile << std::endl;
+        return false;
     }
+    infile.close();
+    writer.setAdjs(csc, csr);
 
-    for (unsigned nid = 0; nid < numNodes; ++nid) {
-        std::vector<unsigned>& vids = backwardLocalVtxDsts[nid];
-        for (unsigned i = 0; i < vids.size(); ++i) {
-            if (backwardGhostMap.find(vids[i]) == backwardGhostMap.end()) {
-                backwardGhostMap[vids[i]] = std::vector<unsigned>();
-            }
+    imageSize = writer.imageSize();
+    imageBuf.resize((imageSize + sizeof(unsigned long long) - 1) / sizeof(unsigned long long));
+    image = reinterpret_cast<char *>(imageBuf.data());
+    mapped = false;
+    writer.build(image);
+    attachImage();
 
-            backwardGhostMap[vids[i]].push_back(nid);
-        }
-    }
+    writer.save(graphFile + GRAPH_IMAGE_EXT);
+    return true;
+}
 
-    // CSC representation of graph
-    infile.read(reinterpret_cast<char *>(&forwardAdj.columnCnt), sizeof(unsigned));
-    infile.read(reinterpret_cast<char *>(&forwardAdj.nnz), sizeof(unsigned long long));
-    forwardAdj.values = new EdgeType[forwardAdj.nnz];
-    forwardAdj.locations = new char[forwardAdj.nnz];
-    forwardAdj.columnPtrs = new unsigned long long[localVtxCnt + 1];
-    forwardAdj.rowIdxs = new unsigned[forwardAdj.nnz];
-    infile.read(reinterpret_cast<char *>(forwardAdj.values), sizeof(EdgeType) * forwardAdj.nnz);
-    // infile.read(reinterpret_cast<char *>(forwardAdj.locations), sizeof(char) * forwardAdj.nnz);
-    infile.read(reinterpret_cast<char *>(forwardAdj.columnPtrs), sizeof(unsigned long long) * (localVtxCnt + 1));
-    infile.read(reinterpret_cast<char *>(forwardAdj.rowIdxs), sizeof(unsigned) * forwardAdj.nnz);
+/** Point all the members at their sections of the image. */
+void Graph::attachImage() {
+    const GraphImageHeader &hdr = header();
+    localVtxCnt = hdr.localVtxCnt;
+    globalVtxCnt = hdr.globalVtxCnt;
+    srcGhostCnt = hdr.srcGhostCnt + hdr.mirrorGhostCnt;
+    dstGhostCnt = hdr.dstGhostCnt;
+    localInEdgeCnt = hdr.localInEdgeCnt;
+    localOutEdgeCnt = hdr.localOutEdgeCnt;
+    globalEdgeCnt = hdr.globalEdgeCnt;
 
-    // CSR representation of grpah
-    infile.read(reinterpret_cast<char *>(&backwardAdj.rowCnt), sizeof(unsigned));
-    infile.read(reinterpret_cast<char *>(&backwardAdj.nnz), sizeof(unsigned long long));
-    backwardAdj.values = new EdgeType[backwardAdj.nnz];
-    backwardAdj.locations = new char[backwardAdj.nnz];
-    backwardAdj.rowPtrs = new unsigned long long[localVtxCnt + 1];
-    backwardAdj.columnIdxs = new unsigned[backwardAdj.nnz];
-    infile.read(reinterpret_cast<char *>(backwardAdj.values), sizeof(EdgeType) * backwardAdj.nnz);
-    // infile.read(reinterpret_cast<char *>(backwardAdj.locations), sizeof(char) * backwardAdj.nnz);
-    infile.read(reinterpret_cast<char *>(backwardAdj.rowPtrs), sizeof(unsigned long long) * (localVtxCnt + 1));
-    infile.read(reinterpret_cast<char *>(backwardAdj.columnIdxs), sizeof(unsigned) * backwardAdj.nnz);
+    localToGlobalId = ArrayView<unsigned>(section<unsigned>(IMG_LOCAL_TO_GLOBAL), localVtxCnt);
+    globaltoLocalId.attach(section<unsigned>(IMG_GLOBAL_TO_LOCAL_KEYS),
+                           section<unsigned>(IMG_GLOBAL_TO_LOCAL_VALS), localVtxCnt);
+    vtxDataVec = ArrayView<EdgeType>(section<EdgeType>(IMG_VTX_DATA), localVtxCnt);
+    srcGhostVtcs.attach(section<unsigned>(IMG_SRC_GHOST_KEYS),
+                        section<unsigned>(IMG_SRC_GHOST_VALS), hdr.srcGhostCnt);
+    dstGhostVtcs.attach(section<unsigned>(IMG_DST_GHOST_KEYS),
+                        section<unsigned>(IMG_DST_GHOST_VALS), dstGhostCnt);
 
-    infile.close();
+    const unsigned numNodes = hdr.numNodes;
+    const unsigned long long *fwdPtrs = section<unsigned long long>(IMG_FWD_DSTS_PTRS);
+    const unsigned long long *bwdPtrs = section<unsigned long long>(IMG_BWD_DSTS_PTRS);
+    forwardLocalVtxDsts.clear();
+    backwardLocalVtxDsts.clear();
+    for (unsigned nid = 0; nid < numNodes; ++nid) {
+        forwardLocalVtxDsts.push_back(ArrayView<unsigned>(
+            section<unsigned>(IMG_FWD_DSTS) + fwdPtrs[nid], fwdPtrs[nid + 1] - fwdPtrs[nid]));
+        backwardLocalVtxDsts.push_back(ArrayView<unsigned>(
+            section<unsigned>(IMG_BWD_DSTS) + bwdPtrs[nid], bwdPtrs[nid + 1] - bwdPtrs[nid]));
+    }
+    forwardGhostMap.attach(section<unsigned>(IMG_FWD_GHOST_KEYS),
+                           section<unsigned long long>(IMG_FWD_GHOST_PTRS),
+                           section<unsigned>(IMG_FWD_GHOST_NIDS),
+                           hdr.sections[IMG_FWD_GHOST_KEYS].size / sizeof(unsigned));
+    backwardGhostMap.attach(section<unsigned>(IMG_BWD_GHOST_KEYS),
+                            section<unsigned long long>(IMG_BWD_GHOST_PTRS),
+                            section<unsigned>(IMG_BWD_GHOST_NIDS),
+                            hdr.sections[IMG_BWD_GHOST_KEYS].size / sizeof(unsigned));
+
+    // CSC / CSR arrays are used in place; `locations` was never stored
+    forwardAdj.owned = false;
+    forwardAdj.columnCnt = localVtxCnt;
+    forwardAdj.nnz = localInEdgeCnt;
+    forwardAdj.columnPtrs = section<unsigned long long>(IMG_CSC_PTRS);
+    forwardAdj.rowIdxs = section<unsigned>(IMG_CSC_IDXS);
+    forwardAdj.values = section<EdgeType>(IMG_CSC_VALS);
+    backwardAdj.owned = false;
+    backwardAdj.rowCnt = localVtxCnt;
+    backwardAdj.nnz = localOutEdgeCnt;
+    backwardAdj.rowPtrs = section<unsigned long long>(IMG_CSR_PTRS);
+    backwardAdj.columnIdxs = section<unsigned>(IMG_CSR_IDXS);
+    backwardAdj.values = section<EdgeType>(IMG_CSR_VALS);
+
+    // Mirror sections are empty in images converted from the old format
+    hubThreshold = hdr.hubThreshold;
+    mirrorGhostCnt = hdr.mirrorGhostCnt;
+    mirrorHubCnt = hdr.mirrorHubCnt;
+    const bool hasMirrors = hdr.sections[IMG_MIRROR_GHOST_PTRS].size > 0;
+    mirrorGhostPtrs = ArrayView<unsigned long long>(
+        section<unsigned long long>(IMG_MIRROR_GHOST_PTRS), hasMirrors ? numNodes + 1 : 0);
+    mirrorGhostHubs = ArrayView<unsigned>(section<unsigned>(IMG_MIRROR_GHOST_HUBS), mirrorGhostCnt);
+    mirrorHubPtrs = ArrayView<unsigned long long>(
+        section<unsigned long long>(IMG_MIRROR_HUB_PTRS), hasMirrors ? numNodes + 1 : 0);
+    mirrorHubs = ArrayView<unsigned>(section<unsigned>(IMG_MIRROR_HUBS), mirrorHubCnt);
+    mirrorAdj.owned = false;
+    mirrorAdj.columnCnt = mirrorHubCnt;
+    mirrorAdj.nnz = hdr.mirrorEdgeCnt;
+    mirrorAdj.columnPtrs = section<unsigned long long>(IMG_MIRROR_ADJ_PTRS);
+    mirrorAdj.rowIdxs = section<unsigned>(IMG_MIRROR_ADJ_IDXS);
+    mirrorAdj.values = section<EdgeType>(IMG_MIRROR_ADJ_VALS);
 }
 
 bool Graph::containsVtx(unsigned gvid) {
@@ -133,141 +250,34 @@ void Graph::print() {
             forwardAdj.nnz, backwardAdj.nnz);
 }
 
-Vertex&
-RawGraph::getVertex(unsigned lvid) {
-    assert(lvid < vertices.size());
-    return vertices[lvid];
-}
-
-Vertex&
-RawGraph::getVertexByGlobal(unsigned gvid) {
-    assert(globalToLocalId.find(gvid) != globalToLocalId.end());
-    return vertices[globalToLocalId[gvid]];
-}
-
-bool
-RawGraph::containsVertex(unsigned gvid) {
-    return globalToLocalId.find(gvid) != globalToLocalId.end();
-}
-
-GhostVertex&
-RawGraph::getInEdgeGhostVertex(unsigned gvid) {
-    assert(inEdgeGhostVertices.find(gvid) != inEdgeGhostVertices.end());
-    return inEdgeGhostVertices[gvid];
-}
-
-GhostVertex&
-RawGraph::getOutEdgeGhostVertex(unsigned gvid) {
-    assert(outEdgeGhostVertices.find(gvid) != outEdgeGhostVertices.end());
-    return outEdgeGhostVertices[gvid];
-}
-
-bool
-RawGraph::containsInEdgeGhostVertex(unsigned gvid) {
-    return inEdgeGhostVertices.find(gvid) != inEdgeGhostVertices.end();
-}
-
-bool
-RawGraph::containsOutEdgeGhostVertex(unsigned gvid) {
-    return outEdgeGhostVertices.find(gvid) != outEdgeGhostVertices.end();
-}
-
-
 /**
  *
- * Compact a graph's data. Mainly does the following things:
- *     1. Shrink all the vertices' edges vector.
- *     2. Shrink all the ghost vertices' edges vector.
- *     3. Shrink the vertices and partitions vector.
+ * Write the partition as a graph image (see graph_image.hpp), which
+ * Graph::init maps as is.
  *
  */
-void
-RawGraph::compactGraph() {
-    vertexPartitionIds.shrink_to_fit();
-    vertices.shrink_to_fit();
-
-    for (unsigned i = 0; i < vertices.size(); ++i)
-        vertices[i].compactVertex();
-
-    for (auto it = inEdgeGhostVertices.begin(); it != inEdgeGhostVertices.end(); ++it) {
-        it->second.compactVertex();
-    }
-    for (auto it = outEdgeGhostVertices.begin(); it != outEdgeGhostVertices.end(); ++it) {
-        it->second.compactVertex();
-    }
-}
-
 void
 RawGraph::dump(std::string filename, unsigned numNodes) {
-    std::ofstream outfile(filename, std::ofstream::binary);
-    if (!outfile.good()) {
-        std::cout << "Cannot open output file:" << filename << ", [Reason: " << std::strerror(errno) << "]" << std::endl;
-        return;
-    }
-    // vertex count (local/global/incoming ghost/outgoing ghost)
-    outfile.write(reinterpret_cast<const char*>(&numLocalVertices), sizeof(numLocalVertices));
-    outfile.write(reinterpret_cast<const char*>(&numGlobalVertices), sizeof(numGlobalVertices));
-    outfile.write(reinterpret_cast<const char *>(&numInEdgeGhostVertices), sizeof(numInEdgeGhostVertices));
-    outfile.write(reinterpret_cast<const char *>(&numOutEdgeGhostVertices), sizeof(numOutEdgeGhostVertices));
-    // edge count (local incoming/local outgoing/global)
-    outfile.write(reinterpret_cast<const char*>(&numLocalInEdges), sizeof(numLocalInEdges));
-    outfile.write(reinterpret_cast<const char*>(&numLocalOutEdges), sizeof(numLocalOutEdges));
-    outfile.write(reinterpret_cast<const char*>(&numGlobalEdges), sizeof(numGlobalEdges));
-    // global IDs of local vertices
-    for (unsigned i = 0; i < numLocalVertices; ++i) {
-        unsigned gvid = localToGlobalId[i];
-        outfile.write(reinterpret_cast<const char *>(&gvid), sizeof(unsigned));
-    }
-    // normFactors of local vertices
-    for (unsigned i = 0; i < numLocalVertices; ++i) {
-        EdgeType normFactor = vertices[i].getNormFactor();
-        outfile.write(reinterpret_cast<const char *>(&normFactor), sizeof(normFactor));
-    }
-    // mapping of incoming ghost's global ID to local ID
-    for (auto &itr: inEdgeGhostVertices) {
-        unsigned gvid = itr.first;
-        unsigned lvid = itr.second.getLocalId();
-        outfile.write(reinterpret_cast<const char *>(&gvid), sizeof(unsigned));
-        outfile.write(reinterpret_cast<const char *>(&lvid), sizeof(unsigned));
-    }
-    // mapping of outgoing ghost's global ID to local ID
-    for (auto &itr : outEdgeGhostVertices) {
-        unsigned gvid = itr.first;
-        unsigned lvid = itr.second.getLocalId();
-        outfile.write(reinterpret_cast<const char *>(&gvid), sizeof(unsigned));
-        outfile.write(reinterpret_cast<const char *>(&lvid), sizeof(unsigned));
-    }
-    outfile.write(reinterpret_cast<const char *>(&numNodes), sizeof(unsigned));
-    // local vertices send out destinations during forward
-    for (unsigned i = 0; i < numNodes; ++i) {
-        unsigned size = forwardGhostsList[i].size();
-        outfile.write(reinterpret_cast<const char *>(&size), sizeof(unsigned));
-        outfile.write(reinterpret_cast<const char *>(forwardGhostsList[i].data()), sizeof(unsigned) * size);
-    }
-    // local vertices send out destinations during backward
-    for (unsigned i = 0; i < numNodes; ++i) {
-        unsigned size = backwardGhostsList[i].size();
-        outfile.write(reinterpret_cast<const char *>(&size), sizeof(unsigned));
-        outfile.write(reinterpret_cast<const char *>(backwardGhostsList[i].data()), sizeof(unsigned) * size);
-    }
-
-    // CSC representation of graph
-    outfile.write(reinterpret_cast<const char *>(&forwardAdj.columnCnt), sizeof(unsigned));
-    outfile.write(reinterpret_cast<const char *>(&forwardAdj.nnz), sizeof(unsigned long long));
-    outfile.write(reinterpret_cast<const char *>(forwardAdj.values), sizeof(EdgeType) * forwardAdj.nnz);
-    // outfile.write(reinterpret_cast<const char *>(forwardAdj.locations), sizeof(char) * forwardAdj.nnz);
-    outfile.write(reinterpret_cast<const char *>(forwardAdj.columnPtrs), sizeof(unsigned long long) * (numLocalVertices + 1));
-    outfile.write(reinterpret_cast<const char *>(forwardAdj.rowIdxs), sizeof(unsigned) * forwardAdj.nnz);
-
-    // CSR representation of graph
-    outfile.write(reinterpret_cast<const char *>(&backwardAdj.rowCnt), sizeof(unsigned));
-    outfile.write(reinterpret_cast<const char *>(&backwardAdj.nnz), sizeof(unsigned long long));
-    outfile.write(reinterpret_cast<const char *>(backwardAdj.values), sizeof(EdgeType) * backwardAdj.nnz);
-    // outfile.write(reinterpret_cast<const char *>(backwardAdj.locations), sizeof(char) * backwardAdj.nnz);
-    outfile.write(reinterpret_cast<const char *>(backwardAdj.rowPtrs), sizeof(unsigned long long) * (numLocalVertices + 1));
-    outfile.write(reinterpret_cast<const char *>(backwardAdj.columnIdxs), sizeof(unsigned) * backwardAdj.nnz);
+    GraphImageWriter writer;
+    // global IDs and normFactors of local vertices
+    writer.setVertices(numLocalVertices, numGlobalVertices, localToGlobalId.data(), normFactors.data());
+    writer.setEdgeCounts(numLocalInEdges, numLocalOutEdges, numGlobalEdges);
+    // mapping of incoming / outgoing ghost's global ID to local ID
+    std::vector<std::pair<unsigned, unsigned>> inGhosts, outGhosts;
+    for (unsigned i = 0; i < inEdgeGhostVertices.size(); ++i)
+        inGhosts.push_back(std::make_pair(inEdgeGhostVertices[i], numLocalVertices + i));
+    for (unsigned i = 0; i < outEdgeGhostVertices.size(); ++i)
+        outGhosts.push_back(std::make_pair(outEdgeGhostVertices[i], numLocalVertices + i));
+    writer.setGhostVtcs(PROP_TYPE::FORWARD, inGhosts);
+    writer.setGhostVtcs(PROP_TYPE::BACKWARD, outGhosts);
+    // local vertices send out destinations during forward / backward
+    writer.setLocalVtxDsts(PROP_TYPE::FORWARD, numNodes, forwardGhostsList);
+    writer.setLocalVtxDsts(PROP_TYPE::BACKWARD, numNodes, backwardGhostsList);
+    // CSC / CSR representation of graph
+    writer.setAdjs(forwardAdj, backwardAdj);
+    writer.setMirrors(hubThreshold, numNodes, mirrorGhostPtrs, mirrorGhostHubs,
+                      mirrorHubPtrs, mirrorHubs, mirrorAdj);
+    writer.setInputs(edgesStamp, partsStamp, undirected);
 
-    outfile.close();
-    // set file permission to 777 to allow accesses from other users
-    chmod(filename.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+    writer.save(filename);
 }
@@ -2,12 +2,14 @@
 #define __GRAPH_HPP__
 
 
+#include <algorithm>
+#include <cassert>
 #include <vector>
-#include <map>
+#include <string>
 #include "../parallel/lock.hpp"
 #include "../utils/utils.hpp"
-#include "vertex.hpp"
-#include "edge.hpp"
+#include "../utils/vid_map.hpp"
+#include "graph_image.hpp"
 
 class Graph;
 class RawGraph;
@@ -15,14 +17,14 @@ class RawGraph;
 template<typename T>
 class CSCMatrix {
 public:
-    CSCMatrix() : columnCnt(0), nnz(0), values(NULL), locations(NULL), columnPtrs(NULL), rowIdxs(NULL) {};
+    CSCMatrix() : columnCnt(0), nnz(0), values(NULL), locations(NULL), columnPtrs(NULL), rowIdxs(NULL), owned(true) {};
     ~CSCMatrix() {
+        if (!owned)     { return; }
         if (values)     { delete[] values; }
         if (locations)  { delete[] locations; }
         if (columnPtrs) { delete[] columnPtrs; }
         if (rowIdxs)    { delete[] rowIdxs; }
     };
-    void init(RawGraph &rgraph);
 
     unsigned columnCnt;
     unsigned long long nnz;         // number of non-zero elements
@@ -30,19 +32,20 @@ public:
     char *locations;                // edge locations vector
     unsigned long long *columnPtrs; // pointers to the start of each column
     unsigned *rowIdxs;              // indices of nz elements in each column
+    bool owned;                     // false if the arrays live in a mapped image
 };
 
 template<typename T>
 class CSRMatrix {
 public:
-    CSRMatrix() : rowCnt(0), nnz(0), values(NULL), locations(NULL), rowPtrs(NULL), columnIdxs(NULL) {};
+    CSRMatrix() : rowCnt(0), nnz(0), values(NULL), locations(NULL), rowPtrs(NULL), columnIdxs(NULL), owned(true) {};
     ~CSRMatrix() {
+        if (!owned)     { return; }
         if (values)     { delete[] values; }
         if (locations)  { delete[] locations; }
         if (rowPtrs)    { delete[] rowPtrs; }
         if (columnIdxs) { delete[] columnIdxs; }
     };
-    void init(RawGraph &rgraph);
 
     unsigned rowCnt;
     unsigned long long nnz;      // number of non-zero elements
@@ -50,16 +53,146 @@ public:
     char *locations;             // edge locations vector
     unsigned long long *rowPtrs; // pointers to the start of each row
     unsigned *columnIdxs;        // indices of nz elements in each row
+    bool owned;                  // false if the arrays live in a mapped image
 };
 
 /**
  *
- * Class of a graph, composed of vertices and directed edges.
+ * Non-owning view of a flat array inside a partition image.
+ *
+ */
+template<typename T>
+class ArrayView {
+public:
+    ArrayView() : ptr(NULL), cnt(0) {};
+    ArrayView(T *_ptr, size_t _cnt) : ptr(_ptr), cnt(_cnt) {};
+
+    T &operator[](size_t i) const { return ptr[i]; }
+    T *data() const { return ptr; }
+    size_t size() const { return cnt; }
+    bool empty() const { return cnt == 0; }
+    T *begin() const { return ptr; }
+    T *end() const { return ptr + cnt; }
+
+private:
+    T *ptr;
+    size_t cnt;
+};
+
+/** Iterator over a sorted flat map, exposing `first` / `second` like std::map. */
+template<typename Map>
+class FlatMapIterator {
+public:
+    typedef typename Map::Entry Entry;
+    FlatMapIterator(const Map *_map, size_t _idx) : map(_map), idx(_idx) { load(); }
+
+    const Entry &operator*() const { return entry; }
+    const Entry *operator->() const { return &entry; }
+    FlatMapIterator &operator++() { ++idx; load(); return *this; }
+    bool operator==(const FlatMapIterator &rhs) const { return idx == rhs.idx; }
+    bool operator!=(const FlatMapIterator &rhs) const { return idx != rhs.idx; }
+
+private:
+    void load() { if (idx < map->size()) entry = map->entryAt(idx); }
+
+    const Map *map;
+    size_t idx;
+    Entry entry;
+};
+
+/**
+ *
+ * Read-only map from a vertex ID to another, stored as sorted keys and
+ * their values. Lookups are binary searches over the mapped arrays.
+ *
+ */
+class IdMap {
+public:
+    struct Entry { unsigned first; unsigned second; };
+    typedef FlatMapIterator<IdMap> iterator;
+
+    IdMap() : keys(NULL), vals(NULL), cnt(0) {};
+    void attach(const unsigned *_keys, const unsigned *_vals, size_t _cnt) {
+        keys = _keys; vals = _vals; cnt = _cnt;
+    }
+
+    size_t size() const { return cnt; }
+    Entry entryAt(size_t i) const { Entry e = { keys[i], vals[i] }; return e; }
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, cnt); }
+    iterator lower_bound(unsigned key) const {
+        return iterator(this, std::lower_bound(keys, keys + cnt, key) - keys);
+    }
+    iterator find(unsigned key) const {
+        size_t i = std::lower_bound(keys, keys + cnt, key) - keys;
+        return iterator(this, (i < cnt && keys[i] == key) ? i : cnt);
+    }
+    size_t count(unsigned key) const { return find(key) != end() ? 1 : 0; }
+    unsigned operator[](unsigned key) const {
+        iterator found = find(key);
+        assert(found != end());
+        return found->second;
+    }
+
+private:
+    const unsigned *keys;
+    const unsigned *vals;
+    size_t cnt;
+};
+
+/**
+ *
+ * Read-only map from a boundary vertex to the nodes it is sent to. This is
+ * the precomputed send list of the partition: sorted lvids, CSR-style
+ * pointers and the receiver node IDs.
+ *
+ */
+class GhostMap {
+public:
+    struct Entry { unsigned first; ArrayView<const unsigned> second; };
+    typedef FlatMapIterator<GhostMap> iterator;
+
+    GhostMap() : keys(NULL), ptrs(NULL), nids(NULL), cnt(0) {};
+    void attach(const unsigned *_keys, const unsigned long long *_ptrs,
+                const unsigned *_nids, size_t _cnt) {
+        keys = _keys; ptrs = _ptrs; nids = _nids; cnt = _cnt;
+    }
+
+    size_t size() const { return cnt; }
+    Entry entryAt(size_t i) const {
+        Entry e = { keys[i], ArrayView<const unsigned>(nids + ptrs[i], ptrs[i + 1] - ptrs[i]) };
+        return e;
+    }
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, cnt); }
+    iterator lower_bound(unsigned key) const {
+        return iterator(this, std::lower_bound(keys, keys + cnt, key) - keys);
+    }
+    iterator find(unsigned key) const {
+        size_t i = std::lower_bound(keys, keys + cnt, key) - keys;
+        return iterator(this, (i < cnt && keys[i] == key) ? i : cnt);
+    }
+
+private:
+    const unsigned *keys;
+    const unsigned long long *ptrs;
+    const unsigned *nids;
+    size_t cnt;
+};
+
+/**
+ *
+ * Class of a graph, composed of vertices and directed edges. The partition
+ * is a single image (see graph_image.hpp) that is mmap'ed as is; all the
+ * members below are views into it, so init() does no parsing at all.
  *
  */
 class Graph {
 public:
-    void init(std::string graphFile);
+    Graph() : image(NULL), imageSize(0), mapped(false) {};
+    ~Graph();
+    // False if the partition cannot be loaded (the reason is printed)
+    bool init(std::string graphFile);
     bool containsVtx(unsigned gvid);
     bool containsSrcGhostVtx(unsigned gvid);
     bool containsDstGhostVtx(unsigned gvid);
@@ -69,74 +202,101 @@ public:
     // vtx cnt
     unsigned localVtxCnt;
     unsigned globalVtxCnt;
-    unsigned srcGhostCnt;
+    unsigned srcGhostCnt;           // ghost rows, incl. the mirror rows
     unsigned dstGhostCnt;
     // edg cnt
     unsigned long long localInEdgeCnt = 0;
     unsigned long long localOutEdgeCnt = 0;
     unsigned long long globalEdgeCnt = 0;
     // local vertices
-    std::vector<unsigned> localToGlobalId;
-    std::map<unsigned, unsigned> globaltoLocalId;
-    std::vector<EdgeType> vtxDataVec;
+    ArrayView<unsigned> localToGlobalId;
+    IdMap globaltoLocalId;
+    ArrayView<EdgeType> vtxDataVec;
     // local vertex outgoing destinations
-    std::vector<std::vector<unsigned>> forwardLocalVtxDsts;
-    std::vector<std::vector<unsigned>> backwardLocalVtxDsts;
+    std::vector<ArrayView<unsigned>> forwardLocalVtxDsts;
+    std::vector<ArrayView<unsigned>> backwardLocalVtxDsts;
 
     // Outoing dests for pipelining
-    std::map<unsigned, std::vector<unsigned>> forwardGhostMap;
-    std::map<unsigned, std::vector<unsigned>> backwardGhostMap;
+    GhostMap forwardGhostMap;
+    GhostMap backwardGhostMap;
 
     // incoming edge ghost vertices
-    std::map<unsigned, unsigned> srcGhostVtcs;
-    // std::vector<unsigned> srcGhostDataVec;
+    IdMap srcGhostVtcs;
     // outgoing edge ghost vertices
-    std::map<unsigned, unsigned> dstGhostVtcs;
-    // std::vector<unsigned> dstGhostDataVec;
+    IdMap dstGhostVtcs;
     // ajacency matrices
     CSCMatrix<EdgeType> forwardAdj;
     CSRMatrix<EdgeType> backwardAdj;
+
+    // Hybrid cut (see DataLoader). The last mirrorGhostCnt src ghost rows
+    // hold the partial aggregates other nodes send for my hubs: node n's
+    // rows are mirrorGhostHubs[mirrorGhostPtrs[n] .. mirrorGhostPtrs[n + 1]),
+    // each with a single edge of weight 1 into its hub's CSC column.
+    unsigned hubThreshold = 0;
+    unsigned mirrorGhostCnt = 0;
+    ArrayView<unsigned long long> mirrorGhostPtrs;
+    ArrayView<unsigned> mirrorGhostHubs;
+    // Remote hubs I compute partial aggregates of, grouped by their master
+    // node like the ghost rows above; column i of mirrorAdj is mirrorHubs[i].
+    unsigned mirrorHubCnt = 0;
+    ArrayView<unsigned long long> mirrorHubPtrs;
+    ArrayView<unsigned> mirrorHubs;
+    CSCMatrix<EdgeType> mirrorAdj;
+
+private:
+    bool mapImage(const std::string &filename);
+    bool loadLegacy(const std::string &filename);
+    void attachImage();
+    template<typename T>
+    T *section(GraphImageSection sec) {
+        return reinterpret_cast<T *>(image + header().sections[sec].offset);
+    }
+    const GraphImageHeader &header() {
+        return *reinterpret_cast<const GraphImageHeader *>(image);
+    }
+
+    char *image;
+    size_t imageSize;
+    bool mapped;                                // else image is in imageBuf
+    std::vector<unsigned long long> imageBuf;
 };
 
+/**
+ *
+ * Partition being preprocessed, already in the layout it is dumped in: local
+ * vertices first, then the ghost vertices of each direction numbered in gvid
+ * order, and the edges as CSC / CSR.
+ *
+ */
 class RawGraph {
 public:
-
-    std::vector<Vertex>& getVertices() { return vertices; }
-    Vertex& getVertex(unsigned lvid);
-    Vertex& getVertexByGlobal(unsigned gvid);
-    bool containsVertex(unsigned gvid);   // Contain searches with global ID.
-
-    std::map<unsigned, GhostVertex>& getInEdgeGhostVertices()  { return inEdgeGhostVertices; }
-    std::map<unsigned, GhostVertex>& getOutEdgeGhostVertices() { return outEdgeGhostVertices; }
-    GhostVertex& getInEdgeGhostVertex(unsigned gvid);
-    GhostVertex& getOutEdgeGhostVertex(unsigned gvid);
-    bool containsInEdgeGhostVertex(unsigned gvid);
-    bool containsOutEdgeGhostVertex(unsigned gvid);
+    RawGraph() : forwardGhostsList(NULL), backwardGhostsList(NULL) {};
 
     unsigned getNumLocalVertices() { return numLocalVertices; }
     void setNumLocalVertices(unsigned num) { numLocalVertices = num; }
     unsigned getNumGlobalVertices() { return numGlobalVertices; }
     void setNumGlobalVertices(unsigned num) { numGlobalVertices = num; }
-    unsigned getNumInEdgeGhostVertices()  { return numInEdgeGhostVertices; }
-    unsigned getNumOutEdgeGhostVertices() { return numOutEdgeGhostVertices; }
-    void setNumInEdgeGhostVertices(unsigned num)  { numInEdgeGhostVertices = num; }
-    void setNumOutEdgeGhostVertices(unsigned num) { numOutEdgeGhostVertices = num; }
 
     unsigned long long getNumLocalInEdges() { return numLocalInEdges; }
-    void incrementNumLocalInEdges() { ++numLocalInEdges; }
+    void setNumLocalInEdges(unsigned long long num) { numLocalInEdges = num; }
     unsigned long long getNumLocalOutEdges() { return numLocalOutEdges; }
-    void incrementNumLocalOutEdges() { ++numLocalOutEdges; }
+    void setNumLocalOutEdges(unsigned long long num) { numLocalOutEdges = num; }
     unsigned long long getNumGlobalEdges() { return numGlobalEdges; }
-    void incrementNumGlobalEdges() { ++numGlobalEdges; }
+    void setNumGlobalEdges(unsigned long long num) { numGlobalEdges = num; }
 
     short getVertexPartitionId(unsigned vid) { return vertexPartitionIds[vid]; }
     void appendVertexPartitionId(short pid) { vertexPartitionIds.push_back(pid); }
 
-    void compactGraph();
     void dump(std::string filename, unsigned numNodes);
 
-    std::map<unsigned, unsigned> globalToLocalId;
-    std::map<unsigned, unsigned> localToGlobalId;
+    VidMap<unsigned> globalToLocalId;
+    std::vector<unsigned> localToGlobalId;
+    std::vector<EdgeType> normFactors;
+
+    // Sorted gvids of the ghosts of incoming / outgoing edges. The ghost at
+    // index i has local ID numLocalVertices + i.
+    std::vector<unsigned> inEdgeGhostVertices;
+    std::vector<unsigned> outEdgeGhostVertices;
 
     std::vector<unsigned> *forwardGhostsList;
     std::vector<unsigned> *backwardGhostsList;
@@ -144,16 +304,22 @@ public:
     CSCMatrix<EdgeType> forwardAdj;
     CSRMatrix<EdgeType> backwardAdj;
 
-private:
+    // Hybrid cut, as in Graph
+    unsigned hubThreshold = 0;
+    std::vector<unsigned long long> mirrorGhostPtrs;
+    std::vector<unsigned> mirrorGhostHubs;
+    std::vector<unsigned long long> mirrorHubPtrs;
+    std::vector<unsigned> mirrorHubs;
+    CSCMatrix<EdgeType> mirrorAdj;
 
-    std::vector<Vertex> vertices;
-    std::map<unsigned, GhostVertex> inEdgeGhostVertices;
-    std::map<unsigned, GhostVertex> outEdgeGhostVertices;
+    // Inputs preprocessed, recorded in the image
+    FileStamp edgesStamp = { 0, 0 };
+    FileStamp partsStamp = { 0, 0 };
+    bool undirected = false;
 
-    unsigned numLocalVertices;
-    unsigned numGlobalVertices;
-    unsigned numInEdgeGhostVertices;
-    unsigned numOutEdgeGhostVertices;
+private:
+    unsigned numLocalVertices = 0;
+    unsigned numGlobalVertices = 0;
 
     // Local Edge: the src vertex locates on the local machine.
     unsigned long long numLocalInEdges = 0;
@@ -163,55 +329,4 @@ private:
     std::vector<short> vertexPartitionIds;
 };
 
-
-template<typename T>
-void CSCMatrix<T>::init(RawGraph &rgraph) {
-    columnCnt = rgraph.getNumLocalVertices();
-    nnz = rgraph.getNumLocalInEdges();
-
-    values = new T[nnz];
-    locations = new char[nnz];
-    columnPtrs = new unsigned long long[columnCnt + 1];
-    rowIdxs = new unsigned [nnz];
-
-    columnPtrs[0] = 0;
-    unsigned long long edgItr = 0;
-    for (unsigned lvid = 0; lvid < columnCnt; ++lvid) {
-        Vertex &v = rgraph.getVertex(lvid);
-        const unsigned edgsCnt = v.getNumInEdges();
-        columnPtrs[lvid + 1] = columnPtrs[lvid] + edgsCnt;
-        for (unsigned veItr = 0; veItr < edgsCnt; ++veItr) {
-            InEdge &vie = v.getInEdge(veItr);
-            values[edgItr] = static_cast<T>(vie.getData());
-            rowIdxs[edgItr] = v.getSourceVertexLocalId(veItr);
-            ++edgItr;
-        }
-    }
-}
-
-template<typename T>
-void CSRMatrix<T>::init(RawGraph &rgraph) {
-    rowCnt = rgraph.getNumLocalVertices();
-    nnz = rgraph.getNumLocalOutEdges();
-
-    values = new T[nnz];
-    locations = new char[nnz];
-    rowPtrs = new unsigned long long[rowCnt + 1];
-    columnIdxs = new unsigned[nnz];
-
-    rowPtrs[0] = 0;
-    unsigned long long edgItr = 0;
-    for (unsigned lvid = 0; lvid < rowCnt; ++lvid) {
-        Vertex &v = rgraph.getVertex(lvid);
-        const unsigned edgsCnt = v.getNumOutEdges();
-        rowPtrs[lvid + 1] = rowPtrs[lvid] + edgsCnt;
-        for (unsigned veItr = 0; veItr < edgsCnt; ++veItr) {
-            OutEdge &voe = v.getOutEdge(veItr);
-            values[edgItr] = static_cast<T>(voe.getData());
-            columnIdxs[edgItr] = v.getDestVertexLocalId(veItr);
-            ++edgItr;
-        }
-    }
-}
-
 #endif //__GRAPH_HPP__
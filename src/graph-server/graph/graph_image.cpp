@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include "graph_image.hpp"
+#include "graph.hpp"
+
+
+static unsigned long long alignUp(unsigned long long off) {
+    return (off + GRAPH_IMAGE_ALIGN - 1) / GRAPH_IMAGE_ALIGN * GRAPH_IMAGE_ALIGN;
+}
+
+bool isGraphImage(const std::string &filename) {
+    std::ifstream infile(filename.c_str(), std::ios::binary);
+    unsigned magic = 0;
+    infile.read(reinterpret_cast<char *>(&magic), sizeof(unsigned));
+    return infile.good() && magic == GRAPH_IMAGE_MAGIC;
+}
+
+/** Last entry of a u64 ptrs section, i.e. the element count it spans. */
+static unsigned long long ptrsEnd(const char *image, GraphImageSection sec) {
+    const GraphImageHeader &header = *reinterpret_cast<const GraphImageHeader *>(image);
+    const GraphImageSectionEntry &entry = header.sections[sec];
+    if (entry.size < sizeof(unsigned long long))
+        return 0;
+    const unsigned long long *ptrs =
+        reinterpret_cast<const unsigned long long *>(image + entry.offset);
+    return ptrs[entry.size / sizeof(unsigned long long) - 1];
+}
+
+bool validGraphImage(const char *image, unsigned long long size) {
+    if (size < sizeof(GraphImageHeader))
+        return false;
+    const GraphImageHeader &header = *reinterpret_cast<const GraphImageHeader *>(image);
+    if (header.magic != GRAPH_IMAGE_MAGIC)
+        return false;
+    if (header.version != GRAPH_IMAGE_VERSION) {
+        std::cout << "Unsupported graph image version " << header.version
+                  << " (expected " << GRAPH_IMAGE_VERSION << ")" << std::endl;
+        return false;
+    }
+    if (header.edgeTypeSize != sizeof(EdgeType) || header.totalSize != size)
+        return false;
+    for (unsigned i = 0; i < IMG_NUM_SECTIONS; ++i) {
+        const GraphImageSectionEntry &sec = header.sections[i];
+        if (sec.offset % GRAPH_IMAGE_ALIGN != 0 || sec.offset > size ||
+            sec.size > size - sec.offset)
+            return false;
+    }
+
+    // Every section holds as many elements as the header, or the last entry
+    // of its ptrs section, says
+    const unsigned long long U = sizeof(unsigned);
+    const unsigned long long P = sizeof(unsigned long long);
+    const unsigned long long E = sizeof(EdgeType);
+    const unsigned long long lv = header.localVtxCnt;
+    const unsigned long long nodePtrs = header.numNodes + 1ull;
+    const unsigned long long fwdKeys = header.sections[IMG_FWD_GHOST_KEYS].size / U;
+    const unsigned long long bwdKeys = header.sections[IMG_BWD_GHOST_KEYS].size / U;
+    std::vector<std::pair<GraphImageSection, unsigned long long>> expected = {
+        { IMG_LOCAL_TO_GLOBAL, U * lv },
+        { IMG_GLOBAL_TO_LOCAL_KEYS, U * lv },
+        { IMG_GLOBAL_TO_LOCAL_VALS, U * lv },
+        { IMG_VTX_DATA, E * lv },
+        { IMG_SRC_GHOST_KEYS, U * header.srcGhostCnt },
+        { IMG_SRC_GHOST_VALS, U * header.srcGhostCnt },
+        { IMG_DST_GHOST_KEYS, U * header.dstGhostCnt },
+        { IMG_DST_GHOST_VALS, U * header.dstGhostCnt },
+        { IMG_FWD_DSTS_PTRS, P * nodePtrs },
+        { IMG_FWD_DSTS, U * ptrsEnd(image, IMG_FWD_DSTS_PTRS) },
+        { IMG_BWD_DSTS_PTRS, P * nodePtrs },
+        { IMG_BWD_DSTS, U * ptrsEnd(image, IMG_BWD_DSTS_PTRS) },
+        { IMG_FWD_GHOST_PTRS, P * (fwdKeys + 1) },
+        { IMG_FWD_GHOST_NIDS, U * ptrsEnd(image, IMG_FWD_GHOST_PTRS) },
+        { IMG_BWD_GHOST_PTRS, P * (bwdKeys + 1) },
+        { IMG_BWD_GHOST_NIDS, U * ptrsEnd(image, IMG_BWD_GHOST_PTRS) },
+        { IMG_CSC_PTRS, P * (lv + 1) },
+        { IMG_CSC_IDXS, U * header.localInEdgeCnt },
+        { IMG_CSC_VALS, E * header.localInEdgeCnt },
+        { IMG_CSR_PTRS, P * (lv + 1) },
+        { IMG_CSR_IDXS, U * header.localOutEdgeCnt },
+        { IMG_CSR_VALS, E * header.localOutEdgeCnt },
+    };
+    // Images converted from the old format have no mirror sections at all
+    if (header.sections[IMG_MIRROR_GHOST_PTRS].size > 0) {
+        expected.insert(expected.end(), {
+            { IMG_MIRROR_GHOST_PTRS, P * nodePtrs },
+            { IMG_MIRROR_GHOST_HUBS, U * header.mirrorGhostCnt },
+            { IMG_MIRROR_HUB_PTRS, P * nodePtrs },
+            { IMG_MIRROR_HUBS, U * header.mirrorHubCnt },
+            { IMG_MIRROR_ADJ_PTRS, P * (header.mirrorHubCnt + 1ull) },
+            { IMG_MIRROR_ADJ_IDXS, U * header.mirrorEdgeCnt },
+            { IMG_MIRROR_ADJ_VALS, E * header.mirrorEdgeCnt },
+        });
+    } else if (header.mirrorGhostCnt != 0 || header.mirrorHubCnt != 0 ||
+               header.mirrorEdgeCnt != 0) {
+        return false;
+    }
+    for (auto &sec : expected) {
+        if (header.sections[sec.first].size != sec.second)
+            return false;
+    }
+    // The ptrs of the adjacencies end at the edge counts of the header
+    if (ptrsEnd(image, IMG_CSC_PTRS) != header.localInEdgeCnt ||
+        ptrsEnd(image, IMG_CSR_PTRS) != header.localOutEdgeCnt)
+        return false;
+    if (header.sections[IMG_MIRROR_GHOST_PTRS].size > 0 &&
+        (ptrsEnd(image, IMG_MIRROR_GHOST_PTRS) != header.mirrorGhostCnt ||
+         ptrsEnd(image, IMG_MIRROR_HUB_PTRS) != header.mirrorHubCnt ||
+         ptrsEnd(image, IMG_MIRROR_ADJ_PTRS) != header.mirrorEdgeCnt))
+        return false;
+    return true;
+}
+
+
+GraphImageWriter::GraphImageWriter() {
+    memset(&header, 0, sizeof(header));
+    header.magic = GRAPH_IMAGE_MAGIC;
+    header.version = GRAPH_IMAGE_VERSION;
+    header.edgeTypeSize = sizeof(EdgeType);
+    for (unsigned i = 0; i < IMG_NUM_SECTIONS; ++i)
+        srcs[i] = NULL;
+}
+
+void GraphImageWriter::setVertices(unsigned localVtxCnt, unsigned globalVtxCnt,
+                                   const unsigned *localToGlobal,
+                                   const EdgeType *vtxData) {
+    header.localVtxCnt = localVtxCnt;
+    header.globalVtxCnt = globalVtxCnt;
+    borrow(IMG_LOCAL_TO_GLOBAL, localToGlobal, localVtxCnt);
+    borrow(IMG_VTX_DATA, vtxData, localVtxCnt);
+
+    std::vector<std::pair<unsigned, unsigned>> g2l(localVtxCnt);
+    for (unsigned lvid = 0; lvid < localVtxCnt; ++lvid)
+        g2l[lvid] = std::make_pair(localToGlobal[lvid], lvid);
+    std::sort(g2l.begin(), g2l.end());
+    g2lKeys.resize(localVtxCnt);
+    g2lVals.resize(localVtxCnt);
+    for (unsigned i = 0; i < localVtxCnt; ++i) {
+        g2lKeys[i] = g2l[i].first;
+        g2lVals[i] = g2l[i].second;
+    }
+    own(IMG_GLOBAL_TO_LOCAL_KEYS, g2lKeys);
+    own(IMG_GLOBAL_TO_LOCAL_VALS, g2lVals);
+}
+
+void GraphImageWriter::setEdgeCounts(unsigned long long localInEdgeCnt,
+                                     unsigned long long localOutEdgeCnt,
+                                     unsigned long long globalEdgeCnt) {
+    header.localInEdgeCnt = localInEdgeCnt;
+    header.localOutEdgeCnt = localOutEdgeCnt;
+    header.globalEdgeCnt = globalEdgeCnt;
+}
+
+void GraphImageWriter::setGhostVtcs(PROP_TYPE dir,
+                                    std::vector<std::pair<unsigned, unsigned>> &ghosts) {
+    std::sort(ghosts.begin(), ghosts.end());
+    std::vector<unsigned> &keys = ghostKeys[dir];
+    std::vector<unsigned> &vals = ghostVals[dir];
+    keys.resize(ghosts.size());
+    vals.resize(ghosts.size());
+    for (unsigned i = 0; i < ghosts.size(); ++i) {
+        keys[i] = ghosts[i].first;
+        vals[i] = ghosts[i].second;
+    }
+    if (dir == PROP_TYPE::FORWARD) {
+        header.srcGhostCnt = ghosts.size();
+        own(IMG_SRC_GHOST_KEYS, keys);
+        own(IMG_SRC_GHOST_VALS, vals);
+    } else {
+        header.dstGhostCnt = ghosts.size();
+        own(IMG_DST_GHOST_KEYS, keys);
+        own(IMG_DST_GHOST_VALS, vals);
+    }
+}
+
+/**
+ *
+ * Flatten the per node destination lists and invert them into the ghost
+ * map (boundary lvid -> receiving nodes) the scatter works on.
+ *
+ */
+void GraphImageWriter::setLocalVtxDsts(PROP_TYPE dir, unsigned numNodes,
+                                       const std::vector<unsigned> *lists) {
+    header.numNodes = numNodes;
+    std::vector<unsigned long long> &ptrs = dstsPtrs[dir];
+    std::vector<unsigned> &flat = dsts[dir];
+    ptrs.assign(numNodes + 1, 0);
+    for (unsigned nid = 0; nid < numNodes; ++nid)
+        ptrs[nid + 1] = ptrs[nid] + lists[nid].size();
+    flat.resize(ptrs[numNodes]);
+    std::vector<std::pair<unsigned, unsigned>> pairs(ptrs[numNodes]);
+    for (unsigned nid = 0; nid < numNodes; ++nid) {
+        std::copy(lists[nid].begin(), lists[nid].end(), flat.begin() + ptrs[nid]);
+        for (unsigned long long i = 0; i < lists[nid].size(); ++i)
+            pairs[ptrs[nid] + i] = std::make_pair(lists[nid][i], nid);
+    }
+
+    // Receivers of a vertex stay in node order, as the per node lists are
+    std::sort(pairs.begin(), pairs.end());
+    std::vector<unsigned> &keys = ghostMapKeys[dir];
+    std::vector<unsigned long long> &mapPtrs = ghostMapPtrs[dir];
+    std::vector<unsigned> &nids = ghostMapNids[dir];
+    keys.clear();
+    mapPtrs.assign(1, 0);
+    nids.resize(pairs.size());
+    for (unsigned long long i = 0; i < pairs.size(); ++i) {
+        if (keys.empty() || keys.back() != pairs[i].first) {
+            if (!keys.empty())
+                mapPtrs.push_back(i);
+            keys.push_back(pairs[i].first);
+        }
+        nids[i] = pairs[i].second;
+    }
+    if (!keys.empty())
+        mapPtrs.push_back(pairs.size());
+
+    if (dir == PROP_TYPE::FORWARD) {
+        own(IMG_FWD_DSTS_PTRS, ptrs);
+        own(IMG_FWD_DSTS, flat);
+        own(IMG_FWD_GHOST_KEYS, keys);
+        own(IMG_FWD_GHOST_PTRS, mapPtrs);
+        own(IMG_FWD_GHOST_NIDS, nids);
+    } else {
+        own(IMG_BWD_DSTS_PTRS, ptrs);
+        own(IMG_BWD_DSTS, flat);
+        own(IMG_BWD_GHOST_KEYS, keys);
+        own(IMG_BWD_GHOST_PTRS, mapPtrs);
+        own(IMG_BWD_GHOST_NIDS, nids);
+    }
+}
+
+void GraphImageWriter::setAdjs(const CSCMatrix<EdgeType> &csc,
+                               const CSRMatrix<EdgeType> &csr) {
+    assert(csc.columnCnt == header.localVtxCnt && csr.rowCnt == header.localVtxCnt);
+    borrow(IMG_CSC_PTRS, csc.columnPtrs, csc.columnCnt + 1);
+    borrow(IMG_CSC_IDXS, csc.rowIdxs, csc.nnz);
+    borrow(IMG_CSC_VALS, csc.values, csc.nnz);
+    borrow(IMG_CSR_PTRS, csr.rowPtrs, csr.rowCnt + 1);
+    borrow(IMG_CSR_IDXS, csr.columnIdxs, csr.nnz);
+    borrow(IMG_CSR_VALS, csr.values, csr.nnz);
+}
+
+void GraphImageWriter::setMirrors(unsigned hubThreshold, unsigned numNodes,
+                                  const std::vector<unsigned long long> &ghostPtrs,
+                                  const std::vector<unsigned> &ghostHubs,
+                                  const std::vector<unsigned long long> &hubPtrs,
+                                  const std::vector<unsigned> &hubs,
+                                  const CSCMatrix<EdgeType> &adj) {
+    assert(ghostPtrs.size() == numNodes + 1 && hubPtrs.size() == numNodes + 1);
+    assert(adj.columnCnt == hubs.size());
+    header.hubThreshold = hubThreshold;
+    header.mirrorGhostCnt = ghostHubs.size();
+    header.mirrorHubCnt = hubs.size();
+    header.mirrorEdgeCnt = adj.nnz;
+    borrow(IMG_MIRROR_GHOST_PTRS, ghostPtrs.data(), ghostPtrs.size());
+    borrow(IMG_MIRROR_GHOST_HUBS, ghostHubs.data(), ghostHubs.size());
+    borrow(IMG_MIRROR_HUB_PTRS, hubPtrs.data(), hubPtrs.size());
+    borrow(IMG_MIRROR_HUBS, hubs.data(), hubs.size());
+    borrow(IMG_MIRROR_ADJ_PTRS, adj.columnPtrs, adj.columnCnt + 1);
+    borrow(IMG_MIRROR_ADJ_IDXS, adj.rowIdxs, adj.nnz);
+    borrow(IMG_MIRROR_ADJ_VALS, adj.values, adj.nnz);
+}
+
+void GraphImageWriter::setInputs(const FileStamp &edges, const FileStamp &parts,
+                                 bool undirected) {
+    header.edgesStamp = edges;
+    header.partsStamp = parts;
+    header.undirected = undirected;
+}
+
+void GraphImageWriter::layout() {
+    unsigned long long off = alignUp(sizeof(GraphImageHeader));
+    for (unsigned i = 0; i < IMG_NUM_SECTIONS; ++i) {
+        header.sections[i].offset = off;
+        off = alignUp(off + header.sections[i].size);
+    }
+    header.totalSize = off;
+}
+
+unsigned long long GraphImageWriter::imageSize() {
+    layout();
+    return header.totalSize;
+}
+
+void GraphImageWriter::build(char *dst) {
+    layout();
+    memset(dst, 0, header.totalSize);
+    memcpy(dst, &header, sizeof(header));
+    for (unsigned i = 0; i < IMG_NUM_SECTIONS; ++i) {
+        if (header.sections[i].size > 0)
+            memcpy(dst + header.sections[i].offset, srcs[i], header.sections[i].size);
+    }
+}
+
+/**
+ *
+ * Write the image to `filename.tmp` and rename it into place, so a crash
+ * half way never leaves a truncated image behind to be mapped later.
+ *
+ */
+bool GraphImageWriter::save(const std::string &filename) {
+    layout();
+    std::string tmpFile = filename + ".tmp";
+    std::ofstream outfile(tmpFile.c_str(), std::ofstream::binary);
+    if (!outfile.good()) {
+        std::cout << "Cannot open output file:" << tmpFile << ", [Reason: " << std::strerror(errno) << "]" << std::endl;
+        return false;
+    }
+    static const char zeros[GRAPH_IMAGE_ALIGN] = { 0 };
+    outfile.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    unsigned long long pos = sizeof(header);
+    for (unsigned i = 0; i < IMG_NUM_SECTIONS; ++i) {
+        outfile.write(zeros, header.sections[i].offset - pos);
+        outfile.write(reinterpret_cast<const char *>(srcs[i]), header.sections[i].size);
+        pos = header.sections[i].offset + header.sections[i].size;
+    }
+    outfile.write(zeros, header.totalSize - pos);
+    outfile.close();
+    if (!outfile.good() || rename(tmpFile.c_str(), filename.c_str()) != 0) {
+        std::cout << "Failed to write graph image " << filename << ", [Reason: " << std::strerror(errno) << "]" << std::endl;
+        remove(tmpFile.c_str());
+        return false;
+    }
+    // set file permission to 777 to allow accesses from other users
+    chmod(filename.c_str(), S_IRWXU | S_IRWXG | S_IRWXO);
+    return true;
+}
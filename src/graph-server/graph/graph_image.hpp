@@ -0,0 +1,168 @@
+#ifndef __GRAPH_IMAGE_HPP__
+#define __GRAPH_IMAGE_HPP__
+
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "../utils/utils.hpp"
+
+
+template<typename T> class CSCMatrix;
+template<typename T> class CSRMatrix;
+
+
+/** Partition image format. Magic is "DGIM" when read as little endian bytes. */
+#define GRAPH_IMAGE_MAGIC 0x4d494744u
+#define GRAPH_IMAGE_VERSION 5
+#define GRAPH_IMAGE_ALIGN 64
+#define GRAPH_IMAGE_EXT ".img"
+
+
+/**
+ *
+ * Sections of a partition image, each a flat array starting on a
+ * GRAPH_IMAGE_ALIGN boundary. ID maps are stored as (sorted keys, values)
+ * pairs and ghost maps as (sorted boundary lvids, u64 ptrs, nids), i.e. the
+ * precomputed send lists of every boundary vertex.
+ *
+ * Hybrid cut partitions (see DataLoader) also carry their mirror sections:
+ * the hubs of this partition that other nodes send partial aggregates of,
+ * and the remote hubs this partition computes partial aggregates for.
+ *
+ */
+enum GraphImageSection {
+    IMG_LOCAL_TO_GLOBAL,        // unsigned[localVtxCnt]
+    IMG_GLOBAL_TO_LOCAL_KEYS,   // unsigned[localVtxCnt], sorted gvids
+    IMG_GLOBAL_TO_LOCAL_VALS,   // unsigned[localVtxCnt]
+    IMG_VTX_DATA,               // EdgeType[localVtxCnt]
+    IMG_SRC_GHOST_KEYS,         // unsigned[srcGhostCnt], sorted gvids
+    IMG_SRC_GHOST_VALS,         // unsigned[srcGhostCnt]
+    IMG_DST_GHOST_KEYS,         // unsigned[dstGhostCnt], sorted gvids
+    IMG_DST_GHOST_VALS,         // unsigned[dstGhostCnt]
+    IMG_FWD_DSTS_PTRS,          // u64[numNodes + 1]
+    IMG_FWD_DSTS,               // unsigned[], lvids sent to each node
+    IMG_BWD_DSTS_PTRS,
+    IMG_BWD_DSTS,
+    IMG_FWD_GHOST_KEYS,         // unsigned[boundary cnt], sorted lvids
+    IMG_FWD_GHOST_PTRS,         // u64[boundary cnt + 1]
+    IMG_FWD_GHOST_NIDS,         // unsigned[], receivers of each lvid
+    IMG_BWD_GHOST_KEYS,
+    IMG_BWD_GHOST_PTRS,
+    IMG_BWD_GHOST_NIDS,
+    IMG_CSC_PTRS,               // u64[localVtxCnt + 1]
+    IMG_CSC_IDXS,               // unsigned[localInEdgeCnt]
+    IMG_CSC_VALS,               // EdgeType[localInEdgeCnt]
+    IMG_CSR_PTRS,               // u64[localVtxCnt + 1]
+    IMG_CSR_IDXS,               // unsigned[localOutEdgeCnt]
+    IMG_CSR_VALS,               // EdgeType[localOutEdgeCnt]
+    IMG_MIRROR_GHOST_PTRS,      // u64[numNodes + 1]
+    IMG_MIRROR_GHOST_HUBS,      // unsigned[mirrorGhostCnt], hub lvids of each node
+    IMG_MIRROR_HUB_PTRS,        // u64[numNodes + 1]
+    IMG_MIRROR_HUBS,            // unsigned[mirrorHubCnt], hub gvids of each master
+    IMG_MIRROR_ADJ_PTRS,        // u64[mirrorHubCnt + 1]
+    IMG_MIRROR_ADJ_IDXS,        // unsigned[mirrorEdgeCnt], local src lvids
+    IMG_MIRROR_ADJ_VALS,        // EdgeType[mirrorEdgeCnt]
+    IMG_NUM_SECTIONS
+};
+
+struct GraphImageSectionEntry {
+    unsigned long long offset;
+    unsigned long long size;    // in bytes
+};
+
+struct GraphImageHeader {
+    unsigned magic;
+    unsigned version;
+    unsigned edgeTypeSize;
+    unsigned numNodes;
+    unsigned localVtxCnt;
+    unsigned globalVtxCnt;
+    unsigned srcGhostCnt;
+    unsigned dstGhostCnt;
+    unsigned long long localInEdgeCnt;
+    unsigned long long localOutEdgeCnt;
+    unsigned long long globalEdgeCnt;
+    unsigned hubThreshold;          // 0 for a plain edge cut
+    unsigned mirrorGhostCnt;        // partial rows received, after the src ghosts
+    unsigned mirrorHubCnt;          // remote hubs partially aggregated here
+    unsigned long long mirrorEdgeCnt;
+    unsigned undirected;
+    FileStamp edgesStamp;           // inputs the image was built from, all
+    FileStamp partsStamp;           // zeros if converted from the old format
+    unsigned long long totalSize;
+    GraphImageSectionEntry sections[IMG_NUM_SECTIONS];
+};
+
+
+/** Whether the file starts with a partition image header. */
+bool isGraphImage(const std::string &filename);
+
+/** Sanity check of an image: header against its size, sections against the counts. */
+bool validGraphImage(const char *image, unsigned long long size);
+
+
+/**
+ *
+ * Lays out a partition image. Derived sections (sorted ID maps, ghost send
+ * lists) are computed and owned by the writer; vertex and edge arrays are
+ * borrowed and must stay alive until the image has been built or saved.
+ *
+ */
+class GraphImageWriter {
+public:
+    GraphImageWriter();
+
+    void setVertices(unsigned localVtxCnt, unsigned globalVtxCnt,
+                     const unsigned *localToGlobal, const EdgeType *vtxData);
+    void setEdgeCounts(unsigned long long localInEdgeCnt,
+                       unsigned long long localOutEdgeCnt,
+                       unsigned long long globalEdgeCnt);
+    // (gvid, lvid) pairs of the src (FORWARD) or dst (BACKWARD) ghosts
+    void setGhostVtcs(PROP_TYPE dir,
+                      std::vector<std::pair<unsigned, unsigned>> &ghosts);
+    // lvids that have to be sent to each node
+    void setLocalVtxDsts(PROP_TYPE dir, unsigned numNodes,
+                         const std::vector<unsigned> *lists);
+    void setAdjs(const CSCMatrix<EdgeType> &csc, const CSRMatrix<EdgeType> &csr);
+    // Hybrid cut: hub lvids whose partial rows each node sends, hub gvids
+    // mirrored here grouped by master node, and the partial aggregation
+    // edges of those hubs (one column per mirrored hub)
+    void setMirrors(unsigned hubThreshold, unsigned numNodes,
+                    const std::vector<unsigned long long> &ghostPtrs,
+                    const std::vector<unsigned> &ghostHubs,
+                    const std::vector<unsigned long long> &hubPtrs,
+                    const std::vector<unsigned> &hubs,
+                    const CSCMatrix<EdgeType> &adj);
+    // Edges / partition files and options the image was preprocessed from
+    void setInputs(const FileStamp &edges, const FileStamp &parts, bool undirected);
+
+    unsigned long long imageSize();
+    void build(char *dst);
+    bool save(const std::string &filename);
+
+private:
+    void layout();
+    template<typename T>
+    void borrow(GraphImageSection sec, const T *ptr, unsigned long long cnt) {
+        srcs[sec] = ptr;
+        header.sections[sec].size = sizeof(T) * cnt;
+    }
+    template<typename T>
+    void own(GraphImageSection sec, std::vector<T> &vec) {
+        borrow(sec, vec.data(), vec.size());
+    }
+
+    GraphImageHeader header;
+    const void *srcs[IMG_NUM_SECTIONS];
+
+    std::vector<unsigned> g2lKeys, g2lVals;
+    std::vector<unsigned> ghostKeys[2], ghostVals[2];
+    std::vector<unsigned long long> dstsPtrs[2];
+    std::vector<unsigned> dsts[2];
+    std::vector<unsigned> ghostMapKeys[2], ghostMapNids[2];
+    std::vector<unsigned long long> ghostMapPtrs[2];
+};
+
+
+#endif //__GRAPH_IMAGE_HPP__
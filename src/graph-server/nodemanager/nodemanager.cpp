@@ -6,6 +6,7 @@
 #include <boost/algorithm/string/trim.hpp>
 #include "nodemanager.hpp"
 #include "../utils/utils.hpp"
+#include "../utils/trace.hpp"
 
 #include "../engine/engine.hpp"
 
@@ -119,6 +120,8 @@ void
 NodeManager::barrier() {
     if (standAlone) return;
 
+    // The exits of the barriers also align the traces of the nodes.
+    TraceScope trace("barrier", "sync");
     inBarrier = true;
     // printLog(me.id, "Hits on a global barrier |xxx|...");
 
@@ -165,6 +168,12 @@ inline bool NodeManager::parseNodeMsg(NodeMessage &nMsg) {
             engine->finishedNodeLock.unlock();
         }
         ret = true;
+    } else if (nMsg.messageType == CHUNKCNT) {
+        if (chunkCnts.size() != numNodes)
+            chunkCnts.assign(numNodes, 0);
+        chunkCnts[nMsg.id] = nMsg.info;
+        ++chunkCntsRecvd;
+        ret = true;
     }
     return ret;
 }
@@ -228,6 +237,28 @@ unsigned NodeManager::syncCurrEpoch(unsigned epoch) {
     return maxEpoch;
 }
 
+std::vector<unsigned> NodeManager::syncChunkCnts(unsigned chunkCnt) {
+    if (standAlone) return std::vector<unsigned>(1, chunkCnt);
+
+    zmq::message_t outMsg(sizeof(NodeMessage));
+    NodeMessage nMsg(CHUNKCNT, chunkCnt, me.id);
+    *((NodeMessage *) outMsg.data()) = nMsg;
+    nodePublisher->send(outMsg);
+
+    // Keep receiving messages until heard from all (including self).
+    zmq::message_t inMsg;
+    while (chunkCntsRecvd < numNodes) {
+        nodeSubscriber->recv(&inMsg);
+        NodeMessage nMsg = *((NodeMessage *) inMsg.data());
+        parseNodeMsg(nMsg);
+    }
+    chunkCntsRecvd = 0;
+
+    std::vector<unsigned> cnts;
+    cnts.swap(chunkCnts);
+    return cnts;
+}
+
 
 /**
  *
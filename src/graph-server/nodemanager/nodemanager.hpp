@@ -17,7 +17,7 @@ class Engine;
 /** Node message topic & contents. */
 #define NODE_MESSAGE_TOPIC 'N'
 enum NodeMessageType { NODENONE = -1, MASTERUP = -2, WORKERUP = -3, INITDONE = -4, BARRIER = -5,
-                       MINEPOCH = -6, MAXEPOCH = -7 };
+                       MINEPOCH = -6, MAXEPOCH = -7, CHUNKCNT = -8 };
 
 
 /** Structure of a node managing message. */
@@ -66,6 +66,9 @@ public:
     void readEpochUpdates();
     unsigned syncCurrEpoch(unsigned epoch);
 
+    // All-gather the number of chunks of every node (indexed by node id)
+    std::vector<unsigned> syncChunkCnts(unsigned chunkCnt);
+
     bool standAloneMode();
     Node& getNode(unsigned i);
     unsigned getNumNodes();
@@ -87,6 +90,10 @@ private:
     unsigned remaining;
     bool inBarrier = false;
 
+    // Chunk counts may arrive while we are still in a barrier
+    std::vector<unsigned> chunkCnts;
+    unsigned chunkCntsRecvd = 0;
+
     zmq::context_t nodeContext;
     zmq::socket_t *nodePublisher = NULL;
     zmq::socket_t *nodeSubscriber = NULL;
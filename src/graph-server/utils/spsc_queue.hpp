@@ -0,0 +1,77 @@
+#ifndef __SPSC_QUEUE_HPP__
+#define __SPSC_QUEUE_HPP__
+
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+
+/**
+ *
+ * Bounded lock-free queue between exactly one producer and one consumer
+ * thread. Elements are moved in and out of preallocated slots, so nothing is
+ * allocated on the way. The capacity is rounded up to a power of two.
+ *
+ */
+template <typename T>
+class SPSCQueue {
+public:
+    explicit SPSCQueue(size_t capacity = 1024) {
+        size_t cap = 1;
+        while (cap < capacity)
+            cap <<= 1;
+        slots.resize(cap);
+        mask = cap - 1;
+    }
+
+    // Producer side. False if the queue is full.
+    bool tryPush(T &&elem) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - headCache > mask) {
+            headCache = head.load(std::memory_order_acquire);
+            if (t - headCache > mask)
+                return false;
+        }
+        slots[t & mask] = std::move(elem);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. False if the queue is empty.
+    bool tryPop(T &elem) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tailCache) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (h == tailCache)
+                return false;
+        }
+        elem = std::move(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) -
+               head.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+
+    // Consumer and producer fields on separate cache lines. Padded rather
+    // than aligned, so the queue can be allocated with plain new.
+    char pad0[64];
+    std::atomic<size_t> head{0};    // Next slot to pop.
+    size_t tailCache = 0;           // Consumer's view of tail.
+    char pad1[64];
+    std::atomic<size_t> tail{0};    // Next slot to push.
+    size_t headCache = 0;           // Producer's view of head.
+    char pad2[64];
+};
+
+
+#endif //__SPSC_QUEUE_HPP__
@@ -0,0 +1,148 @@
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include "trace.hpp"
+
+
+std::atomic<bool> Tracer::on(false);
+unsigned Tracer::nodeId = 0;
+std::string Tracer::file;
+
+static std::mutex buffersMtx;
+static std::vector<void *> buffers;     // Tracer::Buffer *, in registration order.
+static thread_local void *myBuffer = NULL;
+
+
+/**
+ *
+ * Enable tracing on this node.
+ *
+ */
+void
+Tracer::init(unsigned nodeId_, const std::string &file_) {
+    nodeId = nodeId_;
+    file = file_;
+    on = true;
+    printLog(nodeId, "Tracing chunks to %s", file.c_str());
+}
+
+
+unsigned long long
+Tracer::now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+
+/**
+ *
+ * Get the calling thread's buffer, registering it on first use.
+ *
+ */
+Tracer::Buffer &
+Tracer::buffer() {
+    if (myBuffer == NULL) {
+        Buffer *buf = new Buffer();
+        buf->events.reserve(1 << 14);
+        std::lock_guard<std::mutex> lk(buffersMtx);
+        buffers.push_back(buf);
+        myBuffer = buf;
+    }
+    return *((Buffer *) myBuffer);
+}
+
+
+void
+Tracer::record(const TraceEvent &event) {
+    buffer().events.push_back(event);
+}
+
+
+void
+Tracer::setThreadName(const char *name) {
+    if (!on) return;
+    buffer().threadName = name;
+}
+
+
+void
+Tracer::instant(const char *name, const char *cat, const Chunk &chunk) {
+    if (!on) return;
+    record(TraceEvent { name, cat, 'i', now(), 0, true, chunk });
+}
+
+
+void
+Tracer::complete(const char *name, const char *cat, const Chunk &chunk,
+                 unsigned long long stt, unsigned long long end) {
+    if (!on) return;
+    record(TraceEvent { name, cat, 'X', stt, end - stt, true, chunk });
+}
+
+
+void
+Tracer::complete(const char *name, const char *cat,
+                 unsigned long long stt, unsigned long long end) {
+    if (!on) return;
+    record(TraceEvent { name, cat, 'X', stt, end - stt, false, Chunk() });
+}
+
+
+/**
+ *
+ * Write all the buffers as one Chrome trace-event JSON file. pid is the node
+ * id and tid the registration order of the threads.
+ *
+ */
+void
+Tracer::dump() {
+    if (!on.exchange(false)) return;
+
+    std::ofstream out(file.c_str());
+    if (!out.good()) {
+        printLog(nodeId, "Cannot open trace file %s [Reason: %s]",
+                 file.c_str(), std::strerror(errno));
+        return;
+    }
+
+    std::lock_guard<std::mutex> lk(buffersMtx);
+    unsigned long long numEvents = 0;
+    out << "{\"otherData\":{\"nodeId\":" << nodeId << "},\n\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << nodeId
+        << ",\"args\":{\"name\":\"node " << nodeId << "\"}}";
+    for (unsigned tid = 0; tid < buffers.size(); ++tid) {
+        Buffer *buf = (Buffer *) buffers[tid];
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << nodeId
+            << ",\"tid\":" << tid << ",\"args\":{\"name\":\""
+            << (buf->threadName ? buf->threadName : "thread") << " " << tid
+            << "\"}}";
+        for (TraceEvent &e : buf->events) {
+            out << ",\n{\"name\":\"" << e.name << "\",\"cat\":\"" << e.cat
+                << "\",\"ph\":\"" << e.phase << "\",\"pid\":" << nodeId
+                << ",\"tid\":" << tid << ",\"ts\":" << e.ts;
+            if (e.phase == 'X')
+                out << ",\"dur\":" << e.dur;
+            else
+                out << ",\"s\":\"t\"";
+            if (e.hasChunk) {
+                const Chunk &c = e.chunk;
+                out << ",\"args\":{\"chunk\":" << c.localId
+                    << ",\"globalId\":" << c.globalId
+                    << ",\"epoch\":" << c.epoch
+                    << ",\"layer\":" << c.layer
+                    << ",\"dir\":\""
+                    << (c.dir == PROP_TYPE::FORWARD ? "F" : "B")
+                    << "\",\"vertex\":" << (c.vertex ? "true" : "false")
+                    << "}";
+            }
+            out << "}";
+        }
+        numEvents += buf->events.size();
+        delete buf;
+    }
+    out << "\n]}\n";
+    buffers.clear();
+
+    printLog(nodeId, "Dumped %llu trace events to %s", numEvents, file.c_str());
+}
@@ -0,0 +1,97 @@
+#ifndef __TRACE_HPP__
+#define __TRACE_HPP__
+
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "utils.hpp"
+
+
+/**
+ *
+ * Chunk lifecycle tracer, written out in Chrome trace-event format.
+ *
+ * Every thread appends to its own buffer, so recording an event takes neither
+ * a lock nor an atomic operation. A buffer is registered (under a lock) the
+ * first time its thread records something. dump() must only be called after
+ * all the recording threads have been joined.
+ *
+ * Timestamps are wall-clock microseconds, so traces of different nodes can be
+ * merged; `miscs/trace/merge-traces.py` refines the alignment with the exits
+ * of the global barriers.
+ *
+ * Event names and categories must be string literals (only the pointers are
+ * stored).
+ *
+ */
+struct TraceEvent {
+    const char *name;
+    const char *cat;
+    char phase;                 // 'X' complete, 'i' instant.
+    unsigned long long ts;      // us.
+    unsigned long long dur;     // us, only for 'X'.
+    bool hasChunk;
+    Chunk chunk;
+};
+
+class Tracer {
+public:
+    // Enable tracing, events are written to `file` by dump().
+    static void init(unsigned nodeId, const std::string &file);
+    static bool enabled() { return on.load(std::memory_order_relaxed); };
+
+    static unsigned long long now();
+    static void setThreadName(const char *name);
+
+    static void instant(const char *name, const char *cat, const Chunk &chunk);
+    static void complete(const char *name, const char *cat, const Chunk &chunk,
+                         unsigned long long stt, unsigned long long end);
+    static void complete(const char *name, const char *cat,
+                         unsigned long long stt, unsigned long long end);
+
+    static void dump();
+
+private:
+    struct Buffer {
+        const char *threadName = NULL;
+        std::vector<TraceEvent> events;
+    };
+
+    static Buffer &buffer();
+    static void record(const TraceEvent &event);
+
+    static std::atomic<bool> on;
+    static unsigned nodeId;
+    static std::string file;
+};
+
+
+/** Records a complete event for the lifetime of the scope. */
+class TraceScope {
+public:
+    TraceScope(const char *name_, const char *cat_, const Chunk &chunk_)
+        : name(name_), cat(cat_), hasChunk(true), chunk(chunk_),
+          stt(Tracer::enabled() ? Tracer::now() : 0) {};
+    TraceScope(const char *name_, const char *cat_)
+        : name(name_), cat(cat_), hasChunk(false), chunk(),
+          stt(Tracer::enabled() ? Tracer::now() : 0) {};
+    ~TraceScope() {
+        if (!Tracer::enabled()) return;
+        if (hasChunk)
+            Tracer::complete(name, cat, chunk, stt, Tracer::now());
+        else
+            Tracer::complete(name, cat, stt, Tracer::now());
+    };
+
+private:
+    const char *name;
+    const char *cat;
+    bool hasChunk;
+    Chunk chunk;
+    unsigned long long stt;
+};
+
+
+#endif //__TRACE_HPP__
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <cstring>
 #include <cassert>
@@ -67,3 +68,18 @@ getPrIP(std::string& myPrIpFile, std::string& ip) {
 
     ipFile.close();
 }
+
+/**
+ *
+ * Get the size and mtime of a file.
+ *
+ */
+FileStamp getFileStamp(const std::string &filename) {
+    FileStamp stamp = { 0, 0 };
+    struct stat st;
+    if (stat(filename.c_str(), &st) == 0) {
+        stamp.size = st.st_size;
+        stamp.mtime = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    }
+    return stamp;
+}
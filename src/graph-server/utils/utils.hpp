@@ -23,9 +23,6 @@
                                 // From 0 to numGlobalVertices are normal ghost vertices update message,
                                 // From MAX_IDTYPE downto MAX_IDTYPE - numGlobalVertices are receive signals.
 
-typedef std::priority_queue< Chunk > ChunkQueue;
-
-
 /** Print to log file using this one. */
 void printLog(const unsigned nodeId, const char *format, ...);
 
@@ -37,4 +34,25 @@ std::time_t getCurrentTime();
 
 void getPrIP(std::string& myPrIpFile, std::string& ip);
 
+
+/**
+ *
+ * Size and mtime of an input file, recorded in the caches built from it
+ * (partition images, feature / label shards). Copies that keep mtimes
+ * (rsync -a, cp -p) keep their caches valid; other copies only cost a
+ * rebuild.
+ *
+ */
+struct FileStamp {
+    unsigned long long size;
+    long long mtime;                // ns since the epoch
+};
+inline bool operator==(const FileStamp &a, const FileStamp &b) {
+    return a.size == b.size && a.mtime == b.mtime;
+}
+inline bool operator!=(const FileStamp &a, const FileStamp &b) { return !(a == b); }
+
+/** Stamp of a file, all zeros if it cannot be stat'ed. */
+FileStamp getFileStamp(const std::string &filename);
+
 #endif //__GRAPH_UTILS_HPP__
@@ -0,0 +1,173 @@
+#ifndef __VID_MAP_HPP__
+#define __VID_MAP_HPP__
+
+
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+
+/**
+ *
+ * Map from a vertex ID to a value, replacing std::map<unsigned, V> (~48
+ * bytes and a few cache misses per entry) on the preprocessing paths.
+ *
+ * Entries live in a deque in insertion order, so references to values stay
+ * valid across inserts and values are never moved. The index from ID to entry is either
+ *   - dense: one unsigned per ID of the universe, when the universe is at
+ *     most DENSE_RATIO times the expected number of entries, or
+ *   - hashed: open addressing with linear probing over (key, entry) slots,
+ *     kept at most half full.
+ *
+ * Iteration follows insertion order, not key order.
+ *
+ */
+template <typename V>
+class VidMap {
+public:
+    struct Entry {
+        unsigned first;
+        V second;
+    };
+    typedef typename std::deque<Entry>::iterator iterator;
+    typedef typename std::deque<Entry>::const_iterator const_iterator;
+
+    static const unsigned DENSE_RATIO = 4;
+
+    VidMap() : dense(false), mask(0), shift(32) {}
+
+    // Pick the index layout. `universe` is the exclusive upper bound of the
+    // keys, 0 if unknown.
+    void reserve(size_t expected, size_t universe = 0) {
+        assert(entries.empty());
+        dense = universe > 0 && universe <= DENSE_RATIO * expected;
+        if (dense) {
+            denseIdx.assign(universe, EMPTY);
+            slots.clear();
+        } else {
+            rehash(expected);
+        }
+    }
+
+    bool isDense() const { return dense; }
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    void clear() {
+        entries.clear();
+        if (dense)
+            denseIdx.assign(denseIdx.size(), EMPTY);
+        else
+            slots.assign(slots.size(), Slot { EMPTY, EMPTY });
+    }
+
+    iterator begin() { return entries.begin(); }
+    iterator end() { return entries.end(); }
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+
+    iterator find(unsigned key) {
+        unsigned idx = lookup(key);
+        return idx == EMPTY ? entries.end() : entries.begin() + idx;
+    }
+    const_iterator find(unsigned key) const {
+        unsigned idx = lookup(key);
+        return idx == EMPTY ? entries.end() : entries.begin() + idx;
+    }
+    size_t count(unsigned key) const { return lookup(key) == EMPTY ? 0 : 1; }
+
+    // Value of `key`, default constructed in place if absent.
+    V &operator[](unsigned key) {
+        unsigned idx = lookup(key);
+        if (idx == EMPTY)
+            idx = insert(key);
+        return entries[idx].second;
+    }
+
+    // Bytes of the index, for the benchmarks.
+    size_t indexBytes() const {
+        return dense ? denseIdx.size() * sizeof(unsigned) : slots.size() * sizeof(Slot);
+    }
+
+private:
+    static const unsigned EMPTY = UINT_MAX;
+
+    struct Slot {
+        unsigned key;
+        unsigned idx;
+    };
+
+    // Home slot of a key. Fibonacci hashing, taking the high bits of the
+    // product: the low bits of consecutive IDs (the common case) cycle with
+    // a short period.
+    size_t home(unsigned key) const {
+        return (unsigned)(key * 2654435769u) >> shift;
+    }
+
+    unsigned lookup(unsigned key) const {
+        if (dense)
+            return key < denseIdx.size() ? denseIdx[key] : EMPTY;
+        if (slots.empty())
+            return EMPTY;
+        for (size_t i = home(key); ; i = (i + 1) & mask) {
+            if (slots[i].key == key)
+                return slots[i].idx;
+            if (slots[i].idx == EMPTY)
+                return EMPTY;
+        }
+    }
+
+    unsigned insert(unsigned key) {
+        unsigned idx = entries.size();
+        assert(idx != EMPTY);
+        if (dense) {
+            if (key >= denseIdx.size())
+                denseIdx.resize(key + 1, EMPTY);
+            denseIdx[key] = idx;
+        } else {
+            if (2 * (entries.size() + 1) > slots.size())
+                rehash(entries.size() + 1);
+            place(key, idx);
+        }
+        entries.emplace_back();
+        entries.back().first = key;
+        return idx;
+    }
+
+    void place(unsigned key, unsigned idx) {
+        size_t i = home(key);
+        while (slots[i].idx != EMPTY)
+            i = (i + 1) & mask;
+        slots[i] = Slot { key, idx };
+    }
+
+    // Grow the table to hold `cnt` entries at a load factor below 1/2.
+    void rehash(size_t cnt) {
+        size_t cap = 16;
+        while (cap < 2 * cnt)
+            cap <<= 1;
+        if (cap <= slots.size())
+            return;
+        slots.assign(cap, Slot { EMPTY, EMPTY });
+        mask = cap - 1;
+        shift = 32;
+        for (size_t c = cap; c > 1; c >>= 1)
+            --shift;
+        for (size_t i = 0; i < entries.size(); ++i)
+            place(entries[i].first, i);
+    }
+
+    bool dense;
+    size_t mask;
+    unsigned shift;             // 32 - log2(slots.size())
+    std::deque<Entry> entries;
+    std::vector<unsigned> denseIdx;
+    std::vector<Slot> slots;
+};
+
+template <typename V> const unsigned VidMap<V>::DENSE_RATIO;
+template <typename V> const unsigned VidMap<V>::EMPTY;
+
+
+#endif // __VID_MAP_HPP__
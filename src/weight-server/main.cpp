@@ -24,6 +24,8 @@ main(int argc, char *argv[]) {
     std::string gnn_name = std::string(argv[12]);
     float learning_rate = std::atof(argv[13]);
     float switch_threshold = std::atof(argv[14]);
+    // Lossless compression of the update broadcasts [none|lz4|zstd|auto]
+    std::string compression = argc > 15 ? argv[15] : "none";
 
     GNN gnn_type;
     if (gnn_name == "GCN") { // GCN or GAT
@@ -40,7 +42,7 @@ main(int argc, char *argv[]) {
                     configFile, tmpFile,
                     sync, targetAcc, block,
                     gnn_type,
-                    learning_rate, switch_threshold);
+                    learning_rate, switch_threshold, compression);
 
     // Run in a detached thread because so that we can wait
     // on a condition variable.
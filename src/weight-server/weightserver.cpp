@@ -10,7 +10,8 @@ WeightServer::WeightServer(std::string &wserverFile, std::string &myPrIpFile, st
                            unsigned _listenerPort, unsigned _serverPort, unsigned _gport,
                            std::string &configFile, std::string &tmpFile,
                            bool _sync, float _targetAcc, bool block, GNN _gnn_type,
-                           float _learning_rate, float _switch_threshold)
+                           float _learning_rate, float _switch_threshold,
+                           const std::string &compression)
     : ctx(1), frontend(ctx, ZMQ_ROUTER), backend(ctx, ZMQ_DEALER), // gsocket(ctx, ZMQ_DEALER),
       listenerPort(_listenerPort), serverPort(_serverPort), gport(_gport),
       dataCtx(1), publisher(dataCtx, ZMQ_PUB), subscriber(dataCtx, ZMQ_SUB),
@@ -18,6 +19,11 @@ WeightServer::WeightServer(std::string &wserverFile, std::string &myPrIpFile, st
       sync(_sync), targetAcc(_targetAcc), BLOCK(block), gnn_type(_gnn_type),
       learning_rate(_learning_rate), switch_threshold(_switch_threshold) {
 
+    if (!updCompressor.init(compression)) {
+        std::cerr << "Unsupported compression '" << compression << "'" << std::endl;
+        exit(-1);
+    }
+
     std::vector<std::string> allNodeIps =
         parseNodeConfig(configFile, wserverFile, myPrIpFile, gserverFile);
     setupSockets();
@@ -32,6 +38,8 @@ WeightServer::WeightServer(std::string &wserverFile, std::string &myPrIpFile, st
 }
 
 WeightServer::~WeightServer() {
+    if (updCompressor.enabled())
+        serverLog("Weight updates " + updCompressor.report());
     freeAdamOpt();
     stopWorkers();
     freeWeights();
@@ -98,10 +106,20 @@ void WeightServer::applyUpdate(unsigned layer, std::string& name) {
 
     zmq::message_t header(UPD_HEADER_SIZE);
     fillHeader(header, -1, CTRL_MSG::DATA);
-    zmq::message_t describer(TENSOR_NAME_SIZE + sizeof(unsigned));
-    fillTensorDescriber(describer, name, layer);
-    zmq::message_t updateDataMsg(updateMat.getDataSize());
-    std::memcpy(updateDataMsg.data(), updateMat.getData(), updateMat.getDataSize());
+    size_t updSize = updateMat.getDataSize();
+    std::vector<char> frame;
+    size_t frameSize = 0;
+    if (updCompressor.enabled()) {
+        frame.resize(compressFrameBound(updSize));
+        frameSize = updCompressor.compress((char *)updateMat.getData(), updSize,
+                                           frame.data(), frame.size());
+    }
+    zmq::message_t describer(TENSOR_NAME_SIZE + sizeof(unsigned) * 2);
+    fillTensorDescriber(describer, name, layer, frameSize > 0);
+    zmq::message_t updateDataMsg(frameSize > 0 ? frameSize : updSize);
+    std::memcpy(updateDataMsg.data(),
+                frameSize > 0 ? frame.data() : (char *)updateMat.getData(),
+                updateDataMsg.size());
     pubMtx.lock();
     publisher.send(header, ZMQ_SNDMORE);
     publisher.send(describer, ZMQ_SNDMORE);
@@ -147,9 +165,35 @@ void WeightServer::receiver() {
 
             std::string name;
             unsigned layer;
-            parseTensorDescriber(describer, name, layer);
+            bool framed;
+            parseTensorDescriber(describer, name, layer, framed);
 
+            // Dropping a bad update would leave the sync update waiting forever
+            if (layer >= weightsStore.size() || weightsStore[layer].count(name) == 0) {
+                serverLog("Update of unknown weight " + name);
+                exit(-1);
+            }
+            const size_t updSize = weightsStore[layer][name].localUpdMat.getNumElemts();
             FeatType *updateData = (FeatType *)updMsg.data();
+            std::vector<FeatType> rawUpdate;
+            if (framed) {
+                // Check the size read off the wire before allocating for it
+                const char *frame = (const char *)updMsg.data();
+                if (updMsg.size() < COMPRESS_FRAME_HDR ||
+                    framedRawSize(frame) != updSize * sizeof(FeatType)) {
+                    serverLog("Corrupt compressed update of " + name);
+                    exit(-1);
+                }
+                rawUpdate.resize(updSize);
+                if (!decompressFrame(frame, updMsg.size(), (char *)rawUpdate.data())) {
+                    serverLog("Corrupt compressed update of " + name);
+                    exit(-1);
+                }
+                updateData = rawUpdate.data();
+            } else if (updMsg.size() != updSize * sizeof(FeatType)) {
+                serverLog("Update of " + name + " has a wrong size");
+                exit(-1);
+            }
             std::string checkInfo("");
             if (sync) {
                 unsigned ghostUpdCnt = weightsStore[layer][name].ghostUpdate(updateData);
@@ -858,6 +902,9 @@ void WeightServer::setLocalUpdTot(unsigned localUpdTot) {
     numLambdas = localUpdTot;
     for (auto &wtm : weightsStore) {
         for (auto &kv : wtm) {
+            // Chunk count changes between epochs when graph servers re-chunk.
+            // Old chunk ids are never seen again.
+            kv.second.clearChunks();
             kv.second.setLocalUpdTot(localUpdTot);
         }
     }
@@ -893,18 +940,24 @@ void WeightServer::parseHeader(zmq::message_t &header, unsigned &sender, unsigne
     topic = *(unsigned *)msgPtr;
 }
 
-void WeightServer::fillTensorDescriber(zmq::message_t &td, std::string &name, unsigned layer) {
+void WeightServer::fillTensorDescriber(zmq::message_t &td, std::string &name, unsigned layer,
+                                       bool framed) {
     char *msgPtr = (char *)td.data();
     sprintf(msgPtr, "%s", name.c_str());
     msgPtr += TENSOR_NAME_SIZE;
     *(unsigned *)msgPtr = layer;
+    msgPtr += sizeof(unsigned);
+    *(unsigned *)msgPtr = framed;
 }
 
-void WeightServer::parseTensorDescriber(zmq::message_t &td, std::string &name, unsigned &layer) {
+void WeightServer::parseTensorDescriber(zmq::message_t &td, std::string &name, unsigned &layer,
+                                        bool &framed) {
     char *msgPtr = (char *)td.data();
     name = std::string(msgPtr);
     msgPtr += TENSOR_NAME_SIZE;
     layer = *(unsigned *)msgPtr;
+    msgPtr += sizeof(unsigned);
+    framed = td.size() >= TENSOR_NAME_SIZE + sizeof(unsigned) * 2 && *(unsigned *)msgPtr;
 }
 
 void WeightServer::pushoutMsg(zmq::message_t &msg) {
@@ -25,6 +25,7 @@
 #include "weighttensor.hpp"
 #include "../common/matrix.hpp"
 #include "../common/utils.hpp"
+#include "../common/compress.hpp"
 
 
 #define NUM_LISTENERS 6
@@ -52,7 +53,8 @@ public:
                  unsigned _listenerPort, unsigned _serverPort, unsigned _gport,
                  std::string &configFile, std::string &tmpFile,
                  bool _sync, float _targetAcc, bool block, GNN _gnn_type,
-                 float _learning_rate=0.01, float _switch_threshold=0.02);
+                 float _learning_rate=0.01, float _switch_threshold=0.02,
+                 const std::string &compression="none");
     ~WeightServer();
 
     GNN gnn_type;
@@ -64,6 +66,8 @@ public:
     void lrDecay();
 
     void applyUpdate(unsigned layer, std::string& name);
+    // Update broadcasts to the other weight servers (see common/compress.hpp)
+    PayloadCompressor updCompressor;
 
     void receiver();
     std::thread *recvThd;
@@ -144,8 +148,11 @@ public:
     void closeSockets();
     void fillHeader(zmq::message_t &header, unsigned receiver, unsigned topic);
     void parseHeader(zmq::message_t &header, unsigned &sender, unsigned &topic);
-    void fillTensorDescriber(zmq::message_t &td, std::string &name, unsigned layer);
-    void parseTensorDescriber(zmq::message_t &td, std::string &name, unsigned &layer);
+    // Describer: [name][layer][1 if the data is a compressed frame]
+    void fillTensorDescriber(zmq::message_t &td, std::string &name, unsigned layer,
+                             bool framed = false);
+    void parseTensorDescriber(zmq::message_t &td, std::string &name, unsigned &layer,
+                              bool &framed);
     void pushoutMsg(zmq::message_t &msg);
     void pushoutMsgs(std::vector<zmq::message_t *> &msgs);
     zmq::context_t ctx;
@@ -122,6 +122,25 @@ void WeightTensor::decRef(Chunk &chunk) {
     }
 }
 
+void WeightTensor::clearChunks() {
+    std::lock_guard<std::mutex> lg(*wmtx);
+
+    if (!chunk2Ver.empty()) {
+        std::cerr << "drop " << chunk2Ver.size() << " stale chunks of "
+                  << currMat().name() << std::endl;
+    }
+    for (auto &kv : chunk2Ver) {
+        unsigned ver = kv.second;
+        RefMat &rmat = ver2Mat[ver];
+        rmat.refCnt--;
+        if (ver < currVer && rmat.refCnt == 0) {
+            rmat.mat.free();
+            ver2Mat.erase(ver);
+        }
+    }
+    chunk2Ver.clear();
+}
+
 void WeightTensor::stopUpdate() {
     std::lock_guard<std::mutex> lgw(*wmtx);
     std::lock_guard<std::mutex> lgu(*umtx);
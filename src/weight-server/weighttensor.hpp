@@ -35,6 +35,8 @@ struct WeightTensor {
     Matrix& updateVersion(bool withLock = true);
     Matrix& getMat(Chunk &chunk);
     void decRef(Chunk &chunk);
+    // Drop references of chunks that will never push back (e.g. re-chunking)
+    void clearChunks();
 
     void stopUpdate();
 